@@ -61,6 +61,15 @@ volatile unsigned char vUARTIntTxBuffer[TX_BUFFER_SIZE];
 volatile unsigned char vUARTIntTxBufDataCnt;
 volatile unsigned char vUARTIntTxBufWrPtr;
 volatile unsigned char vUARTIntTxBufRdPtr;
+volatile struct txseg vUARTIntTxSeg[TX_SEGMENTS];
+volatile unsigned char vUARTIntTxSegCnt;
+volatile unsigned char vUARTIntTxSegWrPtr;
+volatile unsigned char vUARTIntTxSegRdPtr;
+// TX ISR base64 encoder state: current 3 byte group
+volatile unsigned char vUARTIntTxB64[3];
+volatile unsigned char vUARTIntTxB64Len;
+volatile unsigned char vUARTIntTxB64Pos;
+extern const rom unsigned char cb64[];
 #endif
 
 #if	RXON
@@ -92,6 +101,10 @@ void UARTIntInit(void)
 		vUARTIntTxBufDataCnt = 0;
 		vUARTIntTxBufWrPtr = 0;
 		vUARTIntTxBufRdPtr = 0;
+		vUARTIntTxSegCnt = 0;
+		vUARTIntTxSegWrPtr = 0;
+		vUARTIntTxSegRdPtr = 0;
+		vUARTIntTxB64Pos = 0;
 	#endif
 	#if	RXON
 		vUARTIntStatus.UARTIntRxBufferFull = 0;
@@ -160,6 +173,59 @@ void UARTIntInit(void)
 	#endif
 }
 
+#if	TXON
+/*********************************************************************
+ * Transmit queue helpers, to be called with TXIE disabled:
+ *	UARTIntTxBufPut() appends a byte to the transmit buffer (caller
+ *	checks UARTIntTxBufferFull), UARTIntTxSegAdd() returns the last
+ *	segment if new data of that type can be appended to it, else
+ *	starts a new segment (0 = segment queue full).
+ ********************************************************************/
+static void UARTIntTxBufPut(unsigned char chCharData)
+{
+	vUARTIntTxBuffer[vUARTIntTxBufWrPtr] = chCharData;
+	vUARTIntTxBufDataCnt ++;
+	if(vUARTIntTxBufDataCnt == TX_BUFFER_SIZE)
+	vUARTIntStatus.UARTIntTxBufferFull = 1;
+	vUARTIntTxBufWrPtr++;	
+	if(vUARTIntTxBufWrPtr == TX_BUFFER_SIZE)
+		vUARTIntTxBufWrPtr = 0;								
+}
+
+// ISR side: remove a byte from the transmit buffer
+#define UARTIntTxBufGet() \
+	{ \
+		vUARTIntStatus.UARTIntTxBufferFull = 0; \
+		vUARTIntTxBufDataCnt--; \
+		vUARTIntTxBufRdPtr++; \
+		if(vUARTIntTxBufRdPtr == TX_BUFFER_SIZE) \
+			vUARTIntTxBufRdPtr = 0; \
+	}
+
+static volatile struct txseg *UARTIntTxSegAdd(unsigned char type)
+{
+	volatile struct txseg *seg;
+
+	if(vUARTIntTxSegCnt && type != UARTINTC_SEG_ROM)
+	{
+		seg = &vUARTIntTxSeg[vUARTIntTxSegWrPtr ? vUARTIntTxSegWrPtr-1 : TX_SEGMENTS-1];
+		if(seg->type == type)
+			return seg;
+	}
+	if(vUARTIntTxSegCnt == TX_SEGMENTS)
+		return 0;
+	seg = &vUARTIntTxSeg[vUARTIntTxSegWrPtr];
+	seg->type = type;
+	seg->len = 0;
+	vUARTIntTxSegCnt++;
+	vUARTIntTxSegWrPtr++;
+	if(vUARTIntTxSegWrPtr == TX_SEGMENTS)
+		vUARTIntTxSegWrPtr = 0;
+	vUARTIntStatus.UARTIntTxBufferEmpty = 0;
+	return seg;
+}
+#endif
+
 /*********************************************************************
  * Function:        	unsigned char UARTIntPutChar(unsigned char)
  * PreCondition:    	UARTIntInit()function should have been called.
@@ -183,6 +249,8 @@ void UARTIntInit(void)
 #if	TXON
 unsigned char UARTIntPutChar(unsigned char chCharData)
 {
+	volatile struct txseg *seg;
+
 	/* check if its full , if not add one */
 	/* if not busy send data */
 	
@@ -191,19 +259,135 @@ unsigned char UARTIntPutChar(unsigned char chCharData)
    
     //critical code	, disable interrupts
 	PIE1bits.TXIE = 0;	
-	vUARTIntTxBuffer[vUARTIntTxBufWrPtr] = chCharData;
-	vUARTIntStatus.UARTIntTxBufferEmpty = 0;
-	vUARTIntTxBufDataCnt ++;
-	if(vUARTIntTxBufDataCnt == TX_BUFFER_SIZE)
-	vUARTIntStatus.UARTIntTxBufferFull = 1;
-	vUARTIntTxBufWrPtr++;	
-	if(vUARTIntTxBufWrPtr == TX_BUFFER_SIZE)
-		vUARTIntTxBufWrPtr = 0;								
+	seg = UARTIntTxSegAdd(UARTINTC_SEG_RAM);
+	if(seg == 0)
+	{
+		PIE1bits.TXIE = 1;
+		return 0;
+	}
+	UARTIntTxBufPut(chCharData);
+	seg->len++;
 	PIE1bits.TXIE = 1;	
 	
 	return 1;
 }
 
+/*********************************************************************
+ * Function:        	unsigned char UARTIntPutRom(const rom char *)
+ * PreCondition:    	UARTIntInit()function should have been called.
+ * Input:           	const rom char *
+ * Output:          	unsigned char
+ *							  1 - string has been queued.
+ *							  0 - segment queue is full.
+ * Side Effects:    	None
+ * Overview:        	Queues a zero terminated ROM string as one
+ *						segment. The string is not copied, the TX ISR
+ *						reads it from ROM.
+ ********************************************************************/
+unsigned char UARTIntPutRom(const rom char *chData)
+{
+	volatile struct txseg *seg;
+
+	if(*chData == 0)
+		return 1;
+
+	PIE1bits.TXIE = 0;
+	seg = UARTIntTxSegAdd(UARTINTC_SEG_ROM);
+	if(seg == 0)
+	{
+		PIE1bits.TXIE = 1;
+		return 0;
+	}
+	seg->str = chData;
+	PIE1bits.TXIE = 1;
+
+	return 1;
+}
+
+/*********************************************************************
+ * Function:        	unsigned char UARTIntPutRam(const char *)
+ * PreCondition:    	UARTIntInit()function should have been called.
+ * Input:           	const char *
+ * Output:          	unsigned char
+ *							  number - bytes copied to the transmit
+ *								  buffer (0 = buffer or queue full).
+ * Side Effects:    	None
+ * Overview:        	Copies as much of a zero terminated RAM string
+ *						to the transmit buffer as fits, appending to
+ *						the last RAM segment if possible.
+ ********************************************************************/
+unsigned char UARTIntPutRam(const char *chData)
+{
+	volatile struct txseg *seg;
+	unsigned char cnt = 0;
+
+	if(vUARTIntStatus.UARTIntTxBufferFull || *chData == 0)
+		return 0;
+
+	PIE1bits.TXIE = 0;
+	seg = UARTIntTxSegAdd(UARTINTC_SEG_RAM);
+	if(seg != 0)
+	{
+		while(*chData && !vUARTIntStatus.UARTIntTxBufferFull)
+		{
+			UARTIntTxBufPut(*chData++);
+			seg->len++;
+			cnt++;
+		}
+	}
+	PIE1bits.TXIE = 1;
+
+	return cnt;
+}
+
+/*********************************************************************
+ * Function:        	unsigned char UARTIntPutB64(unsigned char)
+ * PreCondition:    	UARTIntInit()function should have been called.
+ * Input:           	unsigned char
+ * Output:          	unsigned char
+ *							  1 - byte has been queued.
+ *							  0 - buffer or segment queue is full.
+ * Side Effects:    	None
+ * Overview:        	Adds a raw byte to the open base64 segment
+ *						(starting one if necessary). The TX ISR sends
+ *						complete 3 byte groups as 4 characters while
+ *						the segment is open, UARTIntPutB64End() closes
+ *						it and lets the ISR send the padded remainder.
+ ********************************************************************/
+unsigned char UARTIntPutB64(unsigned char chData)
+{
+	volatile struct txseg *seg;
+
+	if(vUARTIntStatus.UARTIntTxBufferFull)
+		return 0;
+
+	PIE1bits.TXIE = 0;
+	seg = UARTIntTxSegAdd(UARTINTC_SEG_B64|UARTINTC_SEG_OPEN);
+	if(seg == 0)
+	{
+		PIE1bits.TXIE = 1;
+		return 0;
+	}
+	UARTIntTxBufPut(chData);
+	seg->len++;
+	PIE1bits.TXIE = 1;
+
+	return 1;
+}
+
+void UARTIntPutB64End(void)
+{
+	volatile struct txseg *seg;
+
+	PIE1bits.TXIE = 0;
+	if(vUARTIntTxSegCnt)
+	{
+		seg = &vUARTIntTxSeg[vUARTIntTxSegWrPtr ? vUARTIntTxSegWrPtr-1 : TX_SEGMENTS-1];
+		seg->type &= ~UARTINTC_SEG_OPEN;
+	}
+	PIE1bits.TXIE = 1;
+}
+
 /*********************************************************************
  * Function:          unsigned char UARTIntGetTxBufferEmptySpace(void)
  * PreCondition:    	UARTIntInit()function should have been called.
@@ -331,25 +515,86 @@ void UARTIntISR(void)
 	#if	RXON
 		unsigned char chTemp;
 	#endif
+	#if TXON
+		volatile struct txseg *seg;
+		unsigned char chTx, done;
+	#endif
 	#if TXON 
 		if(PIR1bits.TXIF & PIE1bits.TXIE)
-		{		
-			if(!vUARTIntStatus.UARTIntTxBufferEmpty)
-			{			
-				TXREG = vUARTIntTxBuffer[vUARTIntTxBufRdPtr];									
-				if(vUARTIntStatus.UARTIntTxBufferFull)
-					vUARTIntStatus.UARTIntTxBufferFull = 0;				
-				vUARTIntTxBufDataCnt--;
-				if(vUARTIntTxBufDataCnt == 0)
-				vUARTIntStatus.UARTIntTxBufferEmpty = 1;				
-				vUARTIntTxBufRdPtr++;
-				if(vUARTIntTxBufRdPtr == TX_BUFFER_SIZE)
-					vUARTIntTxBufRdPtr = 0;				
+		{
+			// send next character of the first segment
+			// (chTx 0 = nothing to send, NUL is never sent):
+			chTx = 0;
+			while(vUARTIntTxSegCnt && !chTx)
+			{
+				seg = &vUARTIntTxSeg[vUARTIntTxSegRdPtr];
+				if(seg->type == UARTINTC_SEG_ROM)
+				{
+					chTx = *seg->str++;
+					done = (*seg->str == 0);
+				}
+				else if(seg->type == UARTINTC_SEG_RAM)
+				{
+					if(seg->len)
+					{
+						chTx = vUARTIntTxBuffer[vUARTIntTxBufRdPtr];
+						UARTIntTxBufGet();
+						seg->len--;
+					}
+					done = (seg->len == 0);
+				}
+				else
+				{
+					// base64 segment:
+					if(vUARTIntTxB64Pos == 0)
+					{
+						if(seg->len < 3 && (seg->type & UARTINTC_SEG_OPEN))
+							break;	// wait for producer
+						vUARTIntTxB64Len = 0;
+						vUARTIntTxB64[1] = vUARTIntTxB64[2] = 0;
+						while(seg->len && vUARTIntTxB64Len < 3)
+						{
+							vUARTIntTxB64[vUARTIntTxB64Len++] = vUARTIntTxBuffer[vUARTIntTxBufRdPtr];
+							UARTIntTxBufGet();
+							seg->len--;
+						}
+					}
+					if(vUARTIntTxB64Len)
+					{
+						switch(vUARTIntTxB64Pos++)
+						{
+						case 0:
+							chTx = cb64[vUARTIntTxB64[0] >> 2];
+							break;
+						case 1:
+							chTx = cb64[((vUARTIntTxB64[0] & 0x03) << 4) | (vUARTIntTxB64[1] >> 4)];
+							break;
+						case 2:
+							chTx = (vUARTIntTxB64Len > 1) ? cb64[((vUARTIntTxB64[1] & 0x0f) << 2) | (vUARTIntTxB64[2] >> 6)] : '=';
+							break;
+						default:
+							chTx = (vUARTIntTxB64Len > 2) ? cb64[vUARTIntTxB64[2] & 0x3f] : '=';
+							vUARTIntTxB64Pos = 0;
+							break;
+						}
+					}
+					done = (vUARTIntTxB64Pos == 0 && seg->len == 0
+							&& !(seg->type & UARTINTC_SEG_OPEN));
+				}
+				if(done)
+				{
+					vUARTIntTxSegCnt--;
+					if(vUARTIntTxSegCnt == 0)
+						vUARTIntStatus.UARTIntTxBufferEmpty = 1;
+					vUARTIntTxSegRdPtr++;
+					if(vUARTIntTxSegRdPtr == TX_SEGMENTS)
+						vUARTIntTxSegRdPtr = 0;
+				}
 			}
+			if(chTx)
+				TXREG = chTx;
 			else
-			{   
-				PIE1bits.TXIE = 0;				
-			}
+				PIE1bits.TXIE = 0;
 		}
 	#endif	
 	#if	TXON_AND_RXON
@@ -55,6 +55,7 @@
 /* Constants found in .def file are given readable names*/
 #define TX_BUFFER_SIZE UARTINTC_TX_BUFFER_SIZE
 #define RX_BUFFER_SIZE UARTINTC_RX_BUFFER_SIZE
+#define TX_SEGMENTS UARTINTC_TX_SEGMENTS
 
 #ifdef UARTINTC_TXON
   #define TXON 1
@@ -104,6 +105,22 @@ struct status
 
 extern volatile struct status vUARTIntStatus;
 
+// Transmit segment queue: the TX ISR sends ROM strings in place, RAM
+// bytes from the transmit buffer and raw bytes from the transmit buffer
+// it base64 encodes on the fly. UARTIntTxBufferEmpty is set when all
+// segments have been sent, UARTIntTxBufferFull when the buffer is full.
+#define UARTINTC_SEG_RAM  0
+#define UARTINTC_SEG_ROM  1
+#define UARTINTC_SEG_B64  2
+#define UARTINTC_SEG_OPEN 0x80  // B64 segment still being filled
+
+struct txseg
+{
+	const rom char *str;		// SEG_ROM: next character
+	unsigned char len;			// SEG_RAM/B64: bytes in transmit buffer
+	unsigned char type;
+};
+
 //  variables representing status of transmission buffer and 
 //  transmission buffer it self are declared below
 
@@ -112,6 +129,8 @@ extern volatile unsigned char vUARTIntTxBuffer[TX_BUFFER_SIZE];
 extern volatile unsigned char vUARTIntTxBufDataCnt;
 extern volatile unsigned char vUARTIntTxBufWrPtr;
 extern volatile unsigned char vUARTIntTxBufRdPtr;
+extern volatile struct txseg vUARTIntTxSeg[TX_SEGMENTS];
+extern volatile unsigned char vUARTIntTxSegCnt;
 #endif
 
 // variables referring the status of receive buffer.
@@ -139,6 +158,13 @@ unsigned char UARTIntPutChar(unsigned char);
 
 // function returns size of the empty section of Transmit buffer
 unsigned char UARTIntGetTxBufferEmptySpace(void);
+// function to queue a zero terminated ROM string (not copied)
+unsigned char UARTIntPutRom(const rom char *);
+// function to copy a zero terminated RAM string, returns bytes queued
+unsigned char UARTIntPutRam(const char *);
+// functions to queue raw bytes for base64 encoding by the TX ISR
+unsigned char UARTIntPutB64(unsigned char);
+void UARTIntPutB64End(void);
 #endif
 
 // Initialisation of the module
@@ -175,6 +201,8 @@ void UARTIntISR(void);
 										SPBRG = iBRGValue;\
 										RCSTAbits.SPEN = 1																	
 
+// mSetUARTBaud() is not valid ANSI C (and unused), skip it for gcc:
+#ifndef OVMS_HOST
 #define mSetUARTBaud(iBaudRate)\
 		do{\
 			\#define SPBRG_V11  (UART_CLOCK_FREQ / UARTINTC_BAUDRATE)\
@@ -189,5 +217,6 @@ void UARTIntISR(void);
 			SPBRG = iBaudRate;\
 			RCSTAbits.SPEN = 1;\
 		}while(false)
+#endif // OVMS_HOST
 
 #endif // #ifndef _UARTIntC_H
\ No newline at end of file
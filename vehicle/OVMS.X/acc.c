@@ -56,34 +56,57 @@ int acc_last_cac = 0;
 unsigned char acc_last_loc = 0;
 int acc_last_estimate = 0;
 
+// Decoded ACC records (PARAM_ACC_S...), reloaded after parameter writes
+#pragma udata ACC_RECS
+struct acc_record acc_recs[PARAM_ACC_COUNT];
+#pragma udata
+unsigned char acc_recs_generation = 0;      // par_generation of acc_recs
+
 #define VOLTS_ACC_ASSUMED 220
 
 rom char ACC_NOTHERE[] = "ACC not at this location";
 
+void acc_load(void)
+  {
+  int k;
+
+  if (acc_recs_generation == par_generation)
+    return; // Up to date
+
+  for (k=0;k<PARAM_ACC_COUNT;k++)
+    par_getbase64(k+PARAM_ACC_S, &acc_recs[k], sizeof(struct acc_record));
+  acc_recs_generation = par_generation;
+  }
+
 signed char acc_find(struct acc_record* ar, BOOL enabledonly)
   {
   int k;
   int radius;
+  struct acc_record *rec;
 
+  acc_load();
   for (k=0;k<PARAM_ACC_COUNT;k++)
     {
-    par_getbase64(k+PARAM_ACC_S, ar, sizeof(ar));
-    if ((ar->acc_latitude != 0)||(ar->acc_longitude != 0))
+    rec = &acc_recs[k];
+    if ((rec->acc_latitude != 0)||(rec->acc_longitude != 0))
       {
       // We have a used location
-      if (ar->acc_radius != 0)
-        radius = ar->acc_radius;
+      if (rec->acc_radius != 0)
+        radius = rec->acc_radius;
       else
         radius = ACC_RANGE_DEFAULT;
-      if (FIsLatLongClose(ar->acc_latitude, ar->acc_longitude, car_latitude, car_longitude, radius)>0)
+      if (FIsLatLongClose(rec->acc_latitude, rec->acc_longitude, car_latitude, car_longitude, radius)>0)
         {
         // This location matches...
+        memcpy((void*)ar, (void*)rec, sizeof(struct acc_record));
         if (enabledonly && (!ar->acc_flags.AccEnabled)) return 0;
         return k+1;
         }
       }
     }
 
+  // No match: *ar holds the last slot, as the callers are used to
+  memcpy((void*)ar, (void*)&acc_recs[PARAM_ACC_COUNT-1], sizeof(struct acc_record));
   return 0;
   }
 
@@ -96,7 +119,8 @@ signed char acc_get(struct acc_record* ar, char *location)
   k = atoi(location);
   if ((k>=1)&&(k<=PARAM_ACC_COUNT))
     {
-    par_getbase64(k+PARAM_ACC_S-1, ar, sizeof(ar));
+    acc_load();
+    memcpy((void*)ar, (void*)&acc_recs[k-1], sizeof(struct acc_record));
     return k;
     }
 
@@ -531,8 +555,7 @@ void acc_state_ticker10(void)
         vehicle_fn_commandhandler(FALSE, 12, NULL); // Stop charge
         }
       // Check if charge is due
-      p = par_get(PARAM_TIMEZONE);
-      now = car_time + ((long)timestring_to_mins(p))*60;  // Date+Time in seconds, local time zone
+      now = car_time + ((long)par_timezone)*60;  // Date+Time in seconds, local time zone
       now = (now % 86400) / 60;  // In minutes past the start of the day
       if (now == acc_chargeminute)
         {
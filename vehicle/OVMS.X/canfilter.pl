@@ -0,0 +1,307 @@
+#!/usr/bin/perl
+
+#    Project:       Open Vehicle Monitor System
+#    Date:          18 October 2026
+#
+#    Changes:
+#    1.0  Initial release
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in
+# all copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+# THE SOFTWARE.
+
+# CAN acceptance mask & filter optimiser, see vehicle_can_setfilters()
+#
+#   canfilter.pl [-p name] [-c current] -0 ids [-1 ids] [log ...]
+#
+#   -0 ids      CAN IDs decoded by vehicle_fn_poll0 (RXB0), hex, comma separated
+#   -1 ids      CAN IDs decoded by vehicle_fn_poll1 (RXB1)
+#   -c regs     current setting to compare with: RXM0,RXF0,RXF1,RXM1,RXF2,
+#               RXF3,RXF4,RXF5 as 8 comma separated hex values
+#   -p name     name of the generated vehicle_canfilter_t
+#   log         CAN-do CSV or CRTD logs of the car bus
+#
+# RXB0 has one mask and two filters, RXB1 one mask and four filters. The
+# optimiser partitions the IDs of each buffer into filter groups and uses
+# the widest mask that keeps every group together, choosing the partition
+# with the fewest accepted but unwanted frames in the logs (or, without
+# logs, unwanted IDs). IDs of RXB1 must not match RXB0, as RXB0 is checked
+# first. Buffers with up to 10 IDs are searched exhaustively, larger sets
+# are merged greedily.
+#
+# The result is printed as a vehicle_canfilter_t initialiser, followed by
+# the accepted / unwanted frame counts of the logs, which are the CAN
+# interrupts the filters let through.
+
+use strict;
+use Getopt::Std;
+
+my %opts;
+getopts('p:c:0:1:', \%opts) or usage();
+usage() if (!defined $opts{'0'});
+
+my @want0 = ids($opts{'0'});
+my @want1 = ids($opts{'1'});
+my %wanted = map { $_ => 0 } @want0;
+foreach (@want1)
+  {
+  die sprintf("ID 0x%03X listed for both buffers\n",$_) if (defined $wanted{$_});
+  $wanted{$_} = 1;
+  }
+
+# Frames per ID in the logs:
+my %count;
+my $frames = 0;
+while (@ARGV)
+  {
+  my $log = shift @ARGV;
+  open my $fh, '<', $log or die "$log: $!\n";
+  while (<$fh>)
+    {
+    my $id;
+    if (/^RD11,\s*[\d.]+,\s*([0-9A-Fa-f]+)/)
+      { $id = hex($1); }
+    elsif (/^\s*[\d.]+\s+(?:\d+)?R11\s+([0-9A-Fa-f]+)/)
+      { $id = hex($1); }
+    else
+      { next; }
+    $count{$id}++;
+    $frames++;
+    }
+  close $fh;
+  }
+my @logids = sort { $a <=> $b } keys %count;
+
+# RXB0 first, RXB1 gets the frames RXB0 does not take:
+my ($m0,@f0) = optimise(2, \@want0, \@want1, undef);
+push @f0, $f0[-1] while (@f0 < 2); # unused filters duplicate a used one
+my ($m1,@f1) = optimise(4, \@want1, [], [$m0,@f0]);
+push @f1, $f1[-1] while (@f1 < 4);
+if (!@want1)
+  {
+  ($m1,@f1) = ($m0,($f0[0]) x 4); # RXB1 unused: nothing new accepted
+  }
+
+my $name = $opts{'p'} || 'vehicle_canfilter';
+print "// canfilter.pl -0 ".join(',',map { sprintf '%03x',$_ } @want0);
+print " -1 ".join(',',map { sprintf '%03x',$_ } @want1) if (@want1);
+print "\n";
+printf "rom vehicle_canfilter_t %s =\n", $name;
+printf "  { 0x%03x, { 0x%03x, 0x%03x }, 0x%03x, { 0x%03x, 0x%03x, 0x%03x, 0x%03x } };\n",
+  $m0, @f0, $m1, @f1;
+
+print "\n";
+printf "%-12s %5s %5s %8s %8s %8s %7s\n",
+  'setting','RXB0','RXB1','accepted','unwanted','misroute','ISR';
+report('optimised', $m0,@f0,$m1,@f1);
+if ($opts{'c'})
+  {
+  my @c = ids($opts{'c'});
+  die "-c needs 8 values\n" if (@c != 8);
+  report('current', @c);
+  }
+report('no filter', 0,0,0,0,0,0,0,0) if ($frames);
+exit 0;
+
+sub usage
+  {
+  die "usage: canfilter.pl [-p name] [-c rxm0,rxf0,rxf1,rxm1,rxf2,rxf3,rxf4,rxf5] -0 ids [-1 ids] [log ...]\n";
+  }
+
+sub ids
+  {
+  my ($list) = @_;
+  return () if (!defined $list);
+  my @ids = map { hex } split /[,\s]+/, $list;
+  foreach (@ids) { die "bad CAN ID\n" if ($_ > 0x7ff); }
+  return @ids;
+  }
+
+# Accepted by RXB0?
+sub rxb0
+  {
+  my ($id,$m0,@f) = @_;
+  foreach (@f)
+    {
+    return 1 if (($id & $m0) == ($_ & $m0));
+    }
+  return 0;
+  }
+
+# Buffer 0/1 a frame ID goes to, undef if not accepted
+sub rxbuffer
+  {
+  my ($id,$m0,$f0,$f1,$m1,@f) = @_;
+  return 0 if (rxb0($id,$m0,$f0,$f1));
+  foreach (@f)
+    {
+    return 1 if (($id & $m1) == ($_ & $m1));
+    }
+  return undef;
+  }
+
+sub report
+  {
+  my ($label,@regs) = @_;
+  my ($acc,$unw,$mis,$ids0,$ids1) = (0,0,0,0,0);
+  foreach my $id (0 .. 0x7ff)
+    {
+    my $b = rxbuffer($id,@regs);
+    next if (!defined $b);
+    if ($b) { $ids1++; } else { $ids0++; }
+    my $n = $count{$id} || 0;
+    $acc += $n;
+    if (!defined $wanted{$id})
+      { $unw += $n; }
+    elsif ($wanted{$id} != $b)
+      { $mis += $n; }
+    }
+  # wanted IDs not accepted at all:
+  foreach my $id (keys %wanted)
+    {
+    $mis += $count{$id} || 0 if (!defined rxbuffer($id,@regs));
+    }
+  printf "%-12s %5d %5d %8d %8d %8d %6.1f%%\n", $label, $ids0, $ids1,
+    $acc, $unw, $mis, $frames ? 100*$acc/$frames : 0;
+  }
+
+# Mask and filters for a partition of the IDs into groups
+sub groupfilters
+  {
+  my (@groups) = @_;
+  my $diff = 0;
+  foreach my $g (@groups)
+    {
+    $diff |= ($_ ^ $g->[0]) foreach (@$g);
+    }
+  my $mask = 0x7ff & ~$diff;
+  my (%seen,@f);
+  foreach my $g (@groups)
+    {
+    my $v = $g->[0] & $mask;
+    push @f, $v if (!$seen{$v}++);
+    }
+  return ($mask,@f);
+  }
+
+# Cost of a mask & filter set: (unwanted log frames, unwanted IDs), or
+# undef if it accepts an ID of the other buffer
+sub cost
+  {
+  my ($mask,$filters,$want,$other,$prev) = @_;
+  my %fset = map { $_ => 1 } @$filters;
+  my %w = map { $_ => 1 } @$want;
+  foreach (@$other)
+    {
+    return undef if ($fset{$_ & $mask});
+    }
+  my $frm = 0;
+  foreach my $id (@logids)
+    {
+    next if ($w{$id} || !$fset{$id & $mask});
+    next if ($prev && rxb0($id,@$prev)); # taken by RXB0
+    $frm += $count{$id};
+    }
+  my $free = 11;
+  for (my $b=0; $b<11; $b++) { $free-- if ($mask & (1<<$b)); }
+  return ($frm, scalar(@$filters) * (1<<$free) - scalar(@$want));
+  }
+
+sub better
+  {
+  my ($x,$y) = @_;
+  return 1 if (!defined $y);
+  return ($x->[0] < $y->[0]) || (($x->[0] == $y->[0]) && ($x->[1] < $y->[1]));
+  }
+
+sub optimise
+  {
+  my ($k,$want,$other,$prev) = @_;
+  return (0x7ff,0x7ff) if (!@$want);
+  my ($best,$bestcost);
+
+  my $try = sub
+    {
+    my (@groups) = @_;
+    my ($mask,@f) = groupfilters(@groups);
+    my @c = cost($mask,\@f,$want,$other,$prev);
+    return if (!defined $c[0]);
+    if (better(\@c,$bestcost))
+      {
+      ($best,$bestcost) = ([$mask,@f],\@c);
+      }
+    };
+
+  if (@$want <= 10)
+    {
+    # All partitions into up to k groups:
+    my @ids = @$want;
+    my @groups;
+    my $rec;
+    $rec = sub
+      {
+      my ($i) = @_;
+      if ($i == @ids)
+        {
+        $try->(@groups);
+        return;
+        }
+      foreach my $g (@groups)
+        {
+        push @$g, $ids[$i];
+        $rec->($i+1);
+        pop @$g;
+        }
+      if (@groups < $k)
+        {
+        push @groups, [$ids[$i]];
+        $rec->($i+1);
+        pop @groups;
+        }
+      };
+    $rec->(0);
+    }
+  else
+    {
+    # Greedy: merge the pair of groups with the lowest cost
+    my @groups = map { [$_] } sort { $a <=> $b } @$want;
+    while (@groups > $k)
+      {
+      my ($bi,$bj,$bc);
+      for (my $i=0; $i<@groups; $i++)
+        {
+        for (my $j=$i+1; $j<@groups; $j++)
+          {
+          my @merged = @groups;
+          $merged[$i] = [@{$groups[$i]},@{$groups[$j]}];
+          splice @merged, $j, 1;
+          my ($mask,@f) = groupfilters(@merged);
+          my @c = cost($mask,\@f,$want,$other,$prev);
+          next if (!defined $c[0]);
+          ($bi,$bj,$bc) = ($i,$j,\@c) if (better(\@c,$bc));
+          }
+        }
+      die "no filter setting keeps the RXB1 IDs out of RXB0\n" if (!defined $bi);
+      push @{$groups[$bi]}, @{$groups[$bj]};
+      splice @groups, $bj, 1;
+      }
+    $try->(@groups);
+    }
+
+  die "no filter setting keeps the RXB1 IDs out of RXB0\n" if (!$best);
+  return @$best;
+  }
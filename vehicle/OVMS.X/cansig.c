@@ -0,0 +1,121 @@
+/*
+;    Project:       Open Vehicle Monitor System
+;    Date:          18 October 2026
+;
+;    Changes:
+;    1.0  Initial release
+;
+;    (C) 2011  Michael Stegen / Stegen Electronics
+;    (C) 2011  Mark Webb-Johnson
+;    (C) 2011  Sonny Chen @ EPRO/DX
+;
+; Permission is hereby granted, free of charge, to any person obtaining a copy
+; of this software and associated documentation files (the "Software"), to deal
+; in the Software without restriction, including without limitation the rights
+; to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+; copies of the Software, and to permit persons to whom the Software is
+; furnished to do so, subject to the following conditions:
+;
+; The above copyright notice and this permission notice shall be included in
+; all copies or substantial portions of the Software.
+;
+; THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+; IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+; FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+; AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+; LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+; OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+; THE SOFTWARE.
+*/
+
+#include "ovms.h"
+#include "cansig.h"
+
+////////////////////////////////////////////////////////////////////////
+// cansig_decode()
+// Decode the current CAN frame (can_id, can_databuffer) by the signal
+// table. Returns TRUE if the frame is described by the table, FALSE if
+// the caller needs to handle it.
+//
+
+// ISR optimization, see http://www.xargs.com/pic/c18-isr-optim.pdf
+#pragma tmpdata high_isr_tmpdata
+
+BOOL cansig_decode(rom cansig_table_t *table)
+  {
+  rom cansig_id_t *id;
+  rom cansig_msg_t *msg;
+  rom cansig_sig_t *sig;
+  unsigned char k, n, mux;
+  unsigned long raw;
+  long val;
+
+  // CAN ID slot:
+  id = &table->ids[(can_id ^ (can_id >> table->idshift)) & table->idmask];
+  if (id->id != can_id)
+    return FALSE;
+
+  // Multiplexor slot:
+  msg = &table->msgs[id->first];
+  if (id->muxbyte != CANSIG_NOMUX)
+    {
+    if (id->muxbyte >= can_datalength)
+      return FALSE;
+    mux = can_databuffer[id->muxbyte];
+    msg += (mux ^ (mux >> id->muxshift)) & id->muxmask;
+    if (msg->mux != mux)
+      return FALSE;
+    }
+  if (msg->count == 0)
+    return FALSE;
+
+  sig = &table->sigs[msg->first];
+  for (n = msg->count; n > 0; n--, sig++)
+    {
+    k = sig->byte + sig->nbytes;
+    if (k > can_datalength)
+      continue; // frame too short
+
+    // Assemble raw value:
+    raw = 0;
+    if (sig->flags & CANSIG_BE)
+      {
+      for (k = sig->byte; k < sig->byte + sig->nbytes; k++)
+        raw = (raw << 8) | can_databuffer[k];
+      }
+    else
+      {
+      while (k > sig->byte)
+        raw = (raw << 8) | can_databuffer[--k];
+      }
+    if (sig->len < 32)
+      {
+      raw = (raw >> sig->shift) & ((1UL << sig->len) - 1);
+      if ((sig->flags & CANSIG_SIGNED) && (sig->len > 0)
+          && (raw & (1UL << (sig->len - 1))))
+        raw |= ~((1UL << sig->len) - 1); // sign extension
+      }
+
+    // Scale:
+    val = (long) raw;
+    if (sig->mul != 1)
+      val *= sig->mul;
+    if (sig->div != 1)
+      val /= (long) sig->div;
+    val += sig->offset;
+    if ((sig->flags & CANSIG_RANGE) && ((val < sig->min) || (val > sig->max)))
+      val = 0;
+
+    // Store:
+    if (sig->size == 1)
+      *((unsigned char *) sig->target) = (unsigned char) val;
+    else if (sig->size == 2)
+      *((unsigned int *) sig->target) = (unsigned int) val;
+    else
+      *((unsigned long *) sig->target) = (unsigned long) val;
+    }
+
+  return TRUE;
+  }
+
+#pragma tmpdata
@@ -0,0 +1,110 @@
+/*
+;    Project:       Open Vehicle Monitor System
+;    Date:          18 October 2026
+;
+;    Changes:
+;    1.0  Initial release
+;
+;    (C) 2011  Michael Stegen / Stegen Electronics
+;    (C) 2011  Mark Webb-Johnson
+;    (C) 2011  Sonny Chen @ EPRO/DX
+;
+; Permission is hereby granted, free of charge, to any person obtaining a copy
+; of this software and associated documentation files (the "Software"), to deal
+; in the Software without restriction, including without limitation the rights
+; to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+; copies of the Software, and to permit persons to whom the Software is
+; furnished to do so, subject to the following conditions:
+;
+; The above copyright notice and this permission notice shall be included in
+; all copies or substantial portions of the Software.
+;
+; THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+; IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+; FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+; AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+; LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+; OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+; THE SOFTWARE.
+*/
+
+#ifndef __OVMS_CANSIG_H
+#define __OVMS_CANSIG_H
+
+////////////////////////////////////////////////////////////////////////////////
+// Table driven CAN signal decoder
+//
+// Signal tables are generated by cansig.pl from a DBC like description of
+// the vehicle CAN messages (see vehicle_teslaroadster.dbc for the format)
+// and stored in ROM. A poll handler calls cansig_decode() first; if the
+// frame is described by the table, all its signals have been stored to
+// their car_* variables and the handler can return:
+//
+//    #include "vehicle_teslaroadster_sig.h"
+//    ...
+//    if (cansig_decode(&teslaroadster_signals))
+//      return TRUE;
+//
+// Lookup is O(1): the CAN ID and the multiplexor byte are hashed into
+// direct mapped slot tables by h = (v ^ (v >> shift)) & mask, with shift
+// and mask chosen by the generator so that no two entries collide.
+//
+// A signal value is: raw * mul / div + offset
+//    raw = data bytes byte..byte+nbytes-1 (Intel: little endian,
+//    Motorola: big endian), shifted right by shift, masked to len bits,
+//    sign extended if CANSIG_SIGNED. len = 0 stores the constant offset,
+//    i.e. for stale indicators. With CANSIG_RANGE, values outside min..max
+//    are stored as 0. Signals beyond can_datalength are skipped.
+//
+
+#define CANSIG_SIGNED   0x01    // raw value is signed
+#define CANSIG_BE       0x02    // Motorola byte order (big endian)
+#define CANSIG_RANGE    0x04    // store 0 if not min <= value <= max
+
+#define CANSIG_NOMUX    0xff    // cansig_id_t.muxbyte: message not multiplexed
+#define CANSIG_NOID     0xffff  // cansig_id_t.id: empty slot
+
+typedef struct
+{
+  void *target;               // car_* variable
+  unsigned char size;         // target size in bytes: 1, 2 or 4
+  unsigned char flags;        // CANSIG_x
+  unsigned char byte;         // first data byte
+  unsigned char nbytes;       // number of data bytes 0..4
+  unsigned char shift;        // right shift of the assembled bytes
+  unsigned char len;          // bit length 0..32
+  int mul;                    // scale = mul / div
+  unsigned int div;
+  long offset;
+  int min;                    // CANSIG_RANGE limits
+  int max;
+} cansig_sig_t;
+
+typedef struct
+{
+  unsigned char mux;          // multiplexor value
+  unsigned char first;        // first signal
+  unsigned char count;        // number of signals (0 = empty slot)
+} cansig_msg_t;
+
+typedef struct
+{
+  unsigned int id;            // CAN ID, CANSIG_NOID = empty slot
+  unsigned char muxbyte;      // multiplexor data byte or CANSIG_NOMUX
+  unsigned char muxshift;     // multiplexor hash
+  unsigned char muxmask;
+  unsigned char first;        // first message slot
+} cansig_id_t;
+
+typedef struct
+{
+  rom cansig_id_t *ids;
+  rom cansig_msg_t *msgs;
+  rom cansig_sig_t *sigs;
+  unsigned char idshift;      // CAN ID hash
+  unsigned int idmask;
+} cansig_table_t;
+
+BOOL cansig_decode(rom cansig_table_t *table);
+
+#endif // #ifndef __OVMS_CANSIG_H
@@ -0,0 +1,406 @@
+#!/usr/bin/perl
+
+#    Project:       Open Vehicle Monitor System
+#    Date:          18 October 2026
+#
+#    Changes:
+#    1.0  Initial release
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in
+# all copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+# THE SOFTWARE.
+
+# CAN signal table generator and log decoder, see cansig.h
+#
+# Generate the ROM signal table of a vehicle module:
+#   cansig.pl [-p prefix] [-o file_sig.h] file.dbc
+#
+# Decode a CAN-do CSV or CRTD log with the same table:
+#   cansig.pl -d file.dbc [log ...]
+#
+# The input is a subset of the DBC format, one signal per SG_ line,
+# extended by the C type and the variable the firmware stores it to:
+#
+#   BO_ <id> <name>
+#    SG_ <name> [M|m<mux>] : <start>|<len>@<order><sign> (<factor>,<offset>) [<min>|<max>] "<unit>" <type> <target>
+#
+#   id, mux     decimal or 0x hex
+#   start, len  DBC bit numbering: Intel (@1) start = lsb, Motorola (@0)
+#               start = msb; len 0 = constant, the value is the offset
+#   factor      rational, i.e. 0.1 or 1.609 (integer math on the module)
+#   min|max     if not 0|0, values out of range are stored as 0
+#   type        u8 s8 u16 s16 u32 s32 of target, "-" = not stored
+#   target      C lvalue, i.e. car_SOC or car_vin[3]
+#
+# The multiplexor (M) must be a byte aligned 8 bit signal. Empty lines
+# and lines starting with # are ignored.
+
+use strict;
+use Getopt::Std;
+
+my %opts;
+getopts('p:o:d', \%opts) or usage();
+usage() if (@ARGV < 1);
+
+my $dbc = shift @ARGV;
+my @msgs = parse_dbc($dbc);
+
+if ($opts{'d'})
+  {
+  decode_logs(@msgs);
+  }
+else
+  {
+  my $prefix = $opts{'p'};
+  if (!defined $prefix)
+    {
+    ($prefix = $dbc) =~ s/^.*\///;
+    $prefix =~ s/\.dbc$//;
+    $prefix =~ s/^vehicle_//;
+    }
+  my $out = \*STDOUT;
+  if ($opts{'o'})
+    {
+    open $out, '>', $opts{'o'} or die "$opts{'o'}: $!\n";
+    }
+  generate($out, $dbc, $prefix, @msgs);
+  close $out;
+  }
+exit 0;
+
+sub usage
+  {
+  die "usage: cansig.pl [-p prefix] [-o file_sig.h] file.dbc\n"
+     ."       cansig.pl -d file.dbc [log ...]\n";
+  }
+
+sub num
+  {
+  my ($v) = @_;
+  return ($v =~ /^0x/i) ? hex($v) : $v;
+  }
+
+sub gcd
+  {
+  my ($x,$y) = @_;
+  ($x,$y) = ($y,$x % $y) while ($y);
+  return $x;
+  }
+
+# factor -> (mul,div)
+sub rational
+  {
+  my ($f,$where) = @_;
+  foreach my $d (1,10,100,1000,10000,100000)
+    {
+    my ($mul,$div) = ($f * $d,$d);
+    next if (abs($mul - int($mul+($mul<0?-0.5:0.5))) > 1e-9);
+    $mul = int($mul+($mul<0?-0.5:0.5));
+    my $g = gcd(abs($mul),$div) || 1;
+    ($mul,$div) = ($mul/$g,$div/$g);
+    die "$where: factor $f out of range\n" if (($mul < -32768)||($mul > 32767));
+    return ($mul,$div);
+    }
+  die "$where: factor $f has too many decimals\n";
+  }
+
+# DBC bit position -> data bytes, right shift
+sub layout
+  {
+  my ($start,$len,$be,$where) = @_;
+  return (0,0,0) if ($len == 0);
+  my ($byte,$nbytes,$shift);
+  $byte = int($start/8);
+  if ($be)
+    {
+    my $top = ($start % 8) + 1; # bits in the first byte
+    if ($len <= $top)
+      {
+      ($nbytes,$shift) = (1,$top-$len);
+      }
+    else
+      {
+      my $extra = int(($len-$top+7)/8);
+      ($nbytes,$shift) = (1+$extra,$extra*8-($len-$top));
+      }
+    }
+  else
+    {
+    $nbytes = int(($start+$len-1)/8) - $byte + 1;
+    $shift = $start % 8;
+    }
+  die "$where: signal spans more than 4 bytes\n" if ($nbytes > 4);
+  die "$where: signal exceeds 8 data bytes\n" if ($byte+$nbytes > 8);
+  return ($byte,$nbytes,$shift);
+  }
+
+sub parse_dbc
+  {
+  my ($file) = @_;
+  my (@msgs,%byid,$msg);
+  open my $fh, '<', $file or die "$file: $!\n";
+  while (<$fh>)
+    {
+    s/[\r\n]+$//;
+    next if (/^\s*(#|$)/);
+    my $where = "$file:$.";
+    if (/^BO_\s+(\w+)\s+(\w+)/)
+      {
+      my $id = num($1);
+      die "$where: bad CAN ID $1\n" if ($id > 0x7ff);
+      die "$where: duplicate CAN ID $1\n" if ($byid{$id});
+      $msg = { id=>$id, name=>$2, muxbyte=>undef, sigs=>[] };
+      $byid{$id} = $msg;
+      push @msgs, $msg;
+      }
+    elsif (/^\s+SG_\s+(\w+)\s+(?:(M|m\w+)\s+)?:\s*(\d+)\|(\d+)@([01])([+-])\s+\(([-\d.eE]+),([-\d]+)\)\s+\[([-\d]+)\|([-\d]+)\]\s+"([^"]*)"\s+(\S+)(?:\s+(\S+))?\s*$/)
+      {
+      die "$where: SG_ without BO_\n" if (!$msg);
+      my ($name,$mux,$start,$len,$be,$signed,$factor,$offset,$min,$max,$unit,$type,$target)
+        = ($1,$2,$3,$4,$5 eq '0',$6 eq '-',$7,$8,$9,$10,$11,$12,$13);
+      my %size = ('u8'=>1, 's8'=>1, 'u16'=>2, 's16'=>2, 'u32'=>4, 's32'=>4, '-'=>0);
+      die "$where: bad type $type\n" if (!defined $size{$type});
+      die "$where: $type needs a target\n" if (($type ne '-')&&(!defined $target));
+      die "$where: bad length $len\n" if ($len > 32);
+      my ($byte,$nbytes,$shift) = layout($start,$len,$be,$where);
+      my ($mul,$div) = rational($factor,$where);
+      die "$where: range out of 16 bit\n"
+        if (($min < -32768)||($min > 32767)||($max < -32768)||($max > 32767));
+      if (defined $mux && $mux eq 'M')
+        {
+        die "$where: multiplexor must be a byte aligned 8 bit signal\n"
+          if (($len != 8)||($shift != 0));
+        die "$where: second multiplexor\n" if (defined $msg->{'muxbyte'});
+        die "$where: multiplexor cannot be stored\n" if ($type ne '-');
+        $msg->{'muxbyte'} = $byte;
+        next;
+        }
+      next if ($type eq '-');
+      push @{$msg->{'sigs'}},
+        { name=>$name, mux=>(defined $mux)?num(substr($mux,1)):undef,
+          byte=>$byte, nbytes=>$nbytes, shift=>$shift, len=>$len,
+          be=>$be, signed=>$signed, mul=>$mul, div=>$div, offset=>$offset,
+          range=>($min != 0 || $max != 0), min=>$min, max=>$max, unit=>$unit,
+          type=>$type, size=>$size{$type}, target=>$target, where=>$where };
+      }
+    else
+      {
+      die "$where: syntax error\n";
+      }
+    }
+  close $fh;
+
+  # Group signals by multiplexor value:
+  foreach my $m (@msgs)
+    {
+    my (%mux,@order);
+    foreach my $s (@{$m->{'sigs'}})
+      {
+      die "$s->{'where'}: multiplexed signal in a message without multiplexor\n"
+        if (defined $s->{'mux'} && !defined $m->{'muxbyte'});
+      die "$s->{'where'}: signal needs a multiplexor value\n"
+        if (!defined $s->{'mux'} && defined $m->{'muxbyte'});
+      my $v = $s->{'mux'} || 0;
+      die "$s->{'where'}: bad multiplexor value\n" if ($v > 255);
+      push @order, $v if (!$mux{$v});
+      push @{$mux{$v}}, $s;
+      }
+    $m->{'mux'} = { map { $_ => $mux{$_} } @order };
+    $m->{'muxorder'} = [ sort { $a <=> $b } @order ];
+    }
+  return @msgs;
+  }
+
+# Find the smallest collision free hash (v ^ (v >> shift)) & mask
+sub hash
+  {
+  my ($bits,@v) = @_;
+  for (my $mask=0; ; $mask=$mask*2+1)
+    {
+    SHIFT: foreach my $shift (1 .. $bits)
+      {
+      my %seen;
+      foreach (@v)
+        {
+        my $h = ($_ ^ ($_ >> $shift)) & $mask;
+        next SHIFT if ($seen{$h}++);
+        }
+      return ($shift,$mask);
+      }
+    }
+  }
+
+sub generate
+  {
+  my ($out,$dbc,$prefix,@msgs) = @_;
+  my (@ids,@slots,@sigs);
+
+  @msgs = grep { scalar @{$_->{'sigs'}} } @msgs;
+  die "$dbc: no signals\n" if (!@msgs);
+
+  foreach my $m (@msgs)
+    {
+    $m->{'first'} = scalar @slots;
+    if (defined $m->{'muxbyte'})
+      {
+      ($m->{'muxshift'},$m->{'muxmask'}) = hash(8,@{$m->{'muxorder'}});
+      my @tab = (undef) x ($m->{'muxmask'}+1);
+      foreach my $v (@{$m->{'muxorder'}})
+        {
+        $tab[($v ^ ($v >> $m->{'muxshift'})) & $m->{'muxmask'}] = $v;
+        }
+      push @slots, map { +{ msg=>$m, mux=>$_ } } @tab;
+      }
+    else
+      {
+      ($m->{'muxshift'},$m->{'muxmask'}) = (0,0);
+      push @slots, { msg=>$m, mux=>0 };
+      }
+    }
+  foreach my $slot (@slots)
+    {
+    next if (!defined $slot->{'mux'});
+    my $list = $slot->{'msg'}{'mux'}{$slot->{'mux'}};
+    $slot->{'first'} = scalar @sigs;
+    $slot->{'count'} = scalar @$list;
+    push @sigs, map { +{ %$_, id=>$slot->{'msg'}{'id'}, msgname=>$slot->{'msg'}{'name'} } } @$list;
+    }
+  die "$dbc: too many multiplexor slots\n" if (@slots > 255);
+  die "$dbc: too many signals\n" if (@sigs > 255);
+
+  my ($idshift,$idmask) = hash(11,map { $_->{'id'} } @msgs);
+  @ids = (undef) x ($idmask+1);
+  foreach my $m (@msgs)
+    {
+    $ids[($m->{'id'} ^ ($m->{'id'} >> $idshift)) & $idmask] = $m;
+    }
+
+  (my $src = $dbc) =~ s/^.*\///;
+  print $out "// Generated by cansig.pl from $src, do not edit.\n";
+  print $out "// Signal table for cansig_decode(), see cansig.h\n\n";
+  print $out "#include \"cansig.h\"\n\n";
+
+  print $out "rom cansig_sig_t ${prefix}_sigs[] =\n  {\n";
+  print $out "  // target, size, flags, byte, nbytes, shift, len, mul, div, offset, min, max\n";
+  foreach my $s (@sigs)
+    {
+    my $flags = join('|', ($s->{'signed'}?'CANSIG_SIGNED':()), ($s->{'be'}?'CANSIG_BE':()),
+                          ($s->{'range'}?'CANSIG_RANGE':())) || '0';
+    my $mux = defined $s->{'mux'} ? sprintf('/0x%02X', $s->{'mux'}) : '';
+    printf $out "  { (void*)&%s, %d, %s, %d, %d, %d, %d, %d, %d, %d, %d, %d }, // 0x%03X%s %s.%s\n",
+      $s->{'target'}, $s->{'size'}, $flags, @$s{qw(byte nbytes shift len mul div offset min max)},
+      $s->{'id'}, $mux, $s->{'msgname'}, $s->{'name'};
+    }
+  print $out "  };\n\n";
+
+  print $out "rom cansig_msg_t ${prefix}_msgs[] =\n  {\n";
+  print $out "  // mux, first, count\n";
+  foreach my $slot (@slots)
+    {
+    if (defined $slot->{'mux'})
+      {
+      printf $out "  { 0x%02X, %d, %d }, // 0x%03X %s\n", $slot->{'mux'}, $slot->{'first'},
+        $slot->{'count'}, $slot->{'msg'}{'id'}, $slot->{'msg'}{'name'};
+      }
+    else
+      {
+      print $out "  { 0, 0, 0 },\n";
+      }
+    }
+  print $out "  };\n\n";
+
+  print $out "rom cansig_id_t ${prefix}_ids[] =\n  {\n";
+  print $out "  // id, muxbyte, muxshift, muxmask, first\n";
+  foreach my $m (@ids)
+    {
+    if ($m)
+      {
+      printf $out "  { 0x%03X, %s, %d, 0x%02X, %d }, // %s\n", $m->{'id'},
+        defined $m->{'muxbyte'} ? $m->{'muxbyte'} : 'CANSIG_NOMUX',
+        $m->{'muxshift'}, $m->{'muxmask'}, $m->{'first'}, $m->{'name'};
+      }
+    else
+      {
+      print $out "  { CANSIG_NOID, 0, 0, 0, 0 },\n";
+      }
+    }
+  print $out "  };\n\n";
+
+  print $out "rom cansig_table_t ${prefix}_signals =\n";
+  printf $out "  { ${prefix}_ids, ${prefix}_msgs, ${prefix}_sigs, %d, 0x%03X };\n", $idshift, $idmask;
+  }
+
+# Value as stored by cansig_decode(), undef if the frame is too short
+sub value
+  {
+  my ($s,@d) = @_;
+  return undef if ($s->{'byte'}+$s->{'nbytes'} > @d);
+  my $raw = 0;
+  my @b = @d[$s->{'byte'} .. $s->{'byte'}+$s->{'nbytes'}-1];
+  @b = reverse @b if (!$s->{'be'});
+  $raw = ($raw << 8) | $_ foreach (@b);
+  $raw = ($raw >> $s->{'shift'}) & ((1 << $s->{'len'}) - 1);
+  $raw -= (1 << $s->{'len'}) if ($s->{'signed'} && $s->{'len'} && ($raw & (1 << ($s->{'len'}-1))));
+  my $v = $raw * $s->{'mul'};
+  $v = int($v / $s->{'div'});
+  $v += $s->{'offset'};
+  $v = 0 if ($s->{'range'} && (($v < $s->{'min'})||($v > $s->{'max'})));
+  return $v;
+  }
+
+sub decode_logs
+  {
+  my (@msgs) = @_;
+  my %byid = map { $_->{'id'} => $_ } @msgs;
+  while (<ARGV>)
+    {
+    s/[\r\n]+$//;
+    my ($time,$id,@d);
+    if (/^RD11,\s*([\d.]+),\s*([0-9A-Fa-f]+),?(.*)$/)
+      {
+      ($time,$id) = ($1,hex($2));
+      @d = map { hex } grep { /\S/ } split /[,\s]+/, $3;
+      }
+    elsif (/^\s*([\d.]+)\s+(?:\d+)?R11\s+([0-9A-Fa-f]+)\s*(.*)$/)
+      {
+      ($time,$id) = ($1,hex($2));
+      @d = map { hex } split /\s+/, $3;
+      }
+    else
+      {
+      next;
+      }
+    my $m = $byid{$id} or next;
+    my $list;
+    if (defined $m->{'muxbyte'})
+      {
+      next if ($m->{'muxbyte'} >= @d);
+      $list = $m->{'mux'}{$d[$m->{'muxbyte'}]} or next;
+      }
+    else
+      {
+      $list = $m->{'mux'}{0} or next;
+      }
+    my @vals;
+    foreach my $s (@$list)
+      {
+      my $v = value($s,@d);
+      push @vals, $s->{'name'}.'='.$v.$s->{'unit'} if (defined $v);
+      }
+    printf "%15s %03X %s %s\n", $time, $id, $m->{'name'}, join(' ',@vals);
+    }
+  }
@@ -91,6 +91,11 @@ void base64encodesend(BYTE *inputData, WORD inputLen)
   {
   int len = 0;
   int k;
+
+  // Direct modem output is encoded by the UART TX ISR:
+  if (net_putb64_ram(inputData, inputLen))
+    return;
+
   for (k=0;k<inputLen;k++)
     {
     in[len++] = inputData[k];
@@ -105,24 +105,13 @@ void diag_ticker(void)
     // re-map DummyData's 8-bit field 0 into an 11-bit CAN ID
     unsigned int message_id = CANIDMap[DummyData[(canwrite_state * 9)]];
     unsigned char field;
+    unsigned char data[8];
 
-    TXB0CON = 0;            // Reset TX buffer
+    // field 0 = CAN ID, data starts from field 1
+    for (field=0; field<8; field++)
+      data[field] = DummyData[(canwrite_state * 9) + 1 + field];
 
-    TXB0SIDL = (message_id & 0x7) << 5;  // Set CAN ID to 0x100
-    TXB0SIDH = message_id >> 3;
-
-    field = 1; // field 0 = CAN ID, data starts from field 1
-    TXB0D0 = DummyData[(canwrite_state * 9) + field++];
-    TXB0D1 = DummyData[(canwrite_state * 9) + field++];
-    TXB0D2 = DummyData[(canwrite_state * 9) + field++];
-    TXB0D3 = DummyData[(canwrite_state * 9) + field++];
-    TXB0D4 = DummyData[(canwrite_state * 9) + field++];
-    TXB0D5 = DummyData[(canwrite_state * 9) + field++];
-    TXB0D6 = DummyData[(canwrite_state * 9) + field++];
-    TXB0D7 = DummyData[(canwrite_state * 9) + field++];
-
-    TXB0DLC = 0b00001000; // data length (8)
-    TXB0CON |= 0b00001000; // mark for transmission
+    vehicle_cantx(message_id, VEHICLE_CANTX_NORMAL, 8, data);
 
     canwrite_state = (canwrite_state+1)%DATA_COUNT;
     }
@@ -227,8 +216,17 @@ void diag_handle_diag(char *command, char *arguments)
   net_puts_ram(net_scratchpad);
   #endif // #ifdef OVMS_HW_V2
 
+  s = stp_ul(net_scratchpad, "#  EEPROM:   ", par_stat_written);
+  s = stp_ul(s, " written / ", par_stat_skipped);
+  s = stp_ul(s, " unchanged / ", (par_stat_blocked * 64) / 1250);
+  s = stp_ul(s, " ms blocked / ", ((unsigned long)par_stat_blockmax * 64) / 1250);
+  s = stp_rom(s, " ms max\n");
+  net_puts_ram(net_scratchpad);
+
   #ifdef OVMS_LOGGINGMODULE
   s = stp_i(net_scratchpad, "#  LOGGING:  ", log_state);
+  s = stp_i(s, " stored ", logging_stored());
+  s = stp_i(s, " dropped ", log_store_drops);
   s = stp_rom(s, "\n");
   net_puts_ram(net_scratchpad);
   #endif
@@ -239,6 +237,38 @@ void diag_handle_diag(char *command, char *arguments)
   net_puts_ram(net_scratchpad);
   #endif
 
+#ifdef OVMS_CAN_DEFERRED
+  s = stp_i(net_scratchpad, "#  CANRING:  ", vehicle_canring_peak);
+  s = stp_i(s, " peak / ", vehicle_canring_drops);
+  s = stp_rom(s, " drops\n");
+  net_puts_ram(net_scratchpad);
+#endif // OVMS_CAN_DEFERRED
+
+#ifdef OVMS_CAN_SUPPRESS
+  s = stp_ul(net_scratchpad, "#  CANSUPP:  ", vehicle_cansupp_skips);
+  s = stp_ul(s, " of ", vehicle_cansupp_frames);
+  s = stp_ul(s, " skipped (", (vehicle_cansupp_frames)
+    ? (vehicle_cansupp_skips * 100) / vehicle_cansupp_frames : 0);
+  s = stp_rom(s, "%)\n");
+  net_puts_ram(net_scratchpad);
+#endif // OVMS_CAN_SUPPRESS
+
+  s = stp_ul(net_scratchpad, "#  CANTX:    ", vehicle_cantx_sent);
+  s = stp_ul(s, " sent / ", vehicle_cantx_errors);
+  s = stp_ul(s, " errors / ", vehicle_cantx_drops);
+  s = stp_i(s, " drops / ", vehicle_cantx_peak);
+  s = stp_rom(s, " peak\n");
+  net_puts_ram(net_scratchpad);
+
+  s = stp_ul(net_scratchpad, "#  RECONN:   <5s ", net_reconnects[0]);
+  s = stp_ul(s, " / <15s ", net_reconnects[1]);
+  s = stp_ul(s, " / <30s ", net_reconnects[2]);
+  s = stp_ul(s, " / <60s ", net_reconnects[3]);
+  s = stp_ul(s, " / <120s ", net_reconnects[4]);
+  s = stp_ul(s, " / more ", net_reconnects[5]);
+  s = stp_rom(s, "\n");
+  net_puts_ram(net_scratchpad);
+
   s = stp_i(net_scratchpad, "#  Signal:   ", net_sq);
   s = stp_rom(s, "\n\n");
   net_puts_ram(net_scratchpad);
@@ -291,6 +321,108 @@ void diag_handle_bl(char *command, char *arguments)
   }
 #endif //OVMS_CAR_RENAULTTWIZY
 
+#ifdef OVMS_ISR_PROFILE
+// ISR: show CAN ISR cycle profile per CAN ID, "ISR R" resets the profile
+// Rates are the frame rates the ISR could sustain for the ID at its
+// average and maximum cycle count (ISR entry/exit not included).
+void diag_handle_isr(char *command, char *arguments)
+  {
+  unsigned char k;
+  unsigned long frames = 0, cycles = 0;
+  vehicle_isrprof_t *p;
+  char *s;
+
+  if ((*arguments == 'R') || (*arguments == 'r'))
+    {
+    vehicle_isrprof_reset();
+    net_puts_rom("\n# ISR profile reset\n");
+    return;
+    }
+
+  net_puts_rom("\n# ISR CYCLES: ID COUNT MIN AVG MAX / FPS AVG MAX\n");
+  for (k=0; k<VEHICLE_ISRPROF_IDS; k++)
+    {
+    p = &vehicle_isrprof[k];
+    if (p->count == 0)
+      break;
+    frames += p->count;
+    cycles += p->sum;
+    s = stp_x(net_scratchpad, "# ", p->id);
+    s = stp_ul(s, " ", p->count);
+    s = stp_ul(s, " ", p->min);
+    s = stp_ul(s, " ", p->sum / p->count);
+    s = stp_ul(s, " ", p->max);
+    s = stp_ul(s, " / ", (5000000UL * p->count) / (p->sum + 1));
+    s = stp_ul(s, " ", 5000000UL / (p->max + 1));
+    s = stp_rom(s, "\n");
+    net_puts_ram(net_scratchpad);
+    }
+
+  s = stp_ul(net_scratchpad, "# TOTAL ", frames);
+  if (frames > 0)
+    {
+    s = stp_ul(s, " AVG ", cycles / frames);
+    s = stp_ul(s, " FPS ", (5000000UL / ((cycles / frames) + 1)));
+    }
+  s = stp_ul(s, " LOST ", vehicle_isrprof_lost);
+  s = stp_rom(s, "\n");
+  net_puts_ram(net_scratchpad);
+  }
+#endif // OVMS_ISR_PROFILE
+
+#ifdef OVMS_CAN_STATS
+// CANSTATS: show CAN bus statistics of the current period, "CANSTATS R" resets
+// Gaps are the min / max inter-arrival times per ID in ms.
+void diag_handle_can(char *command, char *arguments)
+  {
+  unsigned char k;
+  vehicle_canstats_t *p;
+  char *s;
+
+  if ((*arguments == 'R') || (*arguments == 'r'))
+    {
+    vehicle_canstats_reset();
+    net_puts_rom("\n# CAN stats reset\n");
+    return;
+    }
+
+  s = stp_ul(net_scratchpad, "\n# CAN BUS: ", vehicle_canbus_bitrate);
+  s = stp_l2f(s, " bit/s, load ", vehicle_canbus.load, 1);
+  s = stp_l2f(s, "% avg ", (vehicle_canbus.seconds)
+    ? vehicle_canbus.loadsum / vehicle_canbus.seconds : 0, 1);
+  s = stp_l2f(s, "% peak ", vehicle_canbus.loadpeak, 1);
+  s = stp_ul(s, "% at ", vehicle_canbus.loadpeaktime);
+  s = stp_ul(s, " / ", vehicle_canbus.seconds);
+  s = stp_rom(s, " s\n");
+  net_puts_ram(net_scratchpad);
+
+  s = stp_ul(net_scratchpad, "# CAN ERR: OVFL ", vehicle_canbus.ovfl0);
+  s = stp_ul(s, "/", vehicle_canbus.ovfl1);
+  s = stp_i(s, " TXERR ", vehicle_canbus.txerrmax);
+  s = stp_i(s, " RXERR ", vehicle_canbus.rxerrmax);
+  s = stp_ul(s, " BUSOFF ", vehicle_canbus.busoff);
+  s = stp_ul(s, " LOST ", vehicle_canbus.lost);
+  s = stp_rom(s, "\n");
+  net_puts_ram(net_scratchpad);
+
+  net_puts_rom("# CAN IDS: ID FRAMES BYTES CHANGED GAPMIN GAPMAX\n");
+  for (k=0; k<VEHICLE_CANSTATS_SIZE; k++)
+    {
+    p = &vehicle_canstats[k];
+    if (p->count == 0)
+      continue;
+    s = stp_x(net_scratchpad, "# ", vehicle_canstats_id[k]);
+    s = stp_ul(s, " ", p->count);
+    s = stp_ul(s, " ", p->bytes);
+    s = stp_ul(s, " ", p->changed);
+    s = stp_ul(s, " ", (p->count > 1) ? ((unsigned long)p->gapmin * 4096) / 10000 : 0);
+    s = stp_ul(s, " ", ((unsigned long)p->gapmax * 4096) / 10000);
+    s = stp_rom(s, "\n");
+    net_puts_ram(net_scratchpad);
+    }
+  }
+#endif // OVMS_CAN_STATS
+
 #ifdef OVMS_CAR_TESLAROADSTER
 void diag_handle_cantxstart(char *command, char *arguments)
   {
@@ -346,6 +478,12 @@ rom char diag_cmdtable[][27] =
 #ifdef OVMS_CAR_RENAULTTWIZY
     "BL",
 #endif
+#ifdef OVMS_ISR_PROFILE
+    "ISR",
+#endif
+#ifdef OVMS_CAN_STATS
+    "CANSTATS",
+#endif
 #ifdef OVMS_CAR_TESLAROADSTER
     "CANTXSTART",
     "CANTXSTOP",
@@ -365,6 +503,12 @@ rom void (*diag_hfntable[])(char *command, char *arguments) =
 #ifdef OVMS_CAR_RENAULTTWIZY
   ,&diag_handle_bl
 #endif
+#ifdef OVMS_ISR_PROFILE
+  ,&diag_handle_isr
+#endif
+#ifdef OVMS_CAN_STATS
+  ,&diag_handle_can
+#endif
 #ifdef OVMS_CAR_TESLAROADSTER
   ,&diag_handle_cantxstart,
   &diag_handle_cantxstop,
@@ -0,0 +1,218 @@
+////////////////////////////////////////////////////////////////////////////////
+// Project:       Open Vehicle Monitor System
+// Module:        Host build: virtual PIC18 hardware interface
+//
+// History:
+//
+// 1.0  Initial release
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef __OVMS_HOST_H
+#define __OVMS_HOST_H
+
+// Virtual clock in instruction cycles (Fosc/4 = 5 MHz)
+#define HOST_FCY            5000000UL
+#define HOST_MS(ms)         ((host_cycles_t)(ms) * (HOST_FCY / 1000))
+#define HOST_SEC(s)         ((host_cycles_t)(s) * HOST_FCY)
+
+// Instruction cycles per EEPROM byte of the par_read() loop (C18: RD,
+// EEDATA to par_value[k], EEADR++, 16 bit loop counter), an estimate for
+// the status update summary; firmware code takes no virtual time
+#define HOST_EE_CYCLES      19
+
+// Main loop passes longer than this count as stalls in the net READY
+// waits summary (busy waits for the modem, delays)
+#define HOST_STALL_MS       10
+
+typedef uint64_t host_cycles_t;
+
+extern host_cycles_t host_now;        // current virtual time
+extern unsigned char host_sfr_file[]; // emulated register file
+extern unsigned char host_eeprom[1024];
+
+// Power failure during EEPROM writes (scenario "eecut"): the writes after
+// the next host_ee_cut are lost (-1 = off), host_ee_cut_param is read back
+// through par_get() at the end of the run
+extern int host_ee_cut;
+extern unsigned char host_ee_cut_param;
+
+// Program flash (PIC18F2685: 96 KB), see include/flash.h
+#define HOST_FLASH_SIZE     0x18000
+#define HOST_FLASH_BLOCK    64
+extern unsigned char host_flash[HOST_FLASH_SIZE];
+
+// CAN frame as seen on the bus
+typedef struct
+  {
+  host_cycles_t time;                 // virtual receive/transmit time
+  uint32_t id;                        // 11 bit standard id
+  uint8_t dlc;
+  uint8_t data[8];
+  } host_can_frame_t;
+
+// Frame source: fills *frame with the next frame to receive, returns 0 at
+// the end of the input. Frames must be returned in time order.
+typedef int (*host_can_source_t)(host_can_frame_t *frame);
+
+// Reasons for host_run() to return
+#define HOST_STOP_TIME      1         // time limit reached
+#define HOST_STOP_EOF       2         // CAN source exhausted
+#define HOST_STOP_RESET     3         // firmware called reset_cpu()
+#define HOST_STOP_WDT       4         // watchdog timeout (no ClrWdt for 16s)
+
+typedef struct
+  {
+  uint32_t main_loops;                // main loop iterations (TMR0L reads)
+  uint64_t loop_stall;                // longest main loop pass (virtual cycles)
+  uint64_t loop_stall_at;             // ... ending at this virtual time
+  uint64_t uart_wait;                 // main context busy waits on the UART
+  uint64_t ready_wait;                // main loop time in net_state READY
+  uint32_t ready_stalls;              // ... passes over HOST_STALL_MS
+  uint32_t isr_high;                  // high_isr() calls
+  uint32_t isr_low;                   // low_isr() calls
+  uint32_t can_rx;                    // frames received from the source
+  uint64_t can_first, can_last;       // ... virtual time of the first / last
+  uint32_t can_accepted;              // frames passed by the acceptance filters
+  uint32_t can_rxb0;                  // frames placed in RXB0
+  uint32_t can_rxb1;                  // frames placed in RXB1
+  uint32_t can_ovfl0;                 // RXB0 overflows
+  uint32_t can_ovfl1;                 // RXB1 overflows
+  uint32_t can_tx;                    // frames transmitted
+  uint32_t uart_tx;                   // bytes sent to the modem
+  uint32_t uart_rx;                   // bytes received from the modem
+  uint32_t ee_writes;                 // EEPROM byte writes
+  uint32_t ee_reads;                  // EEPROM byte reads
+  uint32_t flash_erases;              // program flash block erases
+  uint32_t flash_writes;              // program flash block writes
+  uint32_t flash_wear;                // most erases of a single block
+  uint32_t pgm_compares;              // memcmppgm2ram() calls
+  uint32_t pgm_reads;                 // program memory bytes read by them and net.c
+  uint32_t lines;                     // modem lines handled by net_state_activity()
+  uint32_t line_compares;             // ... memcmppgm2ram() calls for them
+  uint32_t line_reads;                // ... program memory bytes read for them
+  uint32_t line_compares_max;         // ... most for a single line
+  uint32_t line_reads_max;
+  uint32_t updates;                   // NET_NOTIFY_UPDATE status updates
+  uint32_t update_ee_reads;           // ... EEPROM byte reads in them
+  uint64_t isr_high_ns;               // host time spent in high_isr()
+  } host_stats_t;
+
+extern host_stats_t host_stats;
+
+// high_isr() host time per CAN ID of the frame pending on entry,
+// index 0x800 = ISR calls without a frame pending
+typedef struct
+  {
+  uint32_t count;
+  uint64_t min, max, sum;             // ns
+  } host_isrprof_t;
+
+extern host_isrprof_t host_isrprof[0x801];
+extern void host_isrprof_dump(FILE *out);
+
+// Execution time model (ovms_host -C): firmware code normally takes no
+// virtual time. With the model enabled, each CAN ISR costs HOST_ISR_CYCLES
+// and each poll handler call host_cost[can_id] (or the default in
+// host_cost[0x800]) instruction cycles, during which the bus runs on.
+extern int host_cost_model;
+extern host_cycles_t host_cost[0x801];
+
+// Hooks (all optional)
+extern host_can_source_t host_can_source;
+extern void (*host_can_tx_hook)(const host_can_frame_t *frame);
+extern void (*host_uart_tx_hook)(unsigned char c);
+extern void (*host_uart_rx_hook)(unsigned char c);
+
+// Device on the far side of the PIC UART (the modem): tx() receives each
+// byte sent by the PIC, event() is called at the virtual time returned by
+// next(). The device answers through host_uart_rx().
+typedef struct
+  {
+  void (*tx)(unsigned char c);
+  host_cycles_t (*next)(void);
+  void (*event)(void);
+  } host_uart_device_t;
+
+extern const host_uart_device_t *host_uart_device;
+
+// net.c status update probe: 0 at the start, 1 at the end
+extern void host_update_probe(unsigned char end);
+
+// net.c modem line probe (0 at the start, 1 at the end of a line in
+// net_state_activity()) and program memory table reads
+extern void host_line_probe(unsigned char end);
+extern void host_pgm_read(unsigned char n);
+
+// Setup
+extern void host_initialise(void);
+extern void host_eeprom_param(unsigned char param, const char *value);
+
+// Run the firmware until a stop condition, returns HOST_STOP_*
+extern int host_run(host_cycles_t limit, int stop_at_eof);
+
+// Queue bytes for reception by the PIC UART at the current virtual time
+extern void host_uart_rx(const char *data, int len);
+
+// CAN log replay (host_replay.c)
+extern int host_replay_open(const char *file, int passes, double speed);
+extern void host_replay_close(void);
+extern int host_replay_frame(host_can_frame_t *frame);
+
+// SIM908 modem emulator (host_modem.c)
+typedef struct
+  {
+  const char *name;
+  int (*connect)(const char *host, const char *port);
+  void (*send)(const unsigned char *data, int len);
+  int (*recv)(unsigned char *buf, int size);  // bytes, 0 = none, -1 = closed
+  void (*close)(void);
+  int realtime;                       // pace virtual time to the wall clock
+  void (*report)(FILE *out);          // summary lines, optional
+  } host_tcp_peer_t;
+
+extern int host_modem_open(const char *script, const char *endpoint);
+extern void host_modem_report(FILE *out);
+extern int host_modem_lines_check(FILE *out);
+
+// MP server stand-in (host_mpserver.c), endpoint "mp"
+extern const host_tcp_peer_t host_mpserver_peer;
+extern void host_mpserver_app(const char *msg);
+extern void host_mpserver_ack(int ms);
+extern void host_mpserver_delta(int on);
+extern void host_mpserver_binary(int on);
+extern void host_mpserver_zip(int on);
+extern void host_mpserver_log(const char *file);
+extern void host_mpserver_expect(const char *expect);
+extern void host_mpserver_report(FILE *out);
+
+// History compression (host_lz.c)
+extern int host_lz_decode(const unsigned char *in, int len, char *out, int size);
+extern int host_lz_bench(const char *file, FILE *out);
+
+// Car state snapshots (host_state.c)
+extern void host_state_dump(FILE *out);
+extern int host_state_diff(const char *golden, FILE *out);
+
+// Firmware entry points (ovms.c main() is renamed by the Makefile)
+extern void ovms_main(void);
+extern void high_isr(void);
+extern void low_isr(void);
+
+#endif // #ifndef __OVMS_HOST_H
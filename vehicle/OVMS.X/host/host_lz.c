@@ -0,0 +1,205 @@
+////////////////////////////////////////////////////////////////////////////////
+// Project:       Open Vehicle Monitor System
+// Module:        Host build: history compression (net_lz) decoder and benchmark
+//
+// History:
+//
+// 1.0  Initial release
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "ovms.h"
+#include "net.h"
+#include "net_msg.h"
+#include "net_lz.h"
+#include "host.h"
+
+////////////////////////////////////////////////////////////////////////
+// net_lz decoder
+//
+// Decodes one "MP-0 K" stream (see net_lz.h), the output doubles as the
+// window. Returns the output length or -1 if the stream is invalid.
+//
+
+unsigned long host_lz_steps;          // net_lz.c match search compares
+
+int host_lz_decode(const unsigned char *in, int len, char *out, int size)
+  {
+  const unsigned char *e = in + len;
+  int o = 0, n, d;
+
+  while (in < e)
+    {
+    if (*in < 0x80)
+      {
+      if (o >= size)
+        return -1;
+      out[o++] = *in++;
+      continue;
+      }
+    if (in + 1 >= e)
+      return -1;
+    n = (*in++ & 0x7f) + NET_LZ_MINMATCH;
+    d = *in++ + 1;
+    if ((d > o) || (d > NET_LZ_WINDOW) || (o + n > size))
+      return -1;
+    for (; n > 0; n--, o++)
+      out[o] = out[o-d];
+    }
+  return o;
+  }
+
+
+////////////////////////////////////////////////////////////////////////
+// Benchmark (ovms_host -z file)
+//
+// Compresses the lines of a text file with the firmware's net_lz the way
+// net_msg.c sends history records: an empty line starts a new K message
+// (and window), each line is compressed with its '\n'. Every message is
+// decoded again and compared. Reports the compression ratio of the
+// payload and on the wire (base64 + CRLF, vs one "MP-0 " message per
+// line), the match search compares per input byte, an estimate of the
+// PIC cycles per byte from those and the host time per byte.
+//
+// The cycle estimate assumes HOST_LZ_CYCLES instruction cycles per
+// compare (first byte test ~15, continued match ~30 in C18 code) plus
+// HOST_LZ_CYCLES_BYTE per input byte for the token output and window
+// update. These are counted from the loop code, not measured.
+//
+
+#define HOST_LZ_CYCLES        20
+#define HOST_LZ_CYCLES_BYTE   60
+#define HOST_LZ_MSG_MAX       NET_MSG_SENDMAX
+#define HOST_LZ_BENCH_NS      200000000.0     // repeat the runs for 0.2 s
+
+typedef struct
+  {
+  unsigned int lines, msgs;
+  unsigned int in, out;               // payload bytes
+  unsigned int wire_text, wire_zip;   // wire bytes
+  unsigned int errors;
+  } host_lz_stats_t;
+
+// Compress the corpus, <verify> = decode and compare each message
+static void host_lz_run(const char *text, int len, host_lz_stats_t *st, int verify)
+  {
+  unsigned char zmsg[HOST_LZ_MSG_MAX];
+  char plain[HOST_LZ_MSG_MAX*2], check[HOST_LZ_MSG_MAX*2];
+  const char *p = text, *e = text + len, *nl;
+  int zlen = 0, plen = 0, n;
+
+  memset(st, 0, sizeof(*st));
+  for (; p < e; p += n + 1)
+    {
+    nl = memchr(p, '\n', e - p);
+    n = (nl ? nl : e) - p;
+
+    // End of message: empty line, or the next line may exceed the limit
+    if ((plen > 0) &&
+        ((n == 0) || (NET_MSG_WIRELEN(6 + zlen + n + 1) > NET_MSG_SENDMAX)))
+      {
+      st->out += zlen;
+      st->wire_zip += NET_MSG_WIRELEN(6 + zlen);
+      if (verify &&
+          ((host_lz_decode(zmsg, zlen, check, sizeof(check)) != plen) ||
+           (memcmp(plain, check, plen) != 0)))
+        st->errors++;
+      zlen = plen = 0;
+      }
+    if ((n == 0) || (n >= NET_BUF_MAX - 6))
+      continue;
+
+    if (plen == 0)
+      {
+      net_lz_reset();
+      st->msgs++;
+      }
+    memcpy(plain + plen, p, n);
+    plain[plen + n] = '\n';
+    zlen += net_lz_compress(plain + plen, n + 1, zmsg + zlen);
+    plen += n + 1;
+    st->lines++;
+    st->in += n + 1;
+    st->wire_text += NET_MSG_WIRELEN(5 + n);
+    }
+  if (plen > 0)
+    {
+    st->out += zlen;
+    st->wire_zip += NET_MSG_WIRELEN(6 + zlen);
+    if (verify &&
+        ((host_lz_decode(zmsg, zlen, check, sizeof(check)) != plen) ||
+         (memcmp(plain, check, plen) != 0)))
+      st->errors++;
+    }
+  }
+
+static double host_lz_ns(void)
+  {
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec * 1e9 + t.tv_nsec;
+  }
+
+int host_lz_bench(const char *file, FILE *out)
+  {
+  FILE *f;
+  char *text;
+  int len, runs;
+  host_lz_stats_t st;
+  double t0, t;
+  double steps;
+
+  if ((f = fopen(file, "rb")) == NULL)
+    {
+    perror(file);
+    return 1;
+    }
+  fseek(f, 0, SEEK_END);
+  len = ftell(f);
+  rewind(f);
+  text = malloc(len + 1);
+  if (fread(text, 1, len, f) != (size_t)len)
+    len = 0;
+  fclose(f);
+
+  host_lz_steps = 0;
+  host_lz_run(text, len, &st, 1);
+  steps = host_lz_steps;
+
+  t0 = host_lz_ns();
+  for (runs = 0; (t = host_lz_ns() - t0) < HOST_LZ_BENCH_NS; runs++)
+    host_lz_run(text, len, &st, 0);
+  free(text);
+
+  if (st.in == 0)
+    {
+    fprintf(out, "%s: no lines\n", file);
+    return 1;
+    }
+  fprintf(out, "# lz: %u lines in %u K messages, window %d bytes, errors %u\n",
+    st.lines, st.msgs, NET_LZ_WINDOW, st.errors);
+  fprintf(out, "# lz: payload %u -> %u bytes (%.1f%%), on the wire %u -> %u bytes (%.1f%%)\n",
+    st.in, st.out, 100.0 * st.out / st.in,
+    st.wire_text, st.wire_zip, 100.0 * st.wire_zip / st.wire_text);
+  fprintf(out, "# lz: %.1f compares/byte, ~%.0f PIC cycles/byte (%.1f ms per 100 bytes at 5 MIPS), host %.1f ns/byte\n",
+    steps / st.in, steps / st.in * HOST_LZ_CYCLES + HOST_LZ_CYCLES_BYTE,
+    (steps / st.in * HOST_LZ_CYCLES + HOST_LZ_CYCLES_BYTE) * 100 / 5000.0,
+    t / runs / st.in);
+  return (st.errors) ? 1 : 0;
+  }
@@ -0,0 +1,411 @@
+////////////////////////////////////////////////////////////////////////////////
+// Project:       Open Vehicle Monitor System
+// Module:        Host build: command line driver
+//
+// History:
+//
+// 1.0  Initial release
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "ovms.h"
+#include "params.h"
+#include "host.h"
+
+static FILE *host_log = NULL;
+static int host_log_col = 0;
+static const char *host_log_dir = NULL;
+
+static void host_log_time(void)
+  {
+  fprintf(host_log, "%10.4f ", (double)host_now / HOST_FCY);
+  }
+
+static void host_log_byte(const char *dir, unsigned char c)
+  {
+  if (host_log_col && (dir != host_log_dir))
+    {
+    fputc('\n', host_log);
+    host_log_col = 0;
+    }
+  host_log_dir = dir;
+  if (host_log_col == 0)
+    {
+    host_log_time();
+    fputs(dir, host_log);
+    }
+  if (c == '\n')
+    {
+    fputc('\n', host_log);
+    host_log_col = 0;
+    }
+  else
+    {
+    if (c == '\r')
+      fputs("\\r", host_log);
+    else if ((c < 0x20) || (c >= 0x7f))
+      fprintf(host_log, "\\x%02x", c);
+    else
+      fputc(c, host_log);
+    host_log_col++;
+    }
+  }
+
+static void host_log_uart(unsigned char c)
+  {
+  host_log_byte("TX ", c);
+  }
+
+static void host_log_modem(unsigned char c)
+  {
+  host_log_byte("RX ", c);
+  }
+
+static void host_log_can(const host_can_frame_t *f)
+  {
+  int k;
+  if (host_log_col)
+    {
+    fputc('\n', host_log);
+    host_log_col = 0;
+    }
+  host_log_time();
+  fprintf(host_log, "1T11 %03X", (unsigned int)f->id);
+  for (k=0; k<f->dlc; k++)
+    fprintf(host_log, " %02X", f->data[k]);
+  fputc('\n', host_log);
+  }
+
+static int host_eeprom_load(const char *file)
+  {
+  FILE *f = fopen(file, "rb");
+  if (f == NULL)
+    return 0;
+  fread(host_eeprom, 1, sizeof(host_eeprom), f);
+  fclose(f);
+  return 1;
+  }
+
+static void host_eeprom_save(const char *file)
+  {
+  FILE *f = fopen(file, "wb");
+  if (f == NULL)
+    {
+    perror(file);
+    return;
+    }
+  fwrite(host_eeprom, 1, sizeof(host_eeprom), f);
+  fclose(f);
+  }
+
+static void host_flash_load(const char *file)
+  {
+  FILE *f = fopen(file, "rb");
+  if (f == NULL)
+    return;
+  fread(host_flash, 1, sizeof(host_flash), f);
+  fclose(f);
+  }
+
+static void host_flash_save(const char *file)
+  {
+  FILE *f = fopen(file, "wb");
+  if (f == NULL)
+    {
+    perror(file);
+    return;
+    }
+  fwrite(host_flash, 1, sizeof(host_flash), f);
+  fclose(f);
+  }
+
+static void host_usage(const char *prog)
+  {
+  fprintf(stderr,
+    "usage: %s [options]\n"
+    "  -t secs     run for secs of virtual time (default 60)\n"
+    "  -v type     vehicle type (param 14), e.g. TR, RT, KS\n"
+    "  -p n=value  set parameter slot n before boot\n"
+    "  -e file     EEPROM image, loaded if present and saved on exit\n"
+    "  -F file     program flash image, loaded if present and saved on exit\n"
+    "  -l file     log modem output and CAN transmissions ('-' = stdout)\n"
+    "  -m file     emulate the modem, run the scenario script file ('-' = none)\n"
+    "  -c host:port connect AT+CIPSTART to a TCP server (default: sink)\n"
+    "  -r file     replay CAN log (CAN-do CSV or CRTD), stop 2s after the end\n"
+    "  -n passes   replay the log passes times (default 1)\n"
+    "  -x speed    replay time line speed factor (default 1)\n"
+    "  -C [id=]cyc model poll handler run time in instruction cycles\n"
+    "  -s file     write car state snapshot at the end ('-' = stdout)\n"
+    "  -g file     compare car state with golden snapshot (exit code 3 on diff)\n"
+    "  -P          print the high_isr() profile per CAN ID\n"
+    "  -z file     benchmark the history compressor on the lines of file\n"
+    "  -q          no summary\n",
+    prog);
+  exit(1);
+  }
+
+static const char *host_stop_reason(int reason)
+  {
+  switch (reason)
+    {
+    case HOST_STOP_TIME:  return "time limit";
+    case HOST_STOP_EOF:   return "end of input";
+    case HOST_STOP_RESET: return "firmware reset";
+    case HOST_STOP_WDT:   return "watchdog timeout";
+    }
+  return "?";
+  }
+
+int main(int argc, char **argv)
+  {
+  double secs = 0;
+  const char *eefile = NULL;
+  const char *flashfile = NULL;
+  const char *replay = NULL;
+  const char *snapshot = NULL;
+  const char *golden = NULL;
+  const char *modem = NULL;
+  const char *endpoint = NULL;
+  int passes = 1;
+  double speed = 1;
+  int diffs = 0;
+  int quiet = 0;
+  int profile = 0;
+  int opt, reason, stop_at_eof;
+  clock_t wall;
+
+  host_initialise();
+  if (!host_modem_lines_check(stderr))
+    return 1;
+
+  while ((opt = getopt(argc, argv, "t:v:p:e:F:l:m:c:r:n:x:C:s:g:Pz:q")) != -1)
+    {
+    switch (opt)
+      {
+      case 't':
+        secs = atof(optarg);
+        break;
+      case 'v':
+        host_eeprom_param(PARAM_VEHICLETYPE, optarg);
+        break;
+      case 'p':
+        {
+        char *eq = strchr(optarg, '=');
+        if ((eq == NULL) || (atoi(optarg) >= PARAM_MAX))
+          host_usage(argv[0]);
+        host_eeprom_param(atoi(optarg), eq+1);
+        }
+        break;
+      case 'e':
+        eefile = optarg;
+        host_eeprom_load(eefile);
+        break;
+      case 'F':
+        flashfile = optarg;
+        host_flash_load(flashfile);
+        break;
+      case 'l':
+        host_log = (strcmp(optarg, "-") == 0) ? stdout : fopen(optarg, "w");
+        if (host_log == NULL)
+          {
+          perror(optarg);
+          return 1;
+          }
+        host_uart_tx_hook = host_log_uart;
+        host_uart_rx_hook = host_log_modem;
+        host_can_tx_hook = host_log_can;
+        break;
+      case 'm':
+        modem = optarg;
+        break;
+      case 'c':
+        endpoint = optarg;
+        break;
+      case 'r':
+        replay = optarg;
+        break;
+      case 'n':
+        passes = atoi(optarg);
+        break;
+      case 'x':
+        speed = atof(optarg);
+        break;
+      case 'C':
+        {
+        char *eq = strchr(optarg, '=');
+        int id = (eq) ? (int)strtoul(optarg, NULL, 16) : 0x800;
+        if (id > 0x800)
+          host_usage(argv[0]);
+        host_cost[id] = atoi((eq) ? eq+1 : optarg);
+        host_cost_model = 1;
+        }
+        break;
+      case 's':
+        snapshot = optarg;
+        break;
+      case 'g':
+        golden = optarg;
+        break;
+      case 'P':
+        profile = 1;
+        break;
+      case 'z':
+        return host_lz_bench(optarg, stdout);
+      case 'q':
+        quiet = 1;
+        break;
+      default:
+        host_usage(argv[0]);
+      }
+    }
+
+  if ((modem || endpoint) &&
+      !host_modem_open((modem && strcmp(modem, "-")) ? modem : NULL, endpoint))
+    return 1;
+  if (replay && !host_replay_open(replay, passes, speed))
+    return 1;
+  stop_at_eof = (replay != NULL) && (secs <= 0); // -t: run on after the log
+  if (secs <= 0)
+    secs = (replay) ? 7*24*3600 : 60; // replay: run to end of log
+
+  wall = clock();
+  reason = host_run(HOST_SEC(secs), stop_at_eof);
+  wall = clock() - wall;
+  host_replay_close();
+
+  if (host_log && host_log_col)
+    fputc('\n', host_log);
+  if (host_log && (host_log != stdout))
+    fclose(host_log);
+  if (eefile)
+    host_eeprom_save(eefile);
+  if (flashfile)
+    host_flash_save(flashfile);
+
+  if (snapshot)
+    {
+    FILE *f = (strcmp(snapshot, "-") == 0) ? stdout : fopen(snapshot, "w");
+    if (f == NULL)
+      perror(snapshot);
+    else
+      {
+      host_state_dump(f);
+      if (f != stdout)
+        fclose(f);
+      }
+    }
+  if (golden)
+    {
+    diffs = host_state_diff(golden, stdout);
+    if (diffs)
+      printf("# state differs from %s\n", golden);
+    }
+
+  if (!quiet)
+    {
+    double vsec = (double)host_now / HOST_FCY;
+    double wsec = (double)wall / CLOCKS_PER_SEC;
+    printf("# stop: %s\n", host_stop_reason(reason));
+    printf("# virtual time: %.3f s, host time: %.3f s (x%.0f)\n",
+      vsec, wsec, (wsec > 0) ? vsec / wsec : 0.0);
+    printf("# main loops: %u, isr high: %u, isr low: %u\n",
+      host_stats.main_loops, host_stats.isr_high, host_stats.isr_low);
+    printf("# main loop stall: max %.1f ms at %.3f s, uart waits %.1f ms total\n",
+      (double)host_stats.loop_stall * 1000 / HOST_FCY,
+      (double)host_stats.loop_stall_at / HOST_FCY,
+      (double)host_stats.uart_wait * 1000 / HOST_FCY);
+    printf("# net ready waits: %.1f ms total, %u passes over %d ms\n",
+      (double)host_stats.ready_wait * 1000 / HOST_FCY,
+      host_stats.ready_stalls, HOST_STALL_MS);
+    printf("# can rx: %u, accepted: %u, rxb0: %u, rxb1: %u, ovfl0: %u, ovfl1: %u, tx: %u\n",
+      host_stats.can_rx, host_stats.can_accepted, host_stats.can_rxb0,
+      host_stats.can_rxb1, host_stats.can_ovfl0, host_stats.can_ovfl1,
+      host_stats.can_tx);
+    if (vehicle_cantx_sent || vehicle_cantx_errors || vehicle_cantx_drops)
+      printf("# can tx queue: sent %u, errors %u, drops %u, peak %u/%u\n",
+        vehicle_cantx_sent, vehicle_cantx_errors, vehicle_cantx_drops,
+        vehicle_cantx_peak, VEHICLE_CANTX_SIZE);
+    if (host_stats.isr_high_ns > 0)
+      printf("# can decode: %u frames, %.3f ms in high_isr, %.0f frames/s\n",
+        host_stats.can_rxb0 + host_stats.can_rxb1,
+        host_stats.isr_high_ns / 1e6,
+        (host_stats.can_rxb0 + host_stats.can_rxb1) * 1e9 / host_stats.isr_high_ns);
+    if (host_stats.can_accepted > 0)
+      {
+      uint32_t drops = host_stats.can_ovfl0 + host_stats.can_ovfl1;
+#ifdef OVMS_CAN_DEFERRED
+      printf("# can ring: peak %u/%u, drops %u\n",
+        vehicle_canring_peak, VEHICLE_CANRING_SIZE-1, vehicle_canring_drops);
+      drops += vehicle_canring_drops;
+#endif // OVMS_CAN_DEFERRED
+      printf("# can drop rate: %.2f%% (%u of %u accepted, %.0f frames/s)\n",
+        drops * 100.0 / host_stats.can_accepted, drops, host_stats.can_accepted,
+        (host_stats.can_last > host_stats.can_first)
+          ? host_stats.can_accepted / ((double)(host_stats.can_last - host_stats.can_first) / HOST_FCY)
+          : 0.0);
+#ifdef OVMS_CAN_SUPPRESS
+      printf("# can suppress: %u of %u frames skipped (%.1f%%)\n",
+        vehicle_cansupp_skips, vehicle_cansupp_frames, (vehicle_cansupp_frames)
+          ? vehicle_cansupp_skips * 100.0 / vehicle_cansupp_frames : 0.0);
+#endif // OVMS_CAN_SUPPRESS
+#ifdef OVMS_CAN_STATS
+      {
+      unsigned char k;
+      printf("# can bus: %u bit/s, load peak %u.%u%%, ovfl %u/%u, lost %u\n",
+        vehicle_canbus_bitrate, vehicle_canbus.loadpeak / 10,
+        vehicle_canbus.loadpeak % 10, vehicle_canbus.ovfl0,
+        vehicle_canbus.ovfl1, vehicle_canbus.lost);
+      for (k=0; k<VEHICLE_CANSTATS_SIZE; k++)
+        if (vehicle_canstats[k].count)
+          printf("# can stats: %03x frames %u bytes %u changed %u gap %.1f..%.1f ms\n",
+            vehicle_canstats_id[k], vehicle_canstats[k].count,
+            vehicle_canstats[k].bytes, vehicle_canstats[k].changed,
+            (vehicle_canstats[k].count > 1) ? vehicle_canstats[k].gapmin * 0.4096 : 0.0,
+            vehicle_canstats[k].gapmax * 0.4096);
+      }
+#endif // OVMS_CAN_STATS
+      }
+    printf("# uart tx: %u, rx: %u, eeprom reads: %u, writes: %u\n",
+      host_stats.uart_tx, host_stats.uart_rx,
+      host_stats.ee_reads, host_stats.ee_writes);
+    if (par_stat_written || par_stat_skipped)
+      printf("# par_write: eeprom bytes written %u, unchanged %u, blocked %.1f ms total, %.1f ms max\n",
+        par_stat_written, par_stat_skipped, par_stat_blocked * 0.0512, par_stat_blockmax * 0.0512);
+    if (host_ee_cut_param < PARAM_MAX)
+      printf("# eecut: %d writes left, parameter %u reads \"%s\"\n",
+        host_ee_cut, host_ee_cut_param, par_get(host_ee_cut_param));
+    if (host_stats.updates)
+      printf("# status updates: %u, eeprom reads per update %.1f bytes, ~%.0f cycles\n",
+        host_stats.updates, (double)host_stats.update_ee_reads / host_stats.updates,
+        (double)host_stats.update_ee_reads / host_stats.updates * HOST_EE_CYCLES);
+    if (host_stats.flash_erases || host_stats.flash_writes)
+      printf("# flash: block erases %u, writes %u, max erases per block %u\n",
+        host_stats.flash_erases, host_stats.flash_writes, host_stats.flash_wear);
+    if (host_uart_device)
+      host_modem_report(stdout);
+    printf("# car_time: %u, net_state: 0x%02x, car_type: %s\n",
+      car_time, net_state, car_type);
+    }
+  if (profile)
+    host_isrprof_dump(stdout);
+
+  if (reason == HOST_STOP_WDT)
+    return 2;
+  return (diffs) ? 3 : 0;
+  }
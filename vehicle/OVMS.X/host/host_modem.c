@@ -0,0 +1,1195 @@
+////////////////////////////////////////////////////////////////////////////////
+// Project:       Open Vehicle Monitor System
+// Module:        Host build: SIM908/SIM808 modem emulator
+//
+// History:
+//
+// 1.0  Initial release
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+// The socket headers need the real "long" (host_c18.h maps it to int):
+#undef long
+#include <fcntl.h>
+#include <netdb.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#define long int
+
+#include "ovms.h"
+#include "params.h"
+#include "net.h"
+#include "host.h"
+
+////////////////////////////////////////////////////////////////////////
+// Modem model
+//
+// The emulator sits on the PIC UART (host_uart_device) and answers the
+// AT commands of net.c / net_msg.c / net_sms.c like a SIM908 would: one
+// response per command line, echoed as a whole with E1, with the info lines
+// of chained commands ("AT+CREG?;+CSQ") in order and one final result.
+// Responses are delivered after the configured latency; registration,
+// GPRS activation and TCP connects take their own (scriptable) time.
+//
+// The far end of AT+CIPSTART is a host_tcp_peer_t: by default a sink
+// that accepts the connection and discards the data, or a real TCP
+// endpoint (ovms_host -c host:port), or the MP server stand-in in
+// host_mpserver.c (-c mp). A real endpoint paces the virtual clock to the
+// wall clock while connected.
+//
+// A scenario script drives the network side: one action per line,
+// "<seconds> <action> [args]", in time order ('#' starts a comment):
+//
+//   0 param 5 internet.apn   set parameter 5 before boot (time ignored)
+//   0 latency 200 [50]       response latency [+ random jitter] in ms
+//   0 drop 5                 drop 5% of the response chunks
+//   0 delay +CIICR 3000      extra time for a command (+COPS, +CIICR,
+//                            +CIPSTART = TCP connect, +CIPSHUT,
+//                            +CDNSGIP = DNS lookup, also charged to a
+//                            +CIPSTART to a host name)
+//   0 error +CSTT [n]        answer the next n +CSTT with ERROR
+//   0 refuse [n]             next n connects fail (CONNECT FAIL)
+//   0 creg 2                 registration status (URC if enabled)
+//   0 csq 12                 signal quality
+//   0 gps 51.5007 -0.1246 [alt [course]]  GPS fix (nogps: no fix)
+//   60 sms +4912345 STAT     incoming SMS (+CMT)
+//   90 ipd MP-S 0 ...        raw line from the server (+IPD)
+//   120 close                server closes the TCP connection
+//   200 deact                GPRS context lost (+PDP: DEACT)
+//   300 rdy                  modem restart (RDY, all state lost)
+//   400 silent 30            modem hangs for 30 seconds
+//   100 app C1               MP server (-c mp): app message to the car
+//   0 mpack 2000             MP server: history ack delay in ms (-1 = none)
+//   0 mpdelta 0              MP server: no delta status records (default 1)
+//   0 mpbinary 0             MP server: no binary records (default 1)
+//   0 mpzip 0                MP server: no compressed history (default 1)
+//   0 mplog hist.txt         MP server: write compressed history lines
+//   65 eecut 3 15            EEPROM loses all writes after the next 3,
+//                            parameter 15 is read back at the end
+//
+
+#define MODEM_TICK            HOST_MS(10)     // periodic event: peer poll, state sampling
+#define MODEM_LINE_MAX        512
+#define MODEM_DATA_MAX        2048
+#define MODEM_SEND_MAX        1460    // SIM908 CIPSEND length limit
+#define MODEM_DNS_ADDR        "192.0.2.10" // +CDNSGIP answer for any host name
+#define MODEM_RECONNECT_HIST  6
+
+#define MODEM_IP_INITIAL      0
+#define MODEM_IP_GPRSACT      1
+#define MODEM_IP_CONNECTING   2
+#define MODEM_IP_CONNECTED    3
+#define MODEM_IP_CLOSED       4
+
+#define MODEM_ACT_NONE        0               // chunk actions, applied on delivery
+#define MODEM_ACT_CONNECTED   1
+#define MODEM_ACT_CONNFAIL    2
+
+#define MODEM_R_OK            0               // command results
+#define MODEM_R_ERROR         1
+#define MODEM_R_DONE          2               // final result sent by the handler
+#define MODEM_R_PROMPT        3               // "> " sent, data mode follows
+
+static const char *modem_ipstate[] = {
+  "IP INITIAL", "IP GPRSACT", "TCP CONNECTING", "CONNECT OK", "TCP CLOSED" };
+
+// Reconnect time histogram: bucket limits in seconds (the last is open)
+static const int modem_reconnect_secs[MODEM_RECONNECT_HIST-1] = { 2, 5, 10, 30, 60 };
+
+// Response chunk queue, in delivery order
+typedef struct host_modem_out
+  {
+  struct host_modem_out *next;
+  host_cycles_t time;
+  int action;
+  int len;
+  char data[];
+  } host_modem_out_t;
+
+// Scenario action
+typedef struct
+  {
+  host_cycles_t time;
+  char *cmd;
+  char *args;
+  } host_modem_step_t;
+
+// Extra delay / injected errors per command
+typedef struct
+  {
+  char name[16];
+  unsigned int delay_ms;
+  unsigned int errors;
+  unsigned int count;
+  } host_modem_cmd_t;
+
+#define MODEM_CMDS_MAX        64
+
+static struct
+  {
+  int echo;
+  int creg;                   // registration status
+  int creg_urc;               // AT+CREG=n
+  int csq;
+  int ipstate;                // MODEM_IP_*
+  int iphead;                 // AT+CIPHEAD=1
+  int qsend;                  // AT+CIPQSEND=1
+  int datamode;               // 0 = commands, 1 = CIPSEND data, 2 = CMGS text
+  int refuse;
+  unsigned int latency_ms, jitter_ms, drop_pct;
+  host_cycles_t silent_until;
+  int gps_fix;
+  double gps_lat, gps_lon, gps_alt, gps_course;
+  char line[MODEM_LINE_MAX];
+  int line_len;
+  unsigned char data[MODEM_DATA_MAX];
+  int data_len;
+  } modem;
+
+static host_modem_out_t *modem_out_head, *modem_out_tail;
+static host_cycles_t modem_tick_next;
+static host_modem_step_t *modem_steps;
+static int modem_nsteps, modem_step;
+static host_modem_cmd_t modem_cmds[MODEM_CMDS_MAX];
+static int modem_ncmds;
+static const host_tcp_peer_t *modem_peer;
+static unsigned int modem_rand = 1;
+
+// Metrics
+static struct
+  {
+  host_cycles_t first_ok;     // first OK to the firmware
+  host_cycles_t ready;        // firmware net_state READY
+  host_cycles_t connect;      // first CONNECT OK
+  host_cycles_t down_since;   // link lost, not yet reconnected (0 = up)
+  unsigned int losses, reconnects;
+  host_cycles_t reconnect_sum, reconnect_max;
+  unsigned int reconnect_hist[MODEM_RECONNECT_HIST];
+  unsigned int dns_connects;  // CIPSTARTs to a host name
+  unsigned int at_lines, at_bytes, unknown;
+  unsigned int sends, send_bytes, aborts;
+  unsigned int send_max, oversize;
+  unsigned int ipds, ipd_bytes;
+  unsigned int sms_in, sms_out;
+  unsigned int errors, drops;
+  } modem_stats;
+
+
+////////////////////////////////////////////////////////////////////////
+// TCP peers
+//
+
+// Sink: accepts any connection, discards the data
+static int modem_sink_connect(const char *host, const char *port) { return 1; }
+static void modem_sink_send(const unsigned char *data, int len) { }
+static int modem_sink_recv(unsigned char *buf, int size) { return 0; }
+static void modem_sink_close(void) { }
+
+static const host_tcp_peer_t modem_sink = {
+  "sink", modem_sink_connect, modem_sink_send, modem_sink_recv, modem_sink_close, 0, NULL };
+
+// Real TCP endpoint (ovms_host -c host:port)
+static char modem_sock_host[64], modem_sock_port[16];
+static int modem_sock = -1;
+
+static int modem_sock_connect(const char *host, const char *port)
+  {
+  struct addrinfo hints, *res, *ai;
+
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  if (getaddrinfo(modem_sock_host, modem_sock_port, &hints, &res) != 0)
+    return 0;
+  for (ai = res; ai; ai = ai->ai_next)
+    {
+    modem_sock = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+    if (modem_sock < 0)
+      continue;
+    if (connect(modem_sock, ai->ai_addr, ai->ai_addrlen) == 0)
+      break;
+    close(modem_sock);
+    modem_sock = -1;
+    }
+  freeaddrinfo(res);
+  if (modem_sock < 0)
+    return 0;
+  fcntl(modem_sock, F_SETFL, fcntl(modem_sock, F_GETFL) | O_NONBLOCK);
+  return 1;
+  }
+
+static void modem_sock_send(const unsigned char *data, int len)
+  {
+  while ((modem_sock >= 0) && (len > 0))
+    {
+    ssize_t n = send(modem_sock, data, len, MSG_NOSIGNAL);
+    if (n < 0)
+      {
+      if (errno == EAGAIN)
+        continue;
+      return; // recv() reports the close
+      }
+    data += n;
+    len -= n;
+    }
+  }
+
+static int modem_sock_recv(unsigned char *buf, int size)
+  {
+  ssize_t n;
+
+  if (modem_sock < 0)
+    return -1;
+  n = recv(modem_sock, buf, size, 0);
+  if (n == 0)
+    return -1;
+  if (n < 0)
+    return ((errno == EAGAIN) || (errno == EWOULDBLOCK)) ? 0 : -1;
+  return (int)n;
+  }
+
+static void modem_sock_close(void)
+  {
+  if (modem_sock >= 0)
+    close(modem_sock);
+  modem_sock = -1;
+  }
+
+static const host_tcp_peer_t modem_socket = {
+  "socket", modem_sock_connect, modem_sock_send, modem_sock_recv, modem_sock_close, 1, NULL };
+
+// Wall clock pacing for real endpoints: hold the virtual clock back to
+// the wall clock, waiting for data from the peer in the meantime
+static struct timeval modem_wall0;
+static host_cycles_t modem_virt0;
+
+static void modem_pace(void)
+  {
+  struct timeval now, tv;
+  double ahead;
+  fd_set fds;
+
+  gettimeofday(&now, NULL);
+  ahead = (double)(host_now - modem_virt0) / HOST_FCY
+        - ((now.tv_sec - modem_wall0.tv_sec) + (now.tv_usec - modem_wall0.tv_usec) / 1e6);
+  if ((ahead <= 0) || (modem_sock < 0))
+    return;
+  tv.tv_sec = (int)ahead;
+  tv.tv_usec = (int)((ahead - tv.tv_sec) * 1e6);
+  FD_ZERO(&fds);
+  FD_SET(modem_sock, &fds);
+  select(modem_sock+1, &fds, NULL, NULL, &tv);
+  }
+
+
+////////////////////////////////////////////////////////////////////////
+// Output
+//
+
+static unsigned int modem_random(unsigned int range)
+  {
+  modem_rand = modem_rand * 1103515245 + 12345;
+  return (range) ? ((modem_rand >> 16) % range) : 0;
+  }
+
+// Queue a response chunk for delivery after the latency + extra ms
+static void modem_queue(const char *data, int len, unsigned int extra_ms, int action, int droppable)
+  {
+  host_modem_out_t *o;
+  host_cycles_t t = host_now + HOST_MS(modem.latency_ms + modem_random(modem.jitter_ms + 1) + extra_ms);
+
+  if (modem_out_tail && (t < modem_out_tail->time))
+    t = modem_out_tail->time; // keep the order
+  if (droppable && modem.drop_pct && (modem_random(100) < modem.drop_pct))
+    {
+    modem_stats.drops++;
+    len = 0; // state changes still apply
+    }
+  o = malloc(sizeof(host_modem_out_t) + len);
+  o->next = NULL;
+  o->time = t;
+  o->action = action;
+  o->len = len;
+  memcpy(o->data, data, len);
+  if (modem_out_tail)
+    modem_out_tail->next = o;
+  else
+    modem_out_head = o;
+  modem_out_tail = o;
+  }
+
+static void modem_urc(const char *line, int action)
+  {
+  char buf[MODEM_LINE_MAX+8];
+  int len = snprintf(buf, sizeof(buf), "\r\n%s\r\n", line);
+  modem_queue(buf, len, 0, action, 1);
+  }
+
+static void modem_flush(void)
+  {
+  host_modem_out_t *o;
+  while ((o = modem_out_head) != NULL)
+    {
+    modem_out_head = o->next;
+    free(o);
+    }
+  modem_out_tail = NULL;
+  }
+
+
+////////////////////////////////////////////////////////////////////////
+// Link bookkeeping
+//
+
+static void modem_link_down(void)
+  {
+  if (modem.ipstate == MODEM_IP_CONNECTED || modem.ipstate == MODEM_IP_CONNECTING)
+    modem_peer->close();
+  if ((modem.ipstate == MODEM_IP_CONNECTED) && !modem_stats.down_since)
+    {
+    modem_stats.down_since = host_now;
+    modem_stats.losses++;
+    }
+  }
+
+static void modem_link_up(void)
+  {
+  modem.ipstate = MODEM_IP_CONNECTED;
+  if (!modem_stats.connect)
+    modem_stats.connect = host_now;
+  if (modem_stats.down_since)
+    {
+    host_cycles_t t = host_now - modem_stats.down_since;
+    int k;
+    modem_stats.reconnects++;
+    modem_stats.reconnect_sum += t;
+    if (t > modem_stats.reconnect_max)
+      modem_stats.reconnect_max = t;
+    for (k = 0; (k < MODEM_RECONNECT_HIST-1) && (t >= (host_cycles_t)modem_reconnect_secs[k] * HOST_FCY); k++)
+      ;
+    modem_stats.reconnect_hist[k]++;
+    modem_stats.down_since = 0;
+    }
+  if (modem_peer->realtime)
+    {
+    gettimeofday(&modem_wall0, NULL);
+    modem_virt0 = host_now;
+    }
+  }
+
+static void modem_reset(void)
+  {
+  modem_link_down();
+  modem.echo = 1;
+  modem.creg_urc = 0;
+  modem.ipstate = MODEM_IP_INITIAL;
+  modem.iphead = 0;
+  modem.qsend = 0;
+  modem.datamode = 0;
+  modem.line_len = 0;
+  modem.data_len = 0;
+  }
+
+
+////////////////////////////////////////////////////////////////////////
+// AT commands
+//
+
+static host_modem_cmd_t *modem_cmd(const char *name)
+  {
+  int k;
+  for (k = 0; k < modem_ncmds; k++)
+    if (strcasecmp(modem_cmds[k].name, name) == 0)
+      return &modem_cmds[k];
+  if (modem_ncmds == MODEM_CMDS_MAX)
+    return NULL;
+  memset(&modem_cmds[k], 0, sizeof(host_modem_cmd_t));
+  snprintf(modem_cmds[k].name, sizeof(modem_cmds[k].name), "%s", name);
+  modem_ncmds++;
+  return &modem_cmds[k];
+  }
+
+static char *modem_nmea(char *s, double deg, int lonfmt)
+  {
+  double a = fabs(deg);
+  int d = (int)a;
+  snprintf(s, 16, lonfmt ? "%03d%07.4f" : "%02d%07.4f", d % 1000, (a - d) * 60);
+  return s;
+  }
+
+static void modem_clock(char *s, const char *fmt)
+  {
+  // Network time: 2026-10-18 12:00:00 UTC at boot + virtual time
+  time_t t = 1792324800 + (time_t)(host_now / HOST_FCY);
+  struct tm tm;
+  gmtime_r(&t, &tm);
+  strftime(s, 32, fmt, &tm);
+  }
+
+// Handle one command of a command line, info lines go to out
+static int modem_exec(const char *cmd, char *out, unsigned int *delay)
+  {
+  char name[16], info[256];
+  const char *arg;
+  int n, query;
+  host_modem_cmd_t *c;
+
+  info[0] = 0;
+  for (n = 0; cmd[n] && (cmd[n] != '=') && (cmd[n] != '?') && (n < (int)sizeof(name)-1); n++)
+    name[n] = toupper((unsigned char)cmd[n]);
+  name[n] = 0;
+  query = (cmd[n] == '?');
+  arg = (cmd[n] == '=') ? cmd+n+1 : "";
+
+  // Basic commands (ATE0, ATH, AT):
+  if (name[0] != '+')
+    {
+    if (name[0] == 'E')
+      modem.echo = (name[1] == '1');
+    return MODEM_R_OK;
+    }
+
+  c = modem_cmd(name);
+  if (c)
+    {
+    c->count++;
+    *delay += c->delay_ms;
+    if (c->errors)
+      {
+      c->errors--;
+      modem_stats.errors++;
+      return MODEM_R_ERROR;
+      }
+    }
+
+  if (strcmp(name, "+CSMINS") == 0)
+    strcpy(info, "+CSMINS: 0,1");
+  else if (strcmp(name, "+CCID") == 0)
+    strcpy(info, "89490200001234567890");
+  else if (strcmp(name, "+CPIN") == 0)
+    strcpy(info, "+CPIN: READY");
+  else if (strcmp(name, "+IPR") == 0)
+    {
+    if (query)
+      strcpy(info, "+IPR: 9600");
+    }
+  else if (strcmp(name, "+CREG") == 0)
+    {
+    if (query)
+      sprintf(info, "+CREG: %d,%d", modem.creg_urc, modem.creg);
+    else
+      modem.creg_urc = atoi(arg);
+    }
+  else if (strcmp(name, "+COPS") == 0)
+    {
+    if (query)
+      strcpy(info, "+COPS: 0,1,\"OVMS EMU\"");
+    else if ((modem.creg != 1) && (modem.creg != 5))
+      {
+      strcat(out, "\r\n+CME ERROR: no network service\r\n");
+      return MODEM_R_DONE;
+      }
+    }
+  else if (strcmp(name, "+CSQ") == 0)
+    sprintf(info, "+CSQ: %d,0", modem.csq);
+  else if (strcmp(name, "+CCLK") == 0)
+    {
+    char t[32];
+    modem_clock(t, "%y/%m/%d,%H:%M:%S+00");
+    sprintf(info, "+CCLK: \"%s\"", t);
+    }
+  else if (strcmp(name, "+CGATT") == 0)
+    {
+    if (query)
+      sprintf(info, "+CGATT: %d", (modem.creg == 1) || (modem.creg == 5));
+    }
+  else if (strcmp(name, "+CIPHEAD") == 0)
+    modem.iphead = atoi(arg);
+  else if (strcmp(name, "+CIPQSEND") == 0)
+    modem.qsend = atoi(arg);
+  else if (strcmp(name, "+CIICR") == 0)
+    {
+    if ((modem.creg != 1) && (modem.creg != 5))
+      return MODEM_R_ERROR;
+    if (modem.ipstate == MODEM_IP_INITIAL)
+      modem.ipstate = MODEM_IP_GPRSACT;
+    }
+  else if (strcmp(name, "+CIFSR") == 0)
+    {
+    if (modem.ipstate == MODEM_IP_INITIAL)
+      return MODEM_R_ERROR;
+    strcat(out, "\r\n10.64.0.2\r\n");
+    return MODEM_R_DONE;
+    }
+  else if (strcmp(name, "+CIPSTART") == 0)
+    {
+    char host[64] = "", port[16] = "";
+    if (modem.ipstate == MODEM_IP_INITIAL)
+      return MODEM_R_ERROR;
+    if (modem.ipstate == MODEM_IP_CONNECTED)
+      {
+      strcat(out, "\r\nALREADY CONNECT\r\n\r\nERROR\r\n");
+      return MODEM_R_DONE;
+      }
+    sscanf(arg, "\"%*[^\"]\",\"%63[^\"]\",\"%15[^\"]\"", host, port);
+    if (host[strspn(host, "0123456789.")])
+      {
+      // The modem resolves the host name first:
+      modem_stats.dns_connects++;
+      *delay += modem_cmd("+CDNSGIP")->delay_ms;
+      }
+    strcat(out, "\r\nOK\r\n");
+    modem_queue(out, strlen(out), 0, MODEM_ACT_NONE, 1);
+    out[0] = 0;
+    modem.ipstate = MODEM_IP_CONNECTING;
+    if (modem.refuse)
+      {
+      modem.refuse--;
+      modem_queue("\r\nCONNECT FAIL\r\n", 16, *delay, MODEM_ACT_CONNFAIL, 1);
+      }
+    else if (!modem_peer->connect(host, port))
+      modem_queue("\r\nCONNECT FAIL\r\n", 16, *delay, MODEM_ACT_CONNFAIL, 1);
+    else
+      modem_queue("\r\nCONNECT OK\r\n", 14, *delay, MODEM_ACT_CONNECTED, 1);
+    *delay = 0;
+    return MODEM_R_DONE;
+    }
+  else if (strcmp(name, "+CIPSEND") == 0)
+    {
+    if (modem.ipstate != MODEM_IP_CONNECTED)
+      return MODEM_R_ERROR;
+    modem.datamode = 1;
+    modem.data_len = 0;
+    strcat(out, "\r\n> ");
+    return MODEM_R_PROMPT;
+    }
+  else if (strcmp(name, "+CIPCLOSE") == 0)
+    {
+    if (modem.ipstate != MODEM_IP_CONNECTED)
+      return MODEM_R_ERROR;
+    modem_link_down();
+    modem.ipstate = MODEM_IP_CLOSED;
+    strcat(out, "\r\nCLOSE OK\r\n");
+    return MODEM_R_DONE;
+    }
+  else if (strcmp(name, "+CIPSHUT") == 0)
+    {
+    modem_link_down();
+    modem.ipstate = MODEM_IP_INITIAL;
+    strcat(out, "\r\nSHUT OK\r\n");
+    return MODEM_R_DONE;
+    }
+  else if (strcmp(name, "+CIPSTATUS") == 0)
+    sprintf(info, "STATE: %s", modem_ipstate[modem.ipstate]);
+  else if (strcmp(name, "+CDNSGIP") == 0)
+    {
+    char host[64] = "";
+    if (modem.ipstate == MODEM_IP_INITIAL)
+      return MODEM_R_ERROR;
+    sscanf(arg, "\"%63[^\"]\"", host);
+    strcat(out, "\r\nOK\r\n");
+    modem_queue(out, strlen(out), 0, MODEM_ACT_NONE, 1);
+    out[0] = 0;
+    snprintf(info, sizeof(info), "\r\n+CDNSGIP: 1,\"%s\",\"%s\"\r\n", host,
+      host[strspn(host, "0123456789.")] ? MODEM_DNS_ADDR : host);
+    modem_queue(info, strlen(info), *delay, MODEM_ACT_NONE, 1);
+    *delay = 0;
+    return MODEM_R_DONE;
+    }
+  else if (strcmp(name, "+CGPSINF") == 0)
+    {
+    char t[32], lat[16], lon[16];
+    modem_clock(t, "%H%M%S.000");
+    if (atoi(arg) == 64)
+      sprintf(info, "64,%.2f,T,,M,0.0,N,0.0,K,A", modem.gps_course);
+    else if (modem.gps_fix)
+      sprintf(info, "2,%s,%s,%c,%s,%c,1,8,1.0,%.1f,M,47.0,M,,0000",
+        t, modem_nmea(lat, modem.gps_lat, 0), (modem.gps_lat < 0) ? 'S' : 'N',
+        modem_nmea(lon, modem.gps_lon, 1), (modem.gps_lon < 0) ? 'W' : 'E',
+        modem.gps_alt);
+    else
+      sprintf(info, "2,%s,0000.0000,N,00000.0000,E,0,0,0.0,0.0,M,0.0,M,,0000", t);
+    }
+  else if (strcmp(name, "+CGNSINF") == 0)
+    {
+    char t[32];
+    modem_clock(t, "%Y%m%d%H%M%S.000");
+    sprintf(info, "+CGNSINF: 1,%d,%s,%.6f,%.6f,%.1f,0.00,%.1f,1,,1.0,1.3,0.8,,8,%d,,,40,,",
+      modem.gps_fix, t, modem.gps_lat, modem.gps_lon, modem.gps_alt,
+      modem.gps_course, modem.gps_fix ? 8 : 0);
+    }
+  else if (strcmp(name, "+CMGS") == 0)
+    {
+    modem.datamode = 2;
+    modem.data_len = 0;
+    strcat(out, "\r\n> ");
+    return MODEM_R_PROMPT;
+    }
+  else if (!strstr("+CGPSPWR +CGPSRST +CGNSPWR +CPBF +CLIP +CMGF +CNMI +CSDH +CMEE "
+                   "+CIPSPRT +CLTS +CGDCONT +CSTT +CDNSCFG +CLPORT +CUSD +CMGD +CFUN", name))
+    modem_stats.unknown++;
+
+  if (info[0])
+    {
+    strcat(out, "\r\n");
+    strcat(out, info);
+    strcat(out, "\r\n");
+    }
+  return MODEM_R_OK;
+  }
+
+// Handle a command line (without the CR)
+static void modem_line(char *line)
+  {
+  char out[2048], *cmd, *p;
+  unsigned int delay = 0;
+  int r = MODEM_R_OK, quoted = 0;
+
+  if ((toupper((unsigned char)line[0]) != 'A') || (toupper((unsigned char)line[1]) != 'T'))
+    return; // junk / "A/"
+
+  modem_stats.at_lines++;
+  out[0] = 0;
+
+  // Split into commands at ';' outside of quotes:
+  for (cmd = p = line+2; ; p++)
+    {
+    if (*p == '"')
+      quoted = !quoted;
+    if ((*p == ';' && !quoted) || (*p == 0))
+      {
+      char end = *p;
+      *p = 0;
+      r = modem_exec(cmd, out, &delay);
+      if ((r != MODEM_R_OK) || (end == 0))
+        break;
+      cmd = p+1;
+      }
+    }
+
+  if (r == MODEM_R_OK)
+    {
+    strcat(out, "\r\nOK\r\n");
+    if (!modem_stats.first_ok)
+      modem_stats.first_ok = host_now;
+    }
+  else if (r == MODEM_R_ERROR)
+    strcat(out, "\r\nERROR\r\n");
+
+  if (out[0])
+    modem_queue(out, strlen(out), delay, MODEM_ACT_NONE, 1);
+  }
+
+// Data mode byte (CIPSEND payload / SMS text)
+static void modem_data(unsigned char c)
+  {
+  char out[64];
+
+  if (c == 0x1b)
+    {
+    // Abort:
+    modem.datamode = 0;
+    modem_stats.aborts++;
+    return;
+    }
+  if (c != 0x1a)
+    {
+    if (modem.data_len < MODEM_DATA_MAX)
+      modem.data[modem.data_len++] = c;
+    return;
+    }
+
+  if (modem.datamode == 1)
+    {
+    modem_stats.sends++;
+    modem_stats.send_bytes += modem.data_len;
+    if (modem.data_len > modem_stats.send_max)
+      modem_stats.send_max = modem.data_len;
+    if (modem.data_len > MODEM_SEND_MAX)
+      {
+      modem_stats.oversize++;
+      strcpy(out, "\r\nERROR\r\n");
+      }
+    else if (modem.ipstate == MODEM_IP_CONNECTED)
+      {
+      modem_peer->send(modem.data, modem.data_len);
+      if (modem.qsend)
+        sprintf(out, "\r\nDATA ACCEPT:%d\r\n", modem.data_len);
+      else
+        strcpy(out, "\r\nSEND OK\r\n");
+      }
+    else
+      strcpy(out, "\r\nSEND FAIL\r\n");
+    }
+  else
+    {
+    modem_stats.sms_out++;
+    sprintf(out, "\r\n+CMGS: %u\r\n\r\nOK\r\n", modem_stats.sms_out);
+    }
+  modem.datamode = 0;
+  modem_queue(out, strlen(out), 0, MODEM_ACT_NONE, 1);
+  }
+
+
+////////////////////////////////////////////////////////////////////////
+// Scenario
+//
+
+static void modem_incoming(const unsigned char *data, int len)
+  {
+  char head[32];
+  int n;
+
+  modem_stats.ipds++;
+  modem_stats.ipd_bytes += len;
+  n = (modem.iphead) ? sprintf(head, "+IPD,%d:", len) : 0;
+  // A single chunk: the firmware reads the data by length after the head
+  {
+  char *buf = malloc(n + len);
+  memcpy(buf, head, n);
+  memcpy(buf + n, data, len);
+  modem_queue(buf, n + len, 0, MODEM_ACT_NONE, 0);
+  free(buf);
+  }
+  }
+
+static void modem_action(const char *cmd, char *args)
+  {
+  char line[MODEM_LINE_MAX];
+
+  if (strcmp(cmd, "latency") == 0)
+    {
+    modem.latency_ms = atoi(args);
+    modem.jitter_ms = (strchr(args, ' ')) ? atoi(strchr(args, ' ')) : 0;
+    }
+  else if (strcmp(cmd, "drop") == 0)
+    modem.drop_pct = atoi(args);
+  else if (strcmp(cmd, "delay") == 0 || strcmp(cmd, "error") == 0)
+    {
+    char name[16];
+    unsigned int v = 1;
+    host_modem_cmd_t *c;
+    if ((sscanf(args, "%15s %u", name, &v) < 1) || ((c = modem_cmd(name)) == NULL))
+      return;
+    if (cmd[0] == 'd')
+      c->delay_ms = v;
+    else
+      c->errors += v;
+    }
+  else if (strcmp(cmd, "eecut") == 0)
+    {
+    unsigned int p = 0xff;
+    sscanf(args, "%d %u", &host_ee_cut, &p);
+    host_ee_cut_param = p;
+    }
+  else if (strcmp(cmd, "refuse") == 0)
+    modem.refuse += (*args) ? atoi(args) : 1;
+  else if (strcmp(cmd, "creg") == 0)
+    {
+    modem.creg = atoi(args);
+    if (modem.creg_urc)
+      {
+      sprintf(line, "+CREG: %d", modem.creg);
+      modem_urc(line, MODEM_ACT_NONE);
+      }
+    }
+  else if (strcmp(cmd, "csq") == 0)
+    modem.csq = atoi(args);
+  else if (strcmp(cmd, "gps") == 0)
+    {
+    modem.gps_alt = modem.gps_course = 0;
+    modem.gps_fix = (sscanf(args, "%lf %lf %lf %lf", &modem.gps_lat, &modem.gps_lon,
+      &modem.gps_alt, &modem.gps_course) >= 2);
+    }
+  else if (strcmp(cmd, "nogps") == 0)
+    modem.gps_fix = 0;
+  else if (strcmp(cmd, "sms") == 0)
+    {
+    char caller[32] = "", t[32];
+    char *text = strchr(args, ' ');
+    if (text == NULL)
+      return;
+    sscanf(args, "%31s", caller);
+    text++;
+    modem_clock(t, "%y/%m/%d,%H:%M:%S+00");
+    snprintf(line, sizeof(line), "\r\n+CMT: \"%s\",\"\",\"%s\",145,4,0,0,\"+491770000000\",145,%d\r\n%s\r\n",
+      caller, t, (int)strlen(text), text);
+    modem_queue(line, strlen(line), 0, MODEM_ACT_NONE, 0);
+    modem_stats.sms_in++;
+    }
+  else if (strcmp(cmd, "ipd") == 0)
+    {
+    int len = snprintf(line, sizeof(line), "%s\r\n", args);
+    if (modem.ipstate == MODEM_IP_CONNECTED)
+      modem_incoming((unsigned char *)line, len);
+    }
+  else if (strcmp(cmd, "app") == 0)
+    host_mpserver_app(args);
+  else if (strcmp(cmd, "mpack") == 0)
+    host_mpserver_ack(atoi(args));
+  else if (strcmp(cmd, "mpdelta") == 0)
+    host_mpserver_delta(atoi(args));
+  else if (strcmp(cmd, "mpbinary") == 0)
+    host_mpserver_binary(atoi(args));
+  else if (strcmp(cmd, "mpzip") == 0)
+    host_mpserver_zip(atoi(args));
+  else if (strcmp(cmd, "mplog") == 0)
+    host_mpserver_log(args);
+  else if (strcmp(cmd, "notify") == 0)
+    {
+    // Request car notifications (NET_NOTIFY_* bits, hex), time alerts:
+    unsigned int bits = strtoul(args, NULL, 16);
+    net_req_notification(bits);
+    if (bits & (NET_NOTIFY_ALARM|NET_NOTIFY_TRUNK|NET_NOTIFY_CARON|NET_NOTIFY_12VLOW))
+      host_mpserver_expect("PA");
+    }
+  else if (strcmp(cmd, "close") == 0)
+    {
+    if (modem.ipstate == MODEM_IP_CONNECTED)
+      {
+      modem_link_down();
+      modem.ipstate = MODEM_IP_CLOSED;
+      modem_urc("CLOSED", MODEM_ACT_NONE);
+      }
+    }
+  else if (strcmp(cmd, "deact") == 0)
+    {
+    if (modem.ipstate != MODEM_IP_INITIAL)
+      {
+      modem_link_down();
+      modem.ipstate = MODEM_IP_INITIAL;
+      modem_urc("+PDP: DEACT", MODEM_ACT_NONE);
+      }
+    }
+  else if (strcmp(cmd, "rdy") == 0)
+    {
+    modem_flush();
+    modem_reset();
+    modem_urc("RDY", MODEM_ACT_NONE);
+    }
+  else if (strcmp(cmd, "silent") == 0)
+    {
+    modem_flush();
+    modem.silent_until = host_now + HOST_MS(atof(args) * 1000);
+    }
+  else
+    fprintf(stderr, "modem: unknown scenario action '%s'\n", cmd);
+  }
+
+static int modem_step_cmp(const void *a, const void *b)
+  {
+  const host_modem_step_t *x = a, *y = b;
+  if (x->time != y->time)
+    return (x->time < y->time) ? -1 : 1;
+  return (x->cmd < y->cmd) ? -1 : 1; // keep file order (allocated in sequence)
+  }
+
+static int modem_load(const char *file)
+  {
+  FILE *f = fopen(file, "r");
+  char line[MODEM_LINE_MAX], *p, *cmd;
+  double t;
+  int n;
+
+  if (f == NULL)
+    {
+    perror(file);
+    return 0;
+    }
+  while (fgets(line, sizeof(line), f))
+    {
+    line[strcspn(line, "\r\n")] = 0;
+    if ((p = strchr(line, '#')) != NULL && (strncmp(line, "#", 1) == 0 || isspace((unsigned char)p[-1])))
+      *p = 0;
+    if (sscanf(line, "%lf %n", &t, &n) < 1)
+      continue;
+    cmd = line + n;
+    p = cmd + strcspn(cmd, " \t");
+    if (*p)
+      *p++ = 0;
+    while (isspace((unsigned char)*p)) p++;
+    if (strcmp(cmd, "param") == 0)
+      {
+      char *v = strchr(p, ' ');
+      host_eeprom_param(atoi(p), (v) ? v+1 : "");
+      continue;
+      }
+    modem_steps = realloc(modem_steps, (modem_nsteps+1) * sizeof(host_modem_step_t));
+    modem_steps[modem_nsteps].time = HOST_MS(t * 1000);
+    modem_steps[modem_nsteps].cmd = strdup(cmd);
+    modem_steps[modem_nsteps].args = strdup(p);
+    modem_nsteps++;
+    }
+  fclose(f);
+  if (modem_nsteps)
+    qsort(modem_steps, modem_nsteps, sizeof(host_modem_step_t), modem_step_cmp);
+  return 1;
+  }
+
+
+////////////////////////////////////////////////////////////////////////
+// UART device
+//
+
+static void modem_tx(unsigned char c)
+  {
+  if (host_now < modem.silent_until)
+    return;
+
+  if (modem.datamode)
+    {
+    modem_data(c);
+    return;
+    }
+
+  if (c == '\r')
+    {
+    // Echo the command line in one go (keeps the host log readable):
+    if (modem.echo)
+      {
+      modem.line[modem.line_len] = '\r';
+      host_uart_rx(modem.line, modem.line_len + 1);
+      }
+    modem.line[modem.line_len] = 0;
+    modem_stats.at_bytes += modem.line_len + 1;
+    modem_line(modem.line);
+    modem.line_len = 0;
+    }
+  else if ((c != '\n') && (modem.line_len < MODEM_LINE_MAX-1))
+    modem.line[modem.line_len++] = c;
+  }
+
+static host_cycles_t modem_next(void)
+  {
+  host_cycles_t t = modem_tick_next;
+  if (modem_out_head && (modem_out_head->time < t))
+    t = modem_out_head->time;
+  if ((modem_step < modem_nsteps) && (modem_steps[modem_step].time < t))
+    t = modem_steps[modem_step].time;
+  return t;
+  }
+
+static void modem_event(void)
+  {
+  host_modem_out_t *o;
+
+  // Scenario:
+  while ((modem_step < modem_nsteps) && (modem_steps[modem_step].time <= host_now))
+    {
+    modem_action(modem_steps[modem_step].cmd, modem_steps[modem_step].args);
+    modem_step++;
+    }
+
+  // Responses due:
+  while ((o = modem_out_head) != NULL && (o->time <= host_now))
+    {
+    modem_out_head = o->next;
+    if (modem_out_head == NULL)
+      modem_out_tail = NULL;
+    if (o->action == MODEM_ACT_CONNECTED && modem.ipstate == MODEM_IP_CONNECTING)
+      modem_link_up();
+    else if (o->action == MODEM_ACT_CONNFAIL && modem.ipstate == MODEM_IP_CONNECTING)
+      modem.ipstate = MODEM_IP_CLOSED;
+    if (o->len && (host_now >= modem.silent_until))
+      host_uart_rx(o->data, o->len);
+    free(o);
+    }
+
+  if (host_now >= modem_tick_next)
+    {
+    modem_tick_next = host_now + MODEM_TICK;
+
+    if (!modem_stats.ready && (net_state == NET_STATE_READY))
+      modem_stats.ready = host_now;
+
+    // Data from the peer:
+    if (modem.ipstate == MODEM_IP_CONNECTED)
+      {
+      unsigned char buf[512];
+      int n;
+      if (modem_peer->realtime)
+        modem_pace();
+      while ((n = modem_peer->recv(buf, sizeof(buf))) > 0)
+        modem_incoming(buf, n);
+      if (n < 0)
+        {
+        modem_link_down();
+        modem.ipstate = MODEM_IP_CLOSED;
+        modem_urc("CLOSED", MODEM_ACT_NONE);
+        }
+      }
+    }
+  }
+
+static const host_uart_device_t modem_device = { modem_tx, modem_next, modem_event };
+
+
+////////////////////////////////////////////////////////////////////////
+// Interface
+//
+
+// Attach the modem emulator to the UART. script: scenario file or NULL,
+// endpoint: "host:port" of a TCP server for AT+CIPSTART, NULL = sink.
+int host_modem_open(const char *script, const char *endpoint)
+  {
+  memset(&modem, 0, sizeof(modem));
+  memset(&modem_stats, 0, sizeof(modem_stats));
+  modem.creg = 1;
+  modem.csq = 20;
+  modem.latency_ms = 20;
+  modem_cmd("+COPS")->delay_ms = 1000;
+  modem_cmd("+CIICR")->delay_ms = 1500;
+  modem_cmd("+CIPSTART")->delay_ms = 800;
+  modem_cmd("+CIPSHUT")->delay_ms = 200;
+  modem_cmd("+CDNSGIP")->delay_ms = 1000;
+  modem_reset();
+
+  modem_peer = &modem_sink;
+  if (endpoint && (strcmp(endpoint, "mp") == 0))
+    modem_peer = &host_mpserver_peer;
+  else if (endpoint)
+    {
+    const char *colon = strrchr(endpoint, ':');
+    if (colon == NULL)
+      {
+      fprintf(stderr, "modem: endpoint must be host:port\n");
+      return 0;
+      }
+    snprintf(modem_sock_host, sizeof(modem_sock_host), "%.*s", (int)(colon - endpoint), endpoint);
+    snprintf(modem_sock_port, sizeof(modem_sock_port), "%s", colon+1);
+    modem_peer = &modem_socket;
+    }
+
+  if (script && !modem_load(script))
+    return 0;
+
+  modem_tick_next = host_now;
+  host_uart_device = &modem_device;
+  return 1;
+  }
+
+// Consistency check of the response prefix table net_lines[] in net.c:
+// net_line_class() relies on it being sorted, on each lcp being the common
+// prefix length with the previous entry, on the empty sentinel and on
+// net_line_first[] pointing to the first prefix for each first character.
+// Returns 0 and names the first bad entry if the tables are broken.
+int host_modem_lines_check(FILE *out)
+  {
+  uint32_t reads = host_stats.pgm_reads;
+  const net_line_t *l;
+  const char *prev = "";
+  unsigned char n, line;
+  int c;
+
+  for (l = net_lines; l->prefix[0]; prev = l->prefix, l++)
+    {
+    for (n = 0; prev[n] && (prev[n] == l->prefix[n]); n++)
+      ;
+    if ((l > net_lines) && (strcmp(prev, l->prefix) >= 0))
+      {
+      fprintf(out, "net_lines: \"%s\" is out of order\n", l->prefix);
+      return 0;
+      }
+    if ((l->prefix[0] < NET_LINES_LO) || (l->prefix[0] > NET_LINES_HI))
+      {
+      fprintf(out, "net_lines: \"%s\" starts outside net_line_first[]\n", l->prefix);
+      return 0;
+      }
+    if (l->lcp != n)
+      {
+      fprintf(out, "net_lines: \"%s\" lcp %u, should be %u\n", l->prefix, l->lcp, n);
+      return 0;
+      }
+    strcpy(net_buf, l->prefix);
+    net_buf_pos = strlen(net_buf);
+    line = net_line_class();
+    if (line != l->line)
+      {
+      fprintf(out, "net_lines: \"%s\" classified as %u, should be %u\n", l->prefix, line, l->line);
+      return 0;
+      }
+    }
+  if (l->line != NET_LINE_OTHER)
+    {
+    fprintf(out, "net_lines: sentinel is not NET_LINE_OTHER\n");
+    return 0;
+    }
+  for (c = NET_LINES_LO; c <= NET_LINES_HI; c++)
+    {
+    for (l = net_lines; l->prefix[0] && (l->prefix[0] != c); l++)
+      ;
+    n = (l->prefix[0]) ? (l - net_lines) : NET_LINES_NONE;
+    if (net_line_first[c - NET_LINES_LO] != n)
+      {
+      fprintf(out, "net_line_first: '%c' is %u, should be %u\n", c, net_line_first[c - NET_LINES_LO], n);
+      return 0;
+      }
+    }
+  net_buf[0] = 0;
+  net_buf_pos = 0;
+  host_stats.pgm_reads = reads;
+  return 1;
+  }
+
+void host_modem_report(FILE *out)
+  {
+  int k;
+
+#define MODEM_SECS(t) ((t) ? (double)(t) / HOST_FCY : -1.0)
+  fprintf(out, "# modem: first OK %.3f s, net READY %.3f s, TCP connect %.3f s (peer %s)\n",
+    MODEM_SECS(modem_stats.first_ok), MODEM_SECS(modem_stats.ready),
+    MODEM_SECS(modem_stats.connect), modem_peer->name);
+  fprintf(out, "# modem: link losses %u, reconnects %u, reconnect avg %.3f s, max %.3f s%s\n",
+    modem_stats.losses, modem_stats.reconnects,
+    (modem_stats.reconnects) ? (double)modem_stats.reconnect_sum / modem_stats.reconnects / HOST_FCY : 0.0,
+    (double)modem_stats.reconnect_max / HOST_FCY,
+    (modem_stats.down_since) ? ", down at the end" : "");
+  fprintf(out, "# modem: reconnect times");
+  for (k = 0; k < MODEM_RECONNECT_HIST; k++)
+    if (k < MODEM_RECONNECT_HIST-1)
+      fprintf(out, "%s <%ds %u", k ? "," : "", modem_reconnect_secs[k], modem_stats.reconnect_hist[k]);
+    else
+      fprintf(out, ", more %u", modem_stats.reconnect_hist[k]);
+  fprintf(out, ", CIPSTART by host name %u\n", modem_stats.dns_connects);
+  fprintf(out, "# modem: server logins after a loss (DIAG RECONN) <5s %u, <15s %u, <30s %u, <60s %u, <120s %u, more %u\n",
+    net_reconnects[0], net_reconnects[1], net_reconnects[2],
+    net_reconnects[3], net_reconnects[4], net_reconnects[5]);
+  if (host_stats.lines)
+    fprintf(out, "# modem: response lines %u, %.2f ROM compares, %.1f ROM bytes read per line (max %u, %u)\n",
+      host_stats.lines, (double)host_stats.line_compares / host_stats.lines,
+      (double)host_stats.line_reads / host_stats.lines,
+      host_stats.line_compares_max, host_stats.line_reads_max);
+  fprintf(out, "# modem: AT lines %u (%u bytes), CIPSEND %u (%u bytes, %u aborted), +IPD %u (%u bytes)\n",
+    modem_stats.at_lines, modem_stats.at_bytes, modem_stats.sends,
+    modem_stats.send_bytes, modem_stats.aborts, modem_stats.ipds, modem_stats.ipd_bytes);
+  fprintf(out, "# modem: CIPSEND max %u bytes, %u over the %u byte limit\n",
+    modem_stats.send_max, modem_stats.oversize, MODEM_SEND_MAX);
+  fprintf(out, "# modem: SMS in %u, out %u, errors injected %u, chunks dropped %u, unknown commands %u\n",
+    modem_stats.sms_in, modem_stats.sms_out, modem_stats.errors, modem_stats.drops,
+    modem_stats.unknown);
+  fprintf(out, "# modem commands:");
+  for (k = 0; k < modem_ncmds; k++)
+    if (modem_cmds[k].count)
+      fprintf(out, " %s %u", modem_cmds[k].name, modem_cmds[k].count);
+  fprintf(out, "\n");
+  if (modem_peer->report)
+    modem_peer->report(out);
+#undef MODEM_SECS
+  }
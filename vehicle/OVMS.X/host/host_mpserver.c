@@ -0,0 +1,863 @@
+////////////////////////////////////////////////////////////////////////////////
+// Project:       Open Vehicle Monitor System
+// Module:        Host build: MP protocol server stand-in
+//
+// History:
+//
+// 1.0  Initial release
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "ovms.h"
+#include "params.h"
+#include "crypt_base64.h"
+#include "crypt_md5.h"
+#include "crypt_hmac.h"
+#include "crypt_rc4.h"
+#include "host.h"
+
+////////////////////////////////////////////////////////////////////////
+// MP server
+//
+// The far end of the modem's TCP connection (ovms_host -c mp), running
+// in process on the virtual clock. It implements the car side of the MP
+// v2 protocol the way the OVMS server does:
+//
+//   car:    MP-C 0 <ctoken> <base64 hmac(ctoken)> <vehicleid>
+//   server: MP-S 0 <stoken> <base64 hmac(stoken)>
+//
+// both digests keyed with the server password (param 9), then RC4 in both
+// directions keyed with hmac(stoken ctoken), primed with 1024 discarded
+// bytes, each message base64 encoded on its own CRLF terminated line.
+//
+// Simulated apps talk to the car through the modem scenario script:
+//
+//   100 app C1           send "MP-0 C1" (command 1), time the "c1" reply
+//   100 app A            ping, time the "a" reply
+//   100 app Z1           peer count 1 (the car sends a full update)
+//   0 mpack 2000         acknowledge history records ("MP-0 h<n>" or
+//                        "MP-0 h<first>-<last>") after 2000 ms, -1 = never
+//   0 mpdelta 0          don't offer delta status records
+//   0 mpbinary 0         don't offer binary records
+//   0 mpzip 0            don't offer compressed history records
+//   0 mplog hist.txt     write the lines of compressed history messages
+//                        to hist.txt, an empty line after each message
+//
+// The server acknowledges the history records of each TCP send of the car,
+// runs of consecutive sequence numbers as one "h<first>-<last>"; the
+// firmware then erases them from its store (logging_ack()).
+//
+// After the login the server offers delta status records, binary records
+// and compressed history records ("MP-0 Y7"). The car then sends changes
+// of its S, D and L records as "Y<code><bitmap>,<changed fields>", which
+// the server applies to the last record of that code to rebuild the full
+// record for the apps, records with a schema (net_msg_schemas) as
+// "B<schema>...", which the server converts back to text, and runs of
+// history records as "K<net_lz stream>", which the server decompresses
+// and splits into the records.
+//
+
+#define MP_TOKEN_SIZE         22
+#define MP_LINE_MAX           2048
+#define MP_PENDING_MAX        16
+
+// Server to car message queue
+typedef struct host_mp_out
+  {
+  struct host_mp_out *next;
+  host_cycles_t time;
+  int len;
+  char data[];
+  } host_mp_out_t;
+
+// App request waiting for the car's reply
+typedef struct
+  {
+  char reply[8];              // expected reply prefix, e.g. "c1", "a"
+  host_cycles_t time;
+  int alert;                  // car notification instead of app request
+  } host_mp_pending_t;
+
+// Per message code statistics (car to server)
+typedef struct
+  {
+  unsigned int count;
+  unsigned int bytes;         // on the wire: base64 + CRLF
+  unsigned int payload;       // decrypted "MP-0 ..." message
+  } host_mp_code_t;
+
+static struct
+  {
+  int connected;
+  int authenticated;
+  char ctoken[MP_TOKEN_SIZE+1];
+  char stoken[MP_TOKEN_SIZE+1];
+  RC4_CTX1 rx1, tx1;
+  RC4_CTX2 rx2, tx2;
+  char line[MP_LINE_MAX];
+  int line_len;
+  int ack_ms;                 // history ack delay, -1 = no acks
+  int nodelta;                // don't offer delta records
+  int nobinary;               // don't offer binary records
+  int nozip;                  // don't offer compressed history records
+  FILE *log;                  // lines of compressed history messages
+  char *record[128];          // last S, D, L record (fields after the code)
+  host_mp_pending_t pending[MP_PENDING_MAX];
+  int npending;
+  int ack_first, ack_last;    // history records to acknowledge, -1 = none
+  } mp;
+
+static host_mp_out_t *mp_out_head, *mp_out_tail;
+static unsigned int mp_rand = 4711;
+
+// Metrics
+static struct
+  {
+  unsigned int logins, badlogins, badmsgs;
+  host_cycles_t login_time;   // first login (CONNECT -> MP-S)
+  host_cycles_t connect_time;
+  unsigned int requests, replies, lost;
+  host_cycles_t lat_sum, lat_min, lat_max;
+  unsigned int alerts, alerts_in;
+  host_cycles_t alert_sum, alert_max;
+  unsigned int sends, send_lines, send_lines_max;
+  unsigned int hist, hist_acks, hist_dups, hist_gaps;
+  host_cycles_t hist_sum, hist_max;   // ack -> next record
+  host_cycles_t ack_time;
+  unsigned int rx_msgs, rx_bytes, tx_msgs, tx_bytes;
+  unsigned int deltas, keyframes, delta_errors;
+  unsigned int status_bytes, status_full;  // on the wire / as full records
+  unsigned int bin_msgs, bin_bytes, bin_text, bin_errors;
+  unsigned int zip_msgs, zip_lines, zip_bytes, zip_text, zip_errors;
+  host_mp_code_t code[128];
+  } mp_stats;
+
+static unsigned char mp_hist_seen[65536];
+
+
+////////////////////////////////////////////////////////////////////////
+// Protocol
+//
+
+static const char *mp_serverpass(void)
+  {
+  return (const char *)&host_eeprom[PARAM_SERVERPASS * PARAM_MAX_LENGTH];
+  }
+
+static void mp_queue(const char *line, host_cycles_t delay)
+  {
+  int len = strlen(line);
+  host_mp_out_t *o = malloc(sizeof(host_mp_out_t) + len + 2);
+  o->next = NULL;
+  o->time = host_now + delay;
+  if (mp_out_tail && (o->time < mp_out_tail->time))
+    o->time = mp_out_tail->time; // keep the order
+  memcpy(o->data, line, len);
+  memcpy(o->data + len, "\r\n", 2);
+  o->len = len + 2;
+  if (mp_out_tail)
+    mp_out_tail->next = o;
+  else
+    mp_out_head = o;
+  mp_out_tail = o;
+  mp_stats.tx_msgs++;
+  mp_stats.tx_bytes += o->len;
+  }
+
+// Encrypt and queue "MP-0 <msg>"
+static void mp_send(const char *msg, host_cycles_t delay)
+  {
+  char plain[MP_LINE_MAX], wire[MP_LINE_MAX*2];
+  int len;
+
+  if (!mp.authenticated)
+    return;
+  len = snprintf(plain, sizeof(plain), "MP-0 %s", msg);
+  RC4_crypt(&mp.tx1, &mp.tx2, (unsigned char *)plain, len);
+  base64encode((BYTE *)plain, len, (BYTE *)wire);
+  mp_queue(wire, delay);
+  }
+
+static void mp_rc4_init(RC4_CTX1 *c1, RC4_CTX2 *c2, unsigned char *key)
+  {
+  unsigned char x;
+  int k;
+  RC4_setup(c1, c2, key, MD5_SIZE);
+  for (k=0; k<1024; k++)
+    {
+    x = 0;
+    RC4_crypt(c1, c2, &x, 1);
+    }
+  }
+
+// MP-C 0 <token> <digest> <vehicleid>
+static void mp_login(char *line)
+  {
+  const char *pass = mp_serverpass();
+  unsigned char digest[MD5_SIZE];
+  char check[32], *token, *d, key[2*MP_TOKEN_SIZE+1], reply[128];
+  int k;
+
+  token = strtok(line+7, " ");
+  d = strtok(NULL, " ");
+  if (!token || !d || (strlen(token) != MP_TOKEN_SIZE))
+    {
+    mp_stats.badlogins++;
+    return;
+    }
+  hmac_md5((unsigned char *)token, strlen(token), (unsigned char *)pass, strlen(pass), digest);
+  base64encode(digest, MD5_SIZE, (BYTE *)check);
+  if (strcmp(check, d) != 0)
+    {
+    mp_stats.badlogins++;
+    return; // the real server drops the connection
+    }
+  strcpy(mp.ctoken, token);
+
+  for (k=0; k<MP_TOKEN_SIZE; k++)
+    {
+    mp_rand = mp_rand * 1103515245 + 12345;
+    mp.stoken[k] = cb64[(mp_rand >> 16) % 64];
+    }
+  mp.stoken[MP_TOKEN_SIZE] = 0;
+  hmac_md5((unsigned char *)mp.stoken, MP_TOKEN_SIZE, (unsigned char *)pass, strlen(pass), digest);
+  base64encode(digest, MD5_SIZE, (BYTE *)check);
+  snprintf(reply, sizeof(reply), "MP-S 0 %s %s", mp.stoken, check);
+  mp_queue(reply, 0);
+
+  // Session key:
+  strcpy(key, mp.stoken);
+  strcat(key, mp.ctoken);
+  hmac_md5((unsigned char *)key, strlen(key), (unsigned char *)pass, strlen(pass), digest);
+  mp_rc4_init(&mp.rx1, &mp.rx2, digest);
+  mp_rc4_init(&mp.tx1, &mp.tx2, digest);
+  mp.authenticated = 1;
+  if (!mp.nodelta || !mp.nobinary || !mp.nozip)
+    {
+    sprintf(reply, "Y%d", (mp.nodelta ? 0 : 1) | (mp.nobinary ? 0 : 2) | (mp.nozip ? 0 : 4));
+    mp_send(reply, 0);
+    }
+
+  mp_stats.logins++;
+  if (!mp_stats.login_time)
+    mp_stats.login_time = host_now - mp_stats.connect_time;
+  }
+
+// Wire size of a "MP-0 ..." message of <len> bytes: base64 + CRLF
+#define MP_WIRELEN(len)       ((((len)+2)/3)*4+2)
+
+// Delta record "Y<code><bitmap>,<changed fields>": replace the fields
+// flagged in the hex bitmap (first digit = fields 0-3, bit 0 = field 0)
+// in the last record of <code>
+static void mp_delta(const char *msg, int wire)
+  {
+  char rec[MP_LINE_MAX], chg[MP_LINE_MAX], out[MP_LINE_MAX];
+  char *fields[128], *r, *c;
+  const char *bitmap = msg + 1;
+  unsigned char code = msg[0] & 0x7f;
+  int k, n, nbits, digit;
+
+  mp_stats.deltas++;
+  mp_stats.status_bytes += wire;
+  c = strchr(bitmap, ',');
+  if (!mp.record[code] || !c)
+    {
+    mp_stats.delta_errors++;
+    return;
+    }
+  nbits = 4 * (c - bitmap);
+  strcpy(chg, c);
+
+  // Split the last record:
+  strcpy(rec, mp.record[code]);
+  for (n=0, r=rec; (n < 128) && r; n++)
+    {
+    fields[n] = r;
+    if ((r = strchr(r, ',')) != NULL)
+      *r++ = 0;
+    }
+
+  // Replace the flagged fields, c = separator before the next value:
+  for (k=0, c=chg; k < nbits; k++)
+    {
+    digit = bitmap[k/4];
+    digit = (digit <= '9') ? digit - '0' : digit - 'A' + 10;
+    if (digit & (1 << (k%4)))
+      {
+      if ((k >= n) || !c)
+        {
+        mp_stats.delta_errors++;
+        return;
+        }
+      fields[k] = c + 1;
+      if ((c = strchr(c + 1, ',')) != NULL)
+        *c = 0;
+      }
+    }
+  if (c)
+    {
+    mp_stats.delta_errors++;  // more values than flagged fields
+    return;
+    }
+
+  // Rebuild the full record:
+  for (k=0, r=out; k<n; k++)
+    r += sprintf(r, (k) ? ",%s" : "%s", fields[k]);
+  free(mp.record[code]);
+  mp.record[code] = strdup(out);
+  mp_stats.status_full += MP_WIRELEN(strlen(out) + 6);
+  }
+
+// The server's copy of the firmware's binary record schemas
+// (net_msg_schemas in net_msg.c): record prefix, field types
+static const struct
+  {
+  const char *prefix;
+  const char *types;
+  } mp_schemas[] =
+  {
+  { "S", "isiissiiiiiiiiiiii2iiiiiiiiiiii11i" },
+  { "D", "iiiiiiiuiuiiii1i1ii1" },
+  { "L", "66iiiiiix1uu" },
+  { "W", "ninininii" },
+  { "F", "ssiiss" },
+  { "HRT-BAT-P,", "iuiiiiiiiiiiiiiii" },
+  { "HRT-BAT-C,", "iuiiiiiiiiii" },
+  };
+
+static int mp_varint(const unsigned char **b, const unsigned char *e, uint32_t *v)
+  {
+  int shift = 0;
+  *v = 0;
+  while ((*b < e) && (shift < 35))
+    {
+    unsigned char c = *(*b)++;
+    *v |= (uint32_t)(c & 0x7f) << shift;
+    if (!(c & 0x80))
+      return 1;
+    shift += 7;
+    }
+  return 0;
+  }
+
+// Binary record "B<schema>..." (len bytes) => text record, 0 = error
+static int mp_binary(const unsigned char *b, int len, char *text)
+  {
+  const unsigned char *e = b + len;
+  const char *types;
+  unsigned char bitmap[MP_LINE_MAX];
+  int schema, delta, digits = 0, k, i, dec, first = 1;
+  uint32_t v, div;
+  char *t = text;
+
+  if (len < 2)
+    return 0;
+  b++;
+  schema = *b & 0x7f;
+  delta = *b++ & 0x80;
+  if (schema >= (int)(sizeof(mp_schemas) / sizeof(mp_schemas[0])))
+    return 0;
+  types = mp_schemas[schema].types;
+  t += sprintf(t, "%s%s", delta ? "Y" : "", mp_schemas[schema].prefix);
+  if (delta)
+    {
+    if (b >= e)
+      return 0;
+    digits = *b++;
+    for (k=0; k<digits; k++)
+      {
+      if (b + k/2 >= e)
+        return 0;
+      bitmap[k] = (k & 1) ? (b[k/2] >> 4) : (b[k/2] & 0x0f);
+      *t++ = "0123456789ABCDEF"[bitmap[k]];
+      }
+    b += (digits + 1) / 2;
+    }
+
+  for (k=0; types[k] && (b < e); k++)
+    {
+    if (delta)
+      {
+      if (k/4 >= digits)
+        return 0;
+      if (!(bitmap[k/4] & (1 << (k%4))))
+        continue;
+      *t++ = ',';
+      }
+    else if (!first)
+      *t++ = ',';
+    first = 0;
+
+    if (types[k] == 's')
+      {
+      while ((b < e) && *b)
+        *t++ = *b++;
+      if (b++ >= e)
+        return 0;
+      continue;
+      }
+    if (types[k] == 'x')
+      {
+      t += sprintf(t, "%02X", *b++);
+      continue;
+      }
+    if (!mp_varint(&b, e, &v))
+      return 0;
+    if (types[k] == 'u')
+      {
+      t += sprintf(t, "%u", v);
+      continue;
+      }
+    // zigzag:
+    if (v & 1)
+      *t++ = '-';
+    v = (v + 1) >> 1;
+    dec = 0;
+    if (types[k] == 'n')
+      {
+      dec = v & 7;
+      v >>= 3;
+      }
+    else if ((types[k] >= '1') && (types[k] <= '6'))
+      dec = types[k] - '0';
+    for (div=1, i=0; i < dec; i++)
+      div *= 10;
+    if (dec)
+      t += sprintf(t, "%u.%0*u", v / div, dec, v % div);
+    else
+      t += sprintf(t, "%u", v);
+    }
+  *t = 0;
+  return (b == e) && (delta || !types[k]);
+  }
+
+// Decrypted message from the car (without "MP-0 "), <binary> = converted
+// from a binary record or unpacked from a compressed message (counted as
+// "B" or "K")
+// Acknowledge the pending run of history records
+static void mp_ack(void)
+  {
+  char ack[24];
+
+  if (mp.ack_first < 0)
+    return;
+  if (mp.ack_first == mp.ack_last)
+    sprintf(ack, "h%d", mp.ack_first);
+  else
+    sprintf(ack, "h%d-%d", mp.ack_first, mp.ack_last);
+  mp.ack_first = mp.ack_last = -1;
+  mp_send(ack, HOST_MS(mp.ack_ms));
+  mp_stats.hist_acks++;
+  mp_stats.ack_time = mp_out_tail->time;
+  }
+
+static void mp_message(const char *msg, int wire, int binary)
+  {
+  int k;
+  unsigned char code = msg[0] & 0x7f;
+
+  if (!binary)
+    {
+    mp_stats.code[code].count++;
+    mp_stats.code[code].bytes += wire;
+    mp_stats.code[code].payload += strlen(msg) + 5;
+    }
+
+  if ((code == 'S')||(code == 'D')||(code == 'L'))
+    {
+    free(mp.record[code]);
+    mp.record[code] = strdup(msg+1);
+    mp_stats.status_bytes += wire;
+    mp_stats.status_full += MP_WIRELEN(strlen(msg) + 5);
+    if (!mp.nodelta)
+      mp_stats.keyframes++;
+    }
+  else if (code == 'Y')
+    {
+    mp_delta(msg+1, wire);
+    return;
+    }
+
+  // Reply to an app request?
+  for (k=0; k<mp.npending; k++)
+    {
+    if (strncmp(msg, mp.pending[k].reply, strlen(mp.pending[k].reply)) == 0)
+      {
+      host_cycles_t t = host_now - mp.pending[k].time;
+      if (mp.pending[k].alert)
+        {
+        mp_stats.alerts_in++;
+        mp_stats.alert_sum += t;
+        if (t > mp_stats.alert_max)
+          mp_stats.alert_max = t;
+        mp.pending[k] = mp.pending[--mp.npending];
+        break;
+        }
+      mp_stats.replies++;
+      mp_stats.lat_sum += t;
+      if (!mp_stats.lat_min || (t < mp_stats.lat_min))
+        mp_stats.lat_min = t;
+      if (t > mp_stats.lat_max)
+        mp_stats.lat_max = t;
+      mp.pending[k] = mp.pending[--mp.npending];
+      break;
+      }
+    }
+
+  // History record: "h<n>,..."
+  if (code == 'h')
+    {
+    int n = atoi(msg+1) & 0xffff;
+    mp_stats.hist++;
+    if (mp_hist_seen[n])
+      mp_stats.hist_dups++; // resent: ack lost or too late
+    mp_hist_seen[n] = 1;
+    if (mp_stats.ack_time)
+      {
+      // (0 if the car sent the record before it got the ack)
+      host_cycles_t t = (host_now > mp_stats.ack_time) ? host_now - mp_stats.ack_time : 0;
+      mp_stats.hist_sum += t;
+      mp_stats.hist_gaps++;
+      if (t > mp_stats.hist_max)
+        mp_stats.hist_max = t;
+      mp_stats.ack_time = 0;
+      }
+    if (mp.ack_ms >= 0)
+      {
+      if ((mp.ack_first >= 0) && (n != ((mp.ack_last + 1) & 0xffff)))
+        mp_ack();
+      if (mp.ack_first < 0)
+        mp.ack_first = n;
+      mp.ack_last = n;
+      }
+    }
+  }
+
+// Compressed history records: "MP-0 K" + net_lz stream of the records
+// without "MP-0 ", each terminated by '\n'
+static void mp_zip(const unsigned char *z, int len, int wire)
+  {
+  char text[MP_LINE_MAX*2];
+  char *p, *nl;
+  int n;
+
+  mp_stats.code['K'].count++;
+  mp_stats.code['K'].bytes += wire;
+  mp_stats.code['K'].payload += len + 6;
+  mp_stats.zip_msgs++;
+  mp_stats.zip_bytes += wire;
+  n = host_lz_decode(z, len, text, sizeof(text));
+  if ((n <= 0) || (text[n-1] != '\n'))
+    {
+    mp_stats.zip_errors++;
+    return;
+    }
+  text[n] = 0;
+  for (p = text; (nl = strchr(p, '\n')) != NULL; p = nl + 1)
+    {
+    *nl = 0;
+    mp_stats.zip_lines++;
+    mp_stats.zip_text += MP_WIRELEN(strlen(p) + 5);
+    if (mp.log)
+      fprintf(mp.log, "%s\n", p);
+    mp_message(p, wire, 1);
+    }
+  if (mp.log)
+    fprintf(mp.log, "\n");
+  }
+
+static void mp_line(char *line, int wire)
+  {
+  char plain[MP_LINE_MAX];
+  int len;
+
+  mp_stats.rx_msgs++;
+  mp_stats.rx_bytes += wire;
+
+  if (!mp.authenticated)
+    {
+    if (strncmp(line, "MP-C 0 ", 7) == 0)
+      mp_login(line);
+    else
+      mp_stats.badmsgs++;
+    return;
+    }
+
+  if (strlen(line) * 3 / 4 >= sizeof(plain))
+    {
+    mp_stats.badmsgs++;
+    return;
+    }
+  len = base64decode((BYTE *)line, (BYTE *)plain);
+  RC4_crypt(&mp.rx1, &mp.rx2, (unsigned char *)plain, len);
+  plain[len] = 0;
+  if (strncmp(plain, "MP-0 ", 5) != 0)
+    {
+    mp_stats.badmsgs++;
+    return;
+    }
+  if (plain[5] == 'B')
+    {
+    char text[MP_LINE_MAX];
+    mp_stats.code['B'].count++;
+    mp_stats.code['B'].bytes += wire;
+    mp_stats.code['B'].payload += len;
+    mp_stats.bin_msgs++;
+    mp_stats.bin_bytes += wire;
+    if (!mp_binary((unsigned char *)plain+5, len-5, text))
+      {
+      mp_stats.bin_errors++;
+      return;
+      }
+    mp_stats.bin_text += MP_WIRELEN(strlen(text) + 5);
+    mp_message(text, wire, 1);
+    return;
+    }
+  if (plain[5] == 'K')
+    {
+    mp_zip((unsigned char *)plain+6, len-6, wire);
+    return;
+    }
+  mp_message(plain+5, wire, 0);
+  }
+
+
+////////////////////////////////////////////////////////////////////////
+// TCP peer interface
+//
+
+static void mp_flush(void)
+  {
+  host_mp_out_t *o;
+  while ((o = mp_out_head) != NULL)
+    {
+    mp_out_head = o->next;
+    free(o);
+    }
+  mp_out_tail = NULL;
+  }
+
+static int mp_connect(const char *host, const char *port)
+  {
+  int k, n;
+
+  mp_flush();
+  mp.connected = 1;
+  mp.authenticated = 0;
+  mp.line_len = 0;
+  mp.ack_first = mp.ack_last = -1;
+  // App requests of the previous session are lost, alerts still due:
+  for (k=0, n=0; k<mp.npending; k++)
+    {
+    if (mp.pending[k].alert)
+      mp.pending[n++] = mp.pending[k];
+    else
+      mp_stats.lost++;
+    }
+  mp.npending = n;
+  mp_stats.connect_time = host_now;
+  return 1;
+  }
+
+// One call per CIPSEND
+static void mp_tcp_send(const unsigned char *data, int len)
+  {
+  unsigned int lines = 0;
+
+  mp_stats.sends++;
+  while (len-- > 0)
+    {
+    char c = *data++;
+    if (c == '\n')
+      {
+      lines++;
+      if (mp.line_len && (mp.line[mp.line_len-1] == '\r'))
+        mp.line_len--;
+      mp.line[mp.line_len] = 0;
+      if (mp.line_len)
+        mp_line(mp.line, mp.line_len + 2);
+      mp.line_len = 0;
+      }
+    else if (mp.line_len < MP_LINE_MAX-1)
+      mp.line[mp.line_len++] = c;
+    }
+  mp_ack(); // the history records of this send
+  mp_stats.send_lines += lines;
+  if (lines > mp_stats.send_lines_max)
+    mp_stats.send_lines_max = lines;
+  }
+
+// One message per call, so each becomes an +IPD of its own
+static int mp_recv(unsigned char *buf, int size)
+  {
+  host_mp_out_t *o = mp_out_head;
+  int len;
+
+  if (!mp.connected)
+    return -1;
+  if ((o == NULL) || (o->time > host_now))
+    return 0;
+  len = (o->len < size) ? o->len : size;
+  memcpy(buf, o->data, len);
+  mp_out_head = o->next;
+  if (mp_out_head == NULL)
+    mp_out_tail = NULL;
+  free(o);
+  return len;
+  }
+
+static void mp_close(void)
+  {
+  mp.connected = 0;
+  mp.authenticated = 0;
+  mp_flush();
+  }
+
+const host_tcp_peer_t host_mpserver_peer = {
+  "mp", mp_connect, mp_tcp_send, mp_recv, mp_close, 0, host_mpserver_report };
+
+
+////////////////////////////////////////////////////////////////////////
+// Scenario interface
+//
+
+// Simulated app message: "C<cmd>[,args]", "A", "Z<n>"
+void host_mpserver_app(const char *msg)
+  {
+  char reply[8];
+
+  if ((msg[0] == 'C') || (msg[0] == 'A'))
+    {
+    mp_stats.requests++;
+    if (!mp.authenticated)
+      {
+      mp_stats.lost++;
+      return; // no car connected
+      }
+    if (msg[0] == 'C')
+      snprintf(reply, sizeof(reply), "c%d", atoi(msg+1));
+    else
+      strcpy(reply, "a");
+    if (mp.npending == MP_PENDING_MAX)
+      mp_stats.lost++;
+    else
+      {
+      strcpy(mp.pending[mp.npending].reply, reply);
+      mp.pending[mp.npending].alert = 0;
+      mp.pending[mp.npending++].time = host_now;
+      }
+    }
+  mp_send(msg, 0);
+  }
+
+// Car notification requested by the scenario: time the arrival of the
+// message starting with <expect>, e.g. "PA" for an alert
+void host_mpserver_expect(const char *expect)
+  {
+  mp_stats.alerts++;
+  if (mp.npending < MP_PENDING_MAX)
+    {
+    snprintf(mp.pending[mp.npending].reply, sizeof(mp.pending[0].reply), "%s", expect);
+    mp.pending[mp.npending].alert = 1;
+    mp.pending[mp.npending++].time = host_now;
+    }
+  }
+
+void host_mpserver_ack(int ms)
+  {
+  mp.ack_ms = ms;
+  }
+
+void host_mpserver_delta(int on)
+  {
+  mp.nodelta = !on;
+  }
+
+void host_mpserver_binary(int on)
+  {
+  mp.nobinary = !on;
+  }
+
+void host_mpserver_zip(int on)
+  {
+  mp.nozip = !on;
+  }
+
+void host_mpserver_log(const char *file)
+  {
+  if (mp.log)
+    fclose(mp.log);
+  if ((mp.log = fopen(file, "w")) == NULL)
+    perror(file);
+  }
+
+static unsigned int mp_pending(int alert)
+  {
+  int k;
+  unsigned int n = 0;
+  for (k=0; k<mp.npending; k++)
+    if (mp.pending[k].alert == alert)
+      n++;
+  return n;
+  }
+
+void host_mpserver_report(FILE *out)
+  {
+  int k;
+
+  fprintf(out, "# mp: logins %u (%u failed), first login %.3f s after connect, bad messages %u\n",
+    mp_stats.logins, mp_stats.badlogins, (double)mp_stats.login_time / HOST_FCY,
+    mp_stats.badmsgs);
+  fprintf(out, "# mp: car -> server %u msgs %u bytes, server -> car %u msgs %u bytes\n",
+    mp_stats.rx_msgs, mp_stats.rx_bytes, mp_stats.tx_msgs, mp_stats.tx_bytes);
+  fprintf(out, "# mp: app requests %u, replies %u, lost %u, latency min/avg/max %.3f/%.3f/%.3f s\n",
+    mp_stats.requests, mp_stats.replies, mp_stats.lost + mp_pending(0),
+    (double)mp_stats.lat_min / HOST_FCY,
+    (mp_stats.replies) ? (double)mp_stats.lat_sum / mp_stats.replies / HOST_FCY : 0.0,
+    (double)mp_stats.lat_max / HOST_FCY);
+  fprintf(out, "# mp: alerts %u, delivered %u, latency avg/max %.3f/%.3f s\n",
+    mp_stats.alerts, mp_stats.alerts_in,
+    (mp_stats.alerts_in) ? (double)mp_stats.alert_sum / mp_stats.alerts_in / HOST_FCY : 0.0,
+    (double)mp_stats.alert_max / HOST_FCY);
+  fprintf(out, "# mp: car sends %u, lines per send avg/max %.1f/%u\n",
+    mp_stats.sends, (mp_stats.sends) ? (double)mp_stats.send_lines / mp_stats.sends : 0.0,
+    mp_stats.send_lines_max);
+  fprintf(out, "# mp: history records %u (%u resent), acks %u, ack to next record avg/max %.3f/%.3f s\n",
+    mp_stats.hist, mp_stats.hist_dups, mp_stats.hist_acks,
+    (mp_stats.hist_gaps) ? (double)mp_stats.hist_sum / mp_stats.hist_gaps / HOST_FCY : 0.0,
+    (double)mp_stats.hist_max / HOST_FCY);
+  fprintf(out, "# mp: status records %u bytes on the wire, %u as full records (%.1f%%), deltas %u, keyframes %u, errors %u\n",
+    mp_stats.status_bytes, mp_stats.status_full,
+    (mp_stats.status_full) ? 100.0 * mp_stats.status_bytes / mp_stats.status_full : 0.0,
+    mp_stats.deltas, mp_stats.keyframes, mp_stats.delta_errors);
+  fprintf(out, "# mp: binary records %u, %u bytes on the wire, %u as text (%.1f%%), errors %u\n",
+    mp_stats.bin_msgs, mp_stats.bin_bytes, mp_stats.bin_text,
+    (mp_stats.bin_text) ? 100.0 * mp_stats.bin_bytes / mp_stats.bin_text : 0.0,
+    mp_stats.bin_errors);
+  fprintf(out, "# mp: compressed history %u msgs with %u records, %u bytes on the wire, %u as text (%.1f%%), errors %u\n",
+    mp_stats.zip_msgs, mp_stats.zip_lines, mp_stats.zip_bytes, mp_stats.zip_text,
+    (mp_stats.zip_text) ? 100.0 * mp_stats.zip_bytes / mp_stats.zip_text : 0.0,
+    mp_stats.zip_errors);
+  for (k=0; k<128; k++)
+    if (mp_stats.code[k].count)
+      fprintf(out, "# mp msg %c: %u, %.1f bytes on the wire, %.1f bytes payload\n",
+        k, mp_stats.code[k].count,
+        (double)mp_stats.code[k].bytes / mp_stats.code[k].count,
+        (double)mp_stats.code[k].payload / mp_stats.code[k].count);
+  }
@@ -0,0 +1,211 @@
+////////////////////////////////////////////////////////////////////////////////
+// Project:       Open Vehicle Monitor System
+// Module:        Host build: CAN log replay (CAN-do CSV, CRTD)
+//
+// History:
+//
+// 1.0  Initial release
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "ovms.h"
+#include "host.h"
+
+////////////////////////////////////////////////////////////////////////
+// Log formats
+//
+// CAN-do CSV (vehicle/roadster_canlogs/*.csv), hex fields, time in seconds:
+//   TYPE,TIME,ID,D1,D2,D3,D4,D5,D6,D7,D8
+//   RD11,0.0518,100,88,7F,FF,FF,FF,FF,46
+// Only RD11 (received standard data) lines are replayed.
+//
+// CRTD (others/roadster_can_crtd.pl), time in seconds (usually UTC epoch):
+//   1378618126.470 R11 280 00 00 00 00 00 00 00 00
+// The record type may carry a bus number prefix ("1R11"). Only R11 is
+// replayed; comments, transmissions and 29 bit frames are skipped.
+//
+// Frame times are made relative to the first frame of the log. Rewinding
+// (for repeated benchmark runs) continues the time line after the last
+// frame of the previous pass.
+//
+
+static FILE *replay_file = NULL;
+static int replay_csv;
+static int replay_passes = 1;
+static double replay_speed = 1;
+static int replay_pass;
+static int replay_first;
+static double replay_t0;                  // time of first frame in the log
+static double replay_last;                // time of last frame returned
+static double replay_offset;              // time line offset of current pass
+
+static int host_replay_hex(const char *s, unsigned long *val)
+  {
+  char *end;
+  while (isspace((unsigned char)*s)) s++;
+  if (!isxdigit((unsigned char)*s))
+    return 0;
+  *val = strtoul(s, &end, 16);
+  while (isspace((unsigned char)*end)) end++;
+  return (*end == 0);
+  }
+
+// Parse a CAN-do CSV line, returns 1 for a frame
+static int host_replay_csv(char *line, double *t, host_can_frame_t *f)
+  {
+  char *field[11];
+  int n = 0;
+  unsigned long v;
+  char *p = line;
+
+  while ((n < 11) && p)
+    {
+    field[n++] = p;
+    p = strchr(p, ',');
+    if (p) *p++ = 0;
+    }
+  if ((n < 3) || (strcmp(field[0], "RD11") != 0))
+    return 0;
+
+  *t = atof(field[1]);
+  if (!host_replay_hex(field[2], &v) || (v > 0x7ff))
+    return 0;
+  f->id = v;
+  for (f->dlc = 0; f->dlc < n-3; f->dlc++)
+    {
+    if (!host_replay_hex(field[3+f->dlc], &v) || (v > 0xff))
+      break;
+    f->data[f->dlc] = v;
+    }
+  return 1;
+  }
+
+// Parse a CRTD line, returns 1 for a frame
+static int host_replay_crtd(char *line, double *t, host_can_frame_t *f)
+  {
+  char *tok, *type;
+  unsigned long v;
+
+  if ((tok = strtok(line, " \t")) == NULL)
+    return 0;
+  *t = atof(tok);
+  if ((type = strtok(NULL, " \t")) == NULL)
+    return 0;
+  while (isdigit((unsigned char)*type)) type++; // bus number
+  if (strcmp(type, "R11") != 0)
+    return 0;
+  if (((tok = strtok(NULL, " \t")) == NULL) || !host_replay_hex(tok, &v) || (v > 0x7ff))
+    return 0;
+  f->id = v;
+  for (f->dlc = 0; f->dlc < 8; f->dlc++)
+    {
+    if (((tok = strtok(NULL, " \t")) == NULL) || !host_replay_hex(tok, &v) || (v > 0xff))
+      break;
+    f->data[f->dlc] = v;
+    }
+  return 1;
+  }
+
+// host_can_source_t reading the opened log
+int host_replay_frame(host_can_frame_t *frame)
+  {
+  char line[256];
+  double t;
+  int ok;
+
+  if (replay_file == NULL)
+    return 0;
+
+  for (;;)
+    {
+    if (fgets(line, sizeof(line), replay_file) == NULL)
+      {
+      if (++replay_pass >= replay_passes)
+        return 0;
+      rewind(replay_file);
+      replay_offset = replay_last + 0.001;
+      replay_first = 1;
+      continue;
+      }
+    line[strcspn(line, "\r\n")] = 0;
+
+    memset(frame, 0, sizeof(*frame));
+    ok = (replay_csv)
+      ? host_replay_csv(line, &t, frame)
+      : host_replay_crtd(line, &t, frame);
+    if (!ok)
+      continue;
+
+    if (replay_first)
+      {
+      replay_t0 = t;
+      replay_first = 0;
+      }
+    t = t - replay_t0 + replay_offset;
+    if (t < replay_last)
+      t = replay_last; // keep time order
+    replay_last = t;
+    frame->time = (host_cycles_t)(t / replay_speed * HOST_FCY);
+    return 1;
+    }
+  }
+
+// Open a log for replay, the format is detected from the header. The log
+// is played passes times in a row, speed > 1 compresses the time line.
+// Returns 0 on failure.
+int host_replay_open(const char *file, int passes, double speed)
+  {
+  char line[256];
+  int n;
+
+  replay_file = fopen(file, "r");
+  if (replay_file == NULL)
+    {
+    perror(file);
+    return 0;
+    }
+
+  replay_csv = 0;
+  for (n = 0; (n < 20) && fgets(line, sizeof(line), replay_file); n++)
+    {
+    if ((strncmp(line, "TYPE,TIME,ID", 12) == 0) || (strncmp(line, "RD11,", 5) == 0))
+      {
+      replay_csv = 1;
+      break;
+      }
+    }
+  rewind(replay_file);
+
+  replay_passes = (passes > 0) ? passes : 1;
+  replay_speed = (speed > 0) ? speed : 1;
+  replay_pass = 0;
+  replay_first = 1;
+  replay_offset = replay_last = 0;
+  host_can_source = host_replay_frame;
+  return 1;
+  }
+
+void host_replay_close(void)
+  {
+  if (replay_file)
+    fclose(replay_file);
+  replay_file = NULL;
+  if (host_can_source == host_replay_frame)
+    host_can_source = NULL;
+  }
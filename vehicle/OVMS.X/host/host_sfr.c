@@ -0,0 +1,952 @@
+////////////////////////////////////////////////////////////////////////////////
+// Project:       Open Vehicle Monitor System
+// Module:        Host build: virtual PIC18 hardware (SFRs, timers, CAN, UART, EEPROM)
+//
+// History:
+//
+// 1.0  Initial release
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "ovms.h"
+#include "params.h"
+#include "host.h"
+
+extern rom char EEparam[PARAM_MAX][PARAM_MAX_LENGTH]; // params.c
+
+////////////////////////////////////////////////////////////////////////
+// Emulation model
+//
+// The firmware runs unmodified in a single host thread. It reaches the
+// virtual hardware through host_sfr(), which applies the side effects of
+// the previous access (EEPROM cycles, CAN TXREQ, UART TXREG) before handing
+// out the register. Virtual time only advances where the PIC would wait
+// for hardware:
+//   - main loop TMR0L reads (idle step to the next event),
+//   - TMR2IF polls in the delay5/delay100 loops,
+//   - C18 DelayxTCYx() calls,
+//   - spin loops on EEPROM/CAN TX completion and UART ISR state.
+// Code execution itself takes no virtual time. Interrupts (high_isr for
+// CAN, low_isr for UART + TMR1) are dispatched at those points as the
+// PIC would after the wait, honouring GIEH/GIEL, IPEN and IPR priorities.
+//
+
+unsigned char host_sfr_file[HOST_SFR_COUNT+1];
+unsigned char host_eeprom[1024];
+int host_ee_cut = -1;
+unsigned char host_ee_cut_param = 0xff;
+unsigned char host_flash[HOST_FLASH_SIZE];
+static uint32_t host_flash_erased[HOST_FLASH_SIZE / HOST_FLASH_BLOCK];
+host_cycles_t host_now;
+host_stats_t host_stats;
+host_isrprof_t host_isrprof[0x801];
+int host_cost_model;
+host_cycles_t host_cost[0x801];
+host_can_source_t host_can_source = NULL;
+void (*host_can_tx_hook)(const host_can_frame_t *frame) = NULL;
+void (*host_uart_tx_hook)(unsigned char c) = NULL;
+void (*host_uart_rx_hook)(unsigned char c) = NULL;
+const host_uart_device_t *host_uart_device = NULL;
+
+#define R(n)                  host_sfr_file[HOST_SFR_##n]
+
+#define HOST_LOOP_CYCLES      200             // min. cost of a main loop pass
+#define HOST_WDT_CYCLES       HOST_MS(16384)  // WDTPS 4096 x 4 ms
+#define HOST_EEWRITE_CYCLES   HOST_MS(4)      // EEPROM byte write time
+#define HOST_EOF_GRACE        HOST_SEC(2)     // run on after the last frame
+#define HOST_ISR_CYCLES       100             // CAN ISR entry/exit + RX buffer copy (cost model)
+
+static jmp_buf host_stop_jmp;
+static host_cycles_t host_limit;
+static int host_stop_at_eof;
+static int host_in_isr;
+static unsigned char host_last_idx = 0xff;
+
+// Timers:
+static host_cycles_t tmr0_base;
+static unsigned char tmr0h_set;
+static host_cycles_t tmr1_next;
+static host_cycles_t tmr2_next;
+static host_cycles_t tmr3_base;
+static uint16_t tmr3_set;
+static host_cycles_t wdt_last;
+
+// UART:
+#define HOST_RXQ_SIZE 4096
+static int txreg_pending;
+static host_cycles_t uart_tx_done;
+static host_cycles_t loop_end;
+static unsigned char uart_rxq[HOST_RXQ_SIZE];
+static unsigned int uart_rxq_rd, uart_rxq_wr;
+static host_cycles_t uart_rx_next;
+
+// EEPROM:
+static host_cycles_t ee_write_done;
+
+// CAN:
+static host_can_frame_t can_next;
+static int can_next_valid;
+static int can_eof;
+static host_cycles_t can_t0;
+static host_cycles_t can_bus_free;         // end of the last frame on the bus
+static host_cycles_t can_tx_done[3];
+
+static void host_stop(int reason)
+  {
+  longjmp(host_stop_jmp, reason);
+  }
+
+static void host_advance(host_cycles_t until);
+
+
+////////////////////////////////////////////////////////////////////////
+// Peripheral timing
+//
+
+static host_cycles_t host_uart_byte_cycles(void)
+  {
+  // 10 bits per byte, baud = Fosc / (16|64 * (SPBRG+1))
+  return (host_cycles_t)(R(SPBRG)+1) * ((R(TXSTA) & 0x04) ? 40 : 160);
+  }
+
+static host_cycles_t host_can_frame_cycles(unsigned char dlc)
+  {
+  // Bit time in Tq from BRGCON1..3, Tq = 2*(BRP+1)/Fosc = (BRP+1)/2 TCY
+  unsigned int tq = 1 + ((R(BRGCON2) & 0x07)+1) + (((R(BRGCON2)>>3) & 0x07)+1)
+                      + ((R(BRGCON3) & 0x07)+1);
+  unsigned int brp = (R(BRGCON1) & 0x3f) + 1;
+  // Standard data frame: 47 bits + data, ~10% stuffing
+  unsigned int bits = ((47 + 8*(dlc & 0x0f)) * 11) / 10;
+  return ((host_cycles_t)bits * tq * brp + 1) / 2;
+  }
+
+static host_cycles_t host_tmr1_period(void)
+  {
+  return (host_cycles_t)65536 << ((R(T1CON) >> 4) & 0x03);
+  }
+
+static host_cycles_t host_tmr2_period(void)
+  {
+  static const unsigned char prescale[4] = { 1, 4, 16, 16 };
+  return (host_cycles_t)(R(PR2)+1) * prescale[R(T2CON) & 0x03]
+         * (((R(T2CON) >> 3) & 0x0f) + 1);
+  }
+
+
+////////////////////////////////////////////////////////////////////////
+// CAN controller (legacy mode 0, standard ids)
+//
+
+static int host_can_match(unsigned char flt, unsigned char msk, uint32_t id)
+  {
+  unsigned int fid = ((unsigned int)host_sfr_file[flt] << 3)
+                   | (host_sfr_file[flt+1] >> 5);
+  unsigned int mid = ((unsigned int)host_sfr_file[msk] << 3)
+                   | (host_sfr_file[msk+1] >> 5);
+  if (host_sfr_file[flt+1] & 0x08)
+    return 0; // EXIDEN: extended frames only
+  return (((id ^ fid) & mid) == 0);
+  }
+
+static void host_can_receive(const host_can_frame_t *f)
+  {
+  static const unsigned char filters[6] = {
+    HOST_SFR_RXF0SIDH, HOST_SFR_RXF1SIDH, HOST_SFR_RXF2SIDH,
+    HOST_SFR_RXF3SIDH, HOST_SFR_RXF4SIDH, HOST_SFR_RXF5SIDH };
+  unsigned char opmode = R(CANCON) >> 5;
+  int buf = -1, hit = 0, k;
+  unsigned char base;
+
+  if (host_stats.can_rx++ == 0)
+    host_stats.can_first = host_now;
+  host_stats.can_last = host_now;
+
+  // Only normal (0), loopback (2) and listen only (3) modes receive:
+  if ((opmode != 0) && (opmode != 2) && (opmode != 3))
+    return;
+
+  // Acceptance: RXB0 = RXM0 + RXF0/1, RXB1 = RXM1 + RXF2..5
+  if ((R(RXB0CON) & 0x60) == 0x60)
+    buf = 0;
+  else
+    {
+    for (k=0; k<2 && buf<0; k++)
+      if (host_can_match(filters[k], HOST_SFR_RXM0SIDH, f->id))
+        { buf = 0; hit = k; }
+    }
+  if (buf < 0)
+    {
+    if ((R(RXB1CON) & 0x60) == 0x60)
+      buf = 1;
+    else
+      {
+      for (k=2; k<6 && buf<0; k++)
+        if (host_can_match(filters[k], HOST_SFR_RXM1SIDH, f->id))
+          { buf = 1; hit = k; }
+      }
+    }
+  if (buf < 0)
+    return;
+
+  host_stats.can_accepted++;
+
+  if ((buf == 0) && (R(RXB0CON) & 0x80))
+    {
+    if ((R(RXB0CON) & 0x04) && !(R(RXB1CON) & 0x80))
+      buf = 1; // RXB0DBEN: roll over into RXB1
+    else
+      {
+      R(COMSTAT) |= 0x80; // RXB0OVFL
+      host_stats.can_ovfl0++;
+      return;
+      }
+    }
+  else if ((buf == 1) && (R(RXB1CON) & 0x80))
+    {
+    R(COMSTAT) |= 0x40; // RXB1OVFL
+    host_stats.can_ovfl1++;
+    return;
+    }
+
+  base = (buf == 0) ? HOST_SFR_RXB0CON : HOST_SFR_RXB1CON;
+  host_sfr_file[base+1] = (f->id >> 3) & 0xff;
+  host_sfr_file[base+2] = (f->id & 0x07) << 5;
+  host_sfr_file[base+3] = 0;
+  host_sfr_file[base+4] = 0;
+  host_sfr_file[base+5] = f->dlc & 0x0f;
+  memcpy(&host_sfr_file[base+6], f->data, 8);
+  if (buf == 0)
+    {
+    host_sfr_file[base] = (host_sfr_file[base] & 0x7e) | 0x80 | hit;
+    R(PIR3) |= 0x01;
+    host_stats.can_rxb0++;
+    }
+  else
+    {
+    host_sfr_file[base] = (host_sfr_file[base] & 0x78) | 0x80 | hit;
+    R(PIR3) |= 0x02;
+    host_stats.can_rxb1++;
+    }
+  }
+
+static void host_can_fetch(void)
+  {
+  if (can_next_valid || can_eof || (host_can_source == NULL)
+      || (host_stats.main_loops == 0))
+    return; // replay starts with the first main loop pass
+  if (host_can_source(&can_next))
+    {
+    // The bus serializes frames: a frame can't complete before the end
+    // of the previous frame plus its own transmission time
+    can_next.time += can_t0;
+    if (can_next.time < can_bus_free + host_can_frame_cycles(can_next.dlc))
+      can_next.time = can_bus_free + host_can_frame_cycles(can_next.dlc);
+    can_bus_free = can_next.time;
+    can_next_valid = 1;
+    }
+  else
+    {
+    can_eof = 1;
+    if (host_stop_at_eof && (host_limit > host_now + HOST_EOF_GRACE))
+      host_limit = host_now + HOST_EOF_GRACE;
+    }
+  }
+
+static void host_can_transmit(unsigned char n)
+  {
+  unsigned char base = HOST_SFR_TXB0CON + n*(HOST_SFR_TXB1CON-HOST_SFR_TXB0CON);
+  host_can_frame_t f;
+
+  f.time = host_now;
+  f.id = ((unsigned int)host_sfr_file[base+1] << 3) | (host_sfr_file[base+2] >> 5);
+  f.dlc = host_sfr_file[base+5] & 0x0f;
+  memcpy(f.data, &host_sfr_file[base+6], 8);
+
+  host_sfr_file[base] &= ~0x08;           // TXREQ done
+  R(PIR3) |= (0x04 << n);                 // TXBnIF
+  host_stats.can_tx++;
+  if (host_can_tx_hook)
+    host_can_tx_hook(&f);
+  }
+
+
+////////////////////////////////////////////////////////////////////////
+// Pending side effects of register writes, evaluated before each access
+//
+
+static void host_commit(void)
+  {
+  unsigned char n;
+  unsigned int addr;
+
+  // UART: TXREG written
+  if (txreg_pending)
+    {
+    txreg_pending = 0;
+    R(PIR1) &= ~0x10;   // TXIF
+    R(TXSTA) &= ~0x02;  // TRMT
+    uart_tx_done = host_now + host_uart_byte_cycles();
+    host_stats.uart_tx++;
+    if (host_uart_tx_hook)
+      host_uart_tx_hook(R(TXREG));
+    if (host_uart_device)
+      host_uart_device->tx(R(TXREG));
+    }
+
+  // CAN: TXREQ set
+  for (n=0; n<3; n++)
+    {
+    unsigned char con = HOST_SFR_TXB0CON + n*(HOST_SFR_TXB1CON-HOST_SFR_TXB0CON);
+    if ((host_sfr_file[con] & 0x08) && (can_tx_done[n] == 0))
+      can_tx_done[n] = host_now + host_can_frame_cycles(host_sfr_file[con+5]);
+    }
+
+  // CAN: CANSTAT follows the requested operation mode
+  R(CANSTAT) = (R(CANSTAT) & 0x1f) | (R(CANCON) & 0xe0);
+
+  // EEPROM
+  addr = (((unsigned int)R(EEADRH) << 8) | R(EEADR)) & 0x3ff;
+  if (R(EECON1) & 0x01)
+    {
+    R(EEDATA) = host_eeprom[addr];
+    R(EECON1) &= ~0x01;
+    host_stats.ee_reads++;
+    }
+  if ((R(EECON1) & 0x06) == 0x06 && (ee_write_done == 0))
+    {
+    if (host_ee_cut != 0)
+      host_eeprom[addr] = R(EEDATA);
+    if (host_ee_cut > 0)
+      host_ee_cut--;
+    ee_write_done = host_now + HOST_EEWRITE_CYCLES;
+    host_stats.ee_writes++;
+    }
+
+  // ADC: conversion completes immediately (12.6V on the 47 counts/V divider)
+  if (R(ADCON0) & 0x02)
+    {
+    R(ADCON0) &= ~0x02;
+    R(ADRESL) = 592 & 0xff;
+    R(ADRESH) = 592 >> 8;
+    }
+  }
+
+
+////////////////////////////////////////////////////////////////////////
+// Interrupt dispatch (outside of ISRs only)
+//
+
+// High priority (CAN) ISR, timed on the host clock for decoder throughput.
+// The time is accounted to the ID of the first frame pending (RXB0 first),
+// the host dispatches the ISR for each received frame.
+static void host_high_isr(void)
+  {
+  struct timespec t0, t1;
+  host_isrprof_t *p;
+  uint64_t ns;
+  unsigned int id = 0x800; // no frame pending
+
+  if (R(RXB0CON) & 0x80)
+    id = ((unsigned int)R(RXB0SIDH) << 3) | (R(RXB0SIDL) >> 5);
+  else if (R(RXB1CON) & 0x80)
+    id = ((unsigned int)R(RXB1SIDH) << 3) | (R(RXB1SIDL) >> 5);
+
+  host_in_isr = 2;
+  host_stats.isr_high++;
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  high_isr();
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+  if (host_cost_model)
+    host_advance(host_now + HOST_ISR_CYCLES); // ISR entry/exit
+  host_in_isr = 0;
+
+  ns = (uint64_t)(t1.tv_sec - t0.tv_sec) * 1000000000 + (t1.tv_nsec - t0.tv_nsec);
+  host_stats.isr_high_ns += ns;
+  p = &host_isrprof[id];
+  if ((p->count == 0) || (ns < p->min)) p->min = ns;
+  if (ns > p->max) p->max = ns;
+  p->sum += ns;
+  p->count++;
+  }
+
+static void host_interrupts(void)
+  {
+  unsigned char n, p1, p3;
+  static int storm = 0;
+
+  if (host_in_isr)
+    return;
+
+  for (n=0; n<100; n++)
+    {
+    host_commit();
+    p1 = R(PIR1) & R(PIE1);
+    p3 = R(PIR3) & R(PIE3);
+    if (R(RCON) & 0x80)
+      {
+      // IPEN: high priority via GIEH, low priority via GIEL
+      if ((R(INTCON) & 0x80) && ((p1 & R(IPR1)) || (p3 & R(IPR3))))
+        {
+        host_high_isr();
+        continue;
+        }
+      if (((R(INTCON) & 0xc0) == 0xc0) && ((p1 & ~R(IPR1)) || (p3 & ~R(IPR3))))
+        {
+        host_in_isr = 1;
+        host_stats.isr_low++;
+        low_isr();
+        host_in_isr = 0;
+        continue;
+        }
+      }
+    else if (((R(INTCON) & 0xc0) == 0xc0) && (p1 || p3))
+      {
+      // Compatibility mode: everything vectors to 0x08
+      host_high_isr();
+      continue;
+      }
+    return;
+    }
+
+  if (!storm)
+    {
+    fprintf(stderr, "host: interrupt storm (PIR1=%02x PIE1=%02x PIR3=%02x PIE3=%02x)\n",
+      R(PIR1), R(PIE1), R(PIR3), R(PIE3));
+    storm = 1;
+    }
+  }
+
+
+////////////////////////////////////////////////////////////////////////
+// Virtual clock
+//
+
+// Process all events due at host_now
+static void host_events(void)
+  {
+  unsigned char n;
+
+  host_commit();
+
+  if ((R(T1CON) & 0x01) && (tmr1_next == 0))
+    tmr1_next = host_now + host_tmr1_period();
+  while (tmr1_next && (host_now >= tmr1_next))
+    {
+    R(PIR1) |= 0x01; // TMR1IF
+    tmr1_next += host_tmr1_period();
+    }
+
+  if (uart_tx_done && (host_now >= uart_tx_done))
+    {
+    uart_tx_done = 0;
+    R(PIR1) |= 0x10;   // TXIF
+    R(TXSTA) |= 0x02;  // TRMT
+    }
+
+  if ((uart_rxq_rd != uart_rxq_wr) && !(R(PIR1) & 0x20) && (host_now >= uart_rx_next))
+    {
+    R(RCREG) = uart_rxq[uart_rxq_rd];
+    uart_rxq_rd = (uart_rxq_rd + 1) % HOST_RXQ_SIZE;
+    R(PIR1) |= 0x20;   // RCIF
+    uart_rx_next = host_now + host_uart_byte_cycles();
+    host_stats.uart_rx++;
+    }
+
+  for (n=0; n<3; n++)
+    {
+    if (can_tx_done[n] && (host_now >= can_tx_done[n]))
+      {
+      can_tx_done[n] = 0;
+      host_can_transmit(n);
+      }
+    }
+
+  if (ee_write_done && (host_now >= ee_write_done))
+    {
+    ee_write_done = 0;
+    R(EECON1) &= ~0x02; // WR done
+    }
+
+  if (host_uart_device && (host_now >= host_uart_device->next()))
+    host_uart_device->event();
+
+  host_can_fetch();
+  if (can_next_valid && (host_now >= can_next.time))
+    {
+    can_next_valid = 0;
+    host_can_receive(&can_next);
+    host_can_fetch();
+    }
+  }
+
+// Time of the next hardware event, or limit
+static host_cycles_t host_next_event(host_cycles_t limit)
+  {
+  host_cycles_t t = limit;
+  unsigned char n;
+
+#define HOST_EARLIER(x) { if ((x) && ((x) < t)) t = (x); }
+  HOST_EARLIER(tmr1_next);
+  HOST_EARLIER(uart_tx_done);
+  if ((uart_rxq_rd != uart_rxq_wr) && !(R(PIR1) & 0x20))
+    HOST_EARLIER((uart_rx_next > host_now) ? uart_rx_next : host_now);
+  for (n=0; n<3; n++)
+    HOST_EARLIER(can_tx_done[n]);
+  HOST_EARLIER(ee_write_done);
+  if (can_next_valid)
+    HOST_EARLIER((can_next.time > host_now) ? can_next.time : host_now);
+  if (host_uart_device)
+    HOST_EARLIER((host_uart_device->next() > host_now) ? host_uart_device->next() : host_now);
+#undef HOST_EARLIER
+
+  return t;
+  }
+
+// Advance the virtual clock to 'until', processing events and interrupts
+static void host_advance(host_cycles_t until)
+  {
+  for (;;)
+    {
+    host_cycles_t t = host_next_event(until);
+    if (t > host_now)
+      host_now = t;
+    host_events();
+    host_interrupts();
+
+    if (host_now >= host_limit)
+      host_stop((can_eof && host_stop_at_eof) ? HOST_STOP_EOF : HOST_STOP_TIME);
+    if ((R(T0CON) & 0x80) && (host_now - wdt_last > HOST_WDT_CYCLES))
+      host_stop(HOST_STOP_WDT);
+    if (host_now >= until)
+      break;
+    }
+  }
+
+// Main loop idle step: run to the next event or TMR0H increment
+static void host_idle(void)
+  {
+  host_cycles_t tick = 256*256;
+  host_cycles_t next = host_now + HOST_LOOP_CYCLES;
+  host_cycles_t t0 = tmr0_base + ((host_now - tmr0_base) / tick + 1) * tick;
+
+  // Main loop pass (firmware work incl. busy waits) since the last idle step:
+  if (host_stats.main_loops && (host_now - loop_end > host_stats.loop_stall))
+    {
+    host_stats.loop_stall = host_now - loop_end;
+    host_stats.loop_stall_at = host_now;
+    }
+  if (host_stats.main_loops && (net_state == NET_STATE_READY))
+    {
+    host_stats.ready_wait += host_now - loop_end;
+    if (host_now - loop_end > HOST_MS(HOST_STALL_MS))
+      host_stats.ready_stalls++;
+    }
+
+  if (host_stats.main_loops++ == 0)
+    {
+    // Start CAN replay with the first main loop pass:
+    can_t0 = host_now;
+    host_can_fetch();
+    }
+
+  next = host_next_event((t0 > next) ? t0 : next);
+  if (next < host_now + HOST_LOOP_CYCLES)
+    next = host_now + HOST_LOOP_CYCLES;
+  host_advance(next);
+  loop_end = host_now;
+  }
+
+static void host_tmr0_update(void)
+  {
+  uint32_t count;
+
+  if (R(TMR0H) != tmr0h_set)
+    {
+    // TMR0H has been written (buffered write, takes effect with TMR0L):
+    tmr0_base = host_now - ((host_cycles_t)R(TMR0H) << 16);
+    }
+  count = (R(T0CON) & 0x80) ? (uint32_t)((host_now - tmr0_base) >> 8) : 0;
+  R(TMR0L) = count & 0xff;
+  R(TMR0H) = tmr0h_set = (count >> 8) & 0xff;
+  }
+
+
+// TMR1 (RD16): counts up to the next TMR1IF overflow event, reading
+// TMR1L latches TMR1H. Writes are ignored (the firmware only clears it).
+static void host_tmr1_update(void)
+  {
+  uint16_t count = 0;
+
+  if (tmr1_next > host_now)
+    count = (uint16_t)(0x10000 - ((tmr1_next - host_now) >> ((R(T1CON) >> 4) & 0x03)));
+  R(TMR1L) = count & 0xff;
+  R(TMR1H) = count >> 8;
+  }
+
+// TMR3 (1:1, RD16): free running instruction counter, a write to
+// TMR3H:TMR3L restarts the count from the value written
+static void host_tmr3_update(void)
+  {
+  uint16_t set = ((uint16_t)R(TMR3H) << 8) | R(TMR3L);
+  uint16_t count;
+
+  if (set != tmr3_set)
+    tmr3_base = host_now - set;
+  count = (R(T3CON) & 0x01)
+    ? (uint16_t)((host_now - tmr3_base) >> ((R(T3CON) >> 4) & 0x03)) : set;
+  R(TMR3L) = count & 0xff;
+  R(TMR3H) = count >> 8;
+  tmr3_set = count;
+  }
+
+
+////////////////////////////////////////////////////////////////////////
+// Register access
+//
+
+volatile unsigned char *host_sfr(unsigned char idx)
+  {
+  unsigned char spin = (idx == host_last_idx) && !host_in_isr;
+  host_last_idx = idx;
+
+  host_commit();
+
+  switch (idx)
+    {
+    case HOST_SFR_TXREG:
+      txreg_pending = 1; // write only
+      break;
+    case HOST_SFR_RCREG:
+      R(PIR1) &= ~0x20; // read clears RCIF
+      break;
+    case HOST_SFR_TMR0L:
+      if (!host_in_isr)
+        {
+        host_tmr0_update();
+        host_idle();
+        }
+      host_tmr0_update();
+      break;
+    case HOST_SFR_TMR1L:
+      host_tmr1_update();
+      break;
+    case HOST_SFR_TMR3L:
+    case HOST_SFR_TMR3H:
+      host_tmr3_update();
+      break;
+    case HOST_SFR_TMR2:
+      tmr2_next = host_now + host_tmr2_period();
+      break;
+    case HOST_SFR_PIR1:
+      if (!host_in_isr && (R(T2CON) & 0x04) && !(R(PIR1) & 0x02))
+        {
+        // delay loop polling TMR2IF
+        if (tmr2_next <= host_now)
+          tmr2_next = host_now + host_tmr2_period();
+        host_advance(tmr2_next);
+        tmr2_next += host_tmr2_period();
+        R(PIR1) |= 0x02;
+        }
+      break;
+    case HOST_SFR_EECON1:
+      if (spin && ee_write_done)
+        host_advance(ee_write_done);
+      break;
+    case HOST_SFR_TXB0CON:
+    case HOST_SFR_TXB1CON:
+    case HOST_SFR_TXB2CON:
+      {
+      unsigned char n = (idx - HOST_SFR_TXB0CON) / (HOST_SFR_TXB1CON-HOST_SFR_TXB0CON);
+      if (spin && can_tx_done[n])
+        host_advance(can_tx_done[n]);
+      }
+      break;
+    }
+
+  return &host_sfr_file[idx];
+  }
+
+volatile unsigned short *host_sfr16(unsigned char idx)
+  {
+  host_sfr(idx);
+  return (volatile unsigned short *)&host_sfr_file[idx];
+  }
+
+
+////////////////////////////////////////////////////////////////////////
+// Firmware library / instruction stand-ins
+//
+
+void host_delay_tcy(unsigned int tcy)
+  {
+  if (!host_in_isr)
+    host_advance(host_now + tcy);
+  }
+
+// C18 flash.h: program flash erase and write stall the CPU (TIE, TIW)
+#define HOST_FLASH_CYCLES   HOST_MS(2)
+
+// The stalled CPU takes no interrupts: CAN frames go to the RX buffers
+// (or overflow them) and are dispatched after the stall
+static void host_flash_stall(void)
+  {
+  int isr = host_in_isr;
+
+  host_in_isr = 3;
+  host_advance(host_now + HOST_FLASH_CYCLES);
+  host_in_isr = isr;
+  }
+
+void ReadFlash(unsigned long startaddr, unsigned int num_bytes, unsigned char *flash_array)
+  {
+  while (num_bytes-- > 0)
+    *flash_array++ = host_flash[startaddr++ % HOST_FLASH_SIZE];
+  }
+
+void EraseFlash(unsigned long startaddr, unsigned long endaddr)
+  {
+  unsigned int b;
+
+  startaddr &= ~(HOST_FLASH_BLOCK-1);
+  for (; (startaddr <= endaddr) && (startaddr < HOST_FLASH_SIZE); startaddr += HOST_FLASH_BLOCK)
+    {
+    memset(&host_flash[startaddr], 0xff, HOST_FLASH_BLOCK);
+    b = startaddr / HOST_FLASH_BLOCK;
+    if (++host_flash_erased[b] > host_stats.flash_wear)
+      host_stats.flash_wear = host_flash_erased[b];
+    host_stats.flash_erases++;
+    host_flash_stall();
+    }
+  }
+
+// Programming can only clear bits, a block must be erased before
+void WriteBlockFlash(unsigned long startaddr, unsigned char num_blocks, unsigned char *flash_array)
+  {
+  unsigned int k;
+
+  startaddr &= ~(HOST_FLASH_BLOCK-1);
+  for (; (num_blocks > 0) && (startaddr < HOST_FLASH_SIZE); num_blocks--, startaddr += HOST_FLASH_BLOCK)
+    {
+    for (k = 0; k < HOST_FLASH_BLOCK; k++)
+      host_flash[startaddr + k] &= *flash_array++;
+    host_stats.flash_writes++;
+    host_flash_stall();
+    }
+  }
+
+// Cost model (ovms_host -C): a poll handler for id has returned, let the
+// bus run on for its modelled execution time. In the ISR this receives
+// frames into the RX buffers (or overflows them) without dispatching.
+void host_poll_cost(unsigned int id)
+  {
+  host_cycles_t c = host_cost[id & 0x7ff];
+  if (c == 0)
+    c = host_cost[0x800];
+  if (c)
+    host_advance(host_now + c);
+  }
+
+void host_isr_wait(void)
+  {
+  host_cycles_t t = host_now;
+
+  // Main context spins on ISR state: run to the next event
+  if (!host_in_isr)
+    {
+    host_advance(host_next_event(host_now + HOST_MS(1)));
+    host_stats.uart_wait += host_now - t;
+    }
+  }
+
+void host_update_probe(unsigned char end)
+  {
+  static uint32_t reads;
+
+  if (!end)
+    reads = host_stats.ee_reads;
+  else
+    {
+    host_stats.updates++;
+    host_stats.update_ee_reads += host_stats.ee_reads - reads;
+    }
+  }
+
+void host_line_probe(unsigned char end)
+  {
+  static uint32_t compares, reads;
+
+  if (!end)
+    {
+    compares = host_stats.pgm_compares;
+    reads = host_stats.pgm_reads;
+    }
+  else
+    {
+    uint32_t c = host_stats.pgm_compares - compares;
+    uint32_t r = host_stats.pgm_reads - reads;
+    host_stats.lines++;
+    host_stats.line_compares += c;
+    host_stats.line_reads += r;
+    if (c > host_stats.line_compares_max)
+      host_stats.line_compares_max = c;
+    if (r > host_stats.line_reads_max)
+      host_stats.line_reads_max = r;
+    }
+  }
+
+void host_pgm_read(unsigned char n)
+  {
+  host_stats.pgm_reads += n;
+  }
+
+int host_memcmppgm2ram(const void *s1, const void *s2, size_t n)
+  {
+  const unsigned char *a = s1, *b = s2;
+  size_t k;
+
+  // C18 reads the program memory string up to the first difference:
+  host_stats.pgm_compares++;
+  for (k = 0; k < n; k++)
+    if (a[k] != b[k])
+      {
+      host_stats.pgm_reads += k+1;
+      return a[k] - b[k];
+      }
+  host_stats.pgm_reads += n;
+  return 0;
+  }
+
+void host_clrwdt(void)
+  {
+  wdt_last = host_now;
+  }
+
+void host_reset(void)
+  {
+  host_stop(HOST_STOP_RESET);
+  }
+
+char *host_strupr(char *s)
+  {
+  char *p;
+  for (p = s; *p; p++)
+    *p = toupper((unsigned char)*p);
+  return s;
+  }
+
+char *host_itoa(int value, char *s)
+  {
+  sprintf(s, "%d", value);
+  return s;
+  }
+
+char *host_ltoa(int32_t value, char *s)
+  {
+  sprintf(s, "%d", value);
+  return s;
+  }
+
+char *host_ultoa(uint32_t value, char *s)
+  {
+  sprintf(s, "%u", value);
+  return s;
+  }
+
+
+////////////////////////////////////////////////////////////////////////
+// Harness interface
+//
+
+// Print the per CAN ID high_isr() profile
+void host_isrprof_dump(FILE *out)
+  {
+  unsigned int id;
+  host_isrprof_t *p;
+
+  fprintf(out, "#  id    count   min ns   avg ns   max ns   fps avg   fps max\n");
+  for (id = 0; id <= 0x800; id++)
+    {
+    p = &host_isrprof[id];
+    if (p->count == 0)
+      continue;
+    if (id == 0x800)
+      fprintf(out, "# ---");
+    else
+      fprintf(out, "# %03x", id);
+    fprintf(out, " %8u %8.0f %8.0f %8.0f %9.0f %9.0f\n",
+      p->count, (double)p->min, (double)p->sum / p->count, (double)p->max,
+      (p->sum) ? p->count * 1e9 / p->sum : 0.0,
+      (p->max) ? 1e9 / p->max : 0.0);
+    }
+  }
+
+void host_initialise(void)
+  {
+  memset(host_sfr_file, 0, sizeof(host_sfr_file));
+  memcpy(host_eeprom, EEparam, sizeof(host_eeprom));
+  memset(host_flash, 0xff, sizeof(host_flash));
+
+  // Power on reset state:
+  R(RCON) = 0x1c;           // POR + BOR cleared: normal power on
+  R(PIR1) = 0x10;           // TXIF: TXREG empty
+  R(TXSTA) = 0x02;          // TRMT
+  R(CANCON) = 0x80;         // configuration mode
+  R(CANSTAT) = 0x80;
+  R(TRISA) = R(TRISB) = R(TRISC) = 0xff;
+  R(PORTA) = 0x00;          // RA1 low: GPRS enabled
+  }
+
+void host_eeprom_param(unsigned char param, const char *value)
+  {
+  char *p = (char *)&host_eeprom[(unsigned int)param * PARAM_MAX_LENGTH];
+  memset(p, 0, PARAM_MAX_LENGTH);
+  strncpy(p, value, PARAM_MAX_LENGTH-1);
+  }
+
+void host_uart_rx(const char *data, int len)
+  {
+  while (len-- > 0)
+    {
+    unsigned int next = (uart_rxq_wr + 1) % HOST_RXQ_SIZE;
+    if (next == uart_rxq_rd)
+      break; // queue full
+    if (host_uart_rx_hook)
+      host_uart_rx_hook(*data);
+    uart_rxq[uart_rxq_wr] = *data++;
+    uart_rxq_wr = next;
+    }
+  }
+
+int host_run(host_cycles_t limit, int stop_at_eof)
+  {
+  int reason;
+
+  host_limit = host_now + limit;
+  host_stop_at_eof = stop_at_eof;
+  wdt_last = host_now;
+
+  reason = setjmp(host_stop_jmp);
+  if (reason == 0)
+    {
+    ovms_main();
+    reason = HOST_STOP_RESET; // main() returned
+    }
+  host_in_isr = 0;
+  return reason;
+  }
@@ -0,0 +1,166 @@
+////////////////////////////////////////////////////////////////////////////////
+// Project:       Open Vehicle Monitor System
+// Module:        Host build: car state snapshots and golden file comparison
+//
+// History:
+//
+// 1.0  Initial release
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "ovms.h"
+#include "host.h"
+
+////////////////////////////////////////////////////////////////////////
+// The snapshot is the framework car state (ovms.h car_* variables), one
+// "name value" line per variable in declaration order. Arrays are dumped
+// as comma separated lists, strings quoted.
+//
+
+#define HS_UNSIGNED   0
+#define HS_SIGNED     1
+#define HS_STRING     2
+
+typedef struct
+  {
+  const char *name;
+  const void *addr;
+  unsigned char size;     // element size
+  unsigned char count;    // elements
+  unsigned char type;
+  } host_state_var_t;
+
+#define U(v)      { #v, &v, sizeof(v), 1, HS_UNSIGNED }
+#define S(v)      { #v, &v, sizeof(v), 1, HS_SIGNED }
+#define UA(v)     { #v, v, sizeof(v[0]), sizeof(v)/sizeof(v[0]), HS_UNSIGNED }
+#define SA(v)     { #v, v, sizeof(v[0]), sizeof(v)/sizeof(v[0]), HS_SIGNED }
+#define STR(v)    { #v, v, 1, sizeof(v), HS_STRING }
+
+static const host_state_var_t host_state_vars[] =
+  {
+  U(car_linevoltage), U(car_chargecurrent), U(car_chargelimit),
+  U(car_chargeduration), U(car_chargestate), U(car_chargesubstate),
+  U(car_chargemode), U(car_charge_b4), U(car_chargekwh), U(car_chargetype),
+  U(car_chargepower), U(car_battvoltage),
+  U(car_doors1), U(car_doors2), U(car_doors3), U(car_doors4), U(car_doors5),
+  U(car_lockstate), U(car_speed), U(car_SOC), U(car_idealrange),
+  U(car_estrange), U(car_drivemode), S(car_power), U(car_energy_used),
+  U(car_energy_recd), U(car_time), U(car_parktime), U(car_stopped_mincnt),
+  S(car_ambient_temp), STR(car_vin), STR(car_type), S(car_tpem),
+  S(car_tmotor), S(car_tbattery), S(car_tcharger),
+#ifndef OVMS_NO_TPMS
+  SA(car_tpms_t), UA(car_tpms_p),
+#endif
+  U(car_trip), U(car_odometer), S(car_latitude),
+  S(car_longitude), U(car_direction), S(car_altitude), S(car_timermode),
+  U(car_timerstart), U(car_gpslock), S(car_stale_ambient),
+  S(car_stale_temps), S(car_stale_gps), S(car_stale_tpms),
+  S(car_stale_timer), U(car_12vline), U(car_12vline_ref),
+  U(car_12v_current), U(car_cac100), U(car_soh),
+  S(car_chargefull_minsremaining), S(car_chargelimit_minsremaining_range),
+  S(car_chargelimit_minsremaining_soc), U(car_chargelimit_rangelimit),
+  U(car_chargelimit_soclimit), U(car_max_idealrange),
+#ifndef OVMS_NO_CHARGECONTROL
+  S(car_coolingdown), U(car_cooldown_chargemode), U(car_cooldown_chargelimit),
+  S(car_cooldown_tbattery), U(car_cooldown_timelimit),
+  U(car_cooldown_wascharging),
+#endif
+  S(car_chargeestimate), U(car_SOCalertlimit),
+  };
+
+static int32_t host_state_value(const host_state_var_t *v, int k)
+  {
+  const unsigned char *p = (const unsigned char *)v->addr + k * v->size;
+  switch (v->size)
+    {
+    case 1: return (v->type == HS_SIGNED) ? *(const int8_t *)p : *p;
+    case 2: return (v->type == HS_SIGNED) ? *(const int16_t *)p : *(const uint16_t *)p;
+    default: return (v->type == HS_SIGNED) ? *(const int32_t *)p : (int32_t)*(const uint32_t *)p;
+    }
+  }
+
+void host_state_dump(FILE *out)
+  {
+  const host_state_var_t *v;
+  int k;
+
+  for (v = host_state_vars; v < host_state_vars + sizeof(host_state_vars)/sizeof(host_state_vars[0]); v++)
+    {
+    fprintf(out, "%s ", v->name);
+    if (v->type == HS_STRING)
+      {
+      fputc('"', out);
+      for (k = 0; (k < v->count) && ((const char *)v->addr)[k]; k++)
+        {
+        unsigned char c = ((const unsigned char *)v->addr)[k];
+        if ((c < 0x20) || (c >= 0x7f) || (c == '"'))
+          fprintf(out, "\\x%02x", c);
+        else
+          fputc(c, out);
+        }
+      fputc('"', out);
+      }
+    else
+      {
+      for (k = 0; k < v->count; k++)
+        fprintf(out, (k) ? ",%d" : "%d", host_state_value(v, k));
+      }
+    fputc('\n', out);
+    }
+  }
+
+// Compare the current state against a golden snapshot, report differences
+// to out. Returns the number of differences, or -1 if golden can't be read.
+int host_state_diff(const char *golden, FILE *out)
+  {
+  FILE *g, *cur;
+  char gl[256], cl[256];
+  int diffs = 0;
+  int geof, ceof;
+
+  if ((g = fopen(golden, "r")) == NULL)
+    {
+    perror(golden);
+    return -1;
+    }
+  cur = tmpfile();
+  host_state_dump(cur);
+  rewind(cur);
+
+  for (;;)
+    {
+    geof = (fgets(gl, sizeof(gl), g) == NULL);
+    ceof = (fgets(cl, sizeof(cl), cur) == NULL);
+    if (geof && ceof)
+      break;
+    if (geof) gl[0] = 0;
+    if (ceof) cl[0] = 0;
+    gl[strcspn(gl, "\r\n")] = 0;
+    cl[strcspn(cl, "\r\n")] = 0;
+    if (strcmp(gl, cl) != 0)
+      {
+      fprintf(out, "- %s\n+ %s\n", gl, cl);
+      diffs++;
+      }
+    }
+
+  fclose(cur);
+  fclose(g);
+  return diffs;
+  }
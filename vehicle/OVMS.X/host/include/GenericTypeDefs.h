@@ -0,0 +1,56 @@
+////////////////////////////////////////////////////////////////////////////////
+// Project:       Open Vehicle Monitor System
+// Module:        Host build: Microchip GenericTypeDefs.h stand-in
+//
+// History:
+//
+// 1.0  Initial release
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef __GENERIC_TYPE_DEFS_H_
+#define __GENERIC_TYPE_DEFS_H_
+
+// Same names as the Microchip header, sized as on the PIC18 where the host
+// allows it (long is mapped to 32 bit by host_c18.h, int stays 32 bit).
+
+typedef enum _BOOL { FALSE = 0, TRUE } BOOL;
+
+typedef unsigned char           BYTE;
+typedef unsigned short int      WORD;
+typedef unsigned long           DWORD;
+
+typedef signed int              INT;
+typedef signed char             INT8;
+typedef signed short int        INT16;
+typedef signed long             INT32;
+
+typedef unsigned int            UINT;
+typedef unsigned char           UINT8;
+typedef unsigned short int      UINT16;
+typedef unsigned long           UINT32;
+
+typedef char                    CHAR;
+typedef unsigned char           UCHAR;
+typedef short                   SHORT;
+typedef unsigned short          USHORT;
+typedef long                    LONG;
+typedef unsigned long           ULONG;
+
+#endif // #ifndef __GENERIC_TYPE_DEFS_H_
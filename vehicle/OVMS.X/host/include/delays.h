@@ -0,0 +1,40 @@
+////////////////////////////////////////////////////////////////////////////////
+// Project:       Open Vehicle Monitor System
+// Module:        Host build: C18 delays.h stand-in
+//
+// History:
+//
+// 1.0  Initial release
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef __DELAYS_H
+#define __DELAYS_H
+
+// C18 busy wait delays, in instruction cycles (TCY = 200ns @ 20 MHz).
+// On the host they advance the virtual clock and run pending interrupts.
+extern void host_delay_tcy(unsigned int tcy);
+
+#define Delay1TCY()          host_delay_tcy(1)
+#define Delay10TCYx(n)       host_delay_tcy(10*(unsigned int)(n))
+#define Delay100TCYx(n)      host_delay_tcy(100*(unsigned int)(n))
+#define Delay1KTCYx(n)       host_delay_tcy(1000*(unsigned int)(n))
+#define Delay10KTCYx(n)      host_delay_tcy(10000*(unsigned int)(n))
+
+#endif // #ifndef __DELAYS_H
@@ -0,0 +1,91 @@
+////////////////////////////////////////////////////////////////////////////////
+// Project:       Open Vehicle Monitor System
+// Module:        Host build: MPLAB C18 language shim
+//
+// History:
+//
+// 1.0  Initial release
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef __OVMS_HOST_C18_H
+#define __OVMS_HOST_C18_H
+
+// Force-included (gcc -include) into every translation unit of the host
+// build. Maps the MPLAB C18 language extensions used by the firmware onto
+// standard C. Known differences to the PIC build: int is 32 bit (C18: 16),
+// there is no 24 bit short long, and ROM/RAM pointers are interchangeable.
+
+// The C library must be seen before long is remapped below:
+#include <ctype.h>
+#include <errno.h>
+#include <math.h>
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+// Storage qualifiers
+#define rom
+#define ram
+#define near
+#define far
+
+// C18 long is 32 bit
+#define long int
+
+// Program memory string functions (memcmppgm2ram() counts the program
+// memory bytes it reads, see host_sfr.c)
+extern int host_memcmppgm2ram(const void *s1, const void *s2, size_t n);
+#define memcmppgm2ram(s1,s2,n)    host_memcmppgm2ram(s1,s2,n)
+#define memcpypgm2ram(s1,s2,n)    memcpy(s1,s2,n)
+#define strcmppgm2ram(s1,s2)      strcmp(s1,s2)
+#define strncmppgm2ram(s1,s2,n)   strncmp(s1,s2,n)
+#define strcpypgm2ram(s1,s2)      strcpy(s1,s2)
+#define strncpypgm2ram(s1,s2,n)   strncpy(s1,s2,n)
+#define strcatpgm2ram(s1,s2)      strcat(s1,s2)
+#define strlenpgm(s)              strlen(s)
+#define strstrrampgm(s1,s2)       strstr(s1,s2)
+#define strtokpgmram(s1,s2)       strtok(s1,s2)
+
+// C18 string.h extensions
+extern char *host_strupr(char *s);
+#define strupr(s)   host_strupr(s)
+
+// C18 stdlib number conversions (decimal, no radix argument)
+extern char *host_itoa(int value, char *s);
+extern char *host_ltoa(int32_t value, char *s);
+extern char *host_ultoa(uint32_t value, char *s);
+#define itoa(v,s)   host_itoa(v,s)
+#define ltoa(v,s)   host_ltoa(v,s)
+#define ultoa(v,s)  host_ultoa(v,s)
+
+// Processor instructions
+extern void host_clrwdt(void);
+extern void host_reset(void);
+extern void host_isr_wait(void);
+#define ClrWdt()    host_clrwdt()
+#define Nop()
+#define Sleep()
+
+#endif // #ifndef __OVMS_HOST_C18_H
@@ -0,0 +1,688 @@
+////////////////////////////////////////////////////////////////////////////////
+// Project:       Open Vehicle Monitor System
+// Module:        Host build: PIC18F2685 special function register shim
+//
+// History:
+//
+// 1.0  Initial release
+//  - SFRs used by the firmware, mapped to host_sfr() accessors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef __P18F2685_H
+#define __P18F2685_H
+
+// Every SFR is a byte in host_sfr_file[]. Accesses go through host_sfr(),
+// which first applies pending hardware side effects (EEPROM read/write,
+// CAN TXREQ, timer flags, UART TX) and lets the virtual clock advance at
+// the points where the firmware polls hardware (TMR0L, TMR2IF).
+// See host/host_sfr.c for the emulation.
+
+enum host_sfr_index
+  {
+  HOST_SFR_ADCON0,
+  HOST_SFR_ADCON1,
+  HOST_SFR_ADCON2,
+  HOST_SFR_ADRESL,
+  HOST_SFR_ADRESH,
+  HOST_SFR_BRGCON1,
+  HOST_SFR_BRGCON2,
+  HOST_SFR_BRGCON3,
+  HOST_SFR_CANCON,
+  HOST_SFR_CANSTAT,
+  HOST_SFR_CIOCON,
+  HOST_SFR_COMSTAT,
+  HOST_SFR_ECANCON,
+  HOST_SFR_RXERRCNT,
+  HOST_SFR_TXERRCNT,
+  HOST_SFR_EEADR,
+  HOST_SFR_EEADRH,
+  HOST_SFR_EECON1,
+  HOST_SFR_EECON2,
+  HOST_SFR_EEDATA,
+  HOST_SFR_FSR1L,
+  HOST_SFR_FSR1H,
+  HOST_SFR_INTCON,
+  HOST_SFR_INTCON2,
+  HOST_SFR_INTCON3,
+  HOST_SFR_IPR1,
+  HOST_SFR_IPR2,
+  HOST_SFR_IPR3,
+  HOST_SFR_PIE1,
+  HOST_SFR_PIE2,
+  HOST_SFR_PIE3,
+  HOST_SFR_PIR1,
+  HOST_SFR_PIR2,
+  HOST_SFR_PIR3,
+  HOST_SFR_PORTA,
+  HOST_SFR_PORTB,
+  HOST_SFR_PORTC,
+  HOST_SFR_LATA,
+  HOST_SFR_LATB,
+  HOST_SFR_LATC,
+  HOST_SFR_TRISA,
+  HOST_SFR_TRISB,
+  HOST_SFR_TRISC,
+  HOST_SFR_PR2,
+  HOST_SFR_RCON,
+  HOST_SFR_STKPTR,
+  HOST_SFR_RCREG,
+  HOST_SFR_RCSTA,
+  HOST_SFR_SPBRG,
+  HOST_SFR_TXREG,
+  HOST_SFR_TXSTA,
+  HOST_SFR_T0CON,
+  HOST_SFR_T1CON,
+  HOST_SFR_T2CON,
+  HOST_SFR_T3CON,
+  HOST_SFR_TMR0L,
+  HOST_SFR_TMR0H,
+  HOST_SFR_TMR1L,
+  HOST_SFR_TMR1H,
+  HOST_SFR_TMR2,
+  HOST_SFR_TMR3L,
+  HOST_SFR_TMR3H,
+  HOST_SFR_RXB0CON,
+  HOST_SFR_RXB0SIDH,
+  HOST_SFR_RXB0SIDL,
+  HOST_SFR_RXB0EIDH,
+  HOST_SFR_RXB0EIDL,
+  HOST_SFR_RXB0DLC,
+  HOST_SFR_RXB0D0,
+  HOST_SFR_RXB0D1,
+  HOST_SFR_RXB0D2,
+  HOST_SFR_RXB0D3,
+  HOST_SFR_RXB0D4,
+  HOST_SFR_RXB0D5,
+  HOST_SFR_RXB0D6,
+  HOST_SFR_RXB0D7,
+  HOST_SFR_RXB1CON,
+  HOST_SFR_RXB1SIDH,
+  HOST_SFR_RXB1SIDL,
+  HOST_SFR_RXB1EIDH,
+  HOST_SFR_RXB1EIDL,
+  HOST_SFR_RXB1DLC,
+  HOST_SFR_RXB1D0,
+  HOST_SFR_RXB1D1,
+  HOST_SFR_RXB1D2,
+  HOST_SFR_RXB1D3,
+  HOST_SFR_RXB1D4,
+  HOST_SFR_RXB1D5,
+  HOST_SFR_RXB1D6,
+  HOST_SFR_RXB1D7,
+  HOST_SFR_TXB0CON,
+  HOST_SFR_TXB0SIDH,
+  HOST_SFR_TXB0SIDL,
+  HOST_SFR_TXB0EIDH,
+  HOST_SFR_TXB0EIDL,
+  HOST_SFR_TXB0DLC,
+  HOST_SFR_TXB0D0,
+  HOST_SFR_TXB0D1,
+  HOST_SFR_TXB0D2,
+  HOST_SFR_TXB0D3,
+  HOST_SFR_TXB0D4,
+  HOST_SFR_TXB0D5,
+  HOST_SFR_TXB0D6,
+  HOST_SFR_TXB0D7,
+  HOST_SFR_TXB1CON,
+  HOST_SFR_TXB1SIDH,
+  HOST_SFR_TXB1SIDL,
+  HOST_SFR_TXB1EIDH,
+  HOST_SFR_TXB1EIDL,
+  HOST_SFR_TXB1DLC,
+  HOST_SFR_TXB1D0,
+  HOST_SFR_TXB1D1,
+  HOST_SFR_TXB1D2,
+  HOST_SFR_TXB1D3,
+  HOST_SFR_TXB1D4,
+  HOST_SFR_TXB1D5,
+  HOST_SFR_TXB1D6,
+  HOST_SFR_TXB1D7,
+  HOST_SFR_TXB2CON,
+  HOST_SFR_TXB2SIDH,
+  HOST_SFR_TXB2SIDL,
+  HOST_SFR_TXB2EIDH,
+  HOST_SFR_TXB2EIDL,
+  HOST_SFR_TXB2DLC,
+  HOST_SFR_TXB2D0,
+  HOST_SFR_TXB2D1,
+  HOST_SFR_TXB2D2,
+  HOST_SFR_TXB2D3,
+  HOST_SFR_TXB2D4,
+  HOST_SFR_TXB2D5,
+  HOST_SFR_TXB2D6,
+  HOST_SFR_TXB2D7,
+  HOST_SFR_RXF0SIDH,
+  HOST_SFR_RXF0SIDL,
+  HOST_SFR_RXF0EIDH,
+  HOST_SFR_RXF0EIDL,
+  HOST_SFR_RXF1SIDH,
+  HOST_SFR_RXF1SIDL,
+  HOST_SFR_RXF1EIDH,
+  HOST_SFR_RXF1EIDL,
+  HOST_SFR_RXF2SIDH,
+  HOST_SFR_RXF2SIDL,
+  HOST_SFR_RXF2EIDH,
+  HOST_SFR_RXF2EIDL,
+  HOST_SFR_RXF3SIDH,
+  HOST_SFR_RXF3SIDL,
+  HOST_SFR_RXF3EIDH,
+  HOST_SFR_RXF3EIDL,
+  HOST_SFR_RXF4SIDH,
+  HOST_SFR_RXF4SIDL,
+  HOST_SFR_RXF4EIDH,
+  HOST_SFR_RXF4EIDL,
+  HOST_SFR_RXF5SIDH,
+  HOST_SFR_RXF5SIDL,
+  HOST_SFR_RXF5EIDH,
+  HOST_SFR_RXF5EIDL,
+  HOST_SFR_RXM0SIDH,
+  HOST_SFR_RXM0SIDL,
+  HOST_SFR_RXM0EIDH,
+  HOST_SFR_RXM0EIDL,
+  HOST_SFR_RXM1SIDH,
+  HOST_SFR_RXM1SIDL,
+  HOST_SFR_RXM1EIDH,
+  HOST_SFR_RXM1EIDL,
+  HOST_SFR_COUNT
+  };
+
+#define ADCON0   (*host_sfr(HOST_SFR_ADCON0))
+#define ADCON1   (*host_sfr(HOST_SFR_ADCON1))
+#define ADCON2   (*host_sfr(HOST_SFR_ADCON2))
+#define ADRESL   (*host_sfr(HOST_SFR_ADRESL))
+#define ADRESH   (*host_sfr(HOST_SFR_ADRESH))
+#define BRGCON1  (*host_sfr(HOST_SFR_BRGCON1))
+#define BRGCON2  (*host_sfr(HOST_SFR_BRGCON2))
+#define BRGCON3  (*host_sfr(HOST_SFR_BRGCON3))
+#define CANCON   (*host_sfr(HOST_SFR_CANCON))
+#define CANSTAT  (*host_sfr(HOST_SFR_CANSTAT))
+#define CIOCON   (*host_sfr(HOST_SFR_CIOCON))
+#define COMSTAT  (*host_sfr(HOST_SFR_COMSTAT))
+#define ECANCON  (*host_sfr(HOST_SFR_ECANCON))
+#define RXERRCNT (*host_sfr(HOST_SFR_RXERRCNT))
+#define TXERRCNT (*host_sfr(HOST_SFR_TXERRCNT))
+#define EEADR    (*host_sfr(HOST_SFR_EEADR))
+#define EEADRH   (*host_sfr(HOST_SFR_EEADRH))
+#define EECON1   (*host_sfr(HOST_SFR_EECON1))
+#define EECON2   (*host_sfr(HOST_SFR_EECON2))
+#define EEDATA   (*host_sfr(HOST_SFR_EEDATA))
+#define FSR1L    (*host_sfr(HOST_SFR_FSR1L))
+#define FSR1H    (*host_sfr(HOST_SFR_FSR1H))
+#define INTCON   (*host_sfr(HOST_SFR_INTCON))
+#define INTCON2  (*host_sfr(HOST_SFR_INTCON2))
+#define INTCON3  (*host_sfr(HOST_SFR_INTCON3))
+#define IPR1     (*host_sfr(HOST_SFR_IPR1))
+#define IPR2     (*host_sfr(HOST_SFR_IPR2))
+#define IPR3     (*host_sfr(HOST_SFR_IPR3))
+#define PIE1     (*host_sfr(HOST_SFR_PIE1))
+#define PIE2     (*host_sfr(HOST_SFR_PIE2))
+#define PIE3     (*host_sfr(HOST_SFR_PIE3))
+#define PIR1     (*host_sfr(HOST_SFR_PIR1))
+#define PIR2     (*host_sfr(HOST_SFR_PIR2))
+#define PIR3     (*host_sfr(HOST_SFR_PIR3))
+#define PORTA    (*host_sfr(HOST_SFR_PORTA))
+#define PORTB    (*host_sfr(HOST_SFR_PORTB))
+#define PORTC    (*host_sfr(HOST_SFR_PORTC))
+#define LATA     (*host_sfr(HOST_SFR_LATA))
+#define LATB     (*host_sfr(HOST_SFR_LATB))
+#define LATC     (*host_sfr(HOST_SFR_LATC))
+#define TRISA    (*host_sfr(HOST_SFR_TRISA))
+#define TRISB    (*host_sfr(HOST_SFR_TRISB))
+#define TRISC    (*host_sfr(HOST_SFR_TRISC))
+#define PR2      (*host_sfr(HOST_SFR_PR2))
+#define RCON     (*host_sfr(HOST_SFR_RCON))
+#define STKPTR   (*host_sfr(HOST_SFR_STKPTR))
+#define RCREG    (*host_sfr(HOST_SFR_RCREG))
+#define RCSTA    (*host_sfr(HOST_SFR_RCSTA))
+#define SPBRG    (*host_sfr(HOST_SFR_SPBRG))
+#define TXREG    (*host_sfr(HOST_SFR_TXREG))
+#define TXSTA    (*host_sfr(HOST_SFR_TXSTA))
+#define T0CON    (*host_sfr(HOST_SFR_T0CON))
+#define T1CON    (*host_sfr(HOST_SFR_T1CON))
+#define T2CON    (*host_sfr(HOST_SFR_T2CON))
+#define T3CON    (*host_sfr(HOST_SFR_T3CON))
+#define TMR0L    (*host_sfr(HOST_SFR_TMR0L))
+#define TMR0H    (*host_sfr(HOST_SFR_TMR0H))
+#define TMR1L    (*host_sfr(HOST_SFR_TMR1L))
+#define TMR1H    (*host_sfr(HOST_SFR_TMR1H))
+#define TMR2     (*host_sfr(HOST_SFR_TMR2))
+#define TMR3L    (*host_sfr(HOST_SFR_TMR3L))
+#define TMR3H    (*host_sfr(HOST_SFR_TMR3H))
+#define RXB0CON  (*host_sfr(HOST_SFR_RXB0CON))
+#define RXB0SIDH (*host_sfr(HOST_SFR_RXB0SIDH))
+#define RXB0SIDL (*host_sfr(HOST_SFR_RXB0SIDL))
+#define RXB0EIDH (*host_sfr(HOST_SFR_RXB0EIDH))
+#define RXB0EIDL (*host_sfr(HOST_SFR_RXB0EIDL))
+#define RXB0DLC  (*host_sfr(HOST_SFR_RXB0DLC))
+#define RXB0D0   (*host_sfr(HOST_SFR_RXB0D0))
+#define RXB0D1   (*host_sfr(HOST_SFR_RXB0D1))
+#define RXB0D2   (*host_sfr(HOST_SFR_RXB0D2))
+#define RXB0D3   (*host_sfr(HOST_SFR_RXB0D3))
+#define RXB0D4   (*host_sfr(HOST_SFR_RXB0D4))
+#define RXB0D5   (*host_sfr(HOST_SFR_RXB0D5))
+#define RXB0D6   (*host_sfr(HOST_SFR_RXB0D6))
+#define RXB0D7   (*host_sfr(HOST_SFR_RXB0D7))
+#define RXB1CON  (*host_sfr(HOST_SFR_RXB1CON))
+#define RXB1SIDH (*host_sfr(HOST_SFR_RXB1SIDH))
+#define RXB1SIDL (*host_sfr(HOST_SFR_RXB1SIDL))
+#define RXB1EIDH (*host_sfr(HOST_SFR_RXB1EIDH))
+#define RXB1EIDL (*host_sfr(HOST_SFR_RXB1EIDL))
+#define RXB1DLC  (*host_sfr(HOST_SFR_RXB1DLC))
+#define RXB1D0   (*host_sfr(HOST_SFR_RXB1D0))
+#define RXB1D1   (*host_sfr(HOST_SFR_RXB1D1))
+#define RXB1D2   (*host_sfr(HOST_SFR_RXB1D2))
+#define RXB1D3   (*host_sfr(HOST_SFR_RXB1D3))
+#define RXB1D4   (*host_sfr(HOST_SFR_RXB1D4))
+#define RXB1D5   (*host_sfr(HOST_SFR_RXB1D5))
+#define RXB1D6   (*host_sfr(HOST_SFR_RXB1D6))
+#define RXB1D7   (*host_sfr(HOST_SFR_RXB1D7))
+#define TXB0CON  (*host_sfr(HOST_SFR_TXB0CON))
+#define TXB0SIDH (*host_sfr(HOST_SFR_TXB0SIDH))
+#define TXB0SIDL (*host_sfr(HOST_SFR_TXB0SIDL))
+#define TXB0EIDH (*host_sfr(HOST_SFR_TXB0EIDH))
+#define TXB0EIDL (*host_sfr(HOST_SFR_TXB0EIDL))
+#define TXB0DLC  (*host_sfr(HOST_SFR_TXB0DLC))
+#define TXB0D0   (*host_sfr(HOST_SFR_TXB0D0))
+#define TXB0D1   (*host_sfr(HOST_SFR_TXB0D1))
+#define TXB0D2   (*host_sfr(HOST_SFR_TXB0D2))
+#define TXB0D3   (*host_sfr(HOST_SFR_TXB0D3))
+#define TXB0D4   (*host_sfr(HOST_SFR_TXB0D4))
+#define TXB0D5   (*host_sfr(HOST_SFR_TXB0D5))
+#define TXB0D6   (*host_sfr(HOST_SFR_TXB0D6))
+#define TXB0D7   (*host_sfr(HOST_SFR_TXB0D7))
+#define TXB1CON  (*host_sfr(HOST_SFR_TXB1CON))
+#define TXB1SIDH (*host_sfr(HOST_SFR_TXB1SIDH))
+#define TXB1SIDL (*host_sfr(HOST_SFR_TXB1SIDL))
+#define TXB1EIDH (*host_sfr(HOST_SFR_TXB1EIDH))
+#define TXB1EIDL (*host_sfr(HOST_SFR_TXB1EIDL))
+#define TXB1DLC  (*host_sfr(HOST_SFR_TXB1DLC))
+#define TXB1D0   (*host_sfr(HOST_SFR_TXB1D0))
+#define TXB1D1   (*host_sfr(HOST_SFR_TXB1D1))
+#define TXB1D2   (*host_sfr(HOST_SFR_TXB1D2))
+#define TXB1D3   (*host_sfr(HOST_SFR_TXB1D3))
+#define TXB1D4   (*host_sfr(HOST_SFR_TXB1D4))
+#define TXB1D5   (*host_sfr(HOST_SFR_TXB1D5))
+#define TXB1D6   (*host_sfr(HOST_SFR_TXB1D6))
+#define TXB1D7   (*host_sfr(HOST_SFR_TXB1D7))
+#define TXB2CON  (*host_sfr(HOST_SFR_TXB2CON))
+#define TXB2SIDH (*host_sfr(HOST_SFR_TXB2SIDH))
+#define TXB2SIDL (*host_sfr(HOST_SFR_TXB2SIDL))
+#define TXB2EIDH (*host_sfr(HOST_SFR_TXB2EIDH))
+#define TXB2EIDL (*host_sfr(HOST_SFR_TXB2EIDL))
+#define TXB2DLC  (*host_sfr(HOST_SFR_TXB2DLC))
+#define TXB2D0   (*host_sfr(HOST_SFR_TXB2D0))
+#define TXB2D1   (*host_sfr(HOST_SFR_TXB2D1))
+#define TXB2D2   (*host_sfr(HOST_SFR_TXB2D2))
+#define TXB2D3   (*host_sfr(HOST_SFR_TXB2D3))
+#define TXB2D4   (*host_sfr(HOST_SFR_TXB2D4))
+#define TXB2D5   (*host_sfr(HOST_SFR_TXB2D5))
+#define TXB2D6   (*host_sfr(HOST_SFR_TXB2D6))
+#define TXB2D7   (*host_sfr(HOST_SFR_TXB2D7))
+#define RXF0SIDH (*host_sfr(HOST_SFR_RXF0SIDH))
+#define RXF0SIDL (*host_sfr(HOST_SFR_RXF0SIDL))
+#define RXF0EIDH (*host_sfr(HOST_SFR_RXF0EIDH))
+#define RXF0EIDL (*host_sfr(HOST_SFR_RXF0EIDL))
+#define RXF1SIDH (*host_sfr(HOST_SFR_RXF1SIDH))
+#define RXF1SIDL (*host_sfr(HOST_SFR_RXF1SIDL))
+#define RXF1EIDH (*host_sfr(HOST_SFR_RXF1EIDH))
+#define RXF1EIDL (*host_sfr(HOST_SFR_RXF1EIDL))
+#define RXF2SIDH (*host_sfr(HOST_SFR_RXF2SIDH))
+#define RXF2SIDL (*host_sfr(HOST_SFR_RXF2SIDL))
+#define RXF2EIDH (*host_sfr(HOST_SFR_RXF2EIDH))
+#define RXF2EIDL (*host_sfr(HOST_SFR_RXF2EIDL))
+#define RXF3SIDH (*host_sfr(HOST_SFR_RXF3SIDH))
+#define RXF3SIDL (*host_sfr(HOST_SFR_RXF3SIDL))
+#define RXF3EIDH (*host_sfr(HOST_SFR_RXF3EIDH))
+#define RXF3EIDL (*host_sfr(HOST_SFR_RXF3EIDL))
+#define RXF4SIDH (*host_sfr(HOST_SFR_RXF4SIDH))
+#define RXF4SIDL (*host_sfr(HOST_SFR_RXF4SIDL))
+#define RXF4EIDH (*host_sfr(HOST_SFR_RXF4EIDH))
+#define RXF4EIDL (*host_sfr(HOST_SFR_RXF4EIDL))
+#define RXF5SIDH (*host_sfr(HOST_SFR_RXF5SIDH))
+#define RXF5SIDL (*host_sfr(HOST_SFR_RXF5SIDL))
+#define RXF5EIDH (*host_sfr(HOST_SFR_RXF5EIDH))
+#define RXF5EIDL (*host_sfr(HOST_SFR_RXF5EIDL))
+#define RXM0SIDH (*host_sfr(HOST_SFR_RXM0SIDH))
+#define RXM0SIDL (*host_sfr(HOST_SFR_RXM0SIDL))
+#define RXM0EIDH (*host_sfr(HOST_SFR_RXM0EIDH))
+#define RXM0EIDL (*host_sfr(HOST_SFR_RXM0EIDL))
+#define RXM1SIDH (*host_sfr(HOST_SFR_RXM1SIDH))
+#define RXM1SIDL (*host_sfr(HOST_SFR_RXM1SIDL))
+#define RXM1EIDH (*host_sfr(HOST_SFR_RXM1EIDH))
+#define RXM1EIDL (*host_sfr(HOST_SFR_RXM1EIDL))
+
+extern volatile unsigned char *host_sfr(unsigned char idx);
+extern volatile unsigned short *host_sfr16(unsigned char idx);
+
+// 16 bit register pairs (low byte first, as on the PIC)
+#define ADRES (*host_sfr16(HOST_SFR_ADRESL))
+#define FSR1  (*host_sfr16(HOST_SFR_FSR1L))
+
+// Bit field views
+#define HOST_SFR_BITS(reg,type) (*((volatile type*)host_sfr(HOST_SFR_##reg)))
+
+typedef union {
+  struct {
+    unsigned char ADON:1;
+    unsigned char GO:1;
+    unsigned char CHS:4;
+    unsigned char :2;
+  };
+  struct {
+    unsigned char :1;
+    unsigned char DONE:1;
+  };
+} ADCON0bits_t;
+#define ADCON0bits HOST_SFR_BITS(ADCON0,ADCON0bits_t)
+
+typedef struct {
+  unsigned char :1;
+  unsigned char ICODE:3;
+  unsigned char :1;
+  unsigned char OPMODE0:1;
+  unsigned char OPMODE1:1;
+  unsigned char OPMODE2:1;
+} CANSTATbits_t;
+#define CANSTATbits HOST_SFR_BITS(CANSTAT,CANSTATbits_t)
+
+typedef struct {
+  unsigned char :1;
+  unsigned char WIN:3;
+  unsigned char ABAT:1;
+  unsigned char REQOP:3;
+} CANCONbits_t;
+#define CANCONbits HOST_SFR_BITS(CANCON,CANCONbits_t)
+
+typedef struct {
+  unsigned char EWARN:1;
+  unsigned char RXWARN:1;
+  unsigned char TXWARN:1;
+  unsigned char RXBP:1;
+  unsigned char TXBP:1;
+  unsigned char TXBO:1;
+  unsigned char RXB1OVFL:1;
+  unsigned char RXB0OVFL:1;
+} COMSTATbits_t;
+#define COMSTATbits HOST_SFR_BITS(COMSTAT,COMSTATbits_t)
+
+typedef struct {
+  unsigned char RD:1;
+  unsigned char WR:1;
+  unsigned char WREN:1;
+  unsigned char WRERR:1;
+  unsigned char FREE:1;
+  unsigned char :1;
+  unsigned char CFGS:1;
+  unsigned char EEPGD:1;
+} EECON1bits_t;
+#define EECON1bits HOST_SFR_BITS(EECON1,EECON1bits_t)
+
+typedef union {
+  struct {
+    unsigned char RBIF:1;
+    unsigned char INT0IF:1;
+    unsigned char TMR0IF:1;
+    unsigned char RBIE:1;
+    unsigned char INT0IE:1;
+    unsigned char TMR0IE:1;
+    unsigned char PEIE:1;
+    unsigned char GIE:1;
+  };
+  struct {
+    unsigned char :6;
+    unsigned char GIEL:1;
+    unsigned char GIEH:1;
+  };
+} INTCONbits_t;
+#define INTCONbits HOST_SFR_BITS(INTCON,INTCONbits_t)
+
+typedef struct {
+  unsigned char TMR1IP:1;
+  unsigned char TMR2IP:1;
+  unsigned char CCP1IP:1;
+  unsigned char SSPIP:1;
+  unsigned char TXIP:1;
+  unsigned char RCIP:1;
+  unsigned char ADIP:1;
+  unsigned char PSPIP:1;
+} IPR1bits_t;
+#define IPR1bits HOST_SFR_BITS(IPR1,IPR1bits_t)
+
+typedef struct {
+  unsigned char TMR1IE:1;
+  unsigned char TMR2IE:1;
+  unsigned char CCP1IE:1;
+  unsigned char SSPIE:1;
+  unsigned char TXIE:1;
+  unsigned char RCIE:1;
+  unsigned char ADIE:1;
+  unsigned char PSPIE:1;
+} PIE1bits_t;
+#define PIE1bits HOST_SFR_BITS(PIE1,PIE1bits_t)
+
+typedef struct {
+  unsigned char TMR1IF:1;
+  unsigned char TMR2IF:1;
+  unsigned char CCP1IF:1;
+  unsigned char SSPIF:1;
+  unsigned char TXIF:1;
+  unsigned char RCIF:1;
+  unsigned char ADIF:1;
+  unsigned char PSPIF:1;
+} PIR1bits_t;
+#define PIR1bits HOST_SFR_BITS(PIR1,PIR1bits_t)
+
+typedef struct {
+  unsigned char RXB0IP:1;
+  unsigned char RXB1IP:1;
+  unsigned char TXB0IP:1;
+  unsigned char TXB1IP:1;
+  unsigned char TXB2IP:1;
+  unsigned char ERRIP:1;
+  unsigned char WAKIP:1;
+  unsigned char IRXIP:1;
+} IPR3bits_t;
+#define IPR3bits HOST_SFR_BITS(IPR3,IPR3bits_t)
+
+typedef struct {
+  unsigned char RXB0IE:1;
+  unsigned char RXB1IE:1;
+  unsigned char TXB0IE:1;
+  unsigned char TXB1IE:1;
+  unsigned char TXB2IE:1;
+  unsigned char ERRIE:1;
+  unsigned char WAKIE:1;
+  unsigned char IRXIE:1;
+} PIE3bits_t;
+#define PIE3bits HOST_SFR_BITS(PIE3,PIE3bits_t)
+
+typedef struct {
+  unsigned char RXB0IF:1;
+  unsigned char RXB1IF:1;
+  unsigned char TXB0IF:1;
+  unsigned char TXB1IF:1;
+  unsigned char TXB2IF:1;
+  unsigned char ERRIF:1;
+  unsigned char WAKIF:1;
+  unsigned char IRXIF:1;
+} PIR3bits_t;
+#define PIR3bits HOST_SFR_BITS(PIR3,PIR3bits_t)
+
+typedef struct {
+  unsigned char RA0:1;
+  unsigned char RA1:1;
+  unsigned char RA2:1;
+  unsigned char RA3:1;
+  unsigned char RA4:1;
+  unsigned char RA5:1;
+  unsigned char RA6:1;
+  unsigned char RA7:1;
+} PORTAbits_t;
+#define PORTAbits HOST_SFR_BITS(PORTA,PORTAbits_t)
+
+typedef struct {
+  unsigned char RB0:1;
+  unsigned char RB1:1;
+  unsigned char RB2:1;
+  unsigned char RB3:1;
+  unsigned char RB4:1;
+  unsigned char RB5:1;
+  unsigned char RB6:1;
+  unsigned char RB7:1;
+} PORTBbits_t;
+#define PORTBbits HOST_SFR_BITS(PORTB,PORTBbits_t)
+
+typedef struct {
+  unsigned char RC0:1;
+  unsigned char RC1:1;
+  unsigned char RC2:1;
+  unsigned char RC3:1;
+  unsigned char RC4:1;
+  unsigned char RC5:1;
+  unsigned char RC6:1;
+  unsigned char RC7:1;
+} PORTCbits_t;
+#define PORTCbits HOST_SFR_BITS(PORTC,PORTCbits_t)
+
+typedef union {
+  struct {
+    unsigned char TRISB0:1;
+    unsigned char TRISB1:1;
+    unsigned char TRISB2:1;
+    unsigned char TRISB3:1;
+    unsigned char TRISB4:1;
+    unsigned char TRISB5:1;
+    unsigned char TRISB6:1;
+    unsigned char TRISB7:1;
+  };
+  struct {
+    unsigned char RB0:1;
+    unsigned char RB1:1;
+    unsigned char RB2:1;
+    unsigned char RB3:1;
+    unsigned char RB4:1;
+    unsigned char RB5:1;
+    unsigned char RB6:1;
+    unsigned char RB7:1;
+  };
+} TRISBbits_t;
+#define TRISBbits HOST_SFR_BITS(TRISB,TRISBbits_t)
+
+typedef union {
+  struct {
+    unsigned char TRISC0:1;
+    unsigned char TRISC1:1;
+    unsigned char TRISC2:1;
+    unsigned char TRISC3:1;
+    unsigned char TRISC4:1;
+    unsigned char TRISC5:1;
+    unsigned char TRISC6:1;
+    unsigned char TRISC7:1;
+  };
+  struct {
+    unsigned char RC0:1;
+    unsigned char RC1:1;
+    unsigned char RC2:1;
+    unsigned char RC3:1;
+    unsigned char RC4:1;
+    unsigned char RC5:1;
+    unsigned char RC6:1;
+    unsigned char RC7:1;
+  };
+} TRISCbits_t;
+#define TRISCbits HOST_SFR_BITS(TRISC,TRISCbits_t)
+
+typedef struct {
+  unsigned char NOT_BOR:1;
+  unsigned char NOT_POR:1;
+  unsigned char NOT_PD:1;
+  unsigned char NOT_TO:1;
+  unsigned char NOT_RI:1;
+  unsigned char :1;
+  unsigned char SBOREN:1;
+  unsigned char IPEN:1;
+} RCONbits_t;
+#define RCONbits HOST_SFR_BITS(RCON,RCONbits_t)
+
+typedef struct {
+  unsigned char RX9D:1;
+  unsigned char OERR:1;
+  unsigned char FERR:1;
+  unsigned char ADDEN:1;
+  unsigned char CREN:1;
+  unsigned char SREN:1;
+  unsigned char RX9:1;
+  unsigned char SPEN:1;
+} RCSTAbits_t;
+#define RCSTAbits HOST_SFR_BITS(RCSTA,RCSTAbits_t)
+
+typedef struct {
+  unsigned char TX9D:1;
+  unsigned char TRMT:1;
+  unsigned char BRGH:1;
+  unsigned char SENDB:1;
+  unsigned char SYNC:1;
+  unsigned char TXEN:1;
+  unsigned char TX9:1;
+  unsigned char CSRC:1;
+} TXSTAbits_t;
+#define TXSTAbits HOST_SFR_BITS(TXSTA,TXSTAbits_t)
+
+typedef struct {
+  unsigned char SP:5;
+  unsigned char :1;
+  unsigned char STKUNF:1;
+  unsigned char STKFUL:1;
+} STKPTRbits_t;
+#define STKPTRbits HOST_SFR_BITS(STKPTR,STKPTRbits_t)
+
+typedef union {
+  struct {
+    unsigned char FILHIT0:1;
+    unsigned char JTOFF:1;
+    unsigned char RXB0DBEN:1;
+    unsigned char RXRTRRO:1;
+    unsigned char :1;
+    unsigned char RXM0:1;
+    unsigned char RXM1:1;
+    unsigned char RXFUL:1;
+  };
+  struct {
+    unsigned char FILHIT:3;
+  };
+} RXBnCONbits_t;
+#define RXB0CONbits HOST_SFR_BITS(RXB0CON,RXBnCONbits_t)
+#define RXB1CONbits HOST_SFR_BITS(RXB1CON,RXBnCONbits_t)
+
+typedef struct {
+  unsigned char TXPRI0:1;
+  unsigned char TXPRI1:1;
+  unsigned char :1;
+  unsigned char TXREQ:1;
+  unsigned char TXERR:1;
+  unsigned char TXLARB:1;
+  unsigned char TXABT:1;
+  unsigned char TXBIF:1;
+} TXBnCONbits_t;
+#define TXB0CONbits HOST_SFR_BITS(TXB0CON,TXBnCONbits_t)
+#define TXB1CONbits HOST_SFR_BITS(TXB1CON,TXBnCONbits_t)
+#define TXB2CONbits HOST_SFR_BITS(TXB2CON,TXBnCONbits_t)
+
+#endif // #ifndef __P18F2685_H
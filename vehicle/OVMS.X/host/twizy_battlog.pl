@@ -0,0 +1,104 @@
+#!/usr/bin/perl
+
+#    Project:       Open Vehicle Monitor System
+#    Date:          18 October 2026
+#
+#    Changes:
+#    1.0  Initial release
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in
+# all copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+# THE SOFTWARE.
+
+
+# Twizy battery sensor CAN log generator (CRTD), for the RT host build
+#
+#   twizy_battlog.pl [secs] > file.crtd
+#
+# Emits the battery sensor group decoded by vehicle_twizy.c with
+# OVMS_TWIZY_BATTMON for a drive of <secs> seconds (default 600):
+#
+#   0x556 every 100 ms   cell voltages 1-5 (12 bit, 5 mV)
+#   0x557, 0x55E, 0x554, 0x55F every second: cell voltages 6-10, 11-14,
+#   module temperatures (+40 degC), pack voltage (12 bit, 0.1 V)
+#
+# The cells start at 4.10 V with a fixed spread of a few mV, discharge
+# linearly and sag under a varying load in proportion to their internal
+# resistance; module temperatures rise with the load. Random numbers are
+# seeded, so the output is the same on each run.
+
+use strict;
+
+my $secs = (@ARGV) ? $ARGV[0] : 600;
+my $t0 = 1700000000;
+
+srand(4711);
+my @offset = map { int(rand(17)) - 8 } (1..14);     # mV
+my @res = map { 2.0 + rand(0.6) } (1..14);          # mV per A
+my @tbase = map { 20 + int(rand(3)) } (1..7);       # degC
+
+my ($load, $heat) = (0, 0);
+my @cell;
+
+sub frame
+  {
+  my ($t, $id, @data) = @_;
+  printf "%.3f R11 %03x %s\n", $t0 + $t, $id, join(' ', map { sprintf "%02x", $_ } @data);
+  }
+
+# Pack two 12 bit values per 3 bytes: a[11:4] a[3:0]b[11:8] b[7:0]
+sub pack12
+  {
+  my @v = @_;
+  my @b;
+  while (@v)
+    {
+    my $a = shift @v;
+    my $b = (@v) ? shift @v : 0;
+    push @b, ($a >> 4) & 0xff, (($a & 0x0f) << 4) | (($b >> 8) & 0x0f), $b & 0xff;
+    }
+  return @b;
+  }
+
+for (my $ms = 0; $ms < $secs * 1000; $ms += 100)
+  {
+  my $t = $ms / 1000;
+
+  # Load: city drive with stops, 0..90 A, changing every second
+  if ($ms % 1000 == 0)
+    {
+    $load += int(rand(21)) - 10;
+    $load = 0 if ($load < 0 || ($ms % 60000) >= 50000);   # traffic light
+    $load = 90 if ($load > 90);
+    $heat += ($load * $load / 8100 - $heat / 300);
+    }
+
+  # Cell voltages in 5 mV steps:
+  my $ocv = 4100 - 200 * $t / $secs;
+  @cell = map { int(($ocv + $offset[$_] - $load * $res[$_] + rand(3)) / 5) } (0..13);
+
+  frame($t, 0x556, (pack12(@cell[0..4]))[0..7]);
+  next if ($ms % 1000 != 0);
+
+  frame($t + 0.010, 0x554, (map { int($tbase[$_] + $heat) + 40 } (0..6)), 0);
+  frame($t + 0.020, 0x557, (pack12(@cell[5..9]))[0..7]);
+  frame($t + 0.030, 0x55e, (pack12(@cell[10..13]))[0..5], 0, 0);
+  my $pack = 0;
+  $pack += $_ * 5 for @cell;
+  my @v = pack12(int($pack / 100), int(($pack + 50) / 100));
+  frame($t + 0.040, 0x55f, 0, 0, 0, 0, 0, @v);
+  }
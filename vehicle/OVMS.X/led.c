@@ -38,6 +38,7 @@ signed char   led_stat[OVMS_LED_N] = {0,0};
 signed char   led_tick = -10;
 unsigned char led_k;
 unsigned int  led_carticker = 0;
+unsigned char led_tmr1cnt = 0;   // TMR1 high byte extension, see vehicle_canstats_record()
 
 // Set LED
 void led_set(unsigned char led, signed char digit)
@@ -160,6 +161,7 @@ void led_isr(void)
           }
         }
       }
+    led_tmr1cnt++;
     PIR1bits.TMR1IF = 0;
     }
   }
@@ -42,6 +42,7 @@
 #define OVMS_LED_GRN 1             // Green LED
 
 extern unsigned char led_code[OVMS_LED_N];
+extern unsigned char led_tmr1cnt;          // TMR1 overflow count (104.8576ms)
 
 void led_set(unsigned char, signed char); // Set LED
 void led_start(void);              // Restart LED sequence immediately
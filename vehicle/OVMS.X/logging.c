@@ -29,9 +29,71 @@
 */
 
 #include <string.h>
+#include <flash.h>
 #include "ovms.h"
+#include "utils.h"
 #include "logging.h"
 #include "net_msg.h"
+#include "vehicle.h"
+
+// Record store
+//
+// Finished records go to a ring of LOG_STORE_SLOTS flash blocks at
+// LOG_STORE_BASE, so they survive GPRS outages and resets until the server
+// has acknowledged them. Each slot holds one record with a sequence number
+// and a crc, and is erased once per record: a slot is only rewritten after
+// an erase, acknowledged slots are erased by logging_ticker() (one per
+// second). When the ring is full, the oldest unacknowledged record is
+// overwritten.
+//
+// An erase or write stalls the CPU for about 2 ms, the CAN ISR can't empty
+// the two RX buffers meanwhile. Finished records wait in log_recs[] and
+// erases are deferred until the bus has been quiet for LOG_STORE_QUIET
+// seconds or the car has been off for LOG_STORE_PARKED seconds (for buses
+// that don't sleep, and not right after a reset, before the car state has
+// been decoded), see log_store_idle().
+//
+// The sequence number is the ack code of the "MP-0 h" message; the server
+// acknowledges single records ("h<seq>") or runs of them ("h<first>-<last>").
+
+#ifndef OVMS_HOST
+// Keep the linker off the store. The store is initialised blank (0xff,
+// erased flash): C18 fills an uninitialised romdata section with zeros,
+// which would have to be erased slot by slot after every reflash.
+#if (LOG_STORE_SLOTS != 32) || (LOG_STORE_SLOT != 64)
+#error "log_store: one LOG_BLANK per slot"
+#endif
+#define LOG_FF8   0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff
+#define LOG_BLANK LOG_FF8,LOG_FF8,LOG_FF8,LOG_FF8,LOG_FF8,LOG_FF8,LOG_FF8,LOG_FF8
+#ifdef OVMS_HW_V1
+#pragma romdata LOGSTORE=0x00F800
+#else
+#pragma romdata LOGSTORE=0x017800
+#endif
+rom unsigned char log_store[LOG_STORE_SLOTS*LOG_STORE_SLOT] =
+  {
+  LOG_BLANK, LOG_BLANK, LOG_BLANK, LOG_BLANK, LOG_BLANK, LOG_BLANK, LOG_BLANK, LOG_BLANK,
+  LOG_BLANK, LOG_BLANK, LOG_BLANK, LOG_BLANK, LOG_BLANK, LOG_BLANK, LOG_BLANK, LOG_BLANK,
+  LOG_BLANK, LOG_BLANK, LOG_BLANK, LOG_BLANK, LOG_BLANK, LOG_BLANK, LOG_BLANK, LOG_BLANK,
+  LOG_BLANK, LOG_BLANK, LOG_BLANK, LOG_BLANK, LOG_BLANK, LOG_BLANK, LOG_BLANK, LOG_BLANK
+  };
+#pragma romdata
+#endif // #ifndef OVMS_HOST
+
+union logging_slot
+  {
+  struct
+    {
+    UINT16 seq;                     // Sequence number
+    struct logging_record rec;
+    unsigned char crc;              // crc8 of seq and rec
+    } s;
+  unsigned char raw[LOG_STORE_SLOT];
+  };
+
+#define LOG_STORE_ADDR(x) (LOG_STORE_BASE + (unsigned long)(x) * LOG_STORE_SLOT)
+#define LOG_STORE_BIT(x)  (1UL << (x))
+#define LOG_STORE_CRCLEN  (sizeof(UINT16) + sizeof(struct logging_record))
 
 // LOGGING data
 #pragma udata LOGGING
@@ -44,9 +106,103 @@ unsigned int  log_granular_tick = 0;        // An internal ticker used to genera
 
 struct logging_record log_recs[LOG_RECORDSTORE];
 signed char logging_pos = -1;
-signed char logging_pending = 0;
 signed char logging_coolingdown = -1;
 
+union logging_slot log_slot;                // Flash block buffer
+UINT16        log_store_seq = 0;            // Next sequence number
+unsigned char log_store_next = 0;           // Next slot to write
+unsigned long log_store_used = 0;           // Slots holding a record
+unsigned long log_store_sent = 0;           //   sent since the server connected
+unsigned long log_store_erase = 0;          // Slots to erase
+unsigned int  log_store_drops = 0;          // Records overwritten unacknowledged
+unsigned int  log_store_parked = 0;         // Seconds the car has been off
+
+// Read slot x into log_slot, return TRUE if it holds a valid record
+BOOL log_store_read(unsigned char x)
+  {
+  ReadFlash(LOG_STORE_ADDR(x), sizeof(log_slot.s), log_slot.raw);
+  if ((log_slot.s.rec.type != LOG_TYPE_DRIVE)&&(log_slot.s.rec.type != LOG_TYPE_CHARGE))
+    return FALSE;
+  return (crc8((char*)log_slot.raw, LOG_STORE_CRCLEN) == log_slot.s.crc);
+  }
+
+// Move a finished record from RAM to the store
+void log_store_add(struct logging_record *rec)
+  {
+  unsigned char x = log_store_next;
+  unsigned long bit = LOG_STORE_BIT(x);
+
+  CHECKPOINT(0x5a)
+
+  if (log_store_used & bit)
+    log_store_drops++; // Store full, overwrite the oldest record
+  memset(log_slot.raw, 0xff, LOG_STORE_SLOT);
+  log_slot.s.seq = log_store_seq++;
+  memcpy((void*)&log_slot.s.rec, (void*)rec, sizeof(struct logging_record));
+  log_slot.s.crc = crc8((char*)log_slot.raw, LOG_STORE_CRCLEN);
+  if ((log_store_used|log_store_erase) & bit)
+    EraseFlash(LOG_STORE_ADDR(x), LOG_STORE_ADDR(x) + LOG_STORE_SLOT - 1);
+  WriteBlockFlash(LOG_STORE_ADDR(x), 1, log_slot.raw);
+  log_store_used |= bit;
+  log_store_sent &= ~bit;
+  log_store_erase &= ~bit;
+  log_store_next = (x+1) % LOG_STORE_SLOTS;
+
+  memset((void*)rec,0,sizeof(struct logging_record));
+  rec->type = LOG_TYPE_FREE;
+  }
+
+// Flash erases and writes only while the bus is quiet or the car is off
+BOOL log_store_idle(void)
+  {
+  return ((can_quiet >= LOG_STORE_QUIET)||(log_store_parked >= LOG_STORE_PARKED));
+  }
+
+// Move a finished record waiting in log_recs[] to the store, FALSE if none
+BOOL log_store_flush(void)
+  {
+  unsigned char x;
+
+  for (x=0;x<LOG_RECORDSTORE;x++)
+    {
+    if ((log_recs[x].type == LOG_TYPE_DRIVE)||(log_recs[x].type == LOG_TYPE_CHARGE))
+      {
+      log_store_add(&log_recs[x]);
+      return TRUE;
+      }
+    }
+  return FALSE;
+  }
+
+// Scan the store after a reset
+void log_store_scan(void)
+  {
+  unsigned char x, k;
+  signed char newest = -1;
+
+  log_store_used = log_store_sent = log_store_erase = 0;
+  for (x=0;x<LOG_STORE_SLOTS;x++)
+    {
+    if (log_store_read(x))
+      {
+      log_store_used |= LOG_STORE_BIT(x);
+      if ((newest < 0)||((INT16)(log_slot.s.seq - log_store_seq) >= 0))
+        {
+        newest = x;
+        log_store_seq = log_slot.s.seq + 1;
+        }
+      }
+    else
+      {
+      // Not a record: erase unless blank
+      for (k=0;(k<sizeof(log_slot.s))&&(log_slot.raw[k]==0xff);k++) {}
+      if (k<sizeof(log_slot.s))
+        log_store_erase |= LOG_STORE_BIT(x);
+      }
+    }
+  log_store_next = (newest < 0) ? 0 : (newest+1) % LOG_STORE_SLOTS;
+  }
+
 signed char log_getfreerecord(void)
   {
   unsigned char x;
@@ -57,6 +213,17 @@ signed char log_getfreerecord(void)
       return x;
     }
 
+  // A drive or charge starts before the last record went to the store:
+  // store it now, even on a busy bus, rather than lose the new one
+  for (x=0;x<LOG_RECORDSTORE;x++)
+    {
+    if ((log_recs[x].type == LOG_TYPE_DRIVE)||(log_recs[x].type == LOG_TYPE_CHARGE))
+      {
+      log_store_add(&log_recs[x]);
+      return x;
+      }
+    }
+
   return -1;
   }
 
@@ -155,7 +322,6 @@ void log_state_ticker1(void)
         CHECKPOINT(0x55)
         rec = &log_recs[logging_pos];
         logging_pos = -1;
-        logging_pending++;
         rec->type = LOG_TYPE_DRIVE;
         rec->duration = car_time - rec->start_time;
         rec->record.drive.end_latitude = car_latitude;
@@ -163,7 +329,7 @@ void log_state_ticker1(void)
         rec->record.drive.distance = car_odometer - rec->record.drive.distance;
         rec->record.drive.end_SOC = car_SOC;
         rec->record.drive.end_idealrange = car_idealrange;
-        log_state_enter(LOG_STATE_PARKED);
+        log_state_enter(LOG_STATE_PARKED); // record waits for log_store_flush()
         }
       break;
     case LOG_STATE_CHARGING:
@@ -186,7 +352,6 @@ void log_state_ticker1(void)
         // Charge/Cooldown has finished
         CHECKPOINT(0x56)
         logging_pos = -1;
-        logging_pending++;
         rec->type = LOG_TYPE_CHARGE;
         rec->duration = car_time - rec->start_time;
         rec->record.charge.charge_mode = (logging_coolingdown>=0)?5:car_chargemode;
@@ -199,7 +364,7 @@ void log_state_ticker1(void)
         rec->record.charge.end_SOC = car_SOC;
         rec->record.charge.end_idealrange = car_idealrange;
         rec->record.charge.end_cac100 = car_cac100;
-        log_state_enter(LOG_STATE_PARKED);
+        log_state_enter(LOG_STATE_PARKED); // record waits for log_store_flush()
         }
       logging_coolingdown = car_coolingdown;
       break;
@@ -215,25 +380,40 @@ void log_state_ticker1(void)
 unsigned char logging_haspending(void)
   {
   // Pending log messages
-  return logging_pending;
+  return ((log_store_used & ~log_store_sent) != 0);
   }
 
 void logging_sendpending(void)
   {
-  // Send pending log messages
+  // Send pending log messages, oldest first, up to LOG_SEND_BATCH per call
 
   char *s;
-  unsigned char x;
-  struct logging_record *rec;
+  unsigned char k, x, n;
+  unsigned long bit;
+  struct logging_record *rec = &log_slot.s.rec;
 
   CHECKPOINT(0x57)
-  for (x=0;x<LOG_RECORDSTORE;x++)
+  n = 0;
+  for (k=0;k<LOG_STORE_SLOTS;k++)
     {
-    rec = &log_recs[x];
+    x = (log_store_next + k) % LOG_STORE_SLOTS;
+    bit = LOG_STORE_BIT(x);
+    if (((log_store_used & bit) == 0)||(log_store_sent & bit))
+      continue;
+    if (n == LOG_SEND_BATCH)
+      return; // More on the next call
+    log_store_sent |= bit;
+    if (!log_store_read(x))
+      {
+      // Lost the record (flash corrupted)
+      log_store_used &= ~bit;
+      log_store_erase |= bit;
+      continue;
+      }
     if ((rec->type == LOG_TYPE_DRIVE)&&
         (sys_features[FEATURE_OPTIN]&FEATURE_OI_LOGDRIVES))
       {
-      s = stp_i(net_scratchpad, "MP-0 h", x);
+      s = stp_ul(net_scratchpad, "MP-0 h", log_slot.s.seq);
       s = stp_l(s, ",", rec->start_time - car_time);
       s = stp_i(s, ",*-Log-Drive,", 0);
       s = stp_rom(s, ",31536000");
@@ -250,14 +430,12 @@ void logging_sendpending(void)
       s = stp_i(s, ",", rec->record.drive.end_SOC);
       s = stp_i(s, ",", rec->record.drive.end_idealrange);
       net_msg_encode_puts();
-      rec->type = LOG_TYPE_DRIVE_DEL;
-      logging_pending = 1;
-      return; // Send one at a time
+      n++;
       }
     else if ((rec->type == LOG_TYPE_CHARGE)&&
              (sys_features[FEATURE_OPTIN]&FEATURE_OI_LOGCHARGE))
       {
-      s = stp_i(net_scratchpad, "MP-0 h", x);
+      s = stp_ul(net_scratchpad, "MP-0 h", log_slot.s.seq);
       s = stp_l(s, ",", rec->start_time - car_time);
       s = stp_i(s, ",*-Log-Charge,", 0);
       s = stp_rom(s, ",31536000");
@@ -275,65 +453,56 @@ void logging_sendpending(void)
       s = stp_i(s, ",", rec->record.charge.end_idealrange);
       s = stp_l2f(s, ",", (unsigned long)rec->record.charge.end_cac100, 2);
       net_msg_encode_puts();
-      rec->type = LOG_TYPE_CHARGE_DEL;
-      logging_pending = 1;
-      return; // Send one at a time
+      n++;
       }
     }
-  logging_pending = 0;
   }
 
 void logging_serverconnect(void)
   {
   // Indication that server has connected
-  unsigned char x;
-  struct logging_record *rec;
 
   CHECKPOINT(0x58)
 
-  // We need to reset the pending deliveries
-  // And record the correct number of deliveries pending
-  logging_pending = 0;
-  for (x=0;x<LOG_RECORDSTORE;x++)
-    {
-    rec = &log_recs[x];
-    switch (rec->type)
-      {
-      case LOG_TYPE_CHARGE_DEL:
-        rec->type = LOG_TYPE_CHARGE;
-        logging_pending++;
-        break;
-      case LOG_TYPE_DRIVE_DEL:
-        rec->type = LOG_TYPE_DRIVE;
-        logging_pending++;
-        break;
-      case LOG_TYPE_DRIVE:
-      case LOG_TYPE_CHARGE:
-        logging_pending++;
-        break;
-      }
-    }
+  // Unacknowledged records need to be sent again
+  log_store_sent = 0;
   }
 
-void logging_ack(unsigned char ack)
+void logging_ack(unsigned int first, unsigned int last)
   {
-  // A server acknowledgement
-  struct logging_record *rec;
+  // A server acknowledgement of the records first..last
+  unsigned char x;
+  UINT16 seq;
 
   CHECKPOINT(0x59)
 
-  if ((ack>=0)&&(ack<LOG_RECORDSTORE))
+  for (x=0;x<LOG_STORE_SLOTS;x++)
     {
-    rec = &log_recs[ack];
-    if ((rec->type == LOG_TYPE_DRIVE_DEL)||
-        (rec->type == LOG_TYPE_CHARGE_DEL))
+    if ((log_store_used & LOG_STORE_BIT(x)) == 0)
+      continue;
+    ReadFlash(LOG_STORE_ADDR(x), sizeof(seq), (unsigned char*)&seq);
+    if ((UINT16)(seq - first) <= (UINT16)(last - first))
       {
-      memset((void*)rec,0,sizeof(struct logging_record));
-      rec->type = LOG_TYPE_FREE;
+      log_store_used &= ~LOG_STORE_BIT(x);
+      log_store_sent &= ~LOG_STORE_BIT(x);
+      log_store_erase |= LOG_STORE_BIT(x);
       }
     }
   }
 
+unsigned char logging_stored(void)
+  {
+  // Records in the store
+  unsigned char x, n = 0;
+
+  for (x=0;x<LOG_STORE_SLOTS;x++)
+    {
+    if (log_store_used & LOG_STORE_BIT(x))
+      n++;
+    }
+  return n;
+  }
+
 void log_state_ticker60(void)
   {
   }
@@ -345,13 +514,20 @@ void log_state_ticker3600(void)
 void logging_initialise(void)        // Logging Initialisation
   {
   memset((void*)&log_recs,0,sizeof(struct logging_record)*LOG_RECORDSTORE);
+  log_store_scan();
   log_state_enter(LOG_STATE_FIRSTRUN);
   }
 
 void logging_ticker(void)            // Logging Ticker
   {
   // This ticker is called once every second
+  unsigned char x;
+
   log_granular_tick++;
+  if (CAR_IS_ON || CAR_IS_CHARGING)
+    log_store_parked = 0;
+  else if (log_store_parked < LOG_STORE_PARKED)
+    log_store_parked++;
   if ((log_timeout_goto > 0)&&(log_timeout_ticks-- == 0))
     {
     log_state_enter(log_timeout_goto);
@@ -360,6 +536,16 @@ void logging_ticker(void)            // Logging Ticker
     {
     log_state_ticker1();
     }
+  if (log_store_idle())
+    {
+    // Store a finished record, else erase one acknowledged slot per second
+    if ((!log_store_flush())&&(log_store_erase))
+      {
+      for (x=0;(log_store_erase & LOG_STORE_BIT(x))==0;x++) {}
+      log_store_erase &= ~LOG_STORE_BIT(x);
+      EraseFlash(LOG_STORE_ADDR(x), LOG_STORE_ADDR(x) + LOG_STORE_SLOT - 1);
+      }
+    }
   if ((log_granular_tick % 60)==0)    log_state_ticker60();
   if ((log_granular_tick % 3600)==0)
     {
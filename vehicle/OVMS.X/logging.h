@@ -48,10 +48,8 @@ extern unsigned int  log_timeout_ticks;        // Number of seconds before timeo
 extern unsigned int  log_granular_tick;        // An internal ticker used to generate 1min, 5min, etc, calls
 
 #define LOG_TYPE_CHARGE         'C'     // A charge log record
-#define LOG_TYPE_CHARGE_DEL     'c'     // A charge log record being delivered
 #define LOG_TYPE_CHARGING       'h'     // A charging log record
 #define LOG_TYPE_DRIVE          'D'     // A drive log record
-#define LOG_TYPE_DRIVE_DEL      'd'     // A drive log record being delivered
 #define LOG_TYPE_DRIVING        'r'     // A driving log record
 #define LOG_TYPE_FREE           0       // A free log record
 
@@ -59,7 +57,21 @@ extern unsigned int  log_granular_tick;        // An internal ticker used to gen
 #define LOG_CHARGERESULT_STOP   1       // Result if charge was stopped
 #define LOG_CHARGERESULT_FAIL   2       // Result if charge failed
 
-#define LOG_RECORDSTORE         6       // Number of records that can be stored
+#define LOG_RECORDSTORE         1       // Number of records in progress (RAM)
+
+// Finished records are kept in program flash until the server acknowledges
+// them, one record per flash erase block (see logging.c). The store takes
+// the top LOG_STORE_SLOTS*LOG_STORE_SLOT bytes of the program memory.
+#define LOG_STORE_SLOTS         32      // Number of records that can be stored
+#define LOG_STORE_SLOT          64      // Bytes per record (FLASH_ERASE_BLOCK)
+#define LOG_STORE_QUIET         2       // Seconds without CAN frames for flash work
+#define LOG_STORE_PARKED        600     // or seconds the car has been off
+#ifdef OVMS_HW_V1
+#define LOG_STORE_BASE          0x00F800  // PIC18F2680: 64K program memory
+#else
+#define LOG_STORE_BASE          0x017800  // PIC18F2685: 96K program memory
+#endif
+#define LOG_SEND_BATCH          8       // Records sent per net_idlepoll() pass
 
 struct logging_record
   {
@@ -99,11 +111,13 @@ struct logging_record
   };
   
 extern struct logging_record log_recs[LOG_RECORDSTORE];
+extern unsigned int log_store_drops;           // Records overwritten unacknowledged
 
 unsigned char logging_haspending(void); // Pending log messages
 void logging_sendpending(void);         // Send pending log messages
 void logging_serverconnect(void);       // Indication that server has connected
-void logging_ack(unsigned char ack);    // A server acknowledgement
+void logging_ack(unsigned int first, unsigned int last); // A server acknowledgement
+unsigned char logging_stored(void);     // Records in the store
 void logging_initialise(void);          // Logging Initialisation
 void logging_ticker(void);              // Logging Ticker
 
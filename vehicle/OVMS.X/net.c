@@ -46,12 +46,32 @@
 #include "logging.h"
 #endif // #ifdef OVMS_LOGGINGMODULE
 
+// Host build benchmarks: EEPROM reads of a status update, program memory
+// reads of the modem line dispatch
+#ifdef OVMS_HOST
+extern void host_update_probe(unsigned char end);
+extern void host_line_probe(unsigned char end);
+extern void host_pgm_read(unsigned char n);
+#define NET_UPDATE_PROBE(e) host_update_probe(e)
+#define NET_LINE_PROBE(e) host_line_probe(e)
+#define NET_PGM_READ(n) host_pgm_read(n)
+#else
+#define NET_UPDATE_PROBE(e)
+#define NET_LINE_PROBE(e)
+#define NET_PGM_READ(n)
+#endif // OVMS_HOST
+
 // NET data
 #pragma udata
 unsigned char net_state = 0;                // The current state
 unsigned char net_state_vchar = 0;          //   A per-state CHAR variable
 unsigned int  net_state_vint = NET_GPRS_RETRIES; //   A per-state INT variable
 unsigned char net_cops_tries = 0;           // A counter for COPS attempts
+unsigned char net_backoff_tries = 0;        // GPRS / TCP connect attempts since the last connect
+unsigned int  net_reconnects[NET_RECONNECT_HIST] = {0}; // Reconnect time histogram
+unsigned int  net_reconnect_ticks = 0;      // Seconds since the server session was lost (0 = none lost)
+char net_server_ip[16];                     // IP address of the server host name
+unsigned char net_server_gen = 0;           // par_generation of net_server_ip (0 = none)
 unsigned char net_timeout_goto = 0;         // State to auto-transition to, after timeout
 unsigned int  net_timeout_ticks = 0;        // Number of seconds before timeout auto-transition
 unsigned int  net_granular_tick = 0;        // An internal ticker used to generate 1min, 5min, etc, calls
@@ -66,6 +86,18 @@ unsigned char net_buf_todotimeout = 0;      // Timeout for bytes outstanding
 
 unsigned char net_fnbits = 0;               // Net functionality bits
 
+struct net_at_cmd                           // AT command queue entry:
+  {
+  const rom char *cmd;                      //   Command line incl. "\r"
+  unsigned char expect;                     //   Final result codes (NET_AT_*)
+  unsigned char timeout;                    //   Timeout in 1/10 seconds
+  net_at_handler done;                      //   Completion handler or NULL
+  };
+struct net_at_cmd net_at_cmds[NET_AT_QUEUE]; // The AT command queue
+unsigned char net_at_head = 0;              // Index of the next / sent command
+unsigned char net_at_count = 0;             // Number of commands queued
+unsigned char net_at_timer = 0;             // 1/10 s left for the result (0 = none sent)
+
 #ifdef OVMS_SOCALERT
 unsigned char net_socalert_sms = 0;         // SOC Alert (msg) 10min ticks remaining
 unsigned char net_socalert_msg = 0;         // SOC Alert (sms) 10min ticks remaining
@@ -139,11 +171,13 @@ rom char NET_IPR_SET[] = "AT+IPR=9600\r"; // sets fixed baud rate for the modem
 void low_isr(void);
 
 // serial interrupt taken as low priority interrupt
+#ifndef OVMS_HOST
 #pragma code uart_int_service = 0x18
 void uart_int_service(void)
   {
   _asm goto low_isr _endasm
   }
+#endif // OVMS_HOST
 #pragma code
 
 // ISR optimization, see http://www.xargs.com/pic/c18-isr-optim.pdf
@@ -231,6 +265,15 @@ void net_poll(void)
       // Skip 0x0d (CR)
       if (x == 0x0d) continue;
       
+      // Skip the CIPSEND prompt "> " (has no line end), else an
+      // +IPD arriving before the SEND OK would not be recognized:
+      if ((x == ' ')&&(net_buf_pos==1)&&(net_buf[0]=='>'))
+        {
+        net_buf_pos = 0;
+        net_at_result(NET_AT_PROMPT);
+        continue;
+        }
+      
       // Add char to buffer:
       net_buf[net_buf_pos++] = x;
       if (net_buf_pos == NET_BUF_MAX) net_buf_pos--;
@@ -366,6 +409,15 @@ void net_poll(void)
   }
 
 
+// Body for busy waits on UART ISR state (TX buffer full/empty):
+// the host build has no real interrupts and needs to run them from here.
+#ifdef OVMS_HOST
+#define UART_WAIT_ISR() host_isr_wait()
+#else
+#define UART_WAIT_ISR()
+#endif // OVMS_HOST
+
+
 ////////////////////////////////////////////////////////////////////////
 // net_wait4modem()
 // 
@@ -379,10 +431,13 @@ void net_wait4modem()
   {
   UINT8 c, len;
   
+  // close a CIPSEND prompt requested through the AT queue:
+  net_msg_prompt_close();
+  
   // wait for TX flush:
   if (!vUARTIntStatus.UARTIntTxBufferEmpty)
     {
-    while (!vUARTIntStatus.UARTIntTxBufferEmpty);
+    while (!vUARTIntStatus.UARTIntTxBufferEmpty) UART_WAIT_ISR();
     // add 25 ms processing time:
     delay5(5);
     }
@@ -438,17 +493,151 @@ BOOL net_wait4prompt()
   }
 
 
+////////////////////////////////////////////////////////////////////////
+// net_at_queue()
+// Queue an AT command, net_idlepoll() sends it when the modem is idle
+// and no other queued command is waiting for its result.
+//
+// expect: final result codes of the command (NET_AT_OK, NET_AT_ERROR,
+//   NET_AT_PROMPT), | NET_AT_FIRST to queue it before the commands not
+//   yet sent (e.g. data before housekeeping queries)
+// timeout: 1/10 seconds to wait for the result (1..255)
+// done: completion handler or NULL, called with the result code received
+//   or NET_AT_TIMEOUT
+//
+// Responses other than the final result (e.g. "+CSQ: ...") are handled
+// by net_state_activity() as they arrive.
+// Returns FALSE if the queue is full. A command already queued is not
+// queued twice, so periodic queries don't pile up while the modem is busy.
+//
+BOOL net_at_queue(const rom char *cmd, unsigned char expect, unsigned char timeout, net_at_handler done)
+  {
+  unsigned char i, k;
+
+  for (i=0; i<net_at_count; i++)
+    {
+    if (net_at_cmds[(net_at_head+i) % NET_AT_QUEUE].cmd == cmd)
+      return TRUE;
+    }
+  if (net_at_count == NET_AT_QUEUE)
+    return FALSE;
+
+  if (expect & NET_AT_FIRST)
+    {
+    // Insert behind the command sent (if any):
+    k = (net_at_timer) ? 1 : 0;
+    for (i=net_at_count; i>k; i--)
+      net_at_cmds[(net_at_head+i) % NET_AT_QUEUE] =
+        net_at_cmds[(net_at_head+i-1) % NET_AT_QUEUE];
+    }
+  else
+    k = net_at_count;
+
+  i = (net_at_head+k) % NET_AT_QUEUE;
+  net_at_cmds[i].cmd = cmd;
+  net_at_cmds[i].expect = expect & ~NET_AT_FIRST;
+  net_at_cmds[i].timeout = timeout;
+  net_at_cmds[i].done = done;
+  net_at_count++;
+  return TRUE;
+  }
+
+////////////////////////////////////////////////////////////////////////
+// net_at_active()
+// Returns the expected result codes of the queued command waiting for
+// its result, 0 if none has been sent.
+//
+unsigned char net_at_active(void)
+  {
+  return (net_at_timer) ? net_at_cmds[net_at_head].expect : 0;
+  }
+
+////////////////////////////////////////////////////////////////////////
+// net_at_result()
+// A final result code has been received (or NET_AT_TIMEOUT): complete
+// the command sent if it expects the result, and call its handler.
+//
+void net_at_result(unsigned char result)
+  {
+  net_at_handler done;
+
+  if ((net_at_timer == 0) ||
+      ((result != NET_AT_TIMEOUT) && ((net_at_cmds[net_at_head].expect & result) == 0)))
+    return;
+
+  done = net_at_cmds[net_at_head].done;
+  net_at_head = (net_at_head+1) % NET_AT_QUEUE;
+  net_at_count--;
+  net_at_timer = 0;
+
+  if (done)
+    done(result);
+  }
+
+////////////////////////////////////////////////////////////////////////
+// net_at_next()
+// Send the next queued AT command if the modem is idle.
+//
+static void net_at_next(void)
+  {
+  if ((net_at_timer == 0) && (net_at_count > 0) &&
+      (!net_msg_prompt) && MODEM_READY())
+    {
+    net_puts_rom(net_at_cmds[net_at_head].cmd);
+    net_at_timer = net_at_cmds[net_at_head].timeout;
+    }
+  }
+
+////////////////////////////////////////////////////////////////////////
+// net_at_reset()
+// Drop all queued AT commands (on net state changes).
+//
+void net_at_reset(void)
+  {
+  if (net_at_active() & NET_AT_PROMPT)
+    net_puts_rom("\x1b"); // Cancel the data prompt, should it still come
+  net_at_count = 0;
+  net_at_timer = 0;
+  }
+
+////////////////////////////////////////////////////////////////////////
+// Reconnect time histogram (DIAG "RECONN"): the time from the loss of
+// the server session (net_reconnect_lost(), by net_msg_disconnected())
+// to the next server login (net_reconnect_done()), counted in buckets
+// below net_reconnect_secs.
+//
+rom unsigned int net_reconnect_secs[NET_RECONNECT_HIST-1] = { 5, 15, 30, 60, 120 };
+
+void net_reconnect_lost(void)
+  {
+  if (net_reconnect_ticks == 0)
+    net_reconnect_ticks = 1;
+  }
+
+void net_reconnect_done(void)
+  {
+  unsigned char k;
+
+  if (net_reconnect_ticks == 0)
+    return;
+  for (k = 0; (k < NET_RECONNECT_HIST-1) && (net_reconnect_ticks > net_reconnect_secs[k]); k++) {}
+  if (net_reconnects[k] < 0xffff)
+    net_reconnects[k]++;
+  net_reconnect_ticks = 0;
+  }
+
+
 ////////////////////////////////////////////////////////////////////////
 // net_puts_rom()
 // Transmit zero-terminated character data from ROM to the async port.
-// N.B. This may block if the transmit buffer is full.
+// The string is queued by reference and sent by the UART TX ISR.
+// N.B. This may block if the transmit segment queue is full.
 //
 
-// Macro to wait for TxBuffer before call to PutChar():
+// Macro to wait for TX queue space before call to PutChar():
 #define UART_WAIT_PUTC(c) \
   { \
-  while (vUARTIntStatus.UARTIntTxBufferFull) ; \
-  while (UARTIntPutChar(c)==0) ; \
+  while (UARTIntPutChar(c)==0) UART_WAIT_ISR(); \
   }
 
 void net_puts_rom(const rom char *data)
@@ -500,19 +689,20 @@ void net_puts_rom(const rom char *data)
 
   else
     {
-    // Send characters up to the null
-    for (;*data;data++)
-      UART_WAIT_PUTC(*data)
+    // Queue the string up to the null
+    while (UARTIntPutRom(data)==0) UART_WAIT_ISR();
     }
   }
 
 ////////////////////////////////////////////////////////////////////////
 // net_puts_ram()
 // Transmit zero-terminated character data from RAM to the async port.
+// The data is copied to the UART TX buffer.
 // N.B. This may block if the transmit buffer is full.
 //
 void net_puts_ram(const char *data)
   {
+  UINT8 n;
 
   if (net_msg_bufpos)
     {
@@ -560,9 +750,13 @@ void net_puts_ram(const char *data)
 
   else
     {
-    // Send characters up to the null
-    for (;*data;data++)
-      UART_WAIT_PUTC(*data)
+    // Copy characters up to the null
+    while (*data)
+      {
+      if ((n = UARTIntPutRam(data)) == 0)
+        UART_WAIT_ISR();
+      data += n;
+      }
     }
   }
 
@@ -585,6 +779,44 @@ void net_putc_ram(const char data)
     }
   }
 
+////////////////////////////////////////////////////////////////////////
+// net_putb64_ram()
+// Transmit binary data from RAM base64 encoded to the async port.
+// The raw bytes are queued, the UART TX ISR does the encoding.
+// Returns FALSE (nothing sent) in SMS wrapper and DIAG mode, the caller
+// then needs to encode and output the data itself.
+// N.B. This may block if the transmit buffer is full.
+BOOL net_putb64_ram(BYTE *data, WORD len)
+  {
+  if (!net_putb64_open(data, len))
+    return FALSE;
+  UARTIntPutB64End();
+
+  return TRUE;
+  }
+
+////////////////////////////////////////////////////////////////////////
+// net_putb64_open()
+// As net_putb64_ram(), but leaves the encoding open: the data of the next
+// call continues the same base64 string, net_putb64_ram(NULL,0) ends it.
+// Nothing else can be sent until then.
+BOOL net_putb64_open(BYTE *data, WORD len)
+  {
+  if (net_msg_bufpos)
+    return FALSE;
+#ifdef OVMS_DIAGMODULE
+  if (net_state == NET_STATE_DIAGMODE)
+    return FALSE;
+#endif // OVMS_DIAGMODULE
+
+  for (; len > 0; len--, data++)
+    {
+    while (UARTIntPutB64(*data)==0) UART_WAIT_ISR();
+    }
+
+  return TRUE;
+  }
+
 #ifndef OVMS_NO_ERROR_NOTIFY
 ////////////////////////////////////////////////////////////////////////
 // net_req_notification_error()
@@ -627,13 +859,11 @@ void net_req_notification_error(unsigned int errorcode, unsigned long errordata)
 //
 void net_req_notification(unsigned int notify)
   {
-  char *p;
-  p = par_get(PARAM_NOTIFIES);
-  if (strstrrampgm(p,(char const rom far*)"SMS") != NULL)
+  if (par_notifies & PAR_NOTIFY_SMS)
     {
     net_notify |= (notify<<8); // SMS notification flags are top 8 bits
     }
-  if (strstrrampgm(p,(char const rom far*)"IP") != NULL)
+  if (par_notifies & PAR_NOTIFY_IP)
     {
     net_notify |= notify;      // NET notification flags are bottom 8 bits
     }
@@ -689,6 +919,68 @@ void net_phonebook(char *pb)
 #endif //OVMS_NO_PHONEBOOKAP
 
 
+////////////////////////////////////////////////////////////////////////
+// net_backoff()
+// Pause before the next GPRS / TCP connect attempt in seconds, doubling
+// with every attempt since the last TCP connect: a short coverage gap is
+// bridged quickly, a long one costs few attempts. (The number of attempts
+// before a modem reset is still counted by net_state_vint.)
+//
+static unsigned int net_backoff(void)
+  {
+  if (net_backoff_tries < NET_BACKOFF_MAX)
+    net_backoff_tries++;
+  return (1 << net_backoff_tries);
+  }
+
+////////////////////////////////////////////////////////////////////////
+// net_bearer_up()
+// Check the CIPSTATUS "STATE: " line in net_buf for a GPRS context the
+// TCP connection can be reopened on without a full GPRS initialisation.
+//
+static BOOL net_bearer_up(void)
+  {
+  char *s = net_buf+7;
+
+  return ((memcmppgm2ram(s, "IP INITIAL", 10) != 0) &&
+          (memcmppgm2ram(s, "IP START", 8) != 0) &&
+          (memcmppgm2ram(s, "IP CONFIG", 9) != 0) &&
+          (memcmppgm2ram(s, "PDP DEACT", 9) != 0));
+  }
+
+////////////////////////////////////////////////////////////////////////
+// net_server_name()
+// Check if PARAM_SERVERIP is a host name rather than an IP address.
+//
+static BOOL net_server_name(void)
+  {
+  char *p;
+
+  for (p = par_get(PARAM_SERVERIP); *p; p++)
+    {
+    if (((*p < '0')||(*p > '9'))&&(*p != '.'))
+      return TRUE;
+    }
+  return FALSE;
+  }
+
+////////////////////////////////////////////////////////////////////////
+// net_cipstart()
+// Open the TCP connection to the server. While the parameters are
+// unchanged, this uses the IP address the server host name resolved to
+// (net_server_ip), so a reconnect does not depend on a DNS lookup.
+//
+static void net_cipstart(void)
+  {
+  led_set(OVMS_LED_GRN,NET_LED_NETCALL);
+  net_puts_rom("AT+CIPSTART=\"TCP\",\"");
+  if (net_server_gen == par_generation)
+    net_puts_ram(net_server_ip);
+  else
+    net_puts_ram(par_get(PARAM_SERVERIP));
+  net_puts_rom("\",\"6867\"\r");
+  }
+
 ////////////////////////////////////////////////////////////////////////
 // net_state_enter(newstate)
 // State Model: A new state has been entered.
@@ -705,6 +997,7 @@ void net_state_enter(unsigned char newstate)
 //  net_puts_ram(net_scratchpad);
 //  delay100(1);
   
+  net_at_reset();
   net_state = newstate;
   switch(net_state)
     {
@@ -822,7 +1115,7 @@ void net_state_enter(unsigned char newstate)
         led_set(OVMS_LED_RED,NET_LED_ERRGPRSFAIL);
         net_timeout_goto = NET_STATE_SOFTRESET;
         }
-      net_timeout_ticks = (NET_GPRS_RETRIES-net_state_vint)*5;
+      net_timeout_ticks = net_backoff();
       break;
     
     case NET_STATE_NETINITCP:
@@ -838,19 +1131,21 @@ void net_state_enter(unsigned char newstate)
         {
         net_timeout_goto = NET_STATE_SOFTRESET;
         }
-      net_timeout_ticks = (NET_GPRS_RETRIES-net_state_vint)*5;
+      net_timeout_ticks = net_backoff();
       break;
     case NET_STATE_DONETINITC:
       led_set(OVMS_LED_GRN,NET_LED_NETINIT);
       led_set(OVMS_LED_RED,OVMS_LED_OFF);
       net_watchdog=0; // Disable watchdog, as we have connectivity
       net_reg = 0x05; // Assume connectivity (as COPS worked)
-      net_timeout_goto = NET_STATE_SOFTRESET;
-      net_timeout_ticks = 60;
-      net_state_vchar = NETINIT_CLPORT;
+      // Probe the GPRS context: if it is still up, reopen the TCP
+      // connection on it, else (or without an answer) do a full init
+      net_timeout_goto = NET_STATE_DONETINIT;
+      net_timeout_ticks = 10;
+      net_state_vchar = NETINIT_PROBE;
       net_msg_disconnected();
       delay100(2);
-      net_puts_rom("AT+CLPORT=\"TCP\",\"6867\"\r");
+      net_puts_rom("AT+CIPSTATUS\r");
       net_state = NET_STATE_DONETINIT;
       break;
       
@@ -926,6 +1221,95 @@ void net_state_enter(unsigned char newstate)
     }
   }
 
+////////////////////////////////////////////////////////////////////////
+// Modem response line prefixes for net_line_class(), in ASCII order, each
+// with the number of leading characters it shares with the one before
+// (lcp), so the table can be walked like a trie. Keep both right when
+// adding a line (the host build checks them), the empty prefix ends it.
+//
+rom net_line_t net_lines[] =
+  {
+  { "+CCLK",             0, NET_LINE_CCLK },
+  { "+CDNSGIP",          2, NET_LINE_CDNSGIP },
+  { "+CFUN:",            2, NET_LINE_RDY },
+  { "+CGNSINF:",         2, NET_LINE_CGNSINF },
+  { "+CLIP",             2, NET_LINE_CLIP },
+  { "+CME ERROR",        2, NET_LINE_ERROR },
+  { "+COPS:",            2, NET_LINE_COPS },
+  { "+CREG",             2, NET_LINE_CREG },
+  { "+CSQ:",             2, NET_LINE_CSQ },
+  { "+CUSD:",            2, NET_LINE_CUSD },
+  { "+PDP: DEACT",       1, NET_LINE_PDPDEACT },
+  { "2,",                0, NET_LINE_GPSGGA },
+  { "64,",               0, NET_LINE_GPSVTG },
+  { "CLOSED",            0, NET_LINE_CLOSED },
+  { "CONNECT FAIL",      1, NET_LINE_CONNECTFAIL },
+  { "CONNECT OK",        8, NET_LINE_CONNECTOK },
+  { "DATA ACCEPT",       0, NET_LINE_SENDOK },
+  { "ERROR",             0, NET_LINE_ERROR },
+  { "NORMAL POWER DOWN", 0, NET_LINE_POWERDOWN },
+  { "OK",                0, NET_LINE_OK },
+  { "RDY",               0, NET_LINE_RDY },
+  { "SEND FAIL",         0, NET_LINE_SENDFAIL },
+  { "SEND OK",           5, NET_LINE_SENDOK },
+  { "SHUT OK",           1, NET_LINE_SHUTOK },
+  { "STATE: ",           1, NET_LINE_STATE },
+  { "",                  0, NET_LINE_OTHER }
+  };
+
+// Index of the first net_lines[] entry for each first character
+// NET_LINES_LO..NET_LINES_HI, NET_LINES_NONE if there is none:
+rom unsigned char net_line_first[NET_LINES_HI-NET_LINES_LO+1] =
+  {
+     0, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,   11, 0xff, 0xff, 0xff,   12, 0xff, 0xff, 0xff, 0xff,  // '+'..':'
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,   13,   16,   17, 0xff, 0xff, 0xff, 0xff, 0xff,  // ';'..'J'
+  0xff, 0xff, 0xff,   18,   19, 0xff, 0xff,   20,   21, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff   // 'K'..'Z'
+  };
+
+////////////////////////////////////////////////////////////////////////
+// net_line_class()
+// Identify the modem response line in net_buf by its prefix: returns
+// the NET_LINE_x code. Jumps to the prefixes starting with the first
+// character, then reads each program memory character at most once and
+// stops at the first character no prefix continues with.
+//
+unsigned char net_line_class(void)
+  {
+  rom net_line_t *l;
+  unsigned char n;
+  char c;
+
+  c = net_buf[0];
+  if ((c < NET_LINES_LO)||(c > NET_LINES_HI))
+    return NET_LINE_OTHER;
+  NET_PGM_READ(1);
+  n = net_line_first[c - NET_LINES_LO];
+  if (n == NET_LINES_NONE)
+    return NET_LINE_OTHER;
+  l = &net_lines[n];
+  n = 1;                      // First character matched by the jump
+
+  for (;;)
+    {
+    NET_PGM_READ(1);
+    c = l->prefix[n];
+    if (c == 0)
+      return l->line;         // Prefix complete (or end of table)
+    if (c == net_buf[n])
+      n++;                    // Next character
+    else if (c > net_buf[n])
+      return NET_LINE_OTHER;  // No prefix continues with net_buf[n]
+    else
+      {
+      // Next prefix, if it shares the n characters matched so far:
+      l++;
+      NET_PGM_READ(1);
+      if (l->lcp < n)
+        return NET_LINE_OTHER;
+      }
+    }
+  }
+
 ////////////////////////////////////////////////////////////////////////
 // net_state_activity()
 // State Model: Some async data has been received
@@ -937,6 +1321,7 @@ void net_state_enter(unsigned char newstate)
 void net_state_activity()
   {
   char *b;
+  unsigned char line;
 
   // Reset timeouts:
   net_buf_todotimeout = 0;
@@ -969,6 +1354,18 @@ void net_state_activity()
     return;
     }
 
+  NET_LINE_PROBE(0);
+  line = net_line_class();
+
+  // Final result of a queued AT command?
+  if (net_at_active())
+    {
+    if ((line == NET_LINE_OK)&&(net_buf_pos == 2))
+      net_at_result(NET_AT_OK);
+    else if (line == NET_LINE_ERROR)
+      net_at_result(NET_AT_ERROR);
+    }
+
   /*
   if ((net_buf_pos >= 8)&&
       (memcmppgm2ram(net_buf, "*PSUTTZ:", 8) == 0))
@@ -991,7 +1388,7 @@ void net_state_activity()
       break;
 #endif // #ifdef OVMS_DIAGMODULE
     case NET_STATE_START:
-      if ((net_buf_pos >= 2)&&(net_buf[0] == 'O')&&(net_buf[1] == 'K'))
+      if (line == NET_LINE_OK)
         {
         // OK response from the modem
         led_set(OVMS_LED_RED,OVMS_LED_OFF);
@@ -1012,7 +1409,7 @@ void net_state_activity()
 #endif //OVMS_DIAGMODULE
           }
         }
-      else if ((net_state_vchar==0)&&(net_buf_pos >= 2)&&(net_buf[0] == 'O')&&(net_buf[1] == 'K'))
+      else if ((net_state_vchar==0)&&(line == NET_LINE_OK))
         {
         // The SIM card is inserted
         led_set(OVMS_LED_RED,OVMS_LED_OFF);
@@ -1042,7 +1439,7 @@ void net_state_activity()
           net_state_vchar = 1;
           }
         }
-      else if ((net_state_vchar==0)&&(net_buf_pos >= 2)&&(net_buf[0] == 'O')&&(net_buf[1] == 'K'))
+      else if ((net_state_vchar==0)&&(line == NET_LINE_OK))
         {
         // The SIM card has no pin lock
         led_set(OVMS_LED_RED,OVMS_LED_OFF);
@@ -1056,25 +1453,24 @@ void net_state_activity()
         // SET IPR (baudrate)
         net_puts_rom(NET_IPR_SET);
         }
-      else if ((net_buf_pos >= 2)&&(net_buf[0] == 'O')&&(net_buf[1] == 'K'))
+      else if (line == NET_LINE_OK)
         {
         led_set(OVMS_LED_RED,OVMS_LED_OFF);
         net_state_enter(NET_STATE_COPS);
         }
       break;
     case NET_STATE_COPS:
-      if ((net_buf_pos >= 2)&&(net_buf[0] == 'O')&&(net_buf[1] == 'K'))
+      if (line == NET_LINE_OK)
         {
         net_state_vint = NET_GPRS_RETRIES; // Count-down for DONETINIT attempts
         net_cops_tries = 0; // Successfully out of COPS
         net_state_enter(NET_STATE_COPSSETTLE); // COPS reconnect was OK
         }
-      else if ( ((net_buf_pos >= 5)&&(net_buf[0] == 'E')&&(net_buf[1] == 'R')) ||
-              (memcmppgm2ram(net_buf, "+CME ERROR", 10) == 0) )
+      else if (line == NET_LINE_ERROR)
         {
         net_state_enter(NET_STATE_COPSWAIT); // Try to wait a bit to see if we get a CREG
         }
-      else if (memcmppgm2ram(net_buf, "+COPS:", 6) == 0)
+      else if (line == NET_LINE_COPS)
         {
         // COPS network registration
         b = firstarg(net_buf, '\"');
@@ -1090,7 +1486,7 @@ void net_state_activity()
         }
       break;
     case NET_STATE_COPSWAIT:
-      if (memcmppgm2ram(net_buf, "+CREG", 5) == 0)
+      if (line == NET_LINE_CREG)
         { // "+CREG" Network registration
         if (net_buf[8]==',')
           net_reg = net_buf[9]&0x07; // +CREG: 1,x
@@ -1105,8 +1501,58 @@ void net_state_activity()
         }
       break;
     case NET_STATE_DONETINIT:
-      if ((net_buf_pos >= 2)&&(net_buf[0] == 'E')&&(net_buf[1] == 'R') ||
-              (memcmppgm2ram(net_buf, "+CME ERROR", 10) == 0))
+      if (net_state_vchar == NETINIT_PROBE)
+        {
+        // Reply to the bearer probe of a TCP reconnect:
+        if (line != NET_LINE_STATE)
+          break;
+        net_timeout_goto = NET_STATE_SOFTRESET;
+        net_timeout_ticks = 30;
+        if (!net_bearer_up())
+          net_state_enter(NET_STATE_DONETINIT); // GPRS context lost: full init
+        else if (memcmppgm2ram(net_buf, "STATE: CONNECT OK", 17) == 0)
+          {
+          // Still connected: log in again on the next CIPSTATUS poll
+          net_link = 0;
+          net_state_enter(NET_STATE_READY);
+          }
+        else if (memcmppgm2ram(net_buf, "STATE: IP GPRSACT", 17) == 0)
+          {
+          // Context up, local IP address not yet queried:
+          net_state_vchar = NETINIT_CIFSR;
+          net_puts_rom("AT+CIFSR\r");
+          }
+        else
+          {
+          // Context up: reconnect right away
+          net_state_vchar = NETINIT_CIPSTART;
+          net_cipstart();
+          }
+        break;
+        }
+      else if (net_state_vchar == NETINIT_CDNSGIP)
+        {
+        // Reply to the server host name lookup: connect to the IP address
+        // found, or on failure let the modem resolve the name again
+        if ((line == NET_LINE_CDNSGIP)&&(net_buf[10] == '1')) // +CDNSGIP: 1,
+          {
+          b = firstarg(net_buf, '\"');   // +CDNSGIP: 1,
+          b = nextarg(b);                 // host name
+          b = nextarg(b);                 // ,
+          b = nextarg(b);                 // IP address
+          if ((b != NULL)&&(strlen(b) < sizeof(net_server_ip)))
+            {
+            strcpy(net_server_ip, b);
+            net_server_gen = par_generation;
+            }
+          }
+        else if ((line != NET_LINE_CDNSGIP)&&(line != NET_LINE_ERROR))
+          break;
+        net_state_vchar = NETINIT_CIPSTART;
+        net_cipstart();
+        break;
+        }
+      else if (line == NET_LINE_ERROR)
         {
         if ((net_state_vchar == NETINIT_CSTT)||
                 (net_state_vchar == NETINIT_CIICR))// ERROR response to AT+CSTT OR AT+CIICR
@@ -1120,11 +1566,15 @@ void net_state_activity()
           // The only solution I can find is a hard reset of the modem
           net_state_enter(NET_STATE_HARDRESET);
           }
+        else if (net_state_vchar == NETINIT_CIPSTART) // ERROR response to AT+CIPSTART
+          {
+          // no usable GPRS context: set up GPRS again, after short pause
+          net_state_enter(NET_STATE_NETINITP);
+          }
         }
-      else if ((net_buf_pos >= 2)&&
-          (((net_buf[0] == 'O')&&(net_buf[1] == 'K')))|| // OK
-          (((net_buf[0] == 'S')&&(net_buf[1] == 'H')))||  // SHUT OK
-          (net_state_vchar == NETINIT_CIFSR)) // Local IP address
+      else if ((line == NET_LINE_OK)||
+               (line == NET_LINE_SHUTOK)||
+               (net_state_vchar == NETINIT_CIFSR)) // Local IP address
         {
         net_buf_pos = 0;
         net_timeout_ticks = 30;
@@ -1171,22 +1621,27 @@ void net_state_activity()
             net_puts_rom("AT+CLPORT=\"TCP\",\"6867\"\r");
             break;
           case NETINIT_CIPSTART:
-            led_set(OVMS_LED_GRN,NET_LED_NETCALL);
-            net_puts_rom("AT+CIPSTART=\"TCP\",\"");
-            net_puts_ram(par_get(PARAM_SERVERIP));
-            net_puts_rom("\",\"6867\"\r");
+            if ((net_server_gen != par_generation) && net_server_name())
+              {
+              // Resolve the server host name for later reconnects:
+              net_state_vchar = NETINIT_CDNSGIP;
+              net_puts_rom("AT+CDNSGIP=\"");
+              net_puts_ram(par_get(PARAM_SERVERIP));
+              net_puts_rom("\"\r");
+              }
+            else
+              net_cipstart();
             break;
           case NETINIT_CONNECTING:
             net_state_enter(NET_STATE_READY);
             break;
           }
         }
-      else if ((net_buf_pos>=7)&&
-               (memcmppgm2ram(net_buf, "+CREG: 0", 8) == 0))
+      else if ((line == NET_LINE_CREG)&&(net_buf[5] == ':')&&(net_buf[7] == '0')) // +CREG: 0
         { // Lost network connectivity during NETINIT
         net_state_enter(NET_STATE_SOFTRESET);
         }
-      else if (memcmppgm2ram(net_buf, "+PDP: DEACT", 11) == 0)
+      else if (line == NET_LINE_PDPDEACT)
         { // PDP couldn't be activated - try again...
         net_state_enter(NET_STATE_SOFTRESET);
         }
@@ -1194,216 +1649,208 @@ void net_state_activity()
       
       
     case NET_STATE_READY:
-      if (memcmppgm2ram(net_buf, "+CREG", 5) == 0)
+      switch (line)
         {
-        // "+CREG" Network registration: either from...
-        if (net_buf[8]==',')
-          net_reg = net_buf[9]&0x07; // ...CMD: "+CREG: 1,x"
-        else
-          net_reg = net_buf[7]&0x07; // ...URC: "+CREG: x"
-        // 1 = Registered, home network
-        // 5 = Registered, roaming
-        if ((net_reg == 0x01)||(net_reg == 0x05)) // Registered to network?
-          {
-          net_watchdog=0; // Disable watchdog, as we have connectivity
-          led_set(OVMS_LED_RED,OVMS_LED_OFF);
-          }
-        else if (net_watchdog == 0)
-          {
-          net_watchdog = NET_REG_TIMEOUT; // We need connectivity within 120 seconds
-          led_set(OVMS_LED_RED,NET_LED_ERRLOSTSIG);
-          }
-        }
-      else if (memcmppgm2ram(net_buf, "+CLIP", 5) == 0)
-        { // Incoming CALL
-        if ((net_reg != 0x01)&&(net_reg != 0x05))
-          { // Treat this as a network registration
-          net_watchdog=0; // Disable watchdog, as we have connectivity
-          net_reg = 0x05;
-          led_set(OVMS_LED_RED,OVMS_LED_OFF);
-          }
-        delay100(1);
-        net_puts_rom(NET_HANGUP);
-        }
-      else if (memcmppgm2ram(net_buf, "+CCLK", 5) == 0)
-        {
-        // local clock update
-        // e.g.; +CCLK: "13/12/16,22:01:39+32"
-        if ((net_fnbits & NET_FN_CARTIME)>0)
-          {
-          unsigned long newtime = datestring_to_timestamp(net_buf+7);
-          if (newtime != car_time)
+        case NET_LINE_CREG:
+          // "+CREG" Network registration: either from...
+          if (net_buf[8]==',')
+            net_reg = net_buf[9]&0x07; // ...CMD: "+CREG: 1,x"
+          else
+            net_reg = net_buf[7]&0x07; // ...URC: "+CREG: x"
+          // 1 = Registered, home network
+          // 5 = Registered, roaming
+          if ((net_reg == 0x01)||(net_reg == 0x05)) // Registered to network?
             {
-            // Need to adjust the car_time
-            if (newtime > car_time)
-              {
-              unsigned long diff = newtime - car_time;
-              if (car_parktime!=0) { car_parktime += diff; }
-              car_time += diff;
-              }
-            else
-              {
-              unsigned long diff = car_time - newtime;
-              if (car_parktime!=0) { car_parktime -= diff; }
-              car_time -= diff;
-              }
+            net_watchdog=0; // Disable watchdog, as we have connectivity
+            led_set(OVMS_LED_RED,OVMS_LED_OFF);
             }
-          }
-        }
-#if defined(OVMS_INTERNALGPS) && defined(OVMS_SIMCOM_SIM908)
-      else if ((memcmppgm2ram(net_buf, "2,", 2) == 0)&&
-               ((net_fnbits & NET_FN_INTERNALGPS)>0))
-        {
-        // Incoming GPS coordinates
-        // NMEA format $GPGGA: Global Positioning System Fixed Data
-        // 2,<Time>,<Lat>,<NS>,<Lon>,<EW>,<Fix>,<SatCnt>,<HDOP>,<Alt>,<Unit>,...
-
-        long lat, lon;
-        char ns, ew;
-        char fix, satcnt;
-        int alt;
-
-        // Parse string:
-        if (b = firstarg(net_buf+2, ','))
-          ;                                     // Time
-        if (b = nextarg(b))
-          lat = gps2latlon(b);                  // Latitude
-        if (b = nextarg(b))
-          ns = *b;                              // North / South
-        if (b = nextarg(b))
-          lon = gps2latlon(b);                  // Longitude
-        if (b = nextarg(b))
-          ew = *b;                              // East / West
-        if (b = nextarg(b))
-          fix = *b;                             // Fix (0/1)
-        if (b = nextarg(b))
-          satcnt = atoi(b);                     // Satellite count
-        if (b = nextarg(b))
-          ;                                     // HDOP
-        if (b = nextarg(b))
-          alt = atoi(b);                        // Altitude
-
-        if (b)
-          {
-          // data set complete, store:
-
-          // upper two bits for fix mode (0-2), 6 bits for satcnt:
-          car_gpslock = ((fix & 0x03) << 6) + satcnt;
-
-          if (GPS_LOCK())
+          else if (net_watchdog == 0)
             {
-            if (ns == 'S') lat = ~lat;
-            if (ew == 'W') lon = ~lon;
-
-            car_latitude = lat;
-            car_longitude = lon;
-            car_altitude = alt;
-
-            car_stale_gps = 120; // Reset stale indicator
+            net_watchdog = NET_REG_TIMEOUT; // We need connectivity within 120 seconds
+            led_set(OVMS_LED_RED,NET_LED_ERRLOSTSIG);
             }
-          else
+          break;
+
+        case NET_LINE_CLIP:
+          // Incoming CALL
+          if ((net_reg != 0x01)&&(net_reg != 0x05))
+            { // Treat this as a network registration
+            net_watchdog=0; // Disable watchdog, as we have connectivity
+            net_reg = 0x05;
+            led_set(OVMS_LED_RED,OVMS_LED_OFF);
+            }
+          delay100(1);
+          net_puts_rom(NET_HANGUP);
+          break;
+
+        case NET_LINE_CCLK:
+          // local clock update
+          // e.g.; +CCLK: "13/12/16,22:01:39+32"
+          if ((net_fnbits & NET_FN_CARTIME)>0)
             {
-            car_stale_gps = 0;
+            unsigned long newtime = datestring_to_timestamp(net_buf+7);
+            if (newtime != car_time)
+              {
+              // Need to adjust the car_time
+              if (newtime > car_time)
+                {
+                unsigned long diff = newtime - car_time;
+                if (car_parktime!=0) { car_parktime += diff; }
+                car_time += diff;
+                }
+              else
+                {
+                unsigned long diff = car_time - newtime;
+                if (car_parktime!=0) { car_parktime -= diff; }
+                car_time -= diff;
+                }
+              }
             }
-         }
-
-      }
-    else if ((memcmppgm2ram(net_buf, "64,", 3) == 0)&&
-             ((net_fnbits & NET_FN_INTERNALGPS)>0))
-      {
-      // Incoming GPS coordinates
-      // NMEA format $GPVTG: Course over ground
-      // 64,<Course>,<Ref>,...
+          break;
 
-      int dir;
-
-      // Parse string:
-      if (b = firstarg(net_buf+3, ','))
-        dir = atoi(b);                      // Course
+#if defined(OVMS_INTERNALGPS) && defined(OVMS_SIMCOM_SIM908)
+        case NET_LINE_GPSGGA:
+          if ((net_fnbits & NET_FN_INTERNALGPS)>0)
+            {
+            // Incoming GPS coordinates
+            // NMEA format $GPGGA: Global Positioning System Fixed Data
+            // 2,<Time>,<Lat>,<NS>,<Lon>,<EW>,<Fix>,<SatCnt>,<HDOP>,<Alt>,<Unit>,...
+
+            long lat, lon;
+            char ns, ew;
+            char fix, satcnt;
+            int alt;
+
+            // Parse string:
+            if (b = firstarg(net_buf+2, ','))
+              ;                                     // Time
+            if (b = nextarg(b))
+              lat = gps2latlon(b);                  // Latitude
+            if (b = nextarg(b))
+              ns = *b;                              // North / South
+            if (b = nextarg(b))
+              lon = gps2latlon(b);                  // Longitude
+            if (b = nextarg(b))
+              ew = *b;                              // East / West
+            if (b = nextarg(b))
+              fix = *b;                             // Fix (0/1)
+            if (b = nextarg(b))
+              satcnt = atoi(b);                     // Satellite count
+            if (b = nextarg(b))
+              ;                                     // HDOP
+            if (b = nextarg(b))
+              alt = atoi(b);                        // Altitude
+
+            if (b)
+              {
+              // data set complete, store:
+
+              // upper two bits for fix mode (0-2), 6 bits for satcnt:
+              car_gpslock = ((fix & 0x03) << 6) + satcnt;
+
+              if (GPS_LOCK())
+                {
+                if (ns == 'S') lat = ~lat;
+                if (ew == 'W') lon = ~lon;
+
+                car_latitude = lat;
+                car_longitude = lon;
+                car_altitude = alt;
+
+                car_stale_gps = 120; // Reset stale indicator
+                }
+              else
+                {
+                car_stale_gps = 0;
+                }
+              }
+            }
+          break;
 
-      if (b)
-        {
-        // data set complete, store:
-        if (GPS_LOCK())
-          {
-          car_direction = dir;
-          }
-        }
+        case NET_LINE_GPSVTG:
+          if ((net_fnbits & NET_FN_INTERNALGPS)>0)
+            {
+            // Incoming GPS coordinates
+            // NMEA format $GPVTG: Course over ground
+            // 64,<Course>,<Ref>,...
 
-      }
-#elif defined(OVMS_INTERNALGPS) && defined(OVMS_SIMCOM_SIM808)
-      else if ((memcmppgm2ram(net_buf, "+CGNSINF:", 9) == 0)&&
-               ((net_fnbits & NET_FN_INTERNALGPS)>0))
-        {
-        // Incoming GPS coordinates
-        // +CGNSINF: <GNSS run status>,<Fix status>, <UTC date & Time>,<Latitude>,<Longitude>,
-        // <MSL Altitude>,<Speed Over Ground>, <Course Over Ground>,
-        // <Fix Mode>,<Reserved1>,<HDOP>,<PDOP>, <VDOP>,<Reserved2>,<GPS Satellites in View>,
-        // <GNSS Satellites Used>,<GLONASS Satellites in View>,<Reserved3>,<C/N0 max>,<HPA>,<VPA>
-        long lat, lon;
-        char fix, satcnt, i;
-        int alt;
-        int dir;
-      
-        // Parse string:
-        if (b = firstarg(net_buf+9, ','))
-          ;                                     // GNSS run status
-        if (b = nextarg(b))
-          fix = *b;                             // GNSS Fix status
-        if (b = nextarg(b))
-          ;                                     // UTC date & time
-        if (b = nextarg(b))
-          lat = gps2latlon(b);                  // Latitude
-        if (b = nextarg(b))
-          lon = gps2latlon(b);                  // Longitude
-        if (b = nextarg(b))
-          alt = atoi(b);                        // Altitude
-        if (b = nextarg(b))
-          ;                                     // Speed over ground
-        if (b = nextarg(b))
-          dir = atoi(b);                        // Course over ground
-        for (i=7; i; i--)
-          b = nextarg(b);                       // skip 7 fields
-        if (b = nextarg(b))
-          satcnt = atoi(b);                     // Satellite count
-
-        if (b)
-          {
-          // data set complete, store:
+            int dir;
 
-          car_gpslock = ((fix & 0x03) << 6) + satcnt;
+            // Parse string:
+            if (b = firstarg(net_buf+3, ','))
+              dir = atoi(b);                      // Course
 
-          if (GPS_LOCK())
-            {
-            car_latitude = lat;
-            car_longitude = lon;
-            car_altitude = alt;
-            car_direction = dir;
-          
-            car_stale_gps = 120; // Reset stale indicator
+            if (b)
+              {
+              // data set complete, store:
+              if (GPS_LOCK())
+                {
+                car_direction = dir;
+                }
+              }
             }
-          else
+          break;
+#elif defined(OVMS_INTERNALGPS) && defined(OVMS_SIMCOM_SIM808)
+        case NET_LINE_CGNSINF:
+          if ((net_fnbits & NET_FN_INTERNALGPS)>0)
             {
-            car_stale_gps = 0;
+            // Incoming GPS coordinates
+            // +CGNSINF: <GNSS run status>,<Fix status>, <UTC date & Time>,<Latitude>,<Longitude>,
+            // <MSL Altitude>,<Speed Over Ground>, <Course Over Ground>,
+            // <Fix Mode>,<Reserved1>,<HDOP>,<PDOP>, <VDOP>,<Reserved2>,<GPS Satellites in View>,
+            // <GNSS Satellites Used>,<GLONASS Satellites in View>,<Reserved3>,<C/N0 max>,<HPA>,<VPA>
+            long lat, lon;
+            char fix, satcnt, i;
+            int alt;
+            int dir;
+
+            // Parse string:
+            if (b = firstarg(net_buf+9, ','))
+              ;                                     // GNSS run status
+            if (b = nextarg(b))
+              fix = *b;                             // GNSS Fix status
+            if (b = nextarg(b))
+              ;                                     // UTC date & time
+            if (b = nextarg(b))
+              lat = gps2latlon(b);                  // Latitude
+            if (b = nextarg(b))
+              lon = gps2latlon(b);                  // Longitude
+            if (b = nextarg(b))
+              alt = atoi(b);                        // Altitude
+            if (b = nextarg(b))
+              ;                                     // Speed over ground
+            if (b = nextarg(b))
+              dir = atoi(b);                        // Course over ground
+            for (i=7; i; i--)
+              b = nextarg(b);                       // skip 7 fields
+            if (b = nextarg(b))
+              satcnt = atoi(b);                     // Satellite count
+
+            if (b)
+              {
+              // data set complete, store:
+
+              car_gpslock = ((fix & 0x03) << 6) + satcnt;
+
+              if (GPS_LOCK())
+                {
+                car_latitude = lat;
+                car_longitude = lon;
+                car_altitude = alt;
+                car_direction = dir;
+
+                car_stale_gps = 120; // Reset stale indicator
+                }
+              else
+                {
+                car_stale_gps = 0;
+                }
+              }
             }
-          }
-        }
+          break;
 #endif
-      else if (memcmppgm2ram(net_buf, "CONNECT OK", 10) == 0)
-        {
-        if (net_link == 0)
-          {
-          led_set(OVMS_LED_GRN,NET_LED_READYGPRS);
-          net_msg_start();
-          net_msg_register();
-          net_msg_send();
-          }
-        net_link = 1;
-        }
-      else if (memcmppgm2ram(net_buf, "STATE: ", 7) == 0)
-        { // Incoming CIPSTATUS
-        if (memcmppgm2ram(net_buf, "STATE: CONNECT OK", 17) == 0)
-          {
+
+        case NET_LINE_CONNECTOK:
           if (net_link == 0)
             {
             led_set(OVMS_LED_GRN,NET_LED_READYGPRS);
@@ -1412,83 +1859,113 @@ void net_state_activity()
             net_msg_send();
             }
           net_link = 1;
-          }
-        else if (memcmppgm2ram(net_buf, "STATE: TCP CONNECTING", 21) == 0)
-          {
-          // Connection in progress, ignore it...
-          }
-        else if (memcmppgm2ram(net_buf, "STATE: TCP CLOSED", 17) == 0)
-          {
-          // Re-initialize TCP socket, after short pause
-          net_msg_disconnected();
-          net_state_enter(NET_STATE_NETINITCP);
-          }
-        else
-          {
-          net_link = 0;
-          led_set(OVMS_LED_GRN,NET_LED_READY);
-          if ((net_reg == 0x01)||(net_reg == 0x05))
+          net_backoff_tries = 0;
+          break;
+
+        case NET_LINE_STATE:
+          // Incoming CIPSTATUS
+          if (memcmppgm2ram(net_buf+7, "CONNECT OK", 10) == 0)
+            {
+            if (net_link == 0)
+              {
+              led_set(OVMS_LED_GRN,NET_LED_READYGPRS);
+              net_msg_start();
+              net_msg_register();
+              net_msg_send();
+              }
+            net_link = 1;
+            net_backoff_tries = 0;
+            }
+          else if (memcmppgm2ram(net_buf+7, "TCP CONNECTING", 14) == 0)
             {
-            // We have a GSM network, but CIPSTATUS is not up
+            // Connection in progress, ignore it...
+            }
+          else if (memcmppgm2ram(net_buf+7, "TCP CLOSED", 10) == 0)
+            {
+            // Re-initialize TCP socket, after short pause
             net_msg_disconnected();
-            // try setting up GPRS again, after short pause
-            net_state_enter(NET_STATE_NETINITP);
+            net_state_enter(NET_STATE_NETINITCP);
             }
-          }
-        }
-      else if (memcmppgm2ram(net_buf, "+CSQ:", 5) == 0)
-        {
-        // Signal Quality
+          else
+            {
+            net_link = 0;
+            led_set(OVMS_LED_GRN,NET_LED_READY);
+            if ((net_reg == 0x01)||(net_reg == 0x05))
+              {
+              // We have a GSM network, but CIPSTATUS is not up
+              net_msg_disconnected();
+              if (net_bearer_up())
+                // GPRS context still up: reopen the TCP socket, after short pause
+                net_state_enter(NET_STATE_NETINITCP);
+              else
+                // try setting up GPRS again, after short pause
+                net_state_enter(NET_STATE_NETINITP);
+              }
+            }
+          break;
+
+        case NET_LINE_CSQ:
+          // Signal Quality
           if (net_buf[8]==',')  // two digits
-             net_sq = (net_buf[6]&0x07)*10 + (net_buf[7]&0x07);
+            net_sq = (net_buf[6]&0x07)*10 + (net_buf[7]&0x07);
           else net_sq = net_buf[6]&0x07;
-        }
-      else if ( (memcmppgm2ram(net_buf, "SEND OK", 7) == 0) ||
-                (memcmppgm2ram(net_buf, "DATA ACCEPT", 11) == 0) )
-        {
-        // CIPSEND success response
-        net_msg_sendpending = -1; // 1s modem VBAT recharge pause
-        }
-      else if ( (memcmppgm2ram(net_buf, "CLOSED", 6) == 0) ||
-                (memcmppgm2ram(net_buf, "CONNECT FAIL", 12) == 0) ||
-                (net_msg_sendpending && (
-                  (memcmppgm2ram(net_buf, "SEND FAIL", 9) == 0) ||
-                  (memcmppgm2ram(net_buf, "ERROR", 5) == 0) ||
-                  (memcmppgm2ram(net_buf, "+CME ERROR", 10) == 0)))
-              )
-        {
-        // TCP connection has been lost:
-        // Re-initialize TCP socket, after short pause
-        net_msg_disconnected();
-        net_state_enter(NET_STATE_NETINITCP);
-        }
-      else if ( (memcmppgm2ram(net_buf, "+PDP: DEACT", 11) == 0) ||
-                (memcmppgm2ram(net_buf, "ERROR", 5) == 0) ||
-                (memcmppgm2ram(net_buf, "+CME ERROR", 10) == 0)
-              )
-        {
-        // GPRS context has been lost:
-        // Re-initialize GPRS network and TCP socket, after short pause
-        net_msg_disconnected();
-        net_state_enter(NET_STATE_NETINITP);
-        }
-      else if ( (memcmppgm2ram(net_buf, "RDY", 4) == 0)||
-                (memcmppgm2ram(net_buf, "+CFUN:", 6) == 0) )
-        {
-        // Modem crash/reset: do full re-init
-        net_msg_disconnected();
-        net_state_enter(NET_STATE_START);
-        }
-      else if ( (memcmppgm2ram(net_buf, "NORMAL POWER DOWN", 17) == 0) )
-        {
-        // Modem power down detected: power up, do full re-init
-        modem_pwrkey();
-        net_state_enter(NET_STATE_START);
-        }
-      else if (memcmppgm2ram(net_buf, "+CUSD:", 6) == 0)
-        {
-        // reply MMI/USSD command result:
-        net_msg_reply_ussd(net_buf, net_buf_pos);
+          break;
+
+        case NET_LINE_SENDOK:
+          // CIPSEND success response
+          if (net_msg_unacked > 0)
+            net_msg_unacked--;
+          if (net_msg_unacked == 0)
+            {
+            net_msg_inflight = 0;
+#ifdef OVMS_CAN_STATS
+            net_msg_canstats_acked();
+#endif // OVMS_CAN_STATS
+            net_msg_sendpending = -1; // 1s modem VBAT recharge pause
+            }
+          break;
+
+        case NET_LINE_SENDFAIL:
+          if (!net_msg_sendpending)
+            break;
+          // N.B. Drop through without a break
+        case NET_LINE_CLOSED:
+        case NET_LINE_CONNECTFAIL:
+        case NET_LINE_ERROR:
+          // TCP connection has been lost, or a modem error (the GPRS
+          // context may still be up): Re-initialize TCP socket (probing
+          // the context), after short pause
+          if (line == NET_LINE_CONNECTFAIL)
+            net_server_gen = 0; // The server may have moved: look it up again
+          net_msg_disconnected();
+          net_state_enter(NET_STATE_NETINITCP);
+          break;
+
+        case NET_LINE_PDPDEACT:
+          // GPRS context has been lost:
+          // Re-initialize GPRS network and TCP socket, after short pause
+          net_msg_disconnected();
+          net_state_enter(NET_STATE_NETINITP);
+          break;
+
+        case NET_LINE_RDY:
+          if ((net_buf[0] == 'R')&&(net_buf[3] != 0))
+            break; // "RDY" must be the whole line
+          // Modem crash/reset: do full re-init
+          net_msg_disconnected();
+          net_state_enter(NET_STATE_START);
+          break;
+
+        case NET_LINE_POWERDOWN:
+          // Modem power down detected: power up, do full re-init
+          modem_pwrkey();
+          net_state_enter(NET_STATE_START);
+          break;
+
+        case NET_LINE_CUSD:
+          // reply MMI/USSD command result:
+          net_msg_reply_ussd(net_buf, net_buf_pos);
+          break;
         }
       break;
       
@@ -1499,21 +1976,20 @@ void net_state_activity()
       break;
 #endif // #ifdef OVMS_DIAGMODULE
     }
+
+  NET_LINE_PROBE(1);
   }
 
 
 ////////////////////////////////////////////////////////////////////////
-// net_idlepoll()
-// 
-// This function is called from the main loop after each net_poll().
-// As net_poll() frees the net_msg_sendpending semaphore, this is
-// the place to send queued notifications without interfering with
-// the per second tickers.
+// net_idlepoll_notify()
+// Send queued notifications, see net_idlepoll()
 //
-void net_idlepoll(void)
+static void net_idlepoll_notify(void)
   {
   char stat;
   char cmd[5];
+  BOOL pending;
 
 #ifdef OVMS_DIAGMODULE
   if ((net_state == NET_STATE_DIAGMODE))
@@ -1529,88 +2005,137 @@ void net_idlepoll(void)
 
   
   /*************************************************************
-   * PROCESS BUFFERED COMMAND
+   * SEND IP NOTIFICATIONS
+   *
+   * Everything pending goes into one CIPSEND batch, highest priority
+   * first: alerts, command replies, status updates, history records.
+   * net_msg_encode_puts() continues in a new CIPSEND if the batch
+   * exceeds the modem's size limit.
    */
 
-  if ((net_msg_cmd_code!=0) && (net_msg_serverok==1))
+  if (net_msg_serverok==1)
     {
-    net_msg_cmd_do();
-    return;
-    }
+    // Special AT commands (40-49) need the modem in command mode:
+    if ((net_msg_cmd_code>=40) && (net_msg_cmd_code<=49))
+      {
+      net_msg_cmd_do();
+      return;
+      }
 
-  
-  /*************************************************************
-   * SEND IP NOTIFICATIONS
-   */
+    // Open the CIPSEND through the AT queue and fill it when the prompt
+    // has arrived, instead of waiting for the prompt here:
+    pending = ((net_msg_cmd_code!=0) || (net_msg_pingpending) ||
+               ((net_notify & NET_NOTIFY_NETPART)>0));
+#ifndef OVMS_NO_ERROR_NOTIFY
+    if (net_notify_errorcode>0)
+      pending = TRUE;
+#endif //OVMS_NO_ERROR_NOTIFY
+#ifdef OVMS_CAN_STATS
+    if (net_msg_canstatspending == 1)
+      pending = TRUE;
+#endif // OVMS_CAN_STATS
+#ifdef OVMS_LOGGINGMODULE
+    if (logging_haspending() > 0)
+      pending = TRUE;
+#endif // #ifdef OVMS_LOGGINGMODULE
+    if ((pending) && (!net_msg_prompt) && (net_state == NET_STATE_READY))
+      {
+      net_msg_cipsend_queue();
+      return;
+      }
+
+    net_msg_batch_start();
+
+    // Command parameters live in net_scratchpad, which the alerts
+    // reuse: do a command with parameters first, detach the others
+    if (net_msg_cmd_code!=0)
+      {
+      if ((net_msg_cmd_msg) && (*net_msg_cmd_msg))
+        net_msg_cmd_do();
+      else
+        {
+        net_msg_cmd_msg = cmd;
+        net_msg_cmd_msg[0] = 0;
+        }
+      }
 
 #ifndef OVMS_NO_ERROR_NOTIFY
-  if ((net_notify_errorcode>0) && (net_msg_serverok==1))
-    {
-    if (net_notify_errorcode > 0)
+    if (net_notify_errorcode>0)
       {
       net_msg_erroralert(net_notify_errorcode, net_notify_errordata);
+      net_notify_errorcode = 0;
+      net_notify_errordata = 0;
       }
-    net_notify_errorcode = 0;
-    net_notify_errordata = 0;
-    return;
-    }
 #endif //OVMS_NO_ERROR_NOTIFY
 
-  if (((net_notify & NET_NOTIFY_NETPART)>0)
-          && (net_msg_serverok==1))
-    {
-
 #ifndef OVMS_NO_VEHICLE_ALERTS
     if ((net_notify & NET_NOTIFY_NET_ALARM)>0)
       {
       net_notify &= ~(NET_NOTIFY_NET_ALARM); // Clear notification flag
+      net_msg_inflight |= NET_NOTIFY_NET_ALARM;
       net_msg_alert(ALERT_ALARM);
-      return;
       }
-    else
 #endif //OVMS_NO_VEHICLE_ALERTS
-      
-    if ((net_notify & NET_NOTIFY_NET_CHARGE)>0)
+
+    if ((net_notify & NET_NOTIFY_NET_12VLOW)>0)
       {
-      net_notify &= ~(NET_NOTIFY_NET_CHARGE); // Clear notification flag
-      if (net_notify_suppresscount==0)
+      net_notify &= ~(NET_NOTIFY_NET_12VLOW); // Clear notification flag
+      if (net_fnbits & NET_FN_12VMONITOR)
         {
-        // execute CHARGE ALERT command:
-        net_msg_cmd_code = 6;
-        net_msg_cmd_msg = cmd;
-        net_msg_cmd_msg[0] = 0;
-        net_msg_cmd_do();
+        net_msg_inflight |= NET_NOTIFY_NET_12VLOW;
+        net_msg_alert(ALERT_12VLOW);
         }
-      return;
       }
-    
-    else if ((net_notify & NET_NOTIFY_NET_12VLOW)>0)
-      {
-      net_notify &= ~(NET_NOTIFY_NET_12VLOW); // Clear notification flag
-      if (net_fnbits & NET_FN_12VMONITOR) net_msg_alert(ALERT_12VLOW);
-      return;
-      }
-    
+
 #ifndef OVMS_NO_VEHICLE_ALERTS
-    else if ((net_notify & NET_NOTIFY_NET_TRUNK)>0)
+    if ((net_notify & NET_NOTIFY_NET_TRUNK)>0)
       {
       net_notify &= ~(NET_NOTIFY_NET_TRUNK); // Clear notification flag
+      net_msg_inflight |= NET_NOTIFY_NET_TRUNK;
       net_msg_alert(ALERT_TRUNK);
-      return;
       }
 #endif //OVMS_NO_VEHICLE_ALERTS
-    
-    else if ((net_notify & NET_NOTIFY_NET_CARON)>0)
+
+    if ((net_notify & NET_NOTIFY_NET_CARON)>0)
       {
       net_notify &= ~(NET_NOTIFY_NET_CARON); // Clear notification flag
+      net_msg_inflight |= NET_NOTIFY_NET_CARON;
       net_msg_alert(ALERT_CARON);
-      return;
       }
-    
-    else if ((net_notify & NET_NOTIFY_NET_UPDATE)>0)
+
+    // The charge alert is command 6, wait for a buffered command:
+    if (((net_notify & NET_NOTIFY_NET_CHARGE)>0) && (net_msg_cmd_code==0))
+      {
+      net_notify &= ~(NET_NOTIFY_NET_CHARGE); // Clear notification flag
+      if (net_notify_suppresscount==0)
+        {
+        // execute CHARGE ALERT command:
+        net_msg_inflight |= NET_NOTIFY_NET_CHARGE;
+        net_msg_cmd_code = 6;
+        net_msg_cmd_msg = cmd;
+        net_msg_cmd_msg[0] = 0;
+        net_msg_cmd_do();
+        }
+      }
+
+    // Command replies:
+    if (net_msg_cmd_code!=0)
+      net_msg_cmd_do();
+
+    if (net_msg_pingpending)
+      {
+      net_msg_pingpending = 0;
+      stp_rom(net_scratchpad,(char const rom far*)"MP-0 a");
+      net_msg_start();
+      net_msg_encode_puts();
+      }
+
+    // Status updates:
+    if ((net_notify & NET_NOTIFY_NET_UPDATE)>0)
       {
       net_notify &= ~(NET_NOTIFY_NET_UPDATE | NET_NOTIFY_NET_STAT |
               NET_NOTIFY_NET_STREAM); // Clear all covered notifications
+      NET_UPDATE_PROBE(0);
       stat = 2;
       stat = net_msgp_stat(stat);
       stat = net_msgp_environment(stat);
@@ -1622,9 +2147,7 @@ void net_idlepoll(void)
 #endif
       stat = net_msgp_firmware(stat);
       stat = net_msgp_capabilities(stat);
-      if (stat != 2)
-        net_msg_send();
-      return;
+      NET_UPDATE_PROBE(1);
       }
     
     else if ((net_notify & NET_NOTIFY_NET_STAT)>0)
@@ -1633,22 +2156,34 @@ void net_idlepoll(void)
       stat = 2;
       stat = net_msgp_environment(stat);
       stat = net_msgp_stat(stat);
-      if (stat != 2)
-        net_msg_send();
-      return;
       }
     
     else if ((net_notify & NET_NOTIFY_NET_STREAM)>0)
       {
       net_notify &= ~(NET_NOTIFY_NET_STREAM); // Clear notification flag
-      if (net_msgp_gps(2) != 2)
-        net_msg_send();
-      return;
+      net_msgp_gps(2);
       }
-    
-    } // if NET_NOTIFY_NETPART
 
-  
+#ifdef OVMS_CAN_STATS
+    // CAN bus statistics of the last hour:
+    if (net_msg_canstatspending == 1)
+      net_msg_canstats();
+#endif // OVMS_CAN_STATS
+
+#ifdef OVMS_LOGGINGMODULE
+    // History records (LOG_SEND_BATCH per pass, until all are sent):
+    if (logging_haspending() > 0)
+      {
+      net_msg_start();
+      logging_sendpending();
+      }
+#endif // #ifdef OVMS_LOGGINGMODULE
+
+    if (net_msg_batch_end())
+      return;
+    } // if (net_msg_serverok==1)
+
+
   /*************************************************************
    * SEND SMS NOTIFICATIONS
    */
@@ -1704,6 +2239,36 @@ void net_idlepoll(void)
 
   }
 
+////////////////////////////////////////////////////////////////////////
+// net_idlepoll()
+// 
+// This function is called from the main loop after each net_poll().
+// As net_poll() frees the net_msg_sendpending semaphore, this is
+// the place to send queued notifications without interfering with
+// the per second tickers.
+//
+// Queued AT commands go out after the notifications, so modem
+// housekeeping queries wait behind data traffic.
+//
+void net_idlepoll(void)
+  {
+  net_idlepoll_notify();
+  net_at_next();
+  }
+
+
+////////////////////////////////////////////////////////////////////////
+// net_status_done()
+// AT queue handler of the periodic queries: after a timeout, poll the
+// network status until the modem answers again, so a modem recovering
+// from a hang is found before the RX data timeout (net_timeout_rxdata)
+// resets it.
+//
+static void net_status_done(unsigned char result)
+  {
+  if ((result == NET_AT_TIMEOUT) && (net_state == NET_STATE_READY))
+    net_at_queue(NET_CREG_CIPSTATUS, NET_AT_OK|NET_AT_ERROR, 50, net_status_done);
+  }
 
 ////////////////////////////////////////////////////////////////////////
 // net_state_ticker1()
@@ -1777,12 +2342,7 @@ void net_state_ticker1(void)
       break;
     case NET_STATE_COPSWAIT:
       if ((net_timeout_ticks % 10)==0)
-        {
-        net_wait4modem();
-        net_puts_rom(NET_CREG_STATUS);
-        while(vUARTIntTxBufDataCnt>0); // Wait for TX flush
-        delay5(2); // Wait for result
-        }
+        net_at_queue(NET_CREG_STATUS, NET_AT_OK|NET_AT_ERROR, 20, NULL);
       break;
     case NET_STATE_SOFTRESET:
       net_state_enter(NET_STATE_FIRSTRUN);
@@ -1820,6 +2380,7 @@ void net_state_ticker1(void)
         if (++net_msg_sendpending > NET_IPACK_TIMEOUT)
           {
           // IPSEND ACK timeout:
+          net_msg_disconnected();
           if (net_watchdog == 0)
             net_state_enter(NET_STATE_NETINITCP); // Reopen TCP connection
           else
@@ -1834,12 +2395,9 @@ void net_state_ticker1(void)
         // else once every minute (to trace theft / transportation)
         if ( (((car_doors1bits.CarON) && ((net_granular_tick % 3) == 1))
                 || ((net_granular_tick % 60) == 55))
-                && MODEM_READY()
                 && ((net_fnbits & NET_FN_INTERNALGPS) > 0))
           {
-          net_puts_rom(NET_REQGPS);
-          while(vUARTIntTxBufDataCnt>0); // Wait for TX flush
-          delay5(15); // Wait for result to begin
+          net_at_queue(NET_REQGPS, NET_AT_OK|NET_AT_ERROR, 20, net_status_done);
           }
 #endif
 
@@ -1895,18 +2453,7 @@ void net_state_ticker30(void)
       // Request network status + clock + signal quality
       // once per minute, offset 30 seconds to ticker60 (even second)
       if ((net_granular_tick % 60) != 0)
-        {
-        if (!MODEM_READY())
-          {
-          net_granular_tick -= 2; // Try again in 2 seconds...
-          }
-        else
-          {
-          net_puts_rom(NET_CREG_CIPSTATUS);
-          while(vUARTIntTxBufDataCnt>0); // Wait for TX flush
-          delay5(2); // Wait for result start
-          }
-        }
+        net_at_queue(NET_CREG_CIPSTATUS, NET_AT_OK|NET_AT_ERROR, 50, net_status_done);
       break;
     }
   }
@@ -2006,23 +2553,6 @@ void net_state_ticker60(void)
   switch (net_state)
     {
     case NET_STATE_READY:
-#ifdef OVMS_LOGGINGMODULE
-      if ((net_msg_serverok)&&(logging_haspending() > 0))
-        {
-        if (!MODEM_READY())
-          {
-          net_granular_tick -= 4; // Try again in 4 seconds...
-          }
-        else
-          {
-          net_msg_start();
-          logging_sendpending();
-          net_msg_send();
-          return;
-          }
-        }
-#endif // #ifdef OVMS_LOGGINGMODULE
-      
       // Send standard update
       // once per minute while Apps are connected
       if (net_apps_connected>0)
@@ -2130,6 +2660,12 @@ void net_state_ticker3600(void)
       if ((net_msg_serverok)&&(net_apps_connected==0)&&(!carbusy))
         net_req_notification(NET_NOTIFY_UPDATE);
       
+#ifdef OVMS_CAN_STATS
+      // Queue CAN bus statistics of the last hour for net_idlepoll():
+      if (net_msg_canstatspending == 0)
+        net_msg_canstatspending = 1;
+#endif // OVMS_CAN_STATS
+      
       break;
     }
   }
@@ -2147,6 +2683,7 @@ void net_ticker(void)
   CHECKPOINT(0x3E)
 
   if (net_notify_suppresscount>0) net_notify_suppresscount--;
+  if ((net_reconnect_ticks>0)&&(net_reconnect_ticks<0xffff)) net_reconnect_ticks++;
   net_granular_tick++;
   if ((net_timeout_goto > 0)&&(net_timeout_ticks-- == 0))
     {
@@ -2185,10 +2722,15 @@ void net_ticker(void)
 // net_ticker10th()
 // This function is an entry point from the main() program loop, and
 // gives the NET framework a ticker call approximately ten times per
-// second. It is used to flash the RED LED when the link is up
+// second. It is used to flash the RED LED when the link is up, and
+// times out the queued AT command waiting for its result.
 //
 void net_ticker10th(void)
   {
+  if (net_at_timer == 1)
+    net_at_result(NET_AT_TIMEOUT);
+  else if (net_at_timer > 1)
+    net_at_timer--;
   }
 
 ////////////////////////////////////////////////////////////////////////
@@ -2214,7 +2756,7 @@ char *net_prep_alert(char *s, alert_type alert)
   switch (alert)
     {
     case ALERT_SOCLOW:
-      s = stp_i(net_scratchpad, "ALERT!!! CRITICAL SOC LEVEL APPROACHED (", car_SOC); // 95%
+      s = stp_i(s, "ALERT!!! CRITICAL SOC LEVEL APPROACHED (", car_SOC); // 95%
       s = stp_rom(s, "% SOC)");
       break;
       
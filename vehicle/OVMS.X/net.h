@@ -34,6 +34,8 @@
 #define NET_BUF_MAX 200
 #define NET_TEL_MAX 20
 #define NET_GPRS_RETRIES 10
+#define NET_BACKOFF_MAX  6   // GPRS retry pause up to 1<<6 = 64 seconds
+#define NET_RECONNECT_HIST 6 // Reconnect time histogram buckets (see net_reconnect_secs)
 
 // Timeouts (in seconds)
 #define NET_REG_TIMEOUT    120 // GSM network registration timeout (-> reset modem)
@@ -102,12 +104,52 @@
 #define NETINIT_CLPORT       7
 #define NETINIT_CIPSTART     8
 #define NETINIT_CONNECTING   9
+#define NETINIT_PROBE        10 // TCP reconnect: AT+CIPSTATUS bearer probe
+#define NETINIT_CDNSGIP      11 // Server host name lookup before AT+CIPSTART
+
+// Modem response lines (net_line_class(), see net_lines[] in net.c)
+#define NET_LINE_OTHER       0
+#define NET_LINE_OK          1
+#define NET_LINE_ERROR       2     // ERROR, +CME ERROR
+#define NET_LINE_CCLK        3
+#define NET_LINE_CDNSGIP     4
+#define NET_LINE_CGNSINF     5
+#define NET_LINE_CLIP        6
+#define NET_LINE_COPS        7
+#define NET_LINE_CREG        8
+#define NET_LINE_CSQ         9
+#define NET_LINE_CUSD        10
+#define NET_LINE_PDPDEACT    11
+#define NET_LINE_GPSGGA      12    // AT+CGPSINF=2 reply
+#define NET_LINE_GPSVTG      13    // AT+CGPSINF=64 reply
+#define NET_LINE_CLOSED      14
+#define NET_LINE_CONNECTFAIL 15
+#define NET_LINE_CONNECTOK   16
+#define NET_LINE_SENDOK      17    // SEND OK, DATA ACCEPT
+#define NET_LINE_SENDFAIL    18
+#define NET_LINE_SHUTOK      19
+#define NET_LINE_STATE       20    // AT+CIPSTATUS reply
+#define NET_LINE_RDY         21    // RDY, +CFUN: (modem restart)
+#define NET_LINE_POWERDOWN   22
+
+typedef struct
+  {
+  const rom char *prefix;
+  unsigned char lcp;                 // leading characters shared with the prefix before
+  unsigned char line;                // NET_LINE_x
+  } net_line_t;
+
+// First character jump table range (net_line_first[], see net.c)
+#define NET_LINES_LO         '+'
+#define NET_LINES_HI         'Z'
+#define NET_LINES_NONE       0xff  // no prefix starts with this character
 
 // NET data
 extern unsigned char net_state;                // The current state
 extern unsigned char net_state_vchar;          //   A per-state CHAR variable
 extern unsigned int  net_state_vint;           //   A per-state INT variable
 extern unsigned char net_cops_tries;           // A counter for COPS attempts
+extern unsigned int  net_reconnects[NET_RECONNECT_HIST]; // Reconnect time histogram
 extern unsigned char net_timeout_goto;         // State to auto-transition to, after timeout
 extern unsigned int  net_timeout_ticks;        // Number of seconds before timeout auto-transition
 extern unsigned int  net_granular_tick;        // An internal ticker used to generate 1min, 5min, etc, calls
@@ -123,7 +165,19 @@ extern unsigned char net_buf_todotimeout;      // Timeout for bytes outstanding
 // Test if modem is ready for a new command:
 #define MODEM_READY() ((net_msg_sendpending==0) && \
  (net_buf_mode==NET_BUF_CRLF) && (net_buf_pos==0) && \
- (vUARTIntTxBufDataCnt==0) && (vUARTIntRxBufDataCnt==0))
+ (vUARTIntStatus.UARTIntTxBufferEmpty) && (vUARTIntRxBufDataCnt==0))
+
+// AT command queue, see net_at_queue():
+// Commands are sent one at a time when the modem is idle, the command's
+// handler is called with the final result code received (or the timeout).
+#define NET_AT_QUEUE          4                // Queue size
+#define NET_AT_OK             0x01             // Result "OK"
+#define NET_AT_ERROR          0x02             // Result "ERROR" / "+CME ERROR"
+#define NET_AT_PROMPT         0x04             // Data prompt "> " (CIPSEND)
+#define NET_AT_TIMEOUT        0x80             // No expected result in time
+#define NET_AT_FIRST          0x40             // net_at_queue(): queue in front
+
+typedef void (*net_at_handler)(unsigned char result);
 
 // Generic functionality bits
 extern unsigned char net_fnbits;               // Net functionality bits
@@ -195,21 +249,32 @@ typedef enum _alert_type alert_type;
 
 extern char net_scratchpad[NET_BUF_MAX];
 extern char net_buf[NET_BUF_MAX];
+extern rom net_line_t net_lines[];
+extern rom unsigned char net_line_first[NET_LINES_HI-NET_LINES_LO+1];
 
 void net_puts_rom(const rom char *data);
 void net_puts_ram(const char *data);
 void net_putc_ram(const char data);
+BOOL net_putb64_ram(BYTE *data, WORD len);
+BOOL net_putb64_open(BYTE *data, WORD len);
 
 void net_initialise(void);
 void net_poll(void);
 void net_wait4modem(void);
 BOOL net_wait4prompt(void);
 void net_reset_async(void);
+BOOL net_at_queue(const rom char *cmd, unsigned char expect, unsigned char timeout, net_at_handler done);
+unsigned char net_at_active(void);
+void net_at_result(unsigned char result);
+void net_at_reset(void);
 void net_idlepoll(void);
+void net_reconnect_lost(void);
+void net_reconnect_done(void);
 void net_ticker(void);
 void net_ticker10th(void);
 
 void net_state_enter(unsigned char);
+unsigned char net_line_class(void);
 void net_state_activity(void);
 void net_state_ticker(void);
 
@@ -0,0 +1,129 @@
+/*
+;    Project:       Open Vehicle Monitor System
+;    Date:          18 October 2026
+;
+;    Changes:
+;    1.0  Initial release
+;
+;    (C) 2011  Michael Stegen / Stegen Electronics
+;    (C) 2011  Mark Webb-Johnson
+;    (C) 2011  Sonny Chen @ EPRO/DX
+;
+; Permission is hereby granted, free of charge, to any person obtaining a copy
+; of this software and associated documentation files (the "Software"), to deal
+; in the Software without restriction, including without limitation the rights
+; to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+; copies of the Software, and to permit persons to whom the Software is
+; furnished to do so, subject to the following conditions:
+;
+; The above copyright notice and this permission notice shall be included in
+; all copies or substantial portions of the Software.
+;
+; THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+; IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+; FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+; AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+; LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+; OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+; THE SOFTWARE.
+*/
+
+#include "ovms.h"
+#include "net_lz.h"
+
+// Host build benchmark: count the byte compares of the match search
+#ifdef OVMS_HOST
+extern unsigned long host_lz_steps;
+#define NET_LZ_STEP() host_lz_steps++
+#else
+#define NET_LZ_STEP()
+#endif // OVMS_HOST
+
+#pragma udata NET_LZ
+char net_lz_win[NET_LZ_WINDOW];       // last bytes of the input
+#pragma udata
+UINT8 net_lz_pos;                     // next window position
+UINT16 net_lz_fill;                   // valid window bytes
+
+////////////////////////////////////////////////////////////////////////
+// net_lz_reset()
+// Start a new stream: empty the window.
+//
+void net_lz_reset(void)
+  {
+  net_lz_pos = 0;
+  net_lz_fill = 0;
+  }
+
+////////////////////////////////////////////////////////////////////////
+// net_lz_compress()
+// Compress <len> bytes of 7 bit text from <in> to <out> and add them to
+// the window. Returns the output length, which is at most <len>.
+//
+UINT8 net_lz_compress(char *in, UINT8 len, BYTE *out)
+  {
+  BYTE *o = out;
+  UINT8 i, n, max, best;
+  UINT16 d, bestd;
+  char c, first;
+
+  for (i=0; i<len; )
+    {
+    // Find the longest match in the window:
+    best = 0;
+    bestd = 0;
+    max = len - i;
+    if (max > NET_LZ_MAXMATCH)
+      max = NET_LZ_MAXMATCH;
+    if (max >= NET_LZ_MINMATCH)
+      {
+      first = in[i];
+      for (d=1; d<=net_lz_fill; d++)
+        {
+        NET_LZ_STEP();
+        if (net_lz_win[(net_lz_pos + NET_LZ_WINDOW - d) & (NET_LZ_WINDOW-1)] != first)
+          continue;
+        for (n=1; n<max; n++)
+          {
+          NET_LZ_STEP();
+          if (n < d)
+            c = net_lz_win[(net_lz_pos + NET_LZ_WINDOW - d + n) & (NET_LZ_WINDOW-1)];
+          else
+            c = in[i + n - d]; // overlapping copy
+          if (c != in[i+n])
+            break;
+          }
+        if (n > best)
+          {
+          best = n;
+          bestd = d;
+          if (n == max)
+            break;
+          }
+        }
+      }
+
+    if (best >= NET_LZ_MINMATCH)
+      {
+      *o++ = 0x80 + (best - NET_LZ_MINMATCH);
+      *o++ = bestd - 1;
+      }
+    else
+      {
+      best = 1;
+      *o++ = in[i];
+      }
+
+    // Move the bytes into the window:
+    for (n=0; n<best; n++)
+      {
+      net_lz_win[net_lz_pos] = in[i++];
+      net_lz_pos = (net_lz_pos + 1) & (NET_LZ_WINDOW-1);
+      }
+    net_lz_fill += best;
+    if (net_lz_fill > NET_LZ_WINDOW)
+      net_lz_fill = NET_LZ_WINDOW;
+    }
+
+  return o - out;
+  }
@@ -0,0 +1,56 @@
+/*
+;    Project:       Open Vehicle Monitor System
+;    Date:          18 October 2026
+;
+;    Changes:
+;    1.0  Initial release
+;
+;    (C) 2011  Michael Stegen / Stegen Electronics
+;    (C) 2011  Mark Webb-Johnson
+;    (C) 2011  Sonny Chen @ EPRO/DX
+;
+; Permission is hereby granted, free of charge, to any person obtaining a copy
+; of this software and associated documentation files (the "Software"), to deal
+; in the Software without restriction, including without limitation the rights
+; to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+; copies of the Software, and to permit persons to whom the Software is
+; furnished to do so, subject to the following conditions:
+;
+; The above copyright notice and this permission notice shall be included in
+; all copies or substantial portions of the Software.
+;
+; THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+; IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+; FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+; AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+; LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+; OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+; THE SOFTWARE.
+*/
+
+#ifndef __OVMS_NET_LZ_H
+#define __OVMS_NET_LZ_H
+
+////////////////////////////////////////////////////////////////////////////////
+// Streaming LZ compressor for history uploads (MP-0 K)
+//
+// LZ77 with a sliding window of the last NET_LZ_WINDOW bytes, shared by
+// all lines compressed since net_lz_reset(). Input is 7 bit text, the
+// output is a byte sequence of
+//    0x00..0x7f          literal byte
+//    0x80+(len-3), d-1   copy len = 3..130 bytes from d = 1..256 bytes back
+// A copy may overlap the bytes it produces (d < len repeats a pattern).
+// The decoder needs the same window and copies byte by byte.
+//
+// Matches are searched by brute force over the window (greedy, longest
+// match, nearest first), so RAM use is the window plus a few bytes.
+//
+
+#define NET_LZ_WINDOW     128     // power of 2, max 256
+#define NET_LZ_MINMATCH   3
+#define NET_LZ_MAXMATCH   (0x7f + NET_LZ_MINMATCH)
+
+void net_lz_reset(void);
+UINT8 net_lz_compress(char *in, UINT8 len, BYTE *out);
+
+#endif // #ifndef __OVMS_NET_LZ_H
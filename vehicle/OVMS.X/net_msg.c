@@ -42,6 +42,7 @@
 #include "crypt_hmac.h"
 #include "crypt_rc4.h"
 #include "utils.h"
+#include "net_lz.h"
 #ifdef OVMS_LOGGINGMODULE
 #include "logging.h"
 #endif // #ifdef OVMS_LOGGINGMODULE
@@ -54,6 +55,21 @@
 #pragma udata
 char net_msg_serverok = 0;
 INT8 net_msg_sendpending = 0;
+UINT8 net_msg_batch = 0;            // 1 = batch open, 2 = CIPSEND started
+UINT16 net_msg_sendbytes = 0;       // bytes in the current CIPSEND
+UINT8 net_msg_unacked = 0;          // CIPSENDs waiting for SEND OK
+char net_msg_prompt = 0;            // CIPSEND prompt open, requested through the AT queue
+unsigned int net_msg_inflight = 0;  // NET alerts in unacknowledged CIPSENDs
+char net_msg_pingpending = 0;       // ping reply due with the next batch
+#ifdef OVMS_CAN_STATS
+char net_msg_canstatspending = 0;   // CAN statistics: 1 = due, 2 = sent, not yet acknowledged
+#endif // OVMS_CAN_STATS
+char net_msg_delta = 0;             // server accepts delta records ("Y1")
+char net_msg_binary = 0;            // server accepts binary records ("Y2")
+char net_msg_zip = 0;               // server accepts compressed history ("Y4")
+UINT16 net_msg_zbytes = 0;          // bytes in the open "MP-0 K" message
+UINT8 net_msg_delta_keys[NET_MSG_DELTA_RECS]; // deltas until the next keyframe
+rom UINT8 net_msg_delta_slot[NET_MSG_DELTA_RECS+1] = { 0, 36, 58, 72 };
 char token[23] = {0};
 char ptoken[23] = {0};
 char ptokenmade = 0;
@@ -72,6 +88,8 @@ WORD crc_capabilities = 0;
 
 #pragma udata NETMSG_SP
 char net_msg_scratchpad[NET_BUF_MAX];
+#pragma udata NETMSG_DELTA
+WORD net_msg_fieldcrc[NET_MSG_DELTA_FIELDS]; // CRC16 of each field last sent
 #pragma udata
 
 #pragma udata Q_CMD
@@ -94,12 +112,15 @@ rom char NET_MSG_CMDOK[] = ",0";
 rom char NET_MSG_CMDINVALIDSYNTAX[] = ",1,Invalid syntax";
 rom char NET_MSG_CMDNOCANWRITE[] = ",1,No write access to CAN";
 rom char NET_MSG_CMDINVALIDRANGE[] = ",1,Parameter out of range";
+rom char NET_MSG_CMDCANTXFULL[] = ",1,CAN transmit queue full";
 #ifndef OVMS_NO_CHARGECONTROL
 rom char NET_MSG_CMDNOCANCHARGE[] = ",1,Cannot charge (charge port closed)";
 rom char NET_MSG_CMDNOCANSTOPCHARGE[] = ",1,Cannot stop charge (charge not in progress)";
 #endif // OVMS_NO_CHARGECONTROL
 rom char NET_MSG_CMDUNIMPLEMENTED[] = ",3";
 
+rom char NET_MSG_CIPSEND[] = "AT+CIPSEND\r";
+
 
 void net_msg_init(void)
   {
@@ -110,14 +131,131 @@ void net_msg_init(void)
 
 void net_msg_disconnected(void)
   {
+  if (net_msg_serverok)
+    net_reconnect_lost();
   net_msg_serverok = 0;
   net_msg_sendpending = 0;
   net_apps_connected = 0;
+
+  // Alerts may have been lost with an unacknowledged CIPSEND,
+  // request them again for the next connection:
+  net_notify |= net_msg_inflight;
+  net_msg_inflight = 0;
+  net_msg_unacked = 0;
+  if (net_msg_prompt)
+    {
+    net_msg_prompt = 0;
+    net_puts_rom("\x1b");
+    }
+  net_msg_pingpending = 0;
+#ifdef OVMS_CAN_STATS
+  if (net_msg_canstatspending == 2)
+    net_msg_canstatspending = 1; // send again, the counters are kept
+#endif // OVMS_CAN_STATS
+  net_msg_delta = 0;
+  net_msg_binary = 0;
+  net_msg_zip = 0;
+  net_msg_zbytes = 0;
+  }
+
+// Send the next status records in full
+static void net_msg_delta_resync(void)
+  {
+  UINT8 k;
+  for (k=0;k<NET_MSG_DELTA_RECS;k++)
+    net_msg_delta_keys[k] = 0;
+  }
+
+// AT queue handler of a queued CIPSEND
+static void net_msg_cipsend_done(unsigned char result)
+  {
+  if (result == NET_AT_PROMPT)
+    net_msg_prompt = 1;
+  else if (result == NET_AT_TIMEOUT)
+    net_puts_rom("\x1b"); // abort, the prompt may still come
+  }
+
+// Queue a CIPSEND, net_idlepoll() sends the messages when the prompt
+// has arrived (the batch is then started by net_msg_start() as usual)
+void net_msg_cipsend_queue(void)
+  {
+  net_at_queue(NET_MSG_CIPSEND, NET_AT_PROMPT|NET_AT_ERROR|NET_AT_FIRST,
+          20, net_msg_cipsend_done);
+  }
+
+// Wait here for the prompt of a queued CIPSEND already sent
+static void net_msg_prompt_wait(void)
+  {
+  if (net_at_active() & NET_AT_PROMPT)
+    net_at_result(net_wait4prompt() ? NET_AT_PROMPT : NET_AT_TIMEOUT);
+  }
+
+// Abort a CIPSEND prompt requested through the AT queue, before other
+// modem commands
+void net_msg_prompt_close(void)
+  {
+  net_msg_prompt_wait();
+  if (net_msg_prompt)
+    {
+    net_msg_prompt = 0;
+    net_puts_rom("\x1b");
+    }
+  }
+
+// Open a CIPSEND and wait for the prompt, or take over the prompt of a
+// queued CIPSEND
+static void net_msg_cipsend(void)
+  {
+  net_msg_prompt_wait();
+  if (net_msg_prompt)
+    {
+    net_msg_prompt = 0;
+    net_msg_sendpending = 1;
+    }
+  else
+    {
+    net_wait4modem();
+    net_puts_rom(NET_MSG_CIPSEND);
+    net_msg_sendpending = net_wait4prompt();
+    }
+  net_msg_sendbytes = 0;
+  }
+
+// Close the open "MP-0 K" message
+static void net_msg_zip_end(void)
+  {
+  if (net_msg_zbytes == 0)
+    return;
+  net_putb64_ram(NULL, 0);
+  net_puts_rom("\r\n");
+  net_msg_sendbytes += NET_MSG_WIRELEN(net_msg_zbytes);
+  net_msg_zbytes = 0;
+  }
+
+// Submit / abort the current CIPSEND
+static void net_msg_submit(void)
+  {
+  net_msg_zip_end();
+  if (net_msg_sendpending)
+    {
+    net_puts_rom("\x1a");
+    net_msg_unacked++;
+    }
+  else
+    net_puts_rom("\x1b");
   }
 
 // Start to send a net msg
 void net_msg_start(void)
   {
+  if (net_msg_batch)
+    {
+    // Batch mode: the first message opens the CIPSEND
+    if (net_msg_batch > 1)
+      return;
+    net_msg_batch = 2;
+    }
+
   if (net_state == NET_STATE_DIAGMODE)
     {
     net_msg_sendpending = 1;
@@ -125,15 +263,16 @@ void net_msg_start(void)
     }
   else
     {
-    net_wait4modem();
-    net_puts_rom("AT+CIPSEND\r");
-    net_msg_sendpending = net_wait4prompt();
+    net_msg_cipsend();
     }
   }
 
 // Finish sending a net msg
 void net_msg_send(void)
   {
+  if (net_msg_batch)
+    return; // see net_msg_batch_end()
+
   if (net_state == NET_STATE_DIAGMODE)
     {
     net_msg_sendpending = 0;
@@ -141,9 +280,291 @@ void net_msg_send(void)
     }
   else
     {
-    // Submit / Abort:
-    net_puts_rom(net_msg_sendpending ? "\x1a" : "\x1b");
+    net_msg_submit();
+    }
+  }
+
+// Start collecting messages into one CIPSEND:
+// net_msg_start() / net_msg_send() calls are merged until
+// net_msg_batch_end(), which returns TRUE if anything was sent.
+void net_msg_batch_start(void)
+  {
+  net_msg_batch = 1;
+  }
+
+BOOL net_msg_batch_end(void)
+  {
+  BOOL sent = (net_msg_batch > 1);
+
+  net_msg_batch = 0;
+  if (sent)
+    net_msg_send();
+  else if (net_msg_prompt)
+    {
+    // Nothing to send after all:
+    net_msg_prompt = 0;
+    net_puts_rom("\x1b");
+    }
+  return sent;
+  }
+
+// Binary records
+//
+// A record with a schema in net_msg_schemas is sent as
+//   "MP-0 B" <schema> <fields>
+// where <schema> is the index of the schema, and each field of the text
+// record is encoded as given by the schema's type characters:
+//   i = integer as zigzag varint, u = unsigned long as varint,
+//   1..6 = fixed point number with 1..6 decimals as zigzag varint of the
+//   value without the point, n = number with up to 7 decimals as zigzag
+//   varint of (value << 3 | decimals), x = two digit hex byte,
+//   s = string, terminated by a 0 byte
+// Varints are little endian, 7 bits per byte, bit 7 set = more bytes.
+// A delta record ("Y<code><bitmap>,<fields>") has <schema> | 0x80, then
+// the number of bitmap digits and the bitmap nibbles (two per byte, low
+// nibble first), then the fields flagged in the bitmap.
+// Records with fields that don't decode back to the same text (or more or
+// fewer fields than the schema) are sent as text.
+
+rom struct
+  {
+  const rom char *prefix;     // code and fixed text up to the first field
+  const rom char *types;      // one type character per field
+  } net_msg_schemas[] =
+  {
+  { "S", "isiissiiiiiiiiiiii2iiiiiiiiiiii11i" },
+  { "D", "iiiiiiiuiuiiii1i1ii1" },
+  { "L", "66iiiiiix1uu" },
+  { "W", "ninininii" },
+  { "F", "ssiiss" },
+  { "HRT-BAT-P,", "iuiiiiiiiiiiiiiii" },
+  { "HRT-BAT-C,", "iuiiiiiiiiii" },
+  };
+#define NET_MSG_SCHEMAS (sizeof(net_msg_schemas)/sizeof(net_msg_schemas[0]))
+
+static char *net_msg_bin_varint(char *d, unsigned long v)
+  {
+  while (v >= 0x80)
+    {
+    *d++ = (v & 0x7f) | 0x80;
+    v >>= 7;
+    }
+  *d++ = v;
+  return d;
+  }
+
+// Encode the text field f..e-1 of <type> at d, return the new end or NULL
+// if it doesn't decode back to the same text
+static char *net_msg_bin_field(char *d, char type, char *f, char *e)
+  {
+  unsigned long v = 0;
+  char neg = 0, digits = 0, dec = -1;
+
+  if ((type == 's')||(type == 'x'))
+    {
+    if ((type == 'x')&&(e-f != 2))
+      return NULL;
+    while (f < e)
+      {
+      if (type == 's')
+        *d++ = *f;
+      else if ((*f >= '0')&&(*f <= '9'))
+        v = (v << 4) + (*f - '0');
+      else if ((*f >= 'A')&&(*f <= 'F'))
+        v = (v << 4) + (*f - 'A' + 10);
+      else
+        return NULL;
+      f++;
+      }
+    *d++ = (type == 's') ? 0 : v;
+    return d;
+    }
+
+  // Numbers: [-]digits[.digits], no leading zeros, no negative zero
+  if ((*f == '-')&&(type != 'u'))
+    {
+    neg = 1;
+    f++;
+    }
+  if ((f == e)||((*f == '0')&&(f+1 < e)&&(f[1] != '.')))
+    return NULL;
+  for (;f < e;f++)
+    {
+    if ((*f == '.')&&(dec < 0)&&(digits > 0))
+      dec = 0;
+    else if ((*f >= '0')&&(*f <= '9')&&(digits < 10))
+      {
+      v = v * 10 + (*f - '0');
+      digits++;
+      if (dec >= 0)
+        dec++;
+      }
+    else
+      return NULL;
+    }
+  if (dec < 0)
+    dec = 0;
+  if ((dec == 0)&&(f[-1] == '.'))
+    return NULL;
+  if ((neg)&&(v == 0))
+    return NULL;
+  if ((type >= '1')&&(type <= '6'))
+    {
+    if (dec != type - '0')
+      return NULL;
+    }
+  else if (type == 'n')
+    {
+    if ((dec > 7)||(v >= 0x10000000))
+      return NULL;
+    v = (v << 3) | dec;
+    }
+  else if (dec != 0)
+    return NULL;
+  if ((type == 'u')||(digits < 10))
+    {
+    // zigzag for signed values: 0, -1, 1, -2, ... => 0, 1, 2, 3, ...
+    if (type != 'u')
+      v = (neg) ? ((v << 1) - 1) : (v << 1);
+    return net_msg_bin_varint(d, v);
+    }
+  return NULL;
+  }
+
+// Convert the record in net_scratchpad to a binary record if it has a
+// schema, return the binary message length or 0 (send the text record)
+static int net_msg_bin_encode(void)
+  {
+  char *s = net_scratchpad+5;
+  char *f, *d, *b;
+  const rom char *p;
+  const rom char *types;
+  UINT8 n, k, len, delta = 0;
+
+  if (*s == 'Y')
+    {
+    delta = 0x80;
+    s++;
+    }
+  for (n=0;n<NET_MSG_SCHEMAS;n++)
+    {
+    for (p=net_msg_schemas[n].prefix,f=s;(*p != 0)&&(*p == *f);p++,f++) ;
+    if (*p == 0)
+      break;
+    }
+  if (n == NET_MSG_SCHEMAS)
+    return 0;
+  s = f;
+  types = net_msg_schemas[n].types;
+  d = net_msg_scratchpad;
+  *d++ = 'B';
+  *d++ = n | delta;
+
+  b = s; // delta bitmap
+  if (delta)
+    {
+    while ((*s != 0)&&(*s != ','))
+      s++;
+    len = s - b;
+    if ((len == 0)||(*s == 0))
+      return 0;
+    *d++ = len;
+    for (k=0;k<len;k++)
+      {
+      if ((b[k] >= '0')&&(b[k] <= '9'))
+        n = b[k] - '0';
+      else if ((b[k] >= 'A')&&(b[k] <= 'F'))
+        n = b[k] - 'A' + 10;
+      else
+        return 0;
+      if (k & 1)
+        d[-1] |= n << 4;
+      else
+        *d++ = n;
+      }
+    s++;
+    }
+
+  for (k=0;;k++)
+    {
+    if (types[k] == 0)
+      return 0; // more fields than the schema
+    if (delta)
+      {
+      // skip fields not in the bitmap:
+      if ((k >> 2) >= len)
+        return 0;
+      n = b[k >> 2];
+      n = (n <= '9') ? (n - '0') : (n - 'A' + 10);
+      if ((n & (1 << (k & 3))) == 0)
+        continue;
+      }
+    for (f=s;(*s != 0)&&(*s != ',');s++) ;
+    if ((d + (s-f) + 5) > (net_msg_scratchpad + NET_BUF_MAX))
+      return 0;
+    d = net_msg_bin_field(d, types[k], f, s);
+    if (d == NULL)
+      return 0;
+    if (*s++ == 0)
+      break;
+    }
+  if ((!delta)&&(types[k+1] != 0))
+    return 0; // fewer fields than the schema
+
+  len = d - net_msg_scratchpad;
+  memcpy(net_scratchpad+5, net_msg_scratchpad, len);
+  return len + 5;
+  }
+
+// Compressed history
+//
+// History records ("MP-0 H..." and "MP-0 h...") following each other are
+// sent as one message
+//   "MP-0 K" <net_lz stream>
+// of the records without the "MP-0 " prefix, each terminated by '\n'.
+// The window starts empty with each K message, so a lost message doesn't
+// affect the next ones. The K message is encrypted and base64 encoded as
+// it grows and is closed by the next other message, the end of the
+// CIPSEND, or if the next record could exceed the CIPSEND size limit.
+// Records with 8 bit characters are sent as they are.
+//
+// Returns FALSE if the message in net_scratchpad has not been sent.
+static BOOL net_msg_zip_puts(void)
+  {
+  UINT8 len, n;
+
+  for (len=0; net_scratchpad[5+len] != 0; len++)
+    {
+    if (net_scratchpad[5+len] & 0x80)
+      return FALSE;
+    }
+  net_scratchpad[5+len++] = '\n';
+
+  // Continue in a new CIPSEND if the record may exceed the modem's limit:
+  n = (net_msg_zbytes) ? 0 : 6;
+  if (((net_msg_sendbytes > 0)||(net_msg_zbytes > 0)) &&
+      (net_msg_sendbytes + NET_MSG_WIRELEN(net_msg_zbytes + n + len) > NET_MSG_SENDMAX))
+    {
+    net_msg_submit();
+    net_msg_cipsend();
+    if (!net_msg_sendpending)
+      return TRUE;
     }
+
+  if (net_msg_zbytes == 0)
+    {
+    net_lz_reset();
+    stp_rom(net_msg_scratchpad, (char const rom far*)"MP-0 K");
+    RC4_crypt(&tx_crypto1, &tx_crypto2, net_msg_scratchpad, 6);
+    net_putb64_open(net_msg_scratchpad, 6);
+    net_msg_zbytes = 6;
+    }
+
+  n = net_lz_compress(net_scratchpad+5, len, net_msg_scratchpad);
+  RC4_crypt(&tx_crypto1, &tx_crypto2, net_msg_scratchpad, n);
+  net_putb64_open(net_msg_scratchpad, n);
+  net_msg_zbytes += n;
+  return TRUE;
   }
 
 // Encode the message in net_scratchpad and start the send process
@@ -161,6 +582,14 @@ void net_msg_encode_puts(void)
     }
   else
     {
+    if ((net_msg_zip)&&(ptokenmade==0)&&(net_msg_bufpos==NULL)&&
+        ((net_scratchpad[5]=='H')||(net_scratchpad[5]=='h')))
+      {
+      if (net_msg_zip_puts())
+        return;
+      }
+    net_msg_zip_end();
+
     if ((ptokenmade==1)&&
         (net_scratchpad[5]!='E')&&
         (net_scratchpad[5]!='A')&&
@@ -189,9 +618,27 @@ void net_msg_encode_puts(void)
       net_scratchpad[7] = code;
       base64encode(net_msg_scratchpad,k,net_scratchpad+8);
       // The messdage is now in paranoid mode...
+      k = 0;
       }
+    else if (net_msg_binary)
+      k = net_msg_bin_encode();
+    else
+      k = 0;
+
+    if (k == 0)
+      k = strlen(net_scratchpad);
+
+    // Continue in a new CIPSEND if the line exceeds the modem's limit:
+    if ((net_msg_sendbytes > 0) &&
+        (net_msg_sendbytes + NET_MSG_WIRELEN(k) > NET_MSG_SENDMAX))
+      {
+      net_msg_submit();
+      net_msg_cipsend();
+      if (!net_msg_sendpending)
+        return;
+      }
+    net_msg_sendbytes += NET_MSG_WIRELEN(k);
 
-    k=strlen(net_scratchpad);
     RC4_crypt(&tx_crypto1, &tx_crypto2, net_scratchpad, k);
     base64encodesend(net_scratchpad,k);
     }
@@ -233,6 +680,80 @@ void net_msg_register(void)
   net_puts_rom("\r\n");
   }
 
+// Delta encode status record <rec> in net_scratchpad ("MP-0 <code><fields>")
+// as "MP-0 Y<code><bitmap>,<changed fields>". The <bitmap> has one hex
+// digit per four fields, the first digit for fields 0-3 (bit 0 = field 0),
+// trailing zero digits omitted. The changes are detected by a CRC16 per
+// field: a collision (1 in 65536 per changed field) leaves the field stale
+// until the next keyframe, a changed record without a changed field is
+// sent in full.
+// The record is left as it is (a keyframe) if <keyframe> is set, every
+// NET_MSG_DELTA_KEYFRAME records and if the delta is not shorter.
+static void net_msg_delta_encode(UINT8 rec, char keyframe)
+  {
+  WORD *fcrc = net_msg_fieldcrc + net_msg_delta_slot[rec];
+  UINT8 n = net_msg_delta_slot[rec+1] - net_msg_delta_slot[rec];
+  char *s = net_scratchpad+6;
+  char *f;
+  char *h = net_msg_scratchpad;                      // bitmap digits
+  char *d = net_msg_scratchpad + NET_MSG_DELTA_HDR;  // changed fields
+  UINT8 k, bits = 0;
+  WORD c;
+
+  if (net_msg_delta_keys[rec] == 0)
+    keyframe = 1;
+
+  for (k=0;;k++)
+    {
+    for (f=s;(*s != 0)&&(*s != ',');s++) ;
+    c = crc16(f, s-f);
+    if ((k >= n)||(fcrc[k] != c))
+      {
+      if (k < n)
+        fcrc[k] = c;
+      bits |= 1 << (k & 3);
+      if ((d + (s-f) + 2) > (net_msg_scratchpad + NET_BUF_MAX))
+        keyframe = 1;
+      else
+        {
+        *d++ = ',';
+        while (f < s)
+          *d++ = *f++;
+        }
+      }
+    if (((k & 3) == 3)||(*s == 0))
+      {
+      if (h == (net_msg_scratchpad + NET_MSG_DELTA_HDR))
+        keyframe = 1;
+      else
+        *h++ = (bits < 10) ? ('0' + bits) : ('A' - 10 + bits);
+      bits = 0;
+      }
+    if (*s++ == 0)
+      break;
+    }
+  *d = 0;
+  while ((h > net_msg_scratchpad)&&(h[-1] == '0'))
+    h--;
+
+  if ((keyframe)||(h == net_msg_scratchpad)||
+      ((7 + (h - net_msg_scratchpad) + (d - net_msg_scratchpad - NET_MSG_DELTA_HDR))
+        >= strlen(net_scratchpad)))
+    {
+    net_msg_delta_keys[rec] = NET_MSG_DELTA_KEYFRAME;
+    return;
+    }
+
+  net_msg_delta_keys[rec]--;
+  s = net_scratchpad+5;
+  s[1] = *s;
+  *s = 'Y';
+  s += 2;
+  for (f=net_msg_scratchpad;f<h;)
+    *s++ = *f++;
+  strcpy(s, net_msg_scratchpad + NET_MSG_DELTA_HDR);
+  }
+
 // net_msgp_*
 //
 // The net_msgp_* function output message parts.
@@ -252,35 +773,33 @@ void net_msg_register(void)
 
 // <stat> guarded encode the message in net_scratchpad and start the send process
 char net_msg_encode_statputs(char stat, WORD *oldcrc)
+  {
+  return net_msg_encode_deltaputs(stat, oldcrc, NET_MSG_DELTA_NONE);
+  }
+
+// net_msg_encode_statputs() for the status record <rec> (NET_MSG_DELTA_*):
+// guarded output is delta encoded if the server has enabled it, unless
+// the record is a paranoid one (the server can't decode it) or the
+// output is redirected (net_msg_scratchpad is in use).
+char net_msg_encode_deltaputs(char stat, WORD *oldcrc, UINT8 rec)
   {
   WORD newcrc = crc16(net_scratchpad, strlen(net_scratchpad));
 
-  switch (stat)
+  if ((stat != 0)&&(*oldcrc == newcrc))
+    return stat; // unchanged
+  *oldcrc = newcrc;
+
+  if ((rec != NET_MSG_DELTA_NONE)&&(net_msg_delta)&&
+      (ptokenmade == 0)&&(net_msg_bufpos == NULL))
+    net_msg_delta_encode(rec, (stat == 0));
+
+  if (stat == 2)
     {
-    case 0:
-      // Always output
-      net_msg_encode_puts();
-      *oldcrc = newcrc;
-      break;
-    case 1:
-      // Guarded output, but net_msg_start() has already been sent
-      if (*oldcrc != newcrc)
-        {
-        net_msg_encode_puts();
-        *oldcrc = newcrc;
-        }
-      break;
-    case 2:
-      // Guarded output, but net_msg_start() has not yet been sent
-      if (*oldcrc != newcrc)
-        {
-        net_msg_start();
-        net_msg_encode_puts();
-        *oldcrc = newcrc;
-        stat = 1;
-        }
-      break;
+    // Guarded output, but net_msg_start() has not yet been sent
+    net_msg_start();
+    stat = 1;
     }
+  net_msg_encode_puts();
   return stat;
 }
 
@@ -288,7 +807,7 @@ char net_msgp_stat(char stat)
 {
   char *p, *s;
 
-  p = par_get(PARAM_MILESKM);
+  p = par_mileskm;
 
   s = stp_i(net_scratchpad, "MP-0 S", car_SOC);
   s = stp_s(s, ",", p);
@@ -387,7 +906,7 @@ char net_msgp_stat(char stat)
 #ifdef OVMS_STRESSTEST
   crc_stat = 0;
 #endif
-  return net_msg_encode_statputs(stat, &crc_stat);
+  return net_msg_encode_deltaputs(stat, &crc_stat, NET_MSG_DELTA_STAT);
 }
 
 char net_msgp_gps(char stat)
@@ -410,7 +929,7 @@ char net_msgp_gps(char stat)
 #ifdef OVMS_STRESSTEST
   crc_gps = 0;
 #endif
-  return net_msg_encode_statputs(stat, &crc_gps);
+  return net_msg_encode_deltaputs(stat, &crc_gps, NET_MSG_DELTA_GPS);
 }
 
 #ifndef OVMS_NO_TPMS
@@ -459,7 +978,7 @@ char net_msgp_firmware(char stat)
   s = stp_i(net_scratchpad, "MP-0 F", ovms_firmware[0]);
   s = stp_i(s, ".", ovms_firmware[1]);
   s = stp_i(s, ".", ovms_firmware[2]);
-  s = stp_s(s, "/", par_get(PARAM_VEHICLETYPE));
+  s = stp_s(s, "/", par_vehicletype);
   if (vehicle_version)
     s = stp_rom(s, vehicle_version);
   s = stp_i(s, "/V", hwv);
@@ -507,7 +1026,7 @@ char net_msgp_environment(char stat)
 #ifdef OVMS_STRESSTEST
   crc_environment = 0;
 #endif
-  return net_msg_encode_statputs(stat, &crc_environment);
+  return net_msg_encode_deltaputs(stat, &crc_environment, NET_MSG_DELTA_ENV);
 }
 
 char net_msgp_capabilities(char stat)
@@ -529,9 +1048,9 @@ char net_msgp_group(char stat, char groupnumber)
 {
   char *s;
   
-  par_read(0x0A + groupnumber); // => PARAM_S_GROUP1 / PARAM_S_GROUP2
-  if (par_value[0])
+  if (par_groups & (1 << groupnumber))
     {
+    par_read(0x0A + groupnumber); // => PARAM_S_GROUP1 / PARAM_S_GROUP2
     s = stp_s(net_scratchpad, "MP-0 g", par_value);
     s = stp_i(s, ",", car_SOC);
     s = stp_i(s, ",", car_speed);
@@ -599,6 +1118,10 @@ void net_msg_server_welcome(char *msg)
     }
 
   net_msg_serverok = 1;
+  net_reconnect_done();
+  net_msg_delta = 0; // until the server offers it
+  net_msg_binary = 0;
+  net_msg_zip = 0;
 
   p = par_get(PARAM_PARANOID);
   if (*p == 'P')
@@ -673,6 +1196,7 @@ void net_msg_server_welcome(char *msg)
 void net_msg_in(char* msg)
   {
   int k;
+  char *d;
 
   if (net_msg_serverok == 0)
     {
@@ -716,13 +1240,7 @@ void net_msg_in(char* msg)
   switch (*msg)
     {
     case 'A': // PING
-      if (net_msg_sendpending==0)
-        {
-        stp_rom(net_scratchpad,(char const rom far*)"MP-0 a");
-        net_msg_start();
-        net_msg_encode_puts();
-        net_msg_send();
-        }
+      net_msg_pingpending = 1; // reply with the next net_idlepoll() batch
       break;
     case 'Z': // PEER connections
       k = atoi(msg+1); // get new peer count
@@ -738,13 +1256,23 @@ void net_msg_in(char* msg)
 #endif
         crc_firmware = 0;
         crc_capabilities = 0;
+        net_msg_delta_resync();
         net_req_notification(NET_NOTIFY_UPDATE);
         }
       net_apps_connected = k;
       break;
-    case 'h': // Historical data acknowledgement
+    case 'Y': // Record encodings accepted (NET_MSG_Y_* flags)
+      k = atoi(msg+1);
+      net_msg_delta = ((k & NET_MSG_Y_DELTA) != 0);
+      net_msg_binary = ((k & NET_MSG_Y_BINARY) != 0);
+      net_msg_zip = ((k & NET_MSG_Y_ZIP) != 0);
+      net_msg_delta_resync();
+      break;
+    case 'h': // Historical data acknowledgement: h<seq> or h<first>-<last>
 #ifdef OVMS_LOGGINGMODULE
-      logging_ack(atoi(msg+1));
+      k = atol(msg+1); // sequence numbers are unsigned 16 bit
+      for (d=msg+1;(*d>='0')&&(*d<='9');d++) ;
+      logging_ack(k, (*d=='-')?atol(d+1):k);
 #endif // #ifdef OVMS_LOGGINGMODULE
       break;
     case 'C': // COMMAND
@@ -1358,3 +1886,69 @@ void net_msg_erroralert(unsigned int errorcode, unsigned long errordata)
   net_msg_send();
   }
 #endif // OVMS_NO_ERROR_NOTIFY
+
+#ifdef OVMS_CAN_STATS
+/* CAN bus statistics of the current period (see vehicle_canstats_record),
+ * queued by net_state_ticker3600() and sent with the next net_idlepoll()
+ * batch. The counters are reset when the CIPSENDs have been acknowledged
+ * (net_msg_canstats_acked), a lost connection sends them again:
+ *
+ * MP-0 H*-OVM-CANStats,0,86400
+ *  ,<seconds>,<bitrate>,<load avg %>,<load peak %>,<peak car_time>
+ *  ,<rxb0 ovfl>,<rxb1 ovfl>,<max txerrcnt>,<max rxerrcnt>,<busoff>,<lost>
+ *
+ * MP-0 H*-OVM-CANStats,<n>,86400
+ *  ,<id>,<frames>,<bytes>,<changed>,<min gap ms>,<max gap ms>
+ *
+ * Gaps are clipped at 26843 ms.
+ */
+void net_msg_canstats(void)
+  {
+  unsigned char k, n;
+  vehicle_canstats_t *p;
+  char *s;
+
+  net_msg_start();
+
+  s = stp_ul(net_scratchpad, "MP-0 H*-OVM-CANStats,0,86400,", vehicle_canbus.seconds);
+  s = stp_ul(s, ",", vehicle_canbus_bitrate);
+  s = stp_l2f(s, ",", (vehicle_canbus.seconds)
+    ? vehicle_canbus.loadsum / vehicle_canbus.seconds : 0, 1);
+  s = stp_l2f(s, ",", vehicle_canbus.loadpeak, 1);
+  s = stp_ul(s, ",", vehicle_canbus.loadpeaktime);
+  s = stp_ul(s, ",", vehicle_canbus.ovfl0);
+  s = stp_ul(s, ",", vehicle_canbus.ovfl1);
+  s = stp_i(s, ",", vehicle_canbus.txerrmax);
+  s = stp_i(s, ",", vehicle_canbus.rxerrmax);
+  s = stp_ul(s, ",", vehicle_canbus.busoff);
+  s = stp_ul(s, ",", vehicle_canbus.lost);
+  net_msg_encode_puts();
+
+  for (k=0, n=0; k<VEHICLE_CANSTATS_SIZE; k++)
+    {
+    p = &vehicle_canstats[k];
+    if (p->count == 0)
+      continue;
+    s = stp_i(net_scratchpad, "MP-0 H*-OVM-CANStats,", ++n);
+    s = stp_x(s, ",86400,", vehicle_canstats_id[k]);
+    s = stp_ul(s, ",", p->count);
+    s = stp_ul(s, ",", p->bytes);
+    s = stp_ul(s, ",", p->changed);
+    s = stp_ul(s, ",", (p->count > 1) ? ((unsigned long)p->gapmin * 4096) / 10000 : 0);
+    s = stp_ul(s, ",", ((unsigned long)p->gapmax * 4096) / 10000);
+    net_msg_encode_puts();
+    }
+
+  net_msg_canstatspending = 2;
+  }
+
+// All CIPSENDs acknowledged: reset the CAN statistics sent
+void net_msg_canstats_acked(void)
+  {
+  if (net_msg_canstatspending == 2)
+    {
+    net_msg_canstatspending = 0;
+    vehicle_canstats_reset();
+    }
+  }
+#endif // OVMS_CAN_STATS
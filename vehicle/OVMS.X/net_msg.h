@@ -33,11 +33,33 @@
 
 #include "net.h"
 
+// Modem CIPSEND size limit and the wire size of an encoded message
+// (base64 + CRLF) of <len> bytes:
+#define NET_MSG_SENDMAX     1460
+#define NET_MSG_WIRELEN(len)  ((((len)+2)/3)*4+2)
+
+// Field level delta encoding of the status records, enabled by the server
+// with "MP-0 Y1": see net_msg_encode_deltaputs()
+#define NET_MSG_DELTA_NONE      0xff
+#define NET_MSG_DELTA_STAT      0       // MP-0 S
+#define NET_MSG_DELTA_ENV       1       // MP-0 D
+#define NET_MSG_DELTA_GPS       2       // MP-0 L
+#define NET_MSG_DELTA_RECS      3
+#define NET_MSG_DELTA_FIELDS    72      // field CRCs of all records
+#define NET_MSG_DELTA_KEYFRAME  20      // deltas between full records
+#define NET_MSG_DELTA_HDR       12      // max bitmap digits (48 fields)
+
+// Record encodings offered by the server with "MP-0 Y<flags>":
+#define NET_MSG_Y_DELTA         1       // delta status records
+#define NET_MSG_Y_BINARY        2       // binary records, see net_msg_schemas
+#define NET_MSG_Y_ZIP           4       // compressed history, see net_msg_zip_puts()
+
 extern rom char NET_MSG_CMDRESP[];
 extern rom char NET_MSG_CMDOK[];
 extern rom char NET_MSG_CMDINVALIDSYNTAX[];
 extern rom char NET_MSG_CMDNOCANWRITE[];
 extern rom char NET_MSG_CMDINVALIDRANGE[];
+extern rom char NET_MSG_CMDCANTXFULL[];
 extern rom char NET_MSG_CMDNOCANCHARGE[];
 extern rom char NET_MSG_CMDNOCANSTOPCHARGE[];
 extern rom char NET_MSG_CMDUNIMPLEMENTED[];
@@ -48,12 +70,22 @@ extern rom char NET_MSG_CMDUNIMPLEMENTED[];
 #define STP_INVALIDSYNTAX(buf,cmd)    stp_rom(stp_i(buf, NET_MSG_CMDRESP, cmd), NET_MSG_CMDINVALIDSYNTAX)
 #define STP_NOCANWRITE(buf,cmd)       stp_rom(stp_i(buf, NET_MSG_CMDRESP, cmd), NET_MSG_CMDNOCANWRITE)
 #define STP_INVALIDRANGE(buf,cmd)     stp_rom(stp_i(buf, NET_MSG_CMDRESP, cmd), NET_MSG_CMDINVALIDRANGE)
+#define STP_CANTXFULL(buf,cmd)        stp_rom(stp_i(buf, NET_MSG_CMDRESP, cmd), NET_MSG_CMDCANTXFULL)
 #define STP_NOCANCHARGE(buf,cmd)      stp_rom(stp_i(buf, NET_MSG_CMDRESP, cmd), NET_MSG_CMDNOCANCHARGE)
 #define STP_NOCANSTOPCHARGE(buf,cmd)  stp_rom(stp_i(buf, NET_MSG_CMDRESP, cmd), NET_MSG_CMDNOCANSTOPCHARGE)
 #define STP_UNIMPLEMENTED(buf,cmd)    stp_rom(stp_i(buf, NET_MSG_CMDRESP, cmd), NET_MSG_CMDUNIMPLEMENTED)
 
 extern char net_msg_serverok;               // flag
 extern INT8 net_msg_sendpending;            // flag & counter
+extern UINT8 net_msg_unacked;               // CIPSENDs waiting for SEND OK
+extern char net_msg_prompt;                 // CIPSEND prompt open (AT queue)
+extern unsigned int net_msg_inflight;       // NET alerts waiting for SEND OK
+extern char net_msg_pingpending;            // ping reply due
+#ifdef OVMS_CAN_STATS
+extern char net_msg_canstatspending;        // CAN statistics due / unacknowledged
+#endif // OVMS_CAN_STATS
+extern char net_msg_delta;                  // server accepts delta records
+extern char net_msg_binary;                 // server accepts binary records
 
 extern int  net_msg_cmd_code;               // currently processed msg command code
 extern char* net_msg_cmd_msg;               // ...and parameters, see  net_msg_cmd_in()
@@ -67,11 +99,16 @@ extern char *net_msg_bufpos; // write position in net_msg_scratchpad in wrapper
 
 void net_msg_init(void);
 void net_msg_disconnected(void);
+void net_msg_cipsend_queue(void);
+void net_msg_prompt_close(void);
 void net_msg_start(void);
 void net_msg_send(void);
+void net_msg_batch_start(void);
+BOOL net_msg_batch_end(void);
 void net_msg_encode_puts(void);
 void net_msg_register(void);
 char net_msg_encode_statputs(char stat, WORD *oldcrc);
+char net_msg_encode_deltaputs(char stat, WORD *oldcrc, UINT8 rec);
 
 char net_msgp_stat(char stat);
 char net_msgp_gps(char stat);
@@ -94,6 +131,10 @@ char *net_prep_ctp(char *s, char *arguments);
 void net_msg_stat(void);
 void net_msg_alert(alert_type alert);
 void net_msg_erroralert(unsigned int errorcode, unsigned long errordata);
+#ifdef OVMS_CAN_STATS
+void net_msg_canstats(void);
+void net_msg_canstats_acked(void);
+#endif // OVMS_CAN_STATS
 
 
 // Standard commands:
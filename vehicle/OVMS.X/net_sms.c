@@ -105,8 +105,7 @@ void net_send_sms_start(char* number)
       ((sys_features[FEATURE_CARBITS]&FEATURE_CB_SSMSTIME)==0))
     {
     // Car time is valid, and sms time is not disabled
-    char *p = par_get(PARAM_TIMEZONE);
-    char *s = stp_time(net_scratchpad, NULL, car_time + timestring_to_mins(p)*60L);
+    char *s = stp_time(net_scratchpad, NULL, car_time + par_timezone*60L);
     s = stp_rom(s, "\r ");
     net_puts_ram(net_scratchpad);
     }
@@ -47,14 +47,137 @@ rom char EEparam[PARAM_MAX][PARAM_MAX_LENGTH]
 #pragma udata
 char par_value[PARAM_MAX_LENGTH];
 
+// Parameter cache: the main loop reads some parameters on every status
+// update, an EEPROM read costs about 600 instruction cycles per parameter.
+// Modules keeping their own decoded copies (e.g. acc.c) reload them when
+// par_generation changes.
+char par_mileskm[2];
+char par_vehicletype[PAR_VEHICLETYPE_LENGTH];
+unsigned char par_notifies;
+unsigned char par_groups;
+int par_timezone;
+unsigned char par_generation = 1;
+
+// EEPROM writes: only changed bytes are written (about 4 ms each), with
+// interrupts disabled for the unlock sequence only. Statistics for DIAG:
+unsigned long par_stat_written = 0;         // Bytes written
+unsigned long par_stat_skipped = 0;         // Bytes unchanged, not written
+unsigned long par_stat_blocked = 0;         // Time spent in par_write() (TMR0 ticks)
+unsigned int  par_stat_blockmax = 0;        // Longest par_write() (TMR0 ticks)
+
+// Journalled parameters: short values that change often (the persistent
+// features, the Twizy profile number) rotate through the entries of their
+// slot, so each EEPROM byte is written on every 4th change only:
+//   [0]       PAR_JOURNAL_MARK
+//   [1+7*i]   entry i: sequence number, value (up to 5 chars + '\0')
+// The newest entry is the one not followed by its sequence number + 1.
+// Longer values are stored plain.
+#define PAR_JOURNAL_MARK        0x01
+#define PAR_JOURNAL_ENTRIES     4
+#define PAR_JOURNAL_SIZE        7
+#define PAR_JOURNAL_ENTRY(i)    (1 + (i)*PAR_JOURNAL_SIZE)
+#define PAR_JOURNALLED(p)       (((p) >= PARAM_FEATURE_S) || ((p) == PARAM_COOLDOWN))
+
+unsigned char par_eeread(unsigned int eeaddress)
+  {
+  EECON1 = 0; // select EEprom memory not Flash
+  EEADRH = eeaddress >> 8;
+  EEADR = eeaddress & 0x00ff;
+  EECON1bits.RD = 1;
+  return EEDATA;
+  }
+
+void par_eewrite(unsigned int eeaddress, unsigned char value)
+  {
+  unsigned char savint;
+
+  if (par_eeread(eeaddress) == value)
+    {
+    par_stat_skipped++;
+    return;
+    }
+  EEDATA = value;
+  EECON1bits.WREN = 1; //enable write to EEPROM
+  savint = INTCON; // Save interrupts state
+  INTCONbits.GIE=0; // Disable interrupts
+  EECON2 = 0x55; // required sequence #1
+  EECON2 = 0xAA; // #2
+  EECON1bits.WR = 1; // #3 = actual write
+  INTCON = savint; // Restore interrupts
+  while (EECON1bits.WR); // ~4 ms, interrupts enabled
+  EECON1bits.WREN = 0; // disable write to EEPROM
+  par_stat_written++;
+  }
+
+// Newest journal entry of the slot in par_value
+unsigned char par_journal_newest(void)
+  {
+  unsigned char k;
+
+  for (k=0; k<PAR_JOURNAL_ENTRIES-1; k++)
+    {
+    if ((unsigned char)par_value[PAR_JOURNAL_ENTRY(k+1)] != (unsigned char)(par_value[PAR_JOURNAL_ENTRY(k)]+1))
+      return k;
+    }
+  return PAR_JOURNAL_ENTRIES-1;
+  }
+
+void par_cache(unsigned char param)
+  {
+  // Decode param from par_value into the cache
+  switch (param)
+    {
+    case PARAM_MILESKM:
+      par_mileskm[0] = par_value[0];
+      par_mileskm[1] = 0;
+      break;
+    case PARAM_VEHICLETYPE:
+      strncpy(par_vehicletype, par_value, PAR_VEHICLETYPE_LENGTH);
+      par_vehicletype[PAR_VEHICLETYPE_LENGTH-1] = 0;
+      break;
+    case PARAM_NOTIFIES:
+      par_value[PARAM_MAX_LENGTH-1] = 0;
+      par_notifies = 0;
+      if (strstrrampgm(par_value,(char const rom far*)"SMS") != NULL)
+        par_notifies |= PAR_NOTIFY_SMS;
+      if (strstrrampgm(par_value,(char const rom far*)"IP") != NULL)
+        par_notifies |= PAR_NOTIFY_IP;
+      break;
+    case PARAM_S_GROUP1:
+    case PARAM_S_GROUP2:
+      if (par_value[0])
+        par_groups |= (1 << (param - PARAM_PARANOID));
+      else
+        par_groups &= ~(1 << (param - PARAM_PARANOID));
+      break;
+    case PARAM_TIMEZONE:
+      par_value[PARAM_MAX_LENGTH-1] = 0;
+      par_timezone = timestring_to_mins(par_value);
+      break;
+    }
+  }
+
 void par_initialise(void)
   {
+  par_read(PARAM_MILESKM);
+  par_cache(PARAM_MILESKM);
+  par_read(PARAM_VEHICLETYPE);
+  par_cache(PARAM_VEHICLETYPE);
+  par_read(PARAM_NOTIFIES);
+  par_cache(PARAM_NOTIFIES);
+  par_read(PARAM_S_GROUP1);
+  par_cache(PARAM_S_GROUP1);
+  par_read(PARAM_S_GROUP2);
+  par_cache(PARAM_S_GROUP2);
+  par_read(PARAM_TIMEZONE);
+  par_cache(PARAM_TIMEZONE);
   }
 
 void par_read(unsigned char param)
   {
   int k;
   unsigned int eeaddress;
+  char *v;
 
   // Read parameter from EEprom
   EECON1 = 0; // select EEprom memory not Flash
@@ -68,37 +191,95 @@ void par_read(unsigned char param)
     par_value[k] = EEDATA;
     EEADR++;
     }
+
+  if (PAR_JOURNALLED(param) && (par_value[0] == PAR_JOURNAL_MARK))
+    {
+    // Journal: move the newest value to the start
+    v = par_value + PAR_JOURNAL_ENTRY(par_journal_newest()) + 1;
+    for (k=0; k<PAR_JOURNAL_SIZE-1; k++)
+      par_value[k] = v[k];
+    par_value[PAR_JOURNAL_SIZE-1] = 0;
+    memset(par_value+PAR_JOURNAL_SIZE, 0, PARAM_MAX_LENGTH-PAR_JOURNAL_SIZE);
+    }
   }
 
 void par_write(unsigned char param)
   {
-  int k = 0;
-  unsigned char savint;
-  unsigned int eeaddress;
+  int k;
+  unsigned int eeaddress, x, t;
+  unsigned char seq;
 
   // Protect PARAM_REGPHONE & PARAM_MODULEPASS against empty writes:
   if ((param <= PARAM_MODULEPASS) && (par_value[0] == 0))
       return;
-  
+
+  t = TMR0L; // TMR0L latches TMR0H
+  t |= (unsigned int)TMR0H << 8;
+
   // Write parameter to EEprom
   eeaddress = (int)param;
   eeaddress = eeaddress*PARAM_MAX_LENGTH;
-  EEADRH = eeaddress >> 8;
-  for (k=0;k<PARAM_MAX_LENGTH;k++)
+  if (PAR_JOURNALLED(param) && (memchr(par_value, 0, PAR_JOURNAL_SIZE-1) != NULL))
     {
-    EEADR = (unsigned char)&EEparam[param][k]; // get low byte of address
-    EECON1 = 0; //ensure CFGS=0 and EEPGD=0
-    EECON1bits.WREN = 1; //enable write to EEPROM
-    EEDATA = par_value[k]; // and data
-    savint = INTCON; // Save interrupts state
-    INTCONbits.GIE=0; // Disable interrupts
-    EECON2 = 0x55; // required sequence #1
-    EECON2 = 0xAA; // #2
-    EECON1bits.WR = 1; // #3 = actual write
-    INTCON = savint; // Restore interrupts
-    while (EECON1bits.WR);
-    EECON1bits.WREN = 0; // disable write to EEPROM
+    // Short value: write the journal entry after the newest one
+    if (par_eeread(eeaddress) == PAR_JOURNAL_MARK)
+      {
+      for (k=0; k<PAR_JOURNAL_ENTRIES-1; k++)
+        {
+        seq = par_eeread(eeaddress + PAR_JOURNAL_ENTRY(k));
+        if (par_eeread(eeaddress + PAR_JOURNAL_ENTRY(k+1)) != (unsigned char)(seq+1))
+          break;
+        }
+      if (k == PAR_JOURNAL_ENTRIES-1)
+        seq = par_eeread(eeaddress + PAR_JOURNAL_ENTRY(k));
+      k = (k+1) % PAR_JOURNAL_ENTRIES;
+      seq++;
+      }
+    else
+      {
+      // Convert a plain slot, the plain string stays valid until the mark
+      // is written: the value goes to entry 1, byte 1 of the plain string
+      // serves as the sequence number of entry 0, entries 2 and 3 repeat
+      // the one of entry 1 so that entry 1 is the newest. A plain string
+      // reaching into entry 1 is replaced by the plain new value first.
+      for (k=0; (k<PAR_JOURNAL_ENTRY(1)) && (par_eeread(eeaddress+k) != 0); k++)
+        ;
+      if (k == PAR_JOURNAL_ENTRY(1))
+        {
+        for (k=0;k<PARAM_MAX_LENGTH;k++)
+          par_eewrite(eeaddress + k, par_value[k]);
+        }
+      seq = par_eeread(eeaddress + PAR_JOURNAL_ENTRY(0)) + 1;
+      for (k=2; k<PAR_JOURNAL_ENTRIES; k++)
+        par_eewrite(eeaddress + PAR_JOURNAL_ENTRY(k), seq);
+      k = 1;
+      }
+    // Value first, the sequence number makes it the newest:
+    x = eeaddress + PAR_JOURNAL_ENTRY(k);
+    for (k=0; k<PAR_JOURNAL_SIZE-1; k++)
+      {
+      par_eewrite(x+1+k, par_value[k]);
+      if (par_value[k] == 0) break;
+      }
+    par_eewrite(x, seq);
+    par_eewrite(eeaddress, PAR_JOURNAL_MARK);
     }
+  else
+    {
+    for (k=0;k<PARAM_MAX_LENGTH;k++)
+      par_eewrite(eeaddress + k, par_value[k]);
+    }
+
+  x = TMR0L;
+  x |= (unsigned int)TMR0H << 8;
+  t = x - t;
+  par_stat_blocked += t;
+  if (t > par_stat_blockmax)
+    par_stat_blockmax = t;
+
+  par_cache(param);
+  if (++par_generation == 0)
+    par_generation = 1;
   }
 
 char* par_get(unsigned char param)
@@ -76,6 +76,25 @@
 
 extern char par_value[PARAM_MAX_LENGTH];
 
+// RAM cache of frequently used parameters, decoded by par_initialise()
+// and updated by par_write():
+#define PAR_VEHICLETYPE_LENGTH 4  // Vehicle types have up to 3 characters
+#define PAR_NOTIFY_SMS    0x01    // PARAM_NOTIFIES contains "SMS"
+#define PAR_NOTIFY_IP     0x02    // PARAM_NOTIFIES contains "IP"
+
+extern char par_mileskm[2];                           // PARAM_MILESKM ("K" or "M")
+extern char par_vehicletype[PAR_VEHICLETYPE_LENGTH];  // PARAM_VEHICLETYPE
+extern unsigned char par_notifies;                    // PARAM_NOTIFIES as PAR_NOTIFY_*
+extern unsigned char par_groups;                      // PARAM_S_GROUP1/2 set: bit 1/2
+extern int par_timezone;                              // PARAM_TIMEZONE in minutes
+extern unsigned char par_generation;                  // Changes on every par_write()
+
+// EEPROM write statistics (DIAG), times in TMR0 ticks of 51.2 us:
+extern unsigned long par_stat_written;     // Bytes written
+extern unsigned long par_stat_skipped;     // Bytes unchanged, not written
+extern unsigned long par_stat_blocked;     // Time spent in par_write()
+extern unsigned int  par_stat_blockmax;    // Longest par_write()
+
 void par_initialise(void);
 void par_read(unsigned char param);
 void par_write(unsigned char param);
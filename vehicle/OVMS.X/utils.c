@@ -42,7 +42,11 @@
 // Reset the cpu
 void reset_cpu(void)
   {
+#ifdef OVMS_HOST
+  host_reset();
+#else
   _asm reset _endasm
+#endif // OVMS_HOST
   }
 
 void delay5b(void)
@@ -57,6 +61,9 @@ void delay5b(void)
     while (!PIR1bits.TMR2IF);
     PIR1bits.TMR2IF=0;
     count++;
+#ifdef OVMS_CAN_DEFERRED
+    vehicle_canring_dispatch(); // keep decoding CAN frames while waiting
+#endif // OVMS_CAN_DEFERRED
     }
   }
 
@@ -83,6 +90,9 @@ void delay100b(void)
     while (!PIR1bits.TMR2IF);
     PIR1bits.TMR2IF=0;
     count++;
+#ifdef OVMS_CAN_DEFERRED
+    vehicle_canring_dispatch(); // keep decoding CAN frames while waiting
+#endif // OVMS_CAN_DEFERRED
     }
   }
 
@@ -336,6 +346,29 @@ WORD crc16(char *data, int length)
   return crc;
 }
 
+// Calculate an 8bit CRC (Dallas/Maxim, reflected 0x8C) and return it
+BYTE crc8(char *data, int length)
+  {
+  BYTE crc = 0;
+  int k;
+
+  while (length>0)
+    {
+    crc ^= (BYTE)*data++;
+    length--;
+
+    for (k = 0; k < 8; ++k)
+      {
+      if (crc & 1)
+        crc = (crc >> 1) ^ 0x8C;
+      else
+        crc = (crc >> 1);
+      }
+    }
+
+  return crc;
+}
+
 ////////////////////////////////////////////////////////////////////////
 // convert GSM clock response string to timestamp
 // timezone string must be set correctly to convert local time to UTC
@@ -347,7 +380,6 @@ unsigned long datestring_to_timestamp(const char *arg)
   char aval[6];
   int ival = -1;
   char ch;
-  char *ptimezone = par_get(PARAM_TIMEZONE);
 
   aval[0] = 0; // the rest get handled as we go
   while ((ch = *arg++) != 0 && ival < (int)DIM(aval))
@@ -376,7 +408,7 @@ unsigned long datestring_to_timestamp(const char *arg)
 
   return (JdFromYMD(2000+aval[0], aval[1], aval[2]) - JDEpoch) * (24L * 3600);
               + ((aval[3] * 60L + aval[4]) * 60) + aval[5]
-              - timestring_to_mins(ptimezone) * 60L;
+              - par_timezone * 60L;
   }
 
 // cr2lf: replace \r by \n in s (to convert msg text to sms)
@@ -29,6 +29,7 @@
 #include <string.h>
 #include "ovms.h"
 #include "params.h"
+#include "led.h"
 #ifdef OVMS_ACCMODULE
 #include "acc.h"
 #endif
@@ -41,6 +42,8 @@ unsigned char can_datalength;                // The number of valid bytes in the
 unsigned char can_databuffer[8];             // A buffer to store the current CAN message
 unsigned char can_minSOCnotified;            // minSOC notified flag
 unsigned char can_mileskm;                   // Miles of Kilometers
+unsigned char can_rxflag = 0;                // CAN frame received (set by high_isr)
+unsigned char can_quiet = 0;                 // Seconds without CAN frames (max 255)
 
 rom unsigned char* vehicle_version;          // Vehicle module version
 rom unsigned char* can_capabilities;         // Vehicle capabilities
@@ -69,29 +72,174 @@ rom int  (*vehicle_fn_minutestocharge)(unsigned char chgmod, int wAvail, int imS
 
 unsigned char vehicle_poll_state;        // Current poll state
 rom vehicle_pid_t* vehicle_poll_plist;   // Head of poll list
-rom vehicle_pid_t* vehicle_poll_plcur;   // Current position in poll list
-unsigned int vehicle_poll_ticker;        // Polling ticker
-unsigned int vehicle_poll_moduleid_send; // Send moduleid
-unsigned int vehicle_poll_moduleid_low;  // Expected response moduleid low mark
-unsigned int vehicle_poll_moduleid_high; // Expected response moduleid high mark
+rom vehicle_pid_t* vehicle_poll_plcur;   // Current request (last sent)
+unsigned int vehicle_poll_ticker;        // Polling ticker (TMR1 ticks, 104.9 ms)
+unsigned char vehicle_poll_tick8;        // led_tmr1cnt at the last wheel step
+unsigned char vehicle_poll_rdhead;       // Ready queue head (entry index)
+unsigned char vehicle_poll_rdtail;       // Ready queue tail
+unsigned int vehicle_poll_moduleid_send; // Send moduleid (current response)
+unsigned int vehicle_poll_moduleid_low;  // Expected response moduleid low mark (all sessions)
+unsigned int vehicle_poll_moduleid_high; // Expected response moduleid high mark (all sessions)
 unsigned char vehicle_poll_type;         // Expected type
 unsigned int vehicle_poll_pid;           // Expected pid
 unsigned char vehicle_poll_busactive;    // Indicates recent activity on the passive bus
 unsigned int vehicle_poll_ml_remain;     // Bytes remaining for vehicle poll
 unsigned int vehicle_poll_ml_offset;     // Offset of vehicle poll data
 unsigned int vehicle_poll_ml_frame;      // Frame number for vehicle poll
+unsigned char *vehicle_poll_buffer;      // Reassembly buffer (VEHICLE_POLL_FC_BUFFER)
+unsigned int vehicle_poll_bufsize;       // Reassembly buffer size
 
 rom BOOL (*vehicle_fn_pollpid)(void);
 
+#pragma udata VEHICLE_POLL
+unsigned int vehicle_poll_due[VEHICLE_POLL_MAXPIDS];    // Next due tick per entry
+unsigned char vehicle_poll_next[VEHICLE_POLL_MAXPIDS];  // Wheel / ready queue link
+unsigned char vehicle_poll_wheel[VEHICLE_POLL_WHEEL];   // Wheel slot list heads
+vehicle_poll_slot_t vehicle_poll_slot[VEHICLE_POLL_SLOTS]; // ISO-TP sessions
+#pragma udata VEHICLE
+
 #endif //#ifdef OVMS_POLLER
 
+#ifdef OVMS_CAN_DEFERRED
+#pragma udata VEHICLE_CANRING
+vehicle_canframe_t vehicle_canring[VEHICLE_CANRING_SIZE]; // CAN RX frame ring
+#pragma udata VEHICLE
+unsigned char vehicle_canring_head;         // next write (ISR)
+unsigned char vehicle_canring_tail;         // next read (main loop)
+unsigned char vehicle_canring_peak;         // max ring fill level
+unsigned int vehicle_canring_drops;         // frames lost: ring full
+unsigned int can_time;                      // TMR1 reception time of the current frame
+#endif // OVMS_CAN_DEFERRED
+
+#ifdef OVMS_ISR_PROFILE
+#pragma udata VEHICLE_ISRPROF
+vehicle_isrprof_t vehicle_isrprof[VEHICLE_ISRPROF_IDS]; // CAN ISR cycles per ID
+unsigned int vehicle_isrprof_lost;          // Frames not recorded (table full)
+#endif // OVMS_ISR_PROFILE
+
+#ifdef OVMS_CAN_STATS
+#pragma udata VEHICLE_CANSTATS
+vehicle_canstats_t vehicle_canstats[VEHICLE_CANSTATS_SIZE]; // Counters per CAN ID
+#pragma udata VEHICLE
+unsigned int vehicle_canstats_id[VEHICLE_CANSTATS_SIZE]; // CAN ID of the slot
+vehicle_canbus_t vehicle_canbus;            // Bus wide counters
+unsigned long vehicle_canbus_bits;          // Frame bits received this second
+unsigned long vehicle_canbus_bitrate;       // Bus bit rate from BRGCON1..3
+#endif // OVMS_CAN_STATS
+
+#ifdef OVMS_CAN_SUPPRESS
+#pragma udata VEHICLE_CANSUPP
+vehicle_cansupp_slot_t vehicle_cansupp[VEHICLE_CANSUPP_SIZE]; // Last payload per CAN ID
+#pragma udata VEHICLE
+rom vehicle_cansupp_t *vehicle_cansupp_list; // Module ID list, NULL = off
+unsigned long vehicle_cansupp_frames;       // Frames checked
+unsigned long vehicle_cansupp_skips;        // Frames suppressed
+#endif // OVMS_CAN_SUPPRESS
+
+#pragma udata VEHICLE_CANTX
+vehicle_cantx_t vehicle_cantx_queue[VEHICLE_CANTX_SIZE]; // CAN TX queue
+#pragma udata VEHICLE
+unsigned char vehicle_cantx_mask;           // TX buffers used by the queue
+unsigned char vehicle_cantx_prio[3];        // priority pending per TX buffer
+unsigned char vehicle_cantx_age[3];         // seconds pending per TX buffer
+unsigned char vehicle_cantx_seq;            // next queue order number
+unsigned char vehicle_cantx_peak;           // max queue fill level
+unsigned int vehicle_cantx_sent;            // frames sent
+unsigned int vehicle_cantx_errors;          // frames aborted: timeout
+unsigned int vehicle_cantx_drops;           // frames lost: queue full
+
 #pragma udata
 
 #ifdef OVMS_POLLER
 
+////////////////////////////////////////////////////////////////////////
+// Poll scheduling: a timing wheel of VEHICLE_POLL_WHEEL slots, one per
+// TMR1 tick (104.9 ms, counted by led_isr()). Each entry of the poll list
+// sits in the slot of its next due tick, or in the ready queue once due.
+// A wheel step only visits the entries of one slot, entries due more
+// than one wheel turn ahead are passed on to the next turn.
+// Requests are sent through a pool of VEHICLE_POLL_SLOTS ISO-TP sessions,
+// keyed by the response ID, so modules are polled in parallel. A module
+// has one open request at a time: the next request to it is held back
+// until the response has been received or VEHICLE_POLL_TIMEOUT ticks
+// have passed, later ready entries for other modules may overtake it.
+//
+
+// Poll period of polltime[state] in TMR1 ticks, 0 = off
+unsigned int vehicle_poll_period(unsigned int polltime)
+  {
+  unsigned long t;
+
+  if (polltime == 0)
+    return 0;
+  if (polltime & VEHICLE_POLL_TENTHS)
+    t = ((unsigned long)(polltime & ~VEHICLE_POLL_TENTHS) * 62500UL) >> 16;
+  else if (polltime > 3000)
+    t = 28610; // 3000 seconds
+  else
+    t = ((unsigned long)polltime * 625000UL) >> 16;
+  return (t > 0) ? t : 1;
+  }
+
+void vehicle_poll_wheel_add(unsigned char k)
+  {
+  unsigned char slot = vehicle_poll_due[k] & (VEHICLE_POLL_WHEEL-1);
+
+  vehicle_poll_next[k] = vehicle_poll_wheel[slot];
+  vehicle_poll_wheel[slot] = k;
+  }
+
+void vehicle_poll_ready_add(unsigned char k)
+  {
+  vehicle_poll_next[k] = VEHICLE_POLL_NONE;
+  if (vehicle_poll_rdhead == VEHICLE_POLL_NONE)
+    vehicle_poll_rdhead = k;
+  else
+    vehicle_poll_next[vehicle_poll_rdtail] = k;
+  vehicle_poll_rdtail = k;
+  }
+
+// (Re-)Start scheduling: all entries active in the current state are due
+void vehicle_poll_schedule(void)
+  {
+  unsigned char k, savint;
+
+  vehicle_poll_rdhead = VEHICLE_POLL_NONE;
+  for (k=0; k<VEHICLE_POLL_WHEEL; k++)
+    vehicle_poll_wheel[k] = VEHICLE_POLL_NONE;
+  vehicle_poll_tick8 = led_tmr1cnt;
+  savint = INTCON; // Save interrupts state
+  INTCONbits.GIEH = 0; // Disable CAN interrupts
+  for (k=0; k<VEHICLE_POLL_SLOTS; k++)
+    vehicle_poll_slot[k].wait = 0;
+  vehicle_poll_moduleid_low = 0;
+  vehicle_poll_moduleid_high = 0;
+  INTCON = savint; // Restore interrupts
+  vehicle_poll_plcur = NULL;
+
+  if (vehicle_poll_plist == NULL)
+    return;
+  for (k=0; (k<VEHICLE_POLL_MAXPIDS) && (vehicle_poll_plist[k].moduleid != 0); k++)
+    {
+    if (vehicle_poll_plist[k].polltime[vehicle_poll_state] > 0)
+      {
+      vehicle_poll_due[k] = vehicle_poll_ticker;
+      vehicle_poll_ready_add(k);
+      }
+    }
+  }
+
 void vehicle_poll_setpidlist(rom vehicle_pid_t *plist)
   {
   vehicle_poll_plist = plist;
+  vehicle_poll_schedule();
+  }
+
+// Set the buffer for VEHICLE_POLL_FC_BUFFER responses (NULL = none)
+void vehicle_poll_setbuffer(unsigned char *buffer, unsigned int size)
+  {
+  vehicle_poll_buffer = buffer;
+  vehicle_poll_bufsize = (buffer != NULL) ? size : 0;
   }
 
 void vehicle_poll_setstate(unsigned char state)
@@ -99,193 +247,374 @@ void vehicle_poll_setstate(unsigned char state)
   if ((state >= 0)&&(state < VEHICLE_POLL_NSTATES)&&(state != vehicle_poll_state))
     {
     vehicle_poll_state = state;
-    vehicle_poll_ticker = 0;
-    vehicle_poll_plcur = NULL;
+    vehicle_poll_schedule();
     }
   }
 
-void vehicle_poll_poller(void)
+// Response ID range of all open sessions, prefilter for vehicle_poll_poll0()
+void vehicle_poll_range(void)
   {
-  if (vehicle_poll_plcur == NULL)
+  unsigned char k, savint;
+  unsigned int low = 0x7ff, high = 0;
+  vehicle_poll_slot_t *sl;
+
+  for (k=0, sl=vehicle_poll_slot; k<VEHICLE_POLL_SLOTS; k++, sl++)
     {
-    vehicle_poll_plcur = vehicle_poll_plist;
+    if (sl->wait == 0)
+      continue;
+    if (sl->moduleid_low < low) low = sl->moduleid_low;
+    if (sl->moduleid_high > high) high = sl->moduleid_high;
     }
+  // The ISR prefilter reads both 16 bit marks:
+  savint = INTCON; // Save interrupts state
+  INTCONbits.GIEH = 0; // Disable CAN interrupts
+  vehicle_poll_moduleid_low = low;
+  vehicle_poll_moduleid_high = high;
+  INTCON = savint; // Restore interrupts
+  }
 
-  while (vehicle_poll_plcur->moduleid != 0)
+// Send the request of a poll list entry using a free session slot,
+// FALSE if the CAN TX queue is full
+BOOL vehicle_poll_send(vehicle_poll_slot_t *sl)
+  {
+  unsigned char req[8];
+  unsigned char savint;
+
+  switch (sl->type)
     {
-    if ((vehicle_poll_plcur->polltime[vehicle_poll_state] > 0)&&
-        ((vehicle_poll_ticker % vehicle_poll_plcur->polltime[vehicle_poll_state] ) == 0))
+    case VEHICLE_POLL_TYPE_OBDIICURRENT:
+    case VEHICLE_POLL_TYPE_OBDIIFREEZE:
+    case VEHICLE_POLL_TYPE_OBDIISESSION:
+    case VEHICLE_POLL_TYPE_OBDIIVEHICLE:
+    case VEHICLE_POLL_TYPE_OBDIIGROUP:
+      // 8 bit PID request for single / multi frame response:
+      req[0] = 0x02;
+      req[1] = sl->type;
+      req[2] = sl->pid;
+      req[3] = 0x00;
+      break;
+    case VEHICLE_POLL_TYPE_OBDIIEXTENDED:
+      // 16 bit PID request:
+      req[0] = 0x03;
+      req[1] = VEHICLE_POLL_TYPE_OBDIIEXTENDED;    // Get extended PID
+      req[2] = sl->pid >> 8;
+      req[3] = sl->pid & 0xff;
+      break;
+    }
+  req[4] = 0x00;
+  req[5] = 0x00;
+  req[6] = 0x00;
+  req[7] = 0x00;
+
+  // Open the session before the response can arrive:
+  savint = INTCON; // Save interrupts state
+  INTCONbits.GIEH = 0; // Disable CAN interrupts
+  sl->ml_remain = 0;
+  sl->ml_offset = 0;
+  sl->ml_frame = 0;
+  sl->bscount = 0;
+  sl->fc_id = 0;
+  sl->wait = VEHICLE_POLL_TIMEOUT;
+  if (sl->moduleid_low < vehicle_poll_moduleid_low)
+    vehicle_poll_moduleid_low = sl->moduleid_low;
+  if (sl->moduleid_high > vehicle_poll_moduleid_high)
+    vehicle_poll_moduleid_high = sl->moduleid_high;
+  INTCON = savint; // Restore interrupts
+  if (!vehicle_cantx(sl->moduleid_send, VEHICLE_CANTX_NORMAL, 8, req))
+    {
+    sl->wait = 0;
+    return FALSE;
+    }
+  return TRUE;
+  }
+
+// Queue the flow control frame of a session to sl->fc_id, cleared when
+// done. A full CAN TX queue leaves it set for vehicle_poll_poller().
+void vehicle_poll_fcsend(vehicle_poll_slot_t *sl)
+  {
+  unsigned char bs, stmin;
+  unsigned char fc[8];
+
+  if (sl->flowctl & 0x8000)
+    {
+    bs = (sl->flowctl >> 8) & 0x3f; // block size
+    stmin = sl->flowctl & 0xff; // separation time
+    }
+  else
+    {
+    bs = 0x00; // request all frames available
+    stmin = 0x32; // with 50ms send interval
+    }
+
+  fc[0] = 0x30; // flow control frame type
+  fc[1] = bs;
+  fc[2] = stmin;
+  fc[3] = 0x00;
+  fc[4] = 0x00;
+  fc[5] = 0x00;
+  fc[6] = 0x00;
+  fc[7] = 0x00;
+
+  if (vehicle_cantx(sl->fc_id, VEHICLE_CANTX_HIGH, 8, fc))
+    sl->fc_id = 0;
+  sl->bscount = bs;
+  }
+
+// Called by vehicle_ticker10th(): advance the wheel to the current tick
+// and send the due requests while the bus is active
+void vehicle_poll_poller(void)
+  {
+  unsigned char k, next, prev, slot, savint;
+  unsigned char nfree;
+  unsigned int send, low, high;
+  vehicle_poll_slot_t *sl, *fsl;
+  rom vehicle_pid_t *p;
+
+  while (vehicle_poll_tick8 != led_tmr1cnt)
+    {
+    vehicle_poll_tick8++;
+    vehicle_poll_ticker++;
+    savint = INTCON; // Save interrupts state
+    INTCONbits.GIEH = 0; // Disable CAN interrupts
+    for (k=0, sl=vehicle_poll_slot; k<VEHICLE_POLL_SLOTS; k++, sl++)
       {
-      // We need to poll this one...
-      
-      while ((TXB0CON & 0b00111000) == 0b00001000) {} // wait for TX done / error
-      TXB0CON = 0; // init new TX / abort TX error
-      while (TXB0CONbits.TXREQ) {} // wait for TX clear
-      
-      vehicle_poll_type = vehicle_poll_plcur->type;
-      vehicle_poll_pid = vehicle_poll_plcur->pid;
-      if (vehicle_poll_plcur->rmoduleid != 0)
-        {
-        // send to <moduleid>, listen to response from <rmoduleid>:
-        vehicle_poll_moduleid_send = vehicle_poll_plcur->moduleid;
-        vehicle_poll_moduleid_low = vehicle_poll_plcur->rmoduleid;
-        vehicle_poll_moduleid_high = vehicle_poll_plcur->rmoduleid;
-        }
+      if (sl->wait > 0)
+        sl->wait--; // 0 = timeout, session closed
+      if ((sl->wait > 0)&&(sl->fc_id != 0))
+        vehicle_poll_fcsend(sl); // retry the flow control frame
+      }
+    INTCON = savint; // Restore interrupts
+    slot = vehicle_poll_ticker & (VEHICLE_POLL_WHEEL-1);
+    k = vehicle_poll_wheel[slot];
+    vehicle_poll_wheel[slot] = VEHICLE_POLL_NONE;
+    while (k != VEHICLE_POLL_NONE)
+      {
+      next = vehicle_poll_next[k];
+      if ((signed int)(vehicle_poll_due[k] - vehicle_poll_ticker) <= 0)
+        vehicle_poll_ready_add(k);
       else
-        {
-        // broadcast: send to 0x7df, listen to all responses:
-        vehicle_poll_moduleid_send = 0x7df;
-        vehicle_poll_moduleid_low = 0x7e8;
-        vehicle_poll_moduleid_high = 0x7ef;
-        }
-      TXB0SIDL = (vehicle_poll_moduleid_send & 0x07) << 5;
-      TXB0SIDH = (vehicle_poll_moduleid_send >> 3);
-      
-      switch (vehicle_poll_plcur->type)
-        {
-        case VEHICLE_POLL_TYPE_OBDIICURRENT:
-        case VEHICLE_POLL_TYPE_OBDIIFREEZE:
-        case VEHICLE_POLL_TYPE_OBDIISESSION:
-          // 8 bit PID request for single frame response:
-          TXB0D0 = 0x02;
-          TXB0D1 = vehicle_poll_type;
-          TXB0D2 = vehicle_poll_pid;
-          TXB0D3 = 0x00;
-          TXB0D4 = 0x00;
-          TXB0D5 = 0x00;
-          TXB0D6 = 0x00;
-          TXB0D7 = 0x00;
-          TXB0DLC = 0b00001000; // data length (8)
-          TXB0CON = 0b00001000; // mark for transmission
-          break;
-        case VEHICLE_POLL_TYPE_OBDIIVEHICLE:
-        case VEHICLE_POLL_TYPE_OBDIIGROUP:
-          // 8 bit PID request for multi frame response:
-          vehicle_poll_ml_remain = 0;
-          TXB0D0 = 0x02;
-          TXB0D1 = vehicle_poll_type;
-          TXB0D2 = vehicle_poll_pid;
-          TXB0D3 = 0x00;
-          TXB0D4 = 0x00;
-          TXB0D5 = 0x00;
-          TXB0D6 = 0x00;
-          TXB0D7 = 0x00;
-          TXB0DLC = 0b00001000; // data length (8)
-          TXB0CON = 0b00001000; // mark for transmission
-          break;
-        case VEHICLE_POLL_TYPE_OBDIIEXTENDED:
-          // 16 bit PID request:
-          TXB0D0 = 0x03;
-          TXB0D1 = VEHICLE_POLL_TYPE_OBDIIEXTENDED;    // Get extended PID
-          TXB0D2 = vehicle_poll_pid >> 8;
-          TXB0D3 = vehicle_poll_pid & 0xff;
-          TXB0D4 = 0x00;
-          TXB0D5 = 0x00;
-          TXB0D6 = 0x00;
-          TXB0D7 = 0x00;
-          TXB0DLC = 0b00001000; // data length (8)
-          TXB0CON = 0b00001000; // mark for transmission
-          break;
-        }
-      
-      vehicle_poll_plcur++;
-      return;
+        vehicle_poll_wheel_add(k); // next turn
+      k = next;
       }
-    vehicle_poll_plcur++;
     }
 
-  vehicle_poll_plcur = vehicle_poll_plist;
-  vehicle_poll_ticker++;
-  if (vehicle_poll_ticker > 3600) vehicle_poll_ticker -= 3600;
+  if ((vehicle_poll_busactive == 0) || (vehicle_poll_rdhead == VEHICLE_POLL_NONE))
+    return;
+
+  nfree = 0;
+  for (k=0; k<VEHICLE_POLL_SLOTS; k++)
+    {
+    if (vehicle_poll_slot[k].wait == 0)
+      nfree++;
+    }
+
+  // Walk the ready queue, send each entry whose module has no open session:
+  prev = VEHICLE_POLL_NONE;
+  for (k = vehicle_poll_rdhead; (k != VEHICLE_POLL_NONE) && (nfree > 0); k = next)
+    {
+    next = vehicle_poll_next[k];
+    p = &vehicle_poll_plist[k];
+    if (p->rmoduleid != 0)
+      {
+      // send to <moduleid>, listen to response from <rmoduleid>:
+      send = p->moduleid;
+      low = high = p->rmoduleid;
+      }
+    else
+      {
+      // broadcast: send to 0x7df, listen to all responses:
+      send = 0x7df;
+      low = 0x7e8;
+      high = 0x7ef;
+      }
+
+    fsl = NULL;
+    for (slot=0, sl=vehicle_poll_slot; slot<VEHICLE_POLL_SLOTS; slot++, sl++)
+      {
+      if (sl->wait == 0)
+        fsl = sl;
+      else if ((sl->moduleid_low <= high) && (sl->moduleid_high >= low))
+        break; // module busy
+      else if ((sl->flowctl & p->flowctl & VEHICLE_POLL_FC_BUFFER) != 0)
+        break; // buffer busy
+      }
+    if (slot < VEHICLE_POLL_SLOTS)
+      {
+      prev = k; // keep waiting in the queue
+      continue;
+      }
+
+    // We need to poll this one...
+    savint = INTCON; // Save interrupts state
+    INTCONbits.GIEH = 0; // Disable CAN interrupts
+    fsl->moduleid_send = send;
+    fsl->moduleid_low = low;
+    fsl->moduleid_high = high;
+    fsl->type = p->type;
+    fsl->pid = p->pid;
+    fsl->flowctl = p->flowctl;
+    INTCON = savint; // Restore interrupts
+    if (!vehicle_poll_send(fsl))
+      break; // CAN TX queue full, retry next tick
+    nfree--;
+
+    if (prev == VEHICLE_POLL_NONE)
+      vehicle_poll_rdhead = next;
+    else
+      vehicle_poll_next[prev] = next;
+    if (vehicle_poll_rdtail == k)
+      vehicle_poll_rdtail = prev;
+    vehicle_poll_plcur = p;
+    vehicle_poll_due[k] = vehicle_poll_ticker
+      + vehicle_poll_period(p->polltime[vehicle_poll_state]);
+    vehicle_poll_wheel_add(k);
+    }
+
+  vehicle_poll_range();
   }
 
+// Send a flow control frame for a multi frame response
+void vehicle_poll_flowcontrol(vehicle_poll_slot_t *sl)
+  {
+  if (sl->moduleid_send == 0x7df)
+    {
+    // broadcast request: derive module ID from response ID:
+    // (Note: this only works for the SAE standard ID scheme)
+    sl->fc_id = can_id-8;
+    }
+  else
+    {
+    // use known module ID:
+    sl->fc_id = sl->moduleid_send;
+    }
+
+  vehicle_poll_fcsend(sl);
+  }
+
+// Copy response data to the reassembly buffer, ml_offset counts the
+// bytes stored (vehicle_poll_bufsize is 0 without a buffer)
+void vehicle_poll_bufcopy(vehicle_poll_slot_t *sl, unsigned char *data, unsigned char len)
+  {
+  unsigned char k;
+
+  for (k=0; (k<len) && (sl->ml_offset < vehicle_poll_bufsize); k++)
+    vehicle_poll_buffer[sl->ml_offset++] = data[k];
+  }
+
+// A response is complete: close a directed session. A broadcast session
+// (0x7df) stays open for the other ECUs' responses until it times out.
+void vehicle_poll_done(vehicle_poll_slot_t *sl)
+  {
+  if (sl->moduleid_low == sl->moduleid_high)
+    sl->wait = 0;
+  }
+
+// Match a poll response to its session, reassemble multi frame responses.
+// The session state is loaded into vehicle_poll_moduleid_send, _type, _pid
+// and _ml_* for the vehicle poll handler.
 BOOL vehicle_poll_poll0(void)
   {
   unsigned char k;
+  vehicle_poll_slot_t *sl;
 
-  switch (vehicle_poll_type)
+  for (k=0, sl=vehicle_poll_slot; k<VEHICLE_POLL_SLOTS; k++, sl++)
+    {
+    if ((sl->wait > 0)&&(can_id >= sl->moduleid_low)&&(can_id <= sl->moduleid_high))
+      break;
+    }
+  if (k == VEHICLE_POLL_SLOTS)
+    return FALSE; // No open session for this response ID
+
+  vehicle_poll_moduleid_send = sl->moduleid_send;
+  vehicle_poll_type = sl->type;
+  vehicle_poll_pid = sl->pid;
+
+  switch (sl->type)
     {
     case VEHICLE_POLL_TYPE_OBDIICURRENT:
     case VEHICLE_POLL_TYPE_OBDIIFREEZE:
     case VEHICLE_POLL_TYPE_OBDIISESSION:
       // 8 bit PID single frame response:
-      if ((can_databuffer[1] == 0x40+vehicle_poll_type)&&
-          (can_databuffer[2] == vehicle_poll_pid))
+      if ((can_databuffer[1] == 0x40+sl->type)&&
+          (can_databuffer[2] == sl->pid))
+        {
+        vehicle_poll_done(sl); // Response complete
         return TRUE; // Call vehicle poller
+        }
       break;
     case VEHICLE_POLL_TYPE_OBDIIVEHICLE:
     case VEHICLE_POLL_TYPE_OBDIIGROUP:
       // 8 bit PID multiple frame response:
       if (((can_databuffer[0]>>4) == 0x1)&&
-          (can_databuffer[2] == 0x40+vehicle_poll_type)&&
-          (can_databuffer[3] == vehicle_poll_pid))
+          (can_databuffer[2] == 0x40+sl->type)&&
+          (can_databuffer[3] == sl->pid))
         {
         // First frame; send flow control frame:
-        
-        while ((TXB0CON & 0b00111000) == 0b00001000) {} // wait for TX done / error
-        TXB0CON = 0; // init new TX / abort TX error
-        while (TXB0CONbits.TXREQ) {} // wait for TX clear
-        
-        if (vehicle_poll_moduleid_send == 0x7df)
-          {
-          // broadcast request: derive module ID from response ID:
-          // (Note: this only works for the SAE standard ID scheme)
-          TXB0SIDL = ((can_id-8) & 0x07) << 5;
-          TXB0SIDH = ((can_id-8) >> 3);
-          }
-        else
+        vehicle_poll_flowcontrol(sl);
+        sl->ml_frame = 0;
+        sl->wait = VEHICLE_POLL_TIMEOUT; // restart timeout for the consecutive frames
+
+        if (sl->flowctl & VEHICLE_POLL_FC_BUFFER)
           {
-          // use known module ID:
-          TXB0SIDL = (vehicle_poll_moduleid_send & 0x07) << 5;
-          TXB0SIDH = (vehicle_poll_moduleid_send >> 3);
+          // collect the data following SID & PID, call handler when complete:
+          sl->ml_remain = (((unsigned int)(can_databuffer[0]&0x0f))<<8)+can_databuffer[1] - 6;
+          sl->ml_offset = 0;
+          vehicle_poll_bufcopy(sl, &can_databuffer[4], 4);
+          return FALSE;
           }
-        
-        TXB0D0 = 0x30; // flow control frame type
-        TXB0D1 = 0x00; // request all frames available
-        TXB0D2 = 0x32; // with 50ms send interval
-        TXB0D3 = 0x00;
-        TXB0D4 = 0x00;
-        TXB0D5 = 0x00;
-        TXB0D6 = 0x00;
-        TXB0D7 = 0x00;
-        TXB0DLC = 0b00001000; // data length (8)
-        TXB0CON = 0b00001000; // mark for transmission
-        
+
         // prepare frame processing, first frame contains first 3 bytes:
-        vehicle_poll_ml_remain = (((unsigned int)(can_databuffer[0]&0xf0))<<8)+can_databuffer[1] - 3;
-        vehicle_poll_ml_offset = 3;
-        vehicle_poll_ml_frame = 0;
+        sl->ml_remain = (((unsigned int)(can_databuffer[0]&0x0f))<<8)+can_databuffer[1] - 3;
+        sl->ml_offset = 3;
         can_datalength = 3;
         can_databuffer[0] = can_databuffer[5];
         can_databuffer[1] = can_databuffer[6];
         can_databuffer[2] = can_databuffer[7];
+        vehicle_poll_ml_remain = sl->ml_remain;
+        vehicle_poll_ml_offset = sl->ml_offset;
+        vehicle_poll_ml_frame = sl->ml_frame;
         return TRUE; // Call vehicle poller
         }
-      else if (((can_databuffer[0]>>4)==0x2)&&(vehicle_poll_ml_remain>0))
+      else if (((can_databuffer[0]>>4)==0x2)&&(sl->ml_remain>0))
         {
         // Consecutive frame (1 control + 7 data bytes)
         for (k=0;k<7;k++) { can_databuffer[k] = can_databuffer[k+1]; }
-        if (vehicle_poll_ml_remain>7)
+        can_datalength = (sl->ml_remain>7) ? 7 : sl->ml_remain;
+        sl->ml_remain -= can_datalength;
+        sl->ml_frame++;
+        if (sl->ml_remain > 0)
           {
-          vehicle_poll_ml_remain -= 7;
-          vehicle_poll_ml_offset += 7;
-          can_datalength = 7;
+          sl->wait = VEHICLE_POLL_TIMEOUT;
+          if ((sl->bscount > 0) && (--sl->bscount == 0))
+            vehicle_poll_flowcontrol(sl); // next block
           }
         else
+          vehicle_poll_done(sl); // Response complete
+
+        if (sl->flowctl & VEHICLE_POLL_FC_BUFFER)
           {
-          can_datalength = vehicle_poll_ml_remain;
-          vehicle_poll_ml_offset += vehicle_poll_ml_remain;
-          vehicle_poll_ml_remain = 0;
+          vehicle_poll_bufcopy(sl, can_databuffer, can_datalength);
+          if (sl->ml_remain > 0)
+            return FALSE;
+          can_datalength = 0; // data is in vehicle_poll_buffer
           }
-        vehicle_poll_ml_frame++;
+        else
+          sl->ml_offset += can_datalength;
+
+        vehicle_poll_ml_remain = sl->ml_remain;
+        vehicle_poll_ml_offset = sl->ml_offset;
+        vehicle_poll_ml_frame = sl->ml_frame;
         return TRUE;
         }
       break;
     case VEHICLE_POLL_TYPE_OBDIIEXTENDED:
       // 16 bit PID response:
       if ((can_databuffer[1] == 0x62)&&
-          ((can_databuffer[3]+(((unsigned int) can_databuffer[2]) << 8)) == vehicle_poll_pid))
+          ((can_databuffer[3]+(((unsigned int) can_databuffer[2]) << 8)) == sl->pid))
+        {
+        vehicle_poll_done(sl); // Response complete
         return TRUE; // Call vehicle poller
+        }
       break;
     }
 
@@ -294,6 +623,656 @@ BOOL vehicle_poll_poll0(void)
 
 #endif //#ifdef OVMS_POLLER
 
+////////////////////////////////////////////////////////////////////////
+// CAN transmit queue
+// vehicle_cantx() may be called from the main loop and from the poll
+// handlers (ISR), it works with CAN interrupts disabled. The TX buffer
+// state is kept in vehicle_cantx_prio[] (priority of the pending frame),
+// the TX complete interrupt of a buffer is enabled while it is pending.
+//
+
+void vehicle_cantx_setbuffers(unsigned char mask)
+  {
+  unsigned char savint;
+
+  savint = INTCON; // Save interrupts state
+  INTCONbits.GIEH = 0; // Disable CAN interrupts
+  vehicle_cantx_mask = mask & 0x07;
+  INTCON = savint; // Restore interrupts
+  }
+
+// Number of frames queued or pending in a TX buffer
+unsigned char vehicle_cantx_pending(void)
+  {
+  unsigned char k, n = 0;
+
+  for (k=0; k<VEHICLE_CANTX_SIZE; k++)
+    {
+    if (vehicle_cantx_queue[k].prio != VEHICLE_CANTX_FREE)
+      n++;
+    }
+  for (k=0; k<3; k++)
+    {
+    if (vehicle_cantx_prio[k] != VEHICLE_CANTX_FREE)
+      n++;
+    }
+  return n;
+  }
+
+// ISR optimization, see http://www.xargs.com/pic/c18-isr-optim.pdf
+#ifdef OVMS_CAN_DEFERRED
+#pragma tmpdata high_isr_ring_tmpdata
+#else
+#pragma tmpdata high_isr_tmpdata
+#endif // OVMS_CAN_DEFERRED
+
+#define VEHICLE_CANTX_LOAD(n,e) \
+  { \
+  TXB##n##CON = 0; \
+  TXB##n##SIDL = ((e)->id & 0x07) << 5; \
+  TXB##n##SIDH = ((e)->id >> 3); \
+  TXB##n##D0 = (e)->data[0]; \
+  TXB##n##D1 = (e)->data[1]; \
+  TXB##n##D2 = (e)->data[2]; \
+  TXB##n##D3 = (e)->data[3]; \
+  TXB##n##D4 = (e)->data[4]; \
+  TXB##n##D5 = (e)->data[5]; \
+  TXB##n##D6 = (e)->data[6]; \
+  TXB##n##D7 = (e)->data[7]; \
+  TXB##n##DLC = (e)->dlc; \
+  PIR3bits.TXB##n##IF = 0; \
+  PIE3bits.TXB##n##IE = 1; \
+  TXB##n##CON = 0b00001000 | (e)->prio; /* mark for transmission */ \
+  }
+
+// Load idle TX buffers with the next frames (CAN interrupts disabled)
+void vehicle_cantx_load(void)
+  {
+  unsigned char n, k, busy;
+  vehicle_cantx_t *e, *best;
+
+  for (n=0; n<3; n++)
+    {
+    if (((vehicle_cantx_mask & (1<<n)) == 0) || (vehicle_cantx_prio[n] != VEHICLE_CANTX_FREE))
+      continue;
+
+    // Highest priority not pending yet, oldest first:
+    busy = 0;
+    for (k=0; k<3; k++)
+      {
+      if (vehicle_cantx_prio[k] != VEHICLE_CANTX_FREE)
+        busy |= (1 << vehicle_cantx_prio[k]);
+      }
+    best = NULL;
+    for (k=0, e=vehicle_cantx_queue; k<VEHICLE_CANTX_SIZE; k++, e++)
+      {
+      if ((e->prio == VEHICLE_CANTX_FREE) || (busy & (1 << e->prio)))
+        continue;
+      if ((best == NULL) || (e->prio > best->prio) ||
+          ((e->prio == best->prio) && ((signed char)(e->seq - best->seq) < 0)))
+        best = e;
+      }
+    if (best == NULL)
+      return;
+
+    switch (n)
+      {
+      case 0: VEHICLE_CANTX_LOAD(0, best); break;
+      case 1: VEHICLE_CANTX_LOAD(1, best); break;
+      case 2: VEHICLE_CANTX_LOAD(2, best); break;
+      }
+    vehicle_cantx_prio[n] = best->prio;
+    vehicle_cantx_age[n] = 0;
+    best->prio = VEHICLE_CANTX_FREE;
+    }
+  }
+
+// TX complete interrupt: free the buffers sent, load the next frames
+void vehicle_cantx_isr(void)
+  {
+  if (PIR3bits.TXB0IF && PIE3bits.TXB0IE)
+    {
+    PIR3bits.TXB0IF = 0;
+    PIE3bits.TXB0IE = 0;
+    vehicle_cantx_prio[0] = VEHICLE_CANTX_FREE;
+    vehicle_cantx_sent++;
+    }
+  if (PIR3bits.TXB1IF && PIE3bits.TXB1IE)
+    {
+    PIR3bits.TXB1IF = 0;
+    PIE3bits.TXB1IE = 0;
+    vehicle_cantx_prio[1] = VEHICLE_CANTX_FREE;
+    vehicle_cantx_sent++;
+    }
+  if (PIR3bits.TXB2IF && PIE3bits.TXB2IE)
+    {
+    PIR3bits.TXB2IF = 0;
+    PIE3bits.TXB2IE = 0;
+    vehicle_cantx_prio[2] = VEHICLE_CANTX_FREE;
+    vehicle_cantx_sent++;
+    }
+  vehicle_cantx_load();
+  }
+
+// ISR optimization, see http://www.xargs.com/pic/c18-isr-optim.pdf
+#pragma tmpdata high_isr_tmpdata
+
+// Queue a CAN frame for transmission, FALSE if the queue is full
+BOOL vehicle_cantx(unsigned int id, unsigned char prio, unsigned char dlc, unsigned char *data)
+  {
+  unsigned char k, n, savint;
+  vehicle_cantx_t *e, *fe;
+
+  savint = INTCON; // Save interrupts state
+  INTCONbits.GIEH = 0; // Disable CAN interrupts
+
+  fe = NULL;
+  n = 0;
+  for (k=0, e=vehicle_cantx_queue; k<VEHICLE_CANTX_SIZE; k++, e++)
+    {
+    if (e->prio == VEHICLE_CANTX_FREE)
+      fe = e;
+    else
+      n++;
+    }
+  if (fe == NULL)
+    {
+    vehicle_cantx_drops++;
+    INTCON = savint; // Restore interrupts
+    return FALSE;
+    }
+  if (n >= vehicle_cantx_peak)
+    vehicle_cantx_peak = n + 1;
+
+  fe->id = id;
+  fe->dlc = dlc & 0x0f;
+  for (k=0; k<8; k++)
+    fe->data[k] = (k < dlc) ? data[k] : 0;
+  fe->seq = vehicle_cantx_seq++;
+  fe->prio = prio & 0x03;
+  vehicle_cantx_load();
+
+  INTCON = savint; // Restore interrupts
+  return TRUE;
+  }
+
+#pragma tmpdata
+
+// Called by vehicle_ticker(): abort frames pending for too long
+void vehicle_cantx_ticker(void)
+  {
+  unsigned char n, savint, abort = 0;
+
+  savint = INTCON; // Save interrupts state
+  INTCONbits.GIEH = 0; // Disable CAN interrupts
+  for (n=0; n<3; n++)
+    {
+    if ((vehicle_cantx_prio[n] == VEHICLE_CANTX_FREE) ||
+        (++vehicle_cantx_age[n] <= VEHICLE_CANTX_TIMEOUT))
+      continue;
+    switch (n)
+      {
+      case 0: TXB0CONbits.TXREQ = 0; PIE3bits.TXB0IE = 0; break;
+      case 1: TXB1CONbits.TXREQ = 0; PIE3bits.TXB1IE = 0; break;
+      case 2: TXB2CONbits.TXREQ = 0; PIE3bits.TXB2IE = 0; break;
+      }
+    vehicle_cantx_prio[n] = VEHICLE_CANTX_FREE;
+    vehicle_cantx_errors++;
+    abort = 1;
+    }
+  if (abort)
+    vehicle_cantx_load();
+  INTCON = savint; // Restore interrupts
+  }
+
+#ifdef OVMS_ISR_PROFILE
+
+////////////////////////////////////////////////////////////////////////
+// CAN ISR profiling
+// TMR3 is started by VEHICLE_ISRPROF_START() before reading an RX buffer,
+// vehicle_isrprof_record() is called from the ISR after the poll handler
+// returned and accounts the cycles to can_id.
+//
+
+void vehicle_isrprof_reset(void)
+  {
+  T3CON = 0b10000001; // 16 bit R/W, 1:1 from Fosc/4, on
+  memset(vehicle_isrprof, 0, sizeof(vehicle_isrprof));
+  vehicle_isrprof_lost = 0;
+  }
+
+// ISR optimization, see http://www.xargs.com/pic/c18-isr-optim.pdf
+#pragma tmpdata high_isr_tmpdata
+
+void vehicle_isrprof_record(void)
+  {
+  unsigned int cycles;
+  unsigned char k;
+  vehicle_isrprof_t *p;
+
+  cycles = TMR3L; // reading TMR3L latches TMR3H
+  cycles |= (unsigned int)TMR3H << 8;
+
+  for (k=0; k<VEHICLE_ISRPROF_IDS; k++)
+    {
+    p = &vehicle_isrprof[k];
+    if (p->count == 0)
+      {
+      p->id = can_id; // new slot
+      p->min = 0xffff;
+      }
+    else if (p->id != can_id)
+      continue;
+    if (p->count == 0xffff)
+      return; // saturated
+    p->count++;
+    p->sum += cycles;
+    if (cycles < p->min) p->min = cycles;
+    if (cycles > p->max) p->max = cycles;
+    return;
+    }
+  vehicle_isrprof_lost++;
+  }
+
+#pragma tmpdata
+
+#endif // OVMS_ISR_PROFILE
+
+#ifdef OVMS_CAN_STATS
+
+////////////////////////////////////////////////////////////////////////
+// CAN bus statistics
+// vehicle_canstats_record() is called by the ISR for every frame taken
+// from an RX buffer, vehicle_canstats_ticker() once per second by
+// vehicle_ticker() to derive the bus load and sample the error state.
+//
+
+void vehicle_canstats_reset(void)
+  {
+  unsigned char k, savint;
+
+  savint = INTCON; // Save interrupts state
+  INTCONbits.GIEH = 0; // Disable CAN interrupts
+  for (k=0; k<VEHICLE_CANSTATS_SIZE; k++)
+    vehicle_canstats_id[k] = VEHICLE_CANSTATS_FREE;
+  memset(vehicle_canstats, 0, sizeof(vehicle_canstats));
+  memset(&vehicle_canbus, 0, sizeof(vehicle_canbus));
+  vehicle_canbus_bits = 0;
+  INTCON = savint; // Restore interrupts
+  }
+
+void vehicle_canstats_ticker(void)
+  {
+  static unsigned char busoff = 0;
+  unsigned char k, savint;
+  unsigned long bits;
+  unsigned int tq, load;
+
+  // Bit time in Tq from BRGCON1..3, Tq = 2*(BRP+1)/Fosc at 20 MHz:
+  tq = 1 + ((BRGCON2 & 0x07)+1) + (((BRGCON2>>3) & 0x07)+1) + ((BRGCON3 & 0x07)+1);
+  vehicle_canbus_bitrate = 10000000UL / ((unsigned long)((BRGCON1 & 0x3f)+1) * tq);
+
+  savint = INTCON; // Save interrupts state
+  INTCONbits.GIEH = 0; // Disable CAN interrupts
+  bits = vehicle_canbus_bits;
+  vehicle_canbus_bits = 0;
+  for (k=0; k<VEHICLE_CANSTATS_SIZE; k++)
+    {
+    if (vehicle_canstats[k].idle < 255)
+      vehicle_canstats[k].idle++;
+    }
+  INTCON = savint; // Restore interrupts
+
+  // Bus load in 0.1%, with ~10% bit stuffing:
+  bits += bits / 10;
+  load = (bits * 1000) / vehicle_canbus_bitrate;
+  vehicle_canbus.load = load;
+  vehicle_canbus.loadsum += load;
+  vehicle_canbus.seconds++;
+  if (load > vehicle_canbus.loadpeak)
+    {
+    vehicle_canbus.loadpeak = load;
+    vehicle_canbus.loadpeaktime = car_time;
+    }
+
+  // Error counters & bus off events:
+  if (TXERRCNT > vehicle_canbus.txerrmax)
+    vehicle_canbus.txerrmax = TXERRCNT;
+  if (RXERRCNT > vehicle_canbus.rxerrmax)
+    vehicle_canbus.rxerrmax = RXERRCNT;
+  if (COMSTATbits.TXBO)
+    {
+    if (!busoff)
+      vehicle_canbus.busoff++;
+    busoff = 1;
+    }
+  else
+    busoff = 0;
+  }
+
+// ISR optimization, see http://www.xargs.com/pic/c18-isr-optim.pdf
+#ifdef OVMS_CAN_DEFERRED
+#pragma tmpdata high_isr_ring_tmpdata
+#else
+#pragma tmpdata high_isr_tmpdata
+#endif // OVMS_CAN_DEFERRED
+
+void vehicle_canstats_record(unsigned int id, unsigned char dlc, unsigned char *data)
+  {
+  unsigned char k, n, hash, t;
+  unsigned int now, gap;
+  vehicle_canstats_t *p;
+
+  if (dlc > 8)
+    dlc = 8;
+  vehicle_canbus_bits += 47 + (dlc << 3); // standard data frame
+
+  // RXBnOVFL: a frame was lost while the buffer was full
+  if (COMSTATbits.RXB0OVFL)
+    {
+    COMSTATbits.RXB0OVFL = 0;
+    if (vehicle_canbus.ovfl0 != 0xffff)
+      vehicle_canbus.ovfl0++;
+    }
+  if (COMSTATbits.RXB1OVFL)
+    {
+    COMSTATbits.RXB1OVFL = 0;
+    if (vehicle_canbus.ovfl1 != 0xffff)
+      vehicle_canbus.ovfl1++;
+    }
+
+  // Find the slot, linear probing:
+  k = (id ^ (id >> 4) ^ (id >> 8)) & (VEHICLE_CANSTATS_SIZE-1);
+  for (n=VEHICLE_CANSTATS_SIZE; n>0; n--)
+    {
+    if (vehicle_canstats_id[k] == id)
+      break;
+    if (vehicle_canstats_id[k] == VEHICLE_CANSTATS_FREE)
+      {
+      vehicle_canstats_id[k] = id; // new slot
+      break;
+      }
+    k = (k+1) & (VEHICLE_CANSTATS_SIZE-1);
+    }
+  if (n == 0)
+    {
+    if (vehicle_canbus.lost != 0xffff)
+      vehicle_canbus.lost++;
+    return;
+    }
+  p = &vehicle_canstats[k];
+
+  // Arrival time in 409.6 us units: TMR1H extended by the overflows
+  // counted by led_isr(), plus a pending overflow not yet counted.
+  t = TMR1L; // reading TMR1L latches TMR1H
+  t = TMR1H;
+  now = ((unsigned int)led_tmr1cnt << 8) | t;
+  if (PIR1bits.TMR1IF && !(t & 0x80))
+    now += 0x100;
+
+  // Payload hash (8 bit, so one in 256 changes goes unnoticed):
+  hash = dlc;
+  for (n=0; n<dlc; n++)
+    hash = ((hash << 1) | (hash >> 7)) ^ data[n];
+
+  if (p->count == 0)
+    {
+    p->gapmin = 0xffff;
+    }
+  else
+    {
+    gap = (p->idle >= 25) ? 0xffff : ((now - p->last) & 0xffff);
+    if (gap < p->gapmin) p->gapmin = gap;
+    if (gap > p->gapmax) p->gapmax = gap;
+    if ((hash != p->hash) && (p->changed != 0xffff))
+      p->changed++;
+    }
+  if (p->count != 0xffff)
+    p->count++;
+  p->bytes += dlc;
+  p->last = now;
+  p->hash = hash;
+  p->idle = 0;
+  }
+
+#pragma tmpdata
+
+#endif // OVMS_CAN_STATS
+
+#ifdef OVMS_CAN_SUPPRESS
+
+////////////////////////////////////////////////////////////////////////
+// Payload change suppression
+// vehicle_cansupp_repeat() is called before a frame is passed to the
+// poll handler, in the ISR or (OVMS_CAN_DEFERRED) the main loop.
+//
+
+// Enable suppression for the module's CAN IDs, NULL disables:
+void vehicle_can_suppress(rom vehicle_cansupp_t *list)
+  {
+  unsigned char k, savint;
+
+  savint = INTCON; // Save interrupts state
+  INTCONbits.GIEH = 0; // Disable CAN interrupts
+  for (k=0; k<VEHICLE_CANSUPP_SIZE; k++)
+    vehicle_cansupp[k].id = VEHICLE_CANSUPP_FREE;
+  vehicle_cansupp_list = list;
+  vehicle_cansupp_frames = 0;
+  vehicle_cansupp_skips = 0;
+  INTCON = savint; // Restore interrupts
+  }
+
+void vehicle_cansupp_ticker(void)
+  {
+  unsigned char k, savint;
+
+  savint = INTCON; // Save interrupts state
+  INTCONbits.GIEH = 0; // Disable CAN interrupts
+  for (k=0; k<VEHICLE_CANSUPP_SIZE; k++)
+    {
+    if (vehicle_cansupp[k].age < 255)
+      vehicle_cansupp[k].age++;
+    }
+  INTCON = savint; // Restore interrupts
+  }
+
+// ISR optimization, see http://www.xargs.com/pic/c18-isr-optim.pdf
+#pragma tmpdata high_isr_tmpdata
+
+// TRUE if the frame in can_databuffer repeats the last payload of its
+// ID (and mux) within the refresh time, FALSE if it is to be delivered
+BOOL vehicle_cansupp_repeat(void)
+  {
+  rom vehicle_cansupp_t *l;
+  vehicle_cansupp_slot_t *p;
+  unsigned char k, n, mux, s1, s2;
+
+  vehicle_cansupp_frames++;
+
+  mux = 0;
+  for (l=vehicle_cansupp_list; l->id != 0; l++)
+    {
+    if (l->id == can_id)
+      {
+      if (l->mode == VEHICLE_CANSUPP_ALWAYS)
+        return FALSE;
+      if (l->mode == VEHICLE_CANSUPP_MUX)
+        mux = can_databuffer[0];
+      break;
+      }
+    }
+
+  // Find the slot, linear probing:
+  k = (can_id ^ (can_id >> 5) ^ mux) & (VEHICLE_CANSUPP_SIZE-1);
+  for (n=VEHICLE_CANSUPP_SIZE; n>0; n--)
+    {
+    p = &vehicle_cansupp[k];
+    if ((p->id == can_id) && (p->mux == mux))
+      break;
+    if (p->id == VEHICLE_CANSUPP_FREE)
+      {
+      p->id = can_id; // new slot
+      p->mux = mux;
+      p->age = VEHICLE_CANSUPP_REFRESH; // deliver
+      break;
+      }
+    k = (k+1) & (VEHICLE_CANSUPP_SIZE-1);
+    }
+  if (n == 0)
+    return FALSE; // table full
+
+  // Fletcher style payload hash, sensitive to byte order:
+  s1 = can_datalength;
+  s2 = s1;
+  for (n=0; (n<can_datalength) && (n<8); n++)
+    {
+    s1 += can_databuffer[n];
+    s2 += s1;
+    }
+
+  if ((p->age < VEHICLE_CANSUPP_REFRESH) &&
+      (p->hash == (((unsigned int)s2 << 8) | s1)))
+    {
+    vehicle_cansupp_skips++;
+    return TRUE;
+    }
+
+  p->hash = ((unsigned int)s2 << 8) | s1;
+  p->age = 0;
+  return FALSE;
+  }
+
+#pragma tmpdata
+
+#endif // OVMS_CAN_SUPPRESS
+
+#ifdef OVMS_CAN_DEFERRED
+
+////////////////////////////////////////////////////////////////////////
+// Deferred CAN decoding
+// The ISR side only copies the RX buffer into the ring. The poll handlers
+// are called from the main loop, so they now share high_isr_tmpdata with
+// the main context only; the ISR side uses its own tmpdata section.
+//
+
+// ISR optimization, see http://www.xargs.com/pic/c18-isr-optim.pdf
+#pragma tmpdata high_isr_ring_tmpdata
+
+// Queue the frame in RX buffer 0/1 and release the buffer
+void vehicle_canring_push(unsigned char buffer)
+  {
+  volatile near unsigned char *rxb;
+  vehicle_canframe_t *f;
+  unsigned char next, k;
+
+  // RXB0 and RXB1 share the same register layout (CON, SIDH, SIDL,
+  // EIDH, EIDL, DLC, D0..D7):
+  rxb = (buffer) ? &RXB1CON : &RXB0CON;
+
+  next = (vehicle_canring_head + 1) & (VEHICLE_CANRING_SIZE-1);
+  if (next == vehicle_canring_tail)
+    {
+    // Ring full, drop the frame:
+    if (vehicle_canring_drops != 0xffff)
+      vehicle_canring_drops++;
+    }
+  else
+    {
+    f = &vehicle_canring[vehicle_canring_head];
+    f->time = TMR1L; // reading TMR1L latches TMR1H
+    f->time |= (unsigned int)TMR1H << 8;
+    f->id = ((unsigned int)rxb[2] >>5) + ((unsigned int)rxb[1] <<3);
+    f->buffer = buffer;
+    f->filter = rxb[0] & ((buffer) ? 0x07 : 0x01);
+    f->dlc = rxb[5] & 0x0F;
+    for (k=0; k<8; k++)
+      f->data[k] = rxb[6+k];
+    VEHICLE_CANSTATS_RECORD(f->id, f->dlc, f->data);
+    vehicle_canring_head = next; // publish
+
+    k = (next - vehicle_canring_tail) & (VEHICLE_CANRING_SIZE-1);
+    if (k > vehicle_canring_peak)
+      vehicle_canring_peak = k;
+    }
+
+  rxb[0] &= ~0x80; // RXFUL: buffer free
+  if (buffer)
+    PIR3bits.RXB1IF = 0;
+  else
+    PIR3bits.RXB0IF = 0;
+  }
+
+#pragma tmpdata
+
+// Main loop side: feed queued frames to the poll handlers, same
+// dispatch as high_isr() in direct mode. Called by vehicle_idlepoll()
+// and the delay loops (utils.c). Handles at most one ring length per
+// call to keep the main loop going under bus load.
+void vehicle_canring_dispatch(void)
+  {
+  static unsigned char active = 0;
+  vehicle_canframe_t *f;
+  unsigned char n, buffer;
+
+  if (active)
+    return; // a poll handler is waiting in a delay loop
+  active = 1;
+
+  for (n=VEHICLE_CANRING_SIZE; (n>0) && (vehicle_canring_tail != vehicle_canring_head); n--)
+    {
+    f = &vehicle_canring[vehicle_canring_tail];
+    can_id = f->id;
+    can_filter = f->filter;
+    can_datalength = f->dlc;
+    memcpy((void*)can_databuffer, (void*)f->data, 8);
+    can_time = f->time;
+    buffer = f->buffer;
+    vehicle_canring_tail = (vehicle_canring_tail + 1) & (VEHICLE_CANRING_SIZE-1);
+
+    if (buffer == 0)
+      {
+      if (vehicle_fn_poll0 == NULL)
+        continue;
+#ifdef OVMS_POLLER
+      if (vehicle_poll_plist != NULL)
+        {
+        if ((can_id >= vehicle_poll_moduleid_low)&&
+            (can_id <= vehicle_poll_moduleid_high))
+          {
+          if (vehicle_poll_poll0())
+            {
+            vehicle_fn_poll0();
+            }
+          }
+        }
+      else
+        {
+        if (!VEHICLE_CANSUPP_REPEAT())
+          vehicle_fn_poll0();
+        }
+#else // #ifdef OVMS_POLLER
+      if (!VEHICLE_CANSUPP_REPEAT())
+        vehicle_fn_poll0();
+#endif //#ifdef OVMS_POLLER
+      }
+    else
+      {
+      if (vehicle_fn_poll1 == NULL)
+        continue;
+#ifdef OVMS_POLLER
+      vehicle_poll_busactive = 60; // Reset countdown timer for passive bus activity
+#endif //#ifdef OVMS_POLLER
+      if (!VEHICLE_CANSUPP_REPEAT())
+        vehicle_fn_poll1();
+      }
+    VEHICLE_POLL_COST();
+    }
+
+  active = 0;
+  }
+
+#endif // OVMS_CAN_DEFERRED
+
 ////////////////////////////////////////////////////////////////////////
 // CAN Interrupt Service Routine (High Priority)
 //
@@ -304,27 +1283,49 @@ BOOL vehicle_poll_poll0(void)
 
 void high_isr(void);
 
+#ifndef OVMS_HOST
 #pragma code can_int_service = 0x08
 void can_int_service(void)
   {
   _asm goto high_isr _endasm
   }
+#endif // OVMS_HOST
 
 #pragma code
 // ISR optimization, see http://www.xargs.com/pic/c18-isr-optim.pdf
+#ifdef OVMS_CAN_DEFERRED
+#pragma tmpdata high_isr_ring_tmpdata
+#else
 #pragma tmpdata high_isr_tmpdata
+#endif // OVMS_CAN_DEFERRED
 #pragma	interrupt high_isr nosave=section(".tmpdata")
 void high_isr(void)
   {
   // High priority CAN interrupt
+  if (PIR3 & 0b00000011)
+    can_rxflag = 1; // Bus activity for can_quiet
+
   do
     {
     
+    // TX complete:
+    if (PIR3 & PIE3 & 0b00011100)
+      vehicle_cantx_isr();
+
+#ifdef OVMS_CAN_DEFERRED
+    // Queue frames for vehicle_idlepoll():
+    if (RXB0CONbits.RXFUL)
+      vehicle_canring_push(0);
+    if (RXB1CONbits.RXFUL)
+      vehicle_canring_push(1);
+#else // OVMS_CAN_DEFERRED
+
     // Check RX buffer 0:
     if (RXB0CONbits.RXFUL)
       {
       if (vehicle_fn_poll0 != NULL)
         {
+        VEHICLE_ISRPROF_START();
         can_id = ((unsigned int)RXB0SIDL >>5)
                + ((unsigned int)RXB0SIDH <<3);
         can_filter = RXB0CON & 0x01;
@@ -353,11 +1354,16 @@ void high_isr(void)
           }
         else
           {
-          vehicle_fn_poll0();
+          if (!VEHICLE_CANSUPP_REPEAT())
+            vehicle_fn_poll0();
           }
 #else // #ifdef OVMS_POLLER
-        vehicle_fn_poll0();
+        if (!VEHICLE_CANSUPP_REPEAT())
+          vehicle_fn_poll0();
 #endif //#ifdef OVMS_POLLER
+        VEHICLE_ISRPROF_STOP();
+        VEHICLE_POLL_COST();
+        VEHICLE_CANSTATS_RECORD(can_id, can_datalength, can_databuffer);
         }
       else
         {
@@ -372,6 +1378,7 @@ void high_isr(void)
       {
       if (vehicle_fn_poll1 != NULL)
         {
+        VEHICLE_ISRPROF_START();
 #ifdef OVMS_POLLER
         vehicle_poll_busactive = 60; // Reset countdown timer for passive bus activity
 #endif //#ifdef OVMS_POLLER
@@ -389,7 +1396,11 @@ void high_isr(void)
         can_databuffer[7] = RXB1D7;
         RXB1CONbits.RXFUL = 0;        // All bytes read, Clear flag
         PIR3bits.RXB1IF = 0;          // reset interrupt flag
-        vehicle_fn_poll1();
+        if (!VEHICLE_CANSUPP_REPEAT())
+          vehicle_fn_poll1();
+        VEHICLE_ISRPROF_STOP();
+        VEHICLE_POLL_COST();
+        VEHICLE_CANSTATS_RECORD(can_id, can_datalength, can_databuffer);
         }
       else
         {
@@ -398,6 +1409,7 @@ void high_isr(void)
         PIR3bits.RXB1IF = 0;   // reset interrupt flag
         }
       }
+#endif // OVMS_CAN_DEFERRED
     
     } while (PIR3bits.RXB0IF || PIR3bits.RXB1IF);
   
@@ -406,6 +1418,24 @@ void high_isr(void)
 
 #endif // OVMS_CUSTOM_CAN_ISR
 
+////////////////////////////////////////////////////////////////////////
+// vehicle_can_setfilters()
+// Program the RX acceptance masks & filters for standard IDs. The CAN
+// module must be in configuration mode.
+//
+void vehicle_can_setfilters(rom vehicle_canfilter_t *f)
+  {
+  RXM0SIDH = f->mask0 >> 3;       RXM0SIDL = (f->mask0 & 0x07) << 5;
+  RXF0SIDH = f->filter0[0] >> 3;  RXF0SIDL = (f->filter0[0] & 0x07) << 5;
+  RXF1SIDH = f->filter0[1] >> 3;  RXF1SIDL = (f->filter0[1] & 0x07) << 5;
+
+  RXM1SIDH = f->mask1 >> 3;       RXM1SIDL = (f->mask1 & 0x07) << 5;
+  RXF2SIDH = f->filter1[0] >> 3;  RXF2SIDL = (f->filter1[0] & 0x07) << 5;
+  RXF3SIDH = f->filter1[1] >> 3;  RXF3SIDL = (f->filter1[1] & 0x07) << 5;
+  RXF4SIDH = f->filter1[2] >> 3;  RXF4SIDL = (f->filter1[2] & 0x07) << 5;
+  RXF5SIDH = f->filter1[3] >> 3;  RXF5SIDL = (f->filter1[3] & 0x07) << 5;
+  }
+
 ////////////////////////////////////////////////////////////////////////
 // vehicle_initialise()
 // This function is an entry point from the main() program loop, and
@@ -414,22 +1444,34 @@ void high_isr(void)
 void vehicle_initialise(void)
   {
   char *p;
+  unsigned char k;
 
   can_granular_tick = 0;
   can_minSOCnotified = 0;
   can_capabilities = NULL;
 
+  for (k=0; k<VEHICLE_CANTX_SIZE; k++)
+    vehicle_cantx_queue[k].prio = VEHICLE_CANTX_FREE;
+  for (k=0; k<3; k++)
+    vehicle_cantx_prio[k] = VEHICLE_CANTX_FREE;
+  vehicle_cantx_mask = 0x07; // TXB0..TXB2
+  vehicle_cantx_seq = 0;
+  vehicle_cantx_peak = 0;
+  vehicle_cantx_sent = 0;
+  vehicle_cantx_errors = 0;
+  vehicle_cantx_drops = 0;
+
 #ifdef OVMS_POLLER
   vehicle_poll_state = 0;
   vehicle_poll_plist = NULL;
   vehicle_poll_plcur = NULL;
   vehicle_poll_ticker = 0;
-  vehicle_poll_moduleid_low = 0;
-  vehicle_poll_moduleid_high = 0;
+  vehicle_poll_schedule();
   vehicle_poll_type = 0;
   vehicle_poll_pid = 0;
   vehicle_poll_busactive = 0;
   vehicle_fn_pollpid = NULL;
+  vehicle_poll_setbuffer(NULL, 0);
 #endif //#ifdef OVMS_POLLER
 
   vehicle_version = NULL;
@@ -449,6 +1491,24 @@ void vehicle_initialise(void)
   vehicle_fn_smsextensions = NULL;
   vehicle_fn_minutestocharge = NULL;
 
+#ifdef OVMS_ISR_PROFILE
+  vehicle_isrprof_reset();
+#endif // OVMS_ISR_PROFILE
+
+#ifdef OVMS_CAN_STATS
+  vehicle_canstats_reset();
+#endif // OVMS_CAN_STATS
+
+#ifdef OVMS_CAN_SUPPRESS
+  vehicle_can_suppress(NULL);
+#endif // OVMS_CAN_SUPPRESS
+
+#ifdef OVMS_CAN_DEFERRED
+  vehicle_canring_tail = vehicle_canring_head; // discard queued frames
+  vehicle_canring_peak = 0;
+  vehicle_canring_drops = 0;
+#endif // OVMS_CAN_DEFERRED
+
   // Clear the internal GPS flag, unless specifically requested by the module
   net_fnbits &= ~(NET_FN_INTERNALGPS);
 
@@ -564,7 +1624,7 @@ void vehicle_initialise(void)
   RCONbits.IPEN = 1; // Enable Interrupt Priority
   PIE3bits.RXB1IE = 1; // CAN Receive Buffer 1 Interrupt Enable bit
   PIE3bits.RXB0IE = 1; // CAN Receive Buffer 0 Interrupt Enable bit
-  IPR3 = 0b00000011; // high priority interrupts for Buffers 0 and 1
+  IPR3 = 0b00011111; // high priority interrupts for RX Buffers 0 and 1, TX Buffers 0..2
   }
 
 ////////////////////////////////////////////////////////////////////////
@@ -573,13 +1633,25 @@ void vehicle_initialise(void)
 
 void vehicle_ticker(void)
   {
+  unsigned char savint;
+
   // This ticker is called once every second
   can_granular_tick++;
 
+  vehicle_cantx_ticker();
+
+  // Bus activity: seconds since the last received frame
+  if (can_rxflag)
+    {
+    can_rxflag = 0;
+    can_quiet = 0;
+    }
+  else if (can_quiet < 255)
+    can_quiet++;
+
 #ifdef OVMS_POLLER
   if ((vehicle_poll_busactive>0)&&(vehicle_poll_plist != NULL))
     {
-    vehicle_poll_poller();
     vehicle_poll_busactive--; // Count down...
     }
 #endif //#ifdef OVMS_POLLER
@@ -603,18 +1675,37 @@ void vehicle_ticker(void)
          >>> This bit must be cleared by the MCU. <<< !!!
    * ...to be sure we're clearing all relevant flags...
    */
+    savint = INTCON; // Save interrupts state
+    INTCONbits.GIEH = 0; // Disable CAN interrupts
     if( COMSTATbits.RXB0OVFL )
       {
+#ifdef OVMS_CAN_STATS
+      if (vehicle_canbus.ovfl0 != 0xffff)
+        vehicle_canbus.ovfl0++;
+#endif // OVMS_CAN_STATS
       RXB0CONbits.RXFUL = 0; // clear buffer full flag
       PIR3bits.RXB0IF = 0; // clear interrupt flag
       COMSTATbits.RXB0OVFL = 0; // clear buffer overflow bit
       }
     if( COMSTATbits.RXB1OVFL )
       {
+#ifdef OVMS_CAN_STATS
+      if (vehicle_canbus.ovfl1 != 0xffff)
+        vehicle_canbus.ovfl1++;
+#endif // OVMS_CAN_STATS
       RXB1CONbits.RXFUL = 0; // clear buffer full flag
       PIR3bits.RXB1IF = 0; // clear interrupt flag
       COMSTATbits.RXB1OVFL = 0; // clear buffer overflow bit
       }
+    INTCON = savint; // Restore interrupts
+
+#ifdef OVMS_CAN_STATS
+  vehicle_canstats_ticker();
+#endif // OVMS_CAN_STATS
+
+#ifdef OVMS_CAN_SUPPRESS
+  vehicle_cansupp_ticker();
+#endif // OVMS_CAN_SUPPRESS
 
   // Reset car stopped countdown when off or moving:
   if ((!car_doors3bits.CarAwake) || (car_speed > 0))
@@ -699,10 +1790,17 @@ void vehicle_ticker(void)
 
 void vehicle_ticker10th(void)
   {
+#ifdef OVMS_POLLER
+  if (vehicle_poll_plist != NULL)
+    vehicle_poll_poller();
+#endif //#ifdef OVMS_POLLER
   if (vehicle_fn_ticker10th != NULL) vehicle_fn_ticker10th();
   }
 
 void vehicle_idlepoll(void)
 {
+#ifdef OVMS_CAN_DEFERRED
+  vehicle_canring_dispatch();
+#endif // OVMS_CAN_DEFERRED
   if (vehicle_fn_idlepoll != NULL) vehicle_fn_idlepoll();
 }
@@ -56,6 +56,8 @@ extern unsigned char  can_minSOCnotified;        // minSOC notified flags
 #define CAN_MINSOC_ALERT_12V     2               // minSOC notify flag for 12V battery
 
 extern unsigned char  can_mileskm;               // Miles of Kilometers
+extern unsigned char  can_rxflag;                // CAN frame received (set by high_isr)
+extern unsigned char  can_quiet;                 // Seconds without CAN frames (max 255)
 
 extern rom unsigned char* vehicle_version;       // Vehicle module version
 extern rom unsigned char* can_capabilities;      // Vehicle capabilities
@@ -82,12 +84,235 @@ extern rom BOOL (*vehicle_fn_smshandler)(BOOL premsg, char *caller, char *comman
 extern rom BOOL (*vehicle_fn_smsextensions)(char *caller, char *command, char *arguments);
 extern rom int  (*vehicle_fn_minutestocharge)(unsigned char chgmod, int wAvail, int imStart, int imTarget, int pctTarget, int cac100, signed char degAmbient, int *pimExpect);
 
+// CAN acceptance masks & filters (standard 11 bit IDs), programmed by
+// vehicle_can_setfilters() in CAN configuration mode. RXB0 receives IDs
+// matching RXM0 + RXF0/1, RXB1 (if not RXB0) RXM1 + RXF2..5.
+// Compute with canfilter.pl from the IDs a module decodes.
+typedef struct
+{
+  unsigned int mask0;                         // RXM0
+  unsigned int filter0[2];                    // RXF0, RXF1
+  unsigned int mask1;                         // RXM1
+  unsigned int filter1[4];                    // RXF2..RXF5
+} vehicle_canfilter_t;
+
 void vehicle_initialise(void);
+void vehicle_can_setfilters(rom vehicle_canfilter_t *f);
 
 void vehicle_ticker(void);
 void vehicle_ticker10th(void);
 void vehicle_idlepoll(void);
 
+// CAN transmit queue: vehicle_cantx() queues a frame and returns at once.
+// The TX buffers are loaded from the queue by vehicle_cantx_isr() on the
+// TX complete interrupt, by priority (VEHICLE_CANTX_LOW..URGENT, also
+// used as TXPRI) and in order within a priority: one frame per priority
+// is pending in the TX buffers at a time. Frames not sent within
+// VEHICLE_CANTX_TIMEOUT seconds (no ACK, bus off) are aborted.
+// Modules with their own use of TX buffers restrict the queue to the
+// others with vehicle_cantx_setbuffers().
+
+#define VEHICLE_CANTX_SIZE    8               // queue length
+#define VEHICLE_CANTX_TIMEOUT 2               // seconds
+#define VEHICLE_CANTX_FREE    0xff            // empty queue entry
+#define VEHICLE_CANTX_LOW     0               // priorities
+#define VEHICLE_CANTX_NORMAL  1
+#define VEHICLE_CANTX_HIGH    2
+#define VEHICLE_CANTX_URGENT  3
+
+typedef struct
+{
+  unsigned int id;
+  unsigned char dlc;
+  unsigned char prio;                         // VEHICLE_CANTX_FREE = unused
+  unsigned char seq;                          // queue order
+  unsigned char data[8];
+} vehicle_cantx_t;
+
+extern unsigned int vehicle_cantx_sent;       // frames sent
+extern unsigned int vehicle_cantx_errors;     // frames aborted: timeout
+extern unsigned int vehicle_cantx_drops;      // frames lost: queue full
+extern unsigned char vehicle_cantx_peak;      // max queue fill level
+
+BOOL vehicle_cantx(unsigned int id, unsigned char prio, unsigned char dlc, unsigned char *data);
+unsigned char vehicle_cantx_pending(void);
+void vehicle_cantx_setbuffers(unsigned char mask);
+void vehicle_cantx_isr(void);
+void vehicle_cantx_ticker(void);
+
+#ifdef OVMS_ISR_PROFILE
+// CAN ISR profiling: instruction cycles per frame from reading the RX
+// buffer to the return of the vehicle poll handler, measured with TMR3
+// (1:1 from Fosc/4, 5 cycles per us). ISR entry/exit and the buffer
+// checks are not included. One slot per CAN ID, first come first served.
+
+#define VEHICLE_ISRPROF_IDS 16
+
+typedef struct
+{
+  unsigned int id;
+  unsigned int count;
+  unsigned int min;
+  unsigned int max;
+  unsigned long sum;
+} vehicle_isrprof_t;
+
+extern vehicle_isrprof_t vehicle_isrprof[VEHICLE_ISRPROF_IDS];
+extern unsigned int vehicle_isrprof_lost;      // Frames not recorded (table full)
+
+#define VEHICLE_ISRPROF_START()  { TMR3H = 0; TMR3L = 0; }
+#define VEHICLE_ISRPROF_STOP()   vehicle_isrprof_record()
+
+void vehicle_isrprof_reset(void);
+void vehicle_isrprof_record(void);
+
+#else // OVMS_ISR_PROFILE
+
+#define VEHICLE_ISRPROF_START()
+#define VEHICLE_ISRPROF_STOP()
+
+#endif // OVMS_ISR_PROFILE
+
+#ifdef OVMS_CAN_DEFERRED
+// Deferred CAN decoding: high_isr() only queues received frames into a
+// single producer / single consumer ring, vehicle_idlepoll() feeds them
+// to the poll handlers from the main loop. Fast path work that needs to
+// be done in the ISR stays in a custom ISR (see vehicle_twizy.c).
+
+#define VEHICLE_CANRING_SIZE 16                // power of 2
+
+typedef struct
+{
+  unsigned int id;
+  unsigned char buffer;                       // RX buffer 0/1 (poll0/poll1)
+  unsigned char filter;
+  unsigned char dlc;
+  unsigned char data[8];
+  unsigned int time;                          // TMR1 at reception (1.6 us)
+} vehicle_canframe_t;
+
+extern vehicle_canframe_t vehicle_canring[VEHICLE_CANRING_SIZE];
+extern unsigned char vehicle_canring_head;    // next write (ISR)
+extern unsigned char vehicle_canring_tail;    // next read (main loop)
+extern unsigned char vehicle_canring_peak;    // max ring fill level
+extern unsigned int vehicle_canring_drops;    // frames lost: ring full
+extern unsigned int can_time;                 // TMR1 reception time of the current frame
+
+void vehicle_canring_push(unsigned char buffer);
+void vehicle_canring_dispatch(void);
+
+#endif // OVMS_CAN_DEFERRED
+
+#ifdef OVMS_CAN_STATS
+// CAN bus statistics: counters per accepted CAN ID in a fixed size open
+// addressed hash table (linear probing), plus bus wide error and load
+// counters. Updated by vehicle_canstats_record() in the ISR, published
+// hourly as "*-OVM-CANStats" history records and shown by DIAG "CANSTATS".
+// Times are TMR1 based in units of 409.6 us (TMR1 / 256, extended by the
+// TMR1 overflow count of led_isr()), gaps beyond 26 s saturate.
+
+#define VEHICLE_CANSTATS_SIZE 16              // power of 2
+#define VEHICLE_CANSTATS_FREE 0xffff          // empty slot id
+
+typedef struct
+{
+  unsigned int count;                         // frames (saturating)
+  unsigned long bytes;                        // payload bytes
+  unsigned int changed;                       // frames with changed payload
+  unsigned int gapmin;                        // inter-arrival min [409.6 us]
+  unsigned int gapmax;                        // inter-arrival max [409.6 us]
+  unsigned int last;                          // arrival time [409.6 us]
+  unsigned char hash;                         // payload hash of last frame
+  unsigned char idle;                         // seconds since last frame
+} vehicle_canstats_t;                         // 16 bytes
+
+typedef struct
+{
+  unsigned int lost;                          // frames not recorded: table full
+  unsigned int ovfl0;                         // RXB0OVFL events
+  unsigned int ovfl1;                         // RXB1OVFL events
+  unsigned int busoff;                        // bus off events
+  unsigned char txerrmax;                     // max TXERRCNT
+  unsigned char rxerrmax;                     // max RXERRCNT
+  unsigned int seconds;                       // period length
+  unsigned int load;                          // bus load last second [0.1%]
+  unsigned int loadpeak;                      // bus load peak [0.1%]
+  unsigned long loadpeaktime;                 // car_time of peak
+  unsigned long loadsum;                      // sum of loads for the average
+} vehicle_canbus_t;
+
+extern unsigned int vehicle_canstats_id[VEHICLE_CANSTATS_SIZE];
+extern vehicle_canstats_t vehicle_canstats[VEHICLE_CANSTATS_SIZE];
+extern vehicle_canbus_t vehicle_canbus;
+extern unsigned long vehicle_canbus_bits;     // frame bits received this second
+extern unsigned long vehicle_canbus_bitrate;  // from BRGCON1..3
+
+void vehicle_canstats_reset(void);
+void vehicle_canstats_ticker(void);
+void vehicle_canstats_record(unsigned int id, unsigned char dlc, unsigned char *data);
+#define VEHICLE_CANSTATS_RECORD(id,dlc,data)  vehicle_canstats_record(id,dlc,data)
+
+#else // OVMS_CAN_STATS
+
+#define VEHICLE_CANSTATS_RECORD(id,dlc,data)
+
+#endif // OVMS_CAN_STATS
+
+#ifdef OVMS_CAN_SUPPRESS
+// Payload change suppression: frames repeating the last payload of their
+// CAN ID are not passed to vehicle_fn_poll0/poll1 (poll responses are
+// always delivered). A module opts in with vehicle_can_suppress() and a
+// list of IDs needing special handling, ended by ID 0:
+//  VEHICLE_CANSUPP_MUX: multiplexed by the first data byte, cache per mux
+//  VEHICLE_CANSUPP_ALWAYS: always deliver (counters, timestamps, triggers)
+// Unlisted IDs are cached per ID. Payloads are compared by a 16 bit hash,
+// repeats are delivered every VEHICLE_CANSUPP_REFRESH seconds anyway to
+// keep stale timers alive and bound the effect of a hash collision.
+
+#define VEHICLE_CANSUPP_SIZE    32            // power of 2
+#define VEHICLE_CANSUPP_REFRESH 10            // seconds
+#define VEHICLE_CANSUPP_FREE    0xffff        // empty slot id
+#define VEHICLE_CANSUPP_PLAIN   0
+#define VEHICLE_CANSUPP_MUX     1
+#define VEHICLE_CANSUPP_ALWAYS  2
+
+typedef struct
+{
+  unsigned int id;
+  unsigned char mode;
+} vehicle_cansupp_t;
+
+typedef struct
+{
+  unsigned int id;                            // VEHICLE_CANSUPP_FREE = unused
+  unsigned char mux;                          // first data byte (MUX mode)
+  unsigned char age;                          // seconds since last delivery
+  unsigned int hash;                          // payload hash
+} vehicle_cansupp_slot_t;
+
+extern rom vehicle_cansupp_t *vehicle_cansupp_list; // NULL = off
+extern unsigned long vehicle_cansupp_frames;  // frames checked
+extern unsigned long vehicle_cansupp_skips;   // frames suppressed
+
+void vehicle_can_suppress(rom vehicle_cansupp_t *list);
+void vehicle_cansupp_ticker(void);
+BOOL vehicle_cansupp_repeat(void);
+#define VEHICLE_CANSUPP_REPEAT() ((vehicle_cansupp_list != NULL) && vehicle_cansupp_repeat())
+
+#else // OVMS_CAN_SUPPRESS
+
+#define VEHICLE_CANSUPP_REPEAT() (0)
+
+#endif // OVMS_CAN_SUPPRESS
+
+#ifdef OVMS_HOST
+// Host build: charge the modelled run time of a poll handler (ovms_host -C)
+extern void host_poll_cost(unsigned int id);
+#define VEHICLE_POLL_COST()  host_poll_cost(can_id)
+#else
+#define VEHICLE_POLL_COST()
+#endif // OVMS_HOST
+
 #ifdef OVMS_POLLER
 // Vehicle Poller functions and data
 
@@ -101,9 +326,31 @@ void vehicle_idlepoll(void);
 //      unsigned char type; // see vehicle.h
 //      unsigned int pid; // the PID to request
 //      unsigned int polltime[VEHICLE_POLL_NSTATES]; // poll frequency
+//      unsigned int flowctl; // ISO-TP flow control, 0 = default
 //    } vehicle_pid_t;
 //
-// polltime[state] = poll period in seconds, i.e. 10 = poll every 10 seconds
+// polltime[state] = poll period in seconds, i.e. 10 = poll every 10 seconds,
+//    or VEHICLE_POLL_100MS(n) = poll every n/10 seconds, 0 = don't poll
+//
+// Up to VEHICLE_POLL_SLOTS requests to different modules are open at a
+// time, each in its own ISO-TP session keyed by the response ID. Requests
+// to the same module are sent one at a time, each waits for the response
+// to the previous one for up to VEHICLE_POLL_TIMEOUT ticks. The poller
+// runs in ticks of TMR1 (104.9 ms). Entries beyond VEHICLE_POLL_MAXPIDS
+// are ignored.
+//
+// The vehicle poll handler gets the session of the response in
+// vehicle_poll_moduleid_send, _type, _pid and _ml_*.
+//
+// flowctl = VEHICLE_POLL_FC(bs,stmin) sets the flow control frame sent for
+//    multi frame responses: block size (0 = all frames, else a new flow
+//    control frame every bs frames) and separation time (0x00..0x7f ms,
+//    0xf1..0xf9 = 100..900 us). The default (0) is bs 0, STmin 50 ms.
+//    Add VEHICLE_POLL_FC_BUFFER to collect the response in the buffer set
+//    by vehicle_poll_setbuffer(): the vehicle poll handler is then called
+//    once when the response is complete, with the data following the
+//    response SID & PID in vehicle_poll_buffer[0..vehicle_poll_ml_offset-1].
+//    One buffered request is open at a time.
 //
 // state: 0..2; set by vehicle_poll_setstate()
 //     0=off, 1=on, 2=charging
@@ -117,6 +364,15 @@ void vehicle_idlepoll(void);
 //
 
 #define VEHICLE_POLL_NSTATES 3
+#define VEHICLE_POLL_MAXPIDS 32               // max poll list length
+#define VEHICLE_POLL_WHEEL   16               // timing wheel slots, power of 2
+#define VEHICLE_POLL_TIMEOUT 10               // response timeout in ticks
+#define VEHICLE_POLL_SLOTS   4                // parallel ISO-TP sessions
+#define VEHICLE_POLL_NONE    0xff             // end of wheel / queue list
+#define VEHICLE_POLL_TENTHS  0x8000           // polltime unit flag: 1/10 seconds
+#define VEHICLE_POLL_100MS(n) (VEHICLE_POLL_TENTHS|(n))
+#define VEHICLE_POLL_FC(bs,stmin) (0x8000|((bs)<<8)|(stmin)) // flow control
+#define VEHICLE_POLL_FC_BUFFER 0x4000         // reassemble into vehicle_poll_buffer
 
 // Polling types supported:
 //  (see https://en.wikipedia.org/wiki/OBD-II_PIDs
@@ -136,24 +392,46 @@ typedef struct
   unsigned char type;
   unsigned int pid;
   unsigned int polltime[VEHICLE_POLL_NSTATES];
+  unsigned int flowctl;
 } vehicle_pid_t;
 
+typedef struct
+{
+  unsigned int moduleid_send;     // request sent to
+  unsigned int moduleid_low;      // response ID range
+  unsigned int moduleid_high;
+  unsigned int pid;
+  unsigned int ml_remain;         // multi frame reassembly
+  unsigned int ml_offset;
+  unsigned int ml_frame;
+  unsigned int flowctl;           // flow control, see vehicle_pid_t
+  unsigned int fc_id;             // flow control frame not yet queued to, 0 = none
+  unsigned char type;
+  unsigned char bscount;          // frames left in the current block
+  unsigned char wait;             // ticks left for the response, 0 = free
+} vehicle_poll_slot_t;
+
 extern unsigned char vehicle_poll_state;        // Current poll state
 extern rom vehicle_pid_t* vehicle_poll_plist;   // Head of poll list
-extern rom vehicle_pid_t* vehicle_poll_plcur;   // Current position in poll list
-extern unsigned int vehicle_poll_ticker;        // Polling ticker
-extern unsigned int vehicle_poll_moduleid_send; // Send moduleid
-extern unsigned int vehicle_poll_moduleid_low;  // Expected response moduleid low mark
-extern unsigned int vehicle_poll_moduleid_high; // Expected response moduleid high mark
+extern rom vehicle_pid_t* vehicle_poll_plcur;   // Current request (last sent)
+extern unsigned int vehicle_poll_ticker;        // Polling ticker (TMR1 ticks, 104.9 ms)
+extern unsigned int vehicle_poll_moduleid_send; // Send moduleid (current response)
+extern unsigned int vehicle_poll_moduleid_low;  // Expected response moduleid low mark (all sessions)
+extern unsigned int vehicle_poll_moduleid_high; // Expected response moduleid high mark (all sessions)
 extern unsigned char vehicle_poll_type;         // Expected type
 extern unsigned int vehicle_poll_pid;           // Expected pid
 extern unsigned char vehicle_poll_busactive;    // Indicates recent activity on the passive bus
 extern unsigned int vehicle_poll_ml_remain;     // Bytes remaining for vehicle poll
 extern unsigned int vehicle_poll_ml_offset;     // Offset of vehicle poll data
 extern unsigned int vehicle_poll_ml_frame;      // Frame number for vehicle poll
+extern unsigned char *vehicle_poll_buffer;      // Reassembly buffer (VEHICLE_POLL_FC_BUFFER)
+extern unsigned int vehicle_poll_bufsize;       // Reassembly buffer size
 
 void vehicle_poll_setpidlist(rom vehicle_pid_t *plist);
 void vehicle_poll_setstate(unsigned char state);
+void vehicle_poll_setbuffer(unsigned char *buffer, unsigned int size);
+void vehicle_poll_schedule(void);
+void vehicle_poll_poller(void);
 
 #endif //#ifdef OVMS_POLLER
 
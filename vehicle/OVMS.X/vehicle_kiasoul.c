@@ -198,6 +198,7 @@ UINT32 ks_battery_cum_discharge; //Cumulated discharge power   02 21 01 -> 26 4-
 UINT8 ks_battery_cum_op_time[3]; //Cumulated operating time    02 21 01 -> 27 1-4
 
 UINT8 ks_battery_cell_voltage[32];
+UINT8 ks_poll_buffer[36]; // cell voltage page: 4 bytes + 32 cells
 
 UINT8 ks_battery_min_temperature; //02 21 05 -> 21 7 
 UINT8 ks_battery_inlet_temperature; //02 21 05 -> 21 6 
@@ -268,31 +269,37 @@ UINT8 ks_door_byte; //TODO Temporary door byte for analysis purposes
 //
 // Polling types ("modes") supported: see vehicle.h
 // 
-// polltime[state] = poll period in seconds, i.e. 10 = poll every 10 seconds
+// polltime[state] = poll period in seconds, i.e. 10 = poll every 10 seconds,
+//    or VEHICLE_POLL_100MS(n) = poll every n/10 seconds
 //
 // state: 0..2; set by vehicle_poll_setstate()
 //     0=off, 1=on, 2=charging
 //
+// The BMS sends its pages with 1 ms frame separation. The cell voltage
+// pages 02-04 are reassembled in ks_poll_buffer.
+//
+
+#define KS_BMS_FC VEHICLE_POLL_FC(0,1)
 
 rom vehicle_pid_t vehicle_kiasoul_polls[] = {
   { 0x7e2, 0, VEHICLE_POLL_TYPE_OBDIIVEHICLE, 0x02,
     { 0, 120, 120}}, // VIN
   { 0x7e4, 0x7ec, VEHICLE_POLL_TYPE_OBDIIGROUP, 0x01,
-    { 30, 10, 10}}, // Diag page 01
+    { 30, 2, 2}, KS_BMS_FC}, // Diag page 01
   { 0x7e4, 0x7ec, VEHICLE_POLL_TYPE_OBDIIGROUP, 0x02,
-    { 0, 30, 10}}, // Diag page 02
+    { 0, 30, 10}, KS_BMS_FC|VEHICLE_POLL_FC_BUFFER}, // Diag page 02
   { 0x7e4, 0x7ec, VEHICLE_POLL_TYPE_OBDIIGROUP, 0x03,
-    { 0, 30, 10}}, // Diag page 03
+    { 0, 30, 10}, KS_BMS_FC|VEHICLE_POLL_FC_BUFFER}, // Diag page 03
   { 0x7e4, 0x7ec, VEHICLE_POLL_TYPE_OBDIIGROUP, 0x04,
-    { 0, 30, 10}}, // Diag page 04
+    { 0, 30, 10}, KS_BMS_FC|VEHICLE_POLL_FC_BUFFER}, // Diag page 04
   { 0x7e4, 0x7ec, VEHICLE_POLL_TYPE_OBDIIGROUP, 0x05,
-    { 120, 10, 10}}, // Diag page 05
+    { 120, 10, 10}, KS_BMS_FC}, // Diag page 05
 
   { 0x794, 0x79c, VEHICLE_POLL_TYPE_OBDIIGROUP, 0x02,
     { 0, 0, 10}}, // On board charger
 
   { 0x7e2, 0x7ea, VEHICLE_POLL_TYPE_OBDIIGROUP, 0x00,
-    { 30, 10, 10}}, // VMCU  Shift-stick 
+    { 30, 1, 10}}, // VMCU  Shift-stick 
   { 0x7e2, 0x7ea, VEHICLE_POLL_TYPE_OBDIIGROUP, 0x02,
     { 30, 10, 0}}, // Motor temp++
 
@@ -338,6 +345,10 @@ BOOL vehicle_kiasoul_checkpass(char *password)
 //  vehicle_poll_ml_offset  = msg length including this frame
 //  vehicle_poll_ml_remain  = msg length remaining after this frame
 //
+// Buffered response (VEHICLE_POLL_FC_BUFFER): hook called once
+//  vehicle_poll_buffer     = ks_poll_buffer
+//  vehicle_poll_ml_offset  = msg length in buffer
+//
 
 BOOL vehicle_kiasoul_poll0(void) {
   UINT8 i;
@@ -547,17 +558,14 @@ BOOL vehicle_kiasoul_poll0(void) {
         case 0x02: //Cell voltages
         case 0x03:
         case 0x04:
-          // diag page 02-04: skip first frame (no data)
-          if (!ks_sms_bits.BCV_BlockFetched) {
-            if (ks_sms_bits.BCV_BlockToFetch == vehicle_poll_pid - 2) {
-              if (vehicle_poll_ml_frame >= 0) {
-                base = vehicle_poll_ml_offset - can_datalength - 3;
-                for (i = 0; i < can_datalength && ((base + i)<sizeof (ks_battery_cell_voltage)); i++)
-                  ks_battery_cell_voltage[base + i] = can_databuffer[i];
-                ks_sms_bits.BCV_BlockFetched = 1;
-                ks_sms_bits.BCV_BlockSent = 0;
-              }
-            }
+          // diag page 02-04: complete page in ks_poll_buffer
+          if (!ks_sms_bits.BCV_BlockFetched
+                  && (ks_sms_bits.BCV_BlockToFetch == vehicle_poll_pid - 2)
+                  && (vehicle_poll_ml_offset == sizeof (ks_poll_buffer))) {
+            for (i = 0; i < sizeof (ks_battery_cell_voltage); i++)
+              ks_battery_cell_voltage[i] = ks_poll_buffer[4 + i];
+            ks_sms_bits.BCV_BlockFetched = 1;
+            ks_sms_bits.BCV_BlockSent = 0;
           }
           break;
 
@@ -1028,38 +1036,15 @@ BOOL vehicle_kiasoul_ticker1(void) {
 void vehicle_kiasoul_send_can_message(void)
 {
   if( sys_features[FEATURE_CANWRITE]>0 ){
-    // wait for previous async send (if any) to finish:
-    while (TXB0CONbits.TXREQ) {}
-
     // try to prevent bus flooding:
     delay5b();
 
-    // init transmit:
-    TXB0CON = 0;
-
-    TXB0SIDL = (ks_send_can.id & 0x07) << 5;
-    TXB0SIDH = (ks_send_can.id >> 3);
-
-    // fill in the can message
-    TXB0D0 = ks_send_can.byte[0];
-    TXB0D1 = ks_send_can.byte[1];
-    TXB0D2 = ks_send_can.byte[2];
-    TXB0D3 = ks_send_can.byte[3];
-    TXB0D4 = ks_send_can.byte[4];
-    TXB0D5 = ks_send_can.byte[5];
-    TXB0D6 = ks_send_can.byte[6];
-    TXB0D7 = ks_send_can.byte[7];
-
-    // data length (8):
-    TXB0DLC = 0b00001000;
-
     // clear status to detect reply:
     ks_send_can.status = 0xff;
 
     // send:
-    TXB0CON = 0b00001000;
-
-    while (TXB0CONbits.TXREQ) {}
+    if (!vehicle_cantx(ks_send_can.id, VEHICLE_CANTX_NORMAL, 8, ks_send_can.byte))
+      ks_send_can.status = 0x1;
   }
 }
 
@@ -1968,6 +1953,7 @@ BOOL vehicle_kiasoul_initialise(void) {
   vehicle_fn_commandhandler = &vehicle_kiasoul_fn_commandhandler;
 
   vehicle_poll_setpidlist(vehicle_kiasoul_polls);
+  vehicle_poll_setbuffer(ks_poll_buffer, sizeof (ks_poll_buffer));
   vehicle_poll_setstate(0);
 
   net_fnbits |= NET_FN_INTERNALGPS; // Require internal GPS
@@ -38,6 +38,7 @@ unsigned char kd_candata_timer;  // A per-second timer for CAN bus data
 unsigned char kd_charge_timer;   // A per-second charge timer
 unsigned long kd_charge_wm;      // A per-minute watt accumulator
 BOOL kd_bus_is_active;           // Indicates recent activity on the bus
+unsigned int kd_poll_retry;      // Polls not sent: CAN TX queue full
 
 #pragma udata
 
@@ -67,6 +68,7 @@ BOOL vehicle_kyburz_ticker1(void)
   {
   int k;
   BOOL doneone = FALSE;
+  unsigned char req[4];
 
   if (kd_candata_timer>0)
     {
@@ -120,26 +122,21 @@ BOOL vehicle_kyburz_ticker1(void)
   // Let's run through and see if we have to poll for any data..
   for (k=0;vehicle_kyburz_polls[k].moduleid != 0; k++)
     {
-    if ((can_granular_tick % vehicle_kyburz_polls[k].polltime) == 0)
+    if (((can_granular_tick % vehicle_kyburz_polls[k].polltime) == 0)||
+        (kd_poll_retry & (1<<k)))
       {
       // OK. Let's send it...
       if (doneone)
         delay100b(); // Delay a little... (100ms, approx)
 
-      while (TXB0CONbits.TXREQ) {} // Loop until TX is done
-      TXB0CON = 0;
-      TXB0SIDL = (vehicle_kyburz_polls[k].moduleid & 0x07)<<5;
-      TXB0SIDH = (vehicle_kyburz_polls[k].moduleid>>3);
-      TXB0D0 = 0x42;        // Read Expedited
-      TXB0D1 = vehicle_kyburz_polls[k].pid & 0xff;
-      TXB0D2 = vehicle_kyburz_polls[k].pid >> 8;
-      TXB0D3 = 0x00;        // Sub-index: 0
-      TXB0D4 = 0x00;
-      TXB0D5 = 0x00;
-      TXB0D6 = 0x00;
-      TXB0D7 = 0x00;
-      TXB0DLC = 0b00000100; // data length (4)
-      TXB0CON = 0b00001000; // mark for transmission
+      req[0] = 0x42;        // Read Expedited
+      req[1] = vehicle_kyburz_polls[k].pid & 0xff;
+      req[2] = vehicle_kyburz_polls[k].pid >> 8;
+      req[3] = 0x00;        // Sub-index: 0
+      if (vehicle_cantx(vehicle_kyburz_polls[k].moduleid, VEHICLE_CANTX_NORMAL, 4, req))
+        kd_poll_retry &= ~(1<<k);
+      else
+        kd_poll_retry |= (1<<k); // Queue full, retry on the next tick
       doneone = TRUE;
       }
     }
@@ -233,6 +230,7 @@ BOOL vehicle_kyburz_initialise(void)
   kd_candata_timer = 0;
   kd_charge_timer = 0;
   kd_charge_wm = 0;
+  kd_poll_retry = 0;
   car_stale_timer = -1; // Timed charging is not supported for OVMS Kyburz
   car_chargestate = 4; // Assume charge has completed
   car_time = 0;
@@ -143,25 +143,11 @@ rom vehicle_pid_t vehicle_nissanleaf_polls[]
 
 void vehicle_nissanleaf_send_can_message(short id, unsigned char length, unsigned char *data)
   {
-  volatile far unsigned char *txb0 = &TXB0D0;
-  UINT8 i;
-
   if (sys_features[FEATURE_CANWRITE] == 0 || length > 8)
     {
     return;
     }
-  while (TXB0CONbits.TXREQ)
-    {
-    } // Loop until TX is done
-  TXB0CON = 0;
-  TXB0SIDL = (id & 0x7) << 5;
-  TXB0SIDH = id >> 3;
-  for (i = 0; i < length; i++)
-    {
-    txb0[i] = data[i];
-    }
-  TXB0DLC = length; // data length
-  TXB0CON = 0b00001000; // mark for transmission
+  vehicle_cantx(id, VEHICLE_CANTX_NORMAL, length, data);
   }
 
 ////////////////////////////////////////////////////////////////////////
@@ -38,6 +38,7 @@ unsigned char tz_candata_timer;  // A per-second timer for CAN bus data
 unsigned char tz_charge_timer;   // A per-second charge timer
 unsigned long tz_charge_wm;      // A per-minute watt accumulator
 BOOL tz_bus_is_active;           // Indicates recent activity on the bus
+unsigned long tz_poll_retry;     // Polls not sent: CAN TX queue full
 
 #pragma udata
 
@@ -82,6 +83,7 @@ BOOL vehicle_tazzari_ticker1(void)
   {
   int k;
   BOOL doneone = FALSE;
+  unsigned char req[4];
 
   if (tz_candata_timer>0)
     {
@@ -135,26 +137,21 @@ BOOL vehicle_tazzari_ticker1(void)
   // Let's run through and see if we have to poll for any data..
   for (k=0;vehicle_tazzari_polls[k].moduleid != 0; k++)
     {
-    if ((can_granular_tick % vehicle_tazzari_polls[k].polltime) == 0)
+    if (((can_granular_tick % vehicle_tazzari_polls[k].polltime) == 0)||
+        (tz_poll_retry & (1UL<<k)))
       {
       // OK. Let's send it...
       if (doneone)
         delay100b(); // Delay a little... (100ms, approx)
 
-      while (TXB0CONbits.TXREQ) {} // Loop until TX is done
-      TXB0CON = 0;
-      TXB0SIDL = (vehicle_tazzari_polls[k].moduleid & 0x07)<<5;
-      TXB0SIDH = (vehicle_tazzari_polls[k].moduleid>>3);
-      TXB0D0 = 0x75;
-      TXB0D1 = 0x21;        // Get extended PID
-      TXB0D2 = vehicle_tazzari_polls[k].pid >> 8;
-      TXB0D3 = vehicle_tazzari_polls[k].pid & 0xff;
-      TXB0D4 = 0x00;
-      TXB0D5 = 0x00;
-      TXB0D6 = 0x00;
-      TXB0D7 = 0x00;
-      TXB0DLC = 0b00000100; // data length (4)
-      TXB0CON = 0b00001000; // mark for transmission
+      req[0] = 0x75;
+      req[1] = 0x21;        // Get extended PID
+      req[2] = vehicle_tazzari_polls[k].pid >> 8;
+      req[3] = vehicle_tazzari_polls[k].pid & 0xff;
+      if (vehicle_cantx(vehicle_tazzari_polls[k].moduleid, VEHICLE_CANTX_NORMAL, 4, req))
+        tz_poll_retry &= ~(1UL<<k);
+      else
+        tz_poll_retry |= (1UL<<k); // Queue full, retry on the next tick
       doneone = TRUE;
       }
     }
@@ -310,6 +307,7 @@ BOOL vehicle_tazzari_initialise(void)
   tz_candata_timer = 0;
   tz_charge_timer = 0;
   tz_charge_wm = 0;
+  tz_poll_retry = 0;
   car_stale_timer = -1; // Timed charging is not supported for OVMS Tazzari
   car_chargestate = 4; // Assume charge has completed
   car_time = 0;
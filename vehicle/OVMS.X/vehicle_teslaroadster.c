@@ -44,6 +44,7 @@
 #include "ovms.h"
 #include "params.h"
 #include "net_msg.h"
+#include "vehicle_teslaroadster_sig.h"
 
 #define FEATURE_SPEEDO_REPEATS 5 // Number of times to repeat speedo updates
 #define FEATURE_ROADSTERBITS               0x0A
@@ -52,10 +53,29 @@
 // Capabilities for Tesla Roadster
 rom char teslaroadster_capabilities[] = "C10-12,C15-24";
 
+// CAN acceptance masks & filters:
+// canfilter.pl -0 100,102 -1 344,400,402
+rom vehicle_canfilter_t teslaroadster_canfilter =
+  { 0x7fd, { 0x100, 0x100 }, 0x7ff, { 0x344, 0x400, 0x402, 0x402 } };
+
+#ifdef OVMS_CAN_SUPPRESS
+// Payload change suppression: 0x100, 0x102 and 0x402 are multiplexed by
+// byte 0, 0x400 drives the digital speedo and must always be seen.
+rom vehicle_cansupp_t teslaroadster_cansupp[] =
+  {
+  { 0x100, VEHICLE_CANSUPP_MUX },
+  { 0x102, VEHICLE_CANSUPP_MUX },
+  { 0x400, VEHICLE_CANSUPP_ALWAYS },
+  { 0x402, VEHICLE_CANSUPP_MUX },
+  { 0, 0 }
+  };
+#endif // OVMS_CAN_SUPPRESS
+
 #pragma udata overlay vehicle_overlay_data
 signed char tr_cooldown_recycle;             // Ticker counter for cooldown recycle
 unsigned char can_lastspeedmsg[8];           // A buffer to store the last speed message
 unsigned char can_lastspeedrpt;              // A mechanism to repeat the tx of last speed message
+unsigned char tr_txbuf[8];                   // CAN TX frame for vehicle_cantx()
 unsigned char tr_requestcac;                 // Request CAC
 
 #pragma udata
@@ -77,6 +97,9 @@ BOOL vehicle_teslaroadster_poll0(void)                // CAN ID 100 and 102
   unsigned int k1;
   unsigned long k2;
 
+  if (cansig_decode(&teslaroadster_signals))
+    return TRUE; // Decoded by signal table (vehicle_teslaroadster.dbc)
+
   if (can_id == 0x100)
     {
     switch (can_databuffer[0])
@@ -93,35 +116,6 @@ BOOL vehicle_teslaroadster_poll0(void)                // CAN ID 100 and 102
           car_stale_timer = 1; // Reset stale indicator
           }
         break;
-      case 0x80: // Range / State of Charge
-        car_SOC = can_databuffer[1];
-        car_idealrange = can_databuffer[2]+((unsigned int) can_databuffer[3] << 8);
-        car_estrange = can_databuffer[6]+((unsigned int) can_databuffer[7] << 8);
-        if (car_idealrange>6000) car_idealrange=0; // Sanity check (limit rng->std)
-        if (car_estrange>6000)   car_estrange=0; // Sanity check (limit rng->std)
-        break;
-      case 0x81: // Time/ Date UTC
-        car_time = can_databuffer[4]
-                   + ((unsigned long) can_databuffer[5] << 8)
-                   + ((unsigned long) can_databuffer[6] << 16)
-                   + ((unsigned long) can_databuffer[7] << 24);
-        break;
-      case 0x82: // Ambient Temperature
-        car_ambient_temp = (signed char)can_databuffer[1];
-        car_stale_ambient = 120; // Reset stale indicator
-        break;
-      case 0x83: // GPS Latitude
-        car_latitude = can_databuffer[4]
-                       + ((unsigned long) can_databuffer[5] << 8)
-                       + ((unsigned long) can_databuffer[6] << 16)
-                       + ((unsigned long) can_databuffer[7] << 24);
-        break;
-      case 0x84: // GPS Longitude
-        car_longitude = can_databuffer[4]
-                        + ((unsigned long) can_databuffer[5] << 8)
-                        + ((unsigned long) can_databuffer[6] << 16)
-                        + ((unsigned long) can_databuffer[7] << 24);
-        break;
       case 0x85: // GPS direction and altitude
         car_gpslock = can_databuffer[1];
         if (car_gpslock)
@@ -272,16 +266,6 @@ BOOL vehicle_teslaroadster_poll0(void)                // CAN ID 100 and 102
         car_cac100 = ((unsigned int)can_databuffer[3]*100)+
                      ((((unsigned int)can_databuffer[2]*100)+128)/256);
         break;
-      case 0xA3: // Temperatures
-        car_tpem = (signed char)can_databuffer[1]; // Tpem
-        car_tmotor = (unsigned char)can_databuffer[2]; // Tmotor
-        car_tbattery = (signed char)can_databuffer[6]; // Tbattery
-        car_stale_temps = 120; // Reset stale indicator
-        break;
-      case 0xA4: // 7 VIN bytes i.e. "SFZRE2B"
-        for (k=0;k<7;k++)
-          car_vin[k] = can_databuffer[k+1];
-        break;
       case 0xA5: // 7 VIN bytes i.e. "39A3000"
         for (k=0;k<7;k++)
           car_vin[k+7] = can_databuffer[k+1];
@@ -296,11 +280,6 @@ BOOL vehicle_teslaroadster_poll0(void)                // CAN ID 100 and 102
         else
           car_type[3] = 'N';
         break;
-      case 0xA6: // 3 VIN bytes i.e. "359"
-        car_vin[14] = can_databuffer[1];
-        car_vin[15] = can_databuffer[2];
-        car_vin[16] = can_databuffer[3];
-        break;
       }
     }
   else if (can_id == 0x102)
@@ -320,6 +299,9 @@ BOOL vehicle_teslaroadster_poll0(void)                // CAN ID 100 and 102
 
 BOOL vehicle_teslaroadster_poll1(void)                // CAN ID 344 and 402
 {
+  if (cansig_decode(&teslaroadster_signals))
+    return TRUE; // Decoded by signal table (vehicle_teslaroadster.dbc)
+
   if (can_id == 0x400)
     {
     // Speedometer feature - replace Range->Dash with speed
@@ -338,20 +320,7 @@ BOOL vehicle_teslaroadster_poll1(void)                // CAN ID 344 and 402
       can_lastspeedmsg[5] = can_databuffer[5];
       can_lastspeedmsg[6] = can_databuffer[6];
       can_lastspeedmsg[7] = can_databuffer[7];
-      while (TXB0CONbits.TXREQ) {} // Loop until TX is done
-      TXB0CON = 0;
-      TXB0SIDL = 0b00000000; // Setup Filter and Mask so that only CAN ID 0x100 will be accepted
-      TXB0SIDH = 0b10000000; // Set Filter to 0x400
-      TXB0D0 = can_lastspeedmsg[0];
-      TXB0D1 = can_lastspeedmsg[1];
-      TXB0D2 = can_lastspeedmsg[2];
-      TXB0D3 = can_lastspeedmsg[3];
-      TXB0D4 = can_lastspeedmsg[4];
-      TXB0D5 = can_lastspeedmsg[5];
-      TXB0D6 = can_lastspeedmsg[6];
-      TXB0D7 = can_lastspeedmsg[7];
-      TXB0DLC = 0b00001000; // data length (8)
-      TXB0CON = 0b00001000; // mark for transmission
+      vehicle_cantx(0x400, VEHICLE_CANTX_HIGH, 8, can_lastspeedmsg);
       can_lastspeedrpt = FEATURE_SPEEDO_REPEATS; // Force re-transmissions
       if (can_lastspeedrpt>10) can_lastspeedrpt=10;
       }
@@ -381,18 +350,6 @@ BOOL vehicle_teslaroadster_poll1(void)                // CAN ID 344 and 402
       }
     car_stale_tpms = 120; // Reset stale indicator
     }
-  else if (can_id == 0x402)
-    {
-    switch (can_databuffer[0])
-      {
-      case 0xFA:			// ODOMETER
-        car_odometer = can_databuffer[3]
-		+ ((unsigned long) can_databuffer[4] << 8)
-                + ((unsigned long) can_databuffer[5] << 16);		// Miles /10
-	car_trip = can_databuffer[6] + ((unsigned int) can_databuffer[7] << 8);	// Miles /10
-	break;
-      }
-    }
 
   return TRUE;
 }
@@ -429,43 +386,35 @@ BOOL vehicle_teslaroadster_idlepoll(void)
       {
       // Request CAC streaming...
       // 102 06 D0 07 00 00 00 00 40
-      tr_requestcac = 1; // Wait for cac, then cancel
-      while (TXB0CONbits.TXREQ) {} // Loop until TX is done
-      TXB0CON = 0;
-      TXB0SIDL = 0b01000000; // Setup 0x102
-      TXB0SIDH = 0b00100000; // Setup 0x102
-      TXB0D0 = 0x06;
-      TXB0D1 = 0xd0;
-      TXB0D2 = 0x07;
-      TXB0D3 = 0x00;
-      TXB0D4 = 0x00;
-      TXB0D5 = 0x00;
-      TXB0D6 = 0x00;
-      TXB0D7 = 0x40;
-      TXB0DLC = 0b00001000; // data length (8)
-      TXB0CON = 0b00001000; // mark for transmission
+      tr_txbuf[0] = 0x06;
+      tr_txbuf[1] = 0xd0;
+      tr_txbuf[2] = 0x07;
+      tr_txbuf[3] = 0x00;
+      tr_txbuf[4] = 0x00;
+      tr_txbuf[5] = 0x00;
+      tr_txbuf[6] = 0x00;
+      tr_txbuf[7] = 0x40;
+      if (vehicle_cantx(0x102, VEHICLE_CANTX_NORMAL, 8, tr_txbuf))
+        tr_requestcac = 1; // Wait for cac, then cancel
       }
     else if (tr_requestcac == 3)
       {
       // Cancel CAC streaming...
       // 102 06 00 00 00 00 00 00 40
-      tr_requestcac = 0; // CAC done
-      while (TXB0CONbits.TXREQ) {} // Loop until TX is done
-      TXB0CON = 0;
-      TXB0SIDL = 0b01000000; // Setup 0x102
-      TXB0SIDH = 0b00100000; // Setup 0x102
-      TXB0D0 = 0x06;
-      TXB0D1 = 0x00;
-      TXB0D2 = 0x00;
-      TXB0D3 = 0x00;
-      TXB0D4 = 0x00;
-      TXB0D5 = 0x00;
-      TXB0D6 = 0x00;
-      TXB0D7 = 0x40;
-      TXB0DLC = 0b00001000; // data length (8)
-      TXB0CON = 0b00001000; // mark for transmission
-      vehicle_teslaroadster_ticker60();      // To calculate charge mins remaining, now we have CAC
-      net_req_notification(NET_NOTIFY_STAT); // Notify it (in particular, the charge time estimate
+      tr_txbuf[0] = 0x06;
+      tr_txbuf[1] = 0x00;
+      tr_txbuf[2] = 0x00;
+      tr_txbuf[3] = 0x00;
+      tr_txbuf[4] = 0x00;
+      tr_txbuf[5] = 0x00;
+      tr_txbuf[6] = 0x00;
+      tr_txbuf[7] = 0x40;
+      if (vehicle_cantx(0x102, VEHICLE_CANTX_NORMAL, 8, tr_txbuf))
+        {
+        tr_requestcac = 0; // CAC done
+        vehicle_teslaroadster_ticker60();      // To calculate charge mins remaining, now we have CAC
+        net_req_notification(NET_NOTIFY_STAT); // Notify it (in particular, the charge time estimate
+        }
       }
     }
 
@@ -479,228 +428,165 @@ BOOL vehicle_teslaroadster_idlepoll(void)
       (sys_features[FEATURE_CANWRITE]>0))  // The CAN bus can be written to
     {
     Delay1KTCYx(1);
-    while (TXB0CONbits.TXREQ) {} // Loop until TX is done
-    TXB0CON = 0;
-    TXB0SIDL = 0b00000000; // Setup Filter and Mask so that only CAN ID 0x100 will be accepted
-    TXB0SIDH = 0b10000000; // Set Filter to 0x400
-    TXB0D0 = can_lastspeedmsg[0];
-    TXB0D1 = can_lastspeedmsg[1];
-    TXB0D2 = can_lastspeedmsg[2];
-    TXB0D3 = can_lastspeedmsg[3];
-    TXB0D4 = can_lastspeedmsg[4];
-    TXB0D5 = can_lastspeedmsg[5];
-    TXB0D6 = can_lastspeedmsg[6];
-    TXB0D7 = can_lastspeedmsg[7];
-    TXB0DLC = 0b00001000; // data length (8)
-    TXB0CON = 0b00001000; // mark for transmission
+    if (!vehicle_cantx(0x400, VEHICLE_CANTX_HIGH, 8, can_lastspeedmsg))
+      return FALSE; // Queue full, repeat on the next call
     }
   can_lastspeedrpt--;
 
   return FALSE;
   }
 
-void vehicle_teslaroadster_tx_wakeup(void)
+BOOL vehicle_teslaroadster_tx_wakeup(void)
   {
-  while (TXB0CONbits.TXREQ) {} // Loop until TX is done
-  TXB0CON = 0;
-  TXB0SIDL = 0b01000000; // Setup 0x102
-  TXB0SIDH = 0b00100000; // Setup 0x102
-  TXB0D0 = 0x0a;
-  TXB0DLC = 0b00000001; // data length (1)
-  TXB0CON = 0b00001000; // mark for transmission
-  while (TXB0CONbits.TXREQ) {} // Loop until TX is done
+  tr_txbuf[0] = 0x0a;
+  return vehicle_cantx(0x102, VEHICLE_CANTX_NORMAL, 1, tr_txbuf);
   }
 
-void vehicle_teslaroadster_tx_wakeuptemps(void)
+BOOL vehicle_teslaroadster_tx_wakeuptemps(void)
   {
-  while (TXB0CONbits.TXREQ) {} // Loop until TX is done
-  TXB0CON = 0;
-  TXB0SIDL = 0b01000000; // Setup 0x102
-  TXB0SIDH = 0b00100000; // Setup 0x102
-  TXB0D0 = 0x06;
-  TXB0D1 = 0x2c;
-  TXB0D2 = 0x01;
-  TXB0D3 = 0x00;
-  TXB0D4 = 0x00;
-  TXB0D5 = 0x09;
-  TXB0D6 = 0x10;
-  TXB0D7 = 0x00;
-  TXB0DLC = 0b00001000; // data length (8)
-  TXB0CON = 0b00001000; // mark for transmission
-  while (TXB0CONbits.TXREQ) {} // Loop until TX is done
+  tr_txbuf[0] = 0x06;
+  tr_txbuf[1] = 0x2c;
+  tr_txbuf[2] = 0x01;
+  tr_txbuf[3] = 0x00;
+  tr_txbuf[4] = 0x00;
+  tr_txbuf[5] = 0x09;
+  tr_txbuf[6] = 0x10;
+  tr_txbuf[7] = 0x00;
+  return vehicle_cantx(0x102, VEHICLE_CANTX_NORMAL, 8, tr_txbuf);
   }
 
-void vehicle_teslaroadster_tx_wakeuphvac(void)
+BOOL vehicle_teslaroadster_tx_wakeuphvac(void)
   {
-  while (TXB0CONbits.TXREQ) {} // Loop until TX is done
-  TXB0CON = 0;
-  TXB0SIDL = 0b01000000; // Setup 0x102
-  TXB0SIDH = 0b00100000; // Setup 0x102
-  TXB0D0 = 0x06;
-  TXB0D1 = 0xd0;
-  TXB0D2 = 0x07;
-  TXB0D3 = 0x00;
-  TXB0D4 = 0x00;
-  TXB0D5 = 0x80;
-  TXB0D6 = 0x00;
-  TXB0D7 = 0x08;
-  TXB0DLC = 0b00001000; // data length (8)
-  TXB0CON = 0b00001000; // mark for transmission
-  while (TXB0CONbits.TXREQ) {} // Loop until TX is done
+  tr_txbuf[0] = 0x06;
+  tr_txbuf[1] = 0xd0;
+  tr_txbuf[2] = 0x07;
+  tr_txbuf[3] = 0x00;
+  tr_txbuf[4] = 0x00;
+  tr_txbuf[5] = 0x80;
+  tr_txbuf[6] = 0x00;
+  tr_txbuf[7] = 0x08;
+  return vehicle_cantx(0x102, VEHICLE_CANTX_NORMAL, 8, tr_txbuf);
   }
 
-void vehicle_teslaroadster_tx_setchargemode(unsigned char mode)
+BOOL vehicle_teslaroadster_tx_setchargemode(unsigned char mode)
   {
-  vehicle_teslaroadster_tx_wakeup(); // Also, wakeup the car if necessary
-
-  while (TXB0CONbits.TXREQ) {} // Loop until TX is done
-  TXB0CON = 0;
-  TXB0SIDL = 0b01000000; // Setup 0x102
-  TXB0SIDH = 0b00100000; // Setup 0x102
-  TXB0D0 = 0x05;
-  TXB0D1 = 0x19;
-  TXB0D2 = 0x00;
-  TXB0D3 = 0x00;
-  TXB0D4 = mode;
-  TXB0D5 = 0x00;
-  TXB0D6 = 0x00;
-  TXB0D7 = 0x00;
-  TXB0DLC = 0b00001000; // data length (8)
-  TXB0CON = 0b00001000; // mark for transmission
-  while (TXB0CONbits.TXREQ) {} // Loop until TX is done
+  if (!vehicle_teslaroadster_tx_wakeup()) // Also, wakeup the car if necessary
+    return FALSE;
+
+  tr_txbuf[0] = 0x05;
+  tr_txbuf[1] = 0x19;
+  tr_txbuf[2] = 0x00;
+  tr_txbuf[3] = 0x00;
+  tr_txbuf[4] = mode;
+  tr_txbuf[5] = 0x00;
+  tr_txbuf[6] = 0x00;
+  tr_txbuf[7] = 0x00;
+  return vehicle_cantx(0x102, VEHICLE_CANTX_NORMAL, 8, tr_txbuf);
   }
 
-void vehicle_teslaroadster_tx_setchargecurrent(unsigned char current)
+BOOL vehicle_teslaroadster_tx_setchargecurrent(unsigned char current)
   {
-  vehicle_teslaroadster_tx_wakeup(); // Also, wakeup the car if necessary
-
-  while (TXB0CONbits.TXREQ) {} // Loop until TX is done
-  TXB0CON = 0;
-  TXB0SIDL = 0b01000000; // Setup 0x102
-  TXB0SIDH = 0b00100000; // Setup 0x102
-  TXB0D0 = 0x05;
-  TXB0D1 = 0x02;
-  TXB0D2 = 0x00;
-  TXB0D3 = 0x00;
-  TXB0D4 = current;
-  TXB0D5 = 0x00;
-  TXB0D6 = 0x00;
-  TXB0D7 = 0x00;
-  TXB0DLC = 0b00001000; // data length (8)
-  TXB0CON = 0b00001000; // mark for transmission
-  while (TXB0CONbits.TXREQ) {} // Loop until TX is done
+  if (!vehicle_teslaroadster_tx_wakeup()) // Also, wakeup the car if necessary
+    return FALSE;
+
+  tr_txbuf[0] = 0x05;
+  tr_txbuf[1] = 0x02;
+  tr_txbuf[2] = 0x00;
+  tr_txbuf[3] = 0x00;
+  tr_txbuf[4] = current;
+  tr_txbuf[5] = 0x00;
+  tr_txbuf[6] = 0x00;
+  tr_txbuf[7] = 0x00;
+  return vehicle_cantx(0x102, VEHICLE_CANTX_NORMAL, 8, tr_txbuf);
   }
 
-void vehicle_teslaroadster_tx_startstopcharge(unsigned char start)
+BOOL vehicle_teslaroadster_tx_startstopcharge(unsigned char start)
   {
-  vehicle_teslaroadster_tx_wakeup(); // Also, wakeup the car if necessary
-
-  while (TXB0CONbits.TXREQ) {} // Loop until TX is done
-  TXB0CON = 0;
-  TXB0SIDL = 0b01000000; // Setup 0x102
-  TXB0SIDH = 0b00100000; // Setup 0x102
-  TXB0D0 = 0x05;
-  TXB0D1 = 0x03;
-  TXB0D2 = 0x00;
-  TXB0D3 = 0x00;
-  TXB0D4 = start;
-  TXB0D5 = 0x00;
-  TXB0D6 = 0x00;
-  TXB0D7 = 0x00;
-  TXB0DLC = 0b00001000; // data length (8)
-  TXB0CON = 0b00001000; // mark for transmission
-  while (TXB0CONbits.TXREQ) {} // Loop until TX is done
+  if (!vehicle_teslaroadster_tx_wakeup()) // Also, wakeup the car if necessary
+    return FALSE;
+
+  tr_txbuf[0] = 0x05;
+  tr_txbuf[1] = 0x03;
+  tr_txbuf[2] = 0x00;
+  tr_txbuf[3] = 0x00;
+  tr_txbuf[4] = start;
+  tr_txbuf[5] = 0x00;
+  tr_txbuf[6] = 0x00;
+  tr_txbuf[7] = 0x00;
+  return vehicle_cantx(0x102, VEHICLE_CANTX_NORMAL, 8, tr_txbuf);
   }
 
-void vehicle_teslaroadster_tx_lockunlockcar(unsigned char mode, char *pin)
+BOOL vehicle_teslaroadster_tx_lockunlockcar(unsigned char mode, char *pin)
   {
   // Mode is 0=valet, 1=novalet, 2=lock, 3=unlock
   long lpin;
   lpin = atol(pin);
 
   if ((mode == 0x02)&&((car_doors1 & 0x40)==0))
-    return; // Refuse to lock a car that has handbrake off
+    return TRUE; // Refuse to lock a car that has handbrake off
     
   if ((mode == 0x02)&&(car_doors1 & 0x80)&&
       ((sys_features[FEATURE_ROADSTERBITS] & FEATURE_ROADSTERBITS_LOCKWHILEON) == 0))
-    return; // Refuse to lock a car that is turned on (unless FEATURE_ROADSTERBITS_LOCKWHILEON bypass is enabled)
-
-  while (TXB0CONbits.TXREQ) {} // Loop until TX is done
-  TXB0CON = 0;
-  TXB0SIDL = 0b01000000; // Setup 0x102
-  TXB0SIDH = 0b00100000; // Setup 0x102
-  TXB0D0 = 0x0B;
-  TXB0D1 = mode;
-  TXB0D2 = 0x00;
-  TXB0D3 = 0x00;
-  TXB0D4 = lpin & 0xff;
-  TXB0D5 = (lpin>>8) & 0xff;
-  TXB0D6 = (lpin>>16) & 0xff;
-  TXB0D7 = (strlen(pin)<<4) + ((lpin>>24) & 0x0f);
-  TXB0DLC = 0b00001000; // data length (8)
-  TXB0CON = 0b00001000; // mark for transmission
-  while (TXB0CONbits.TXREQ) {} // Loop until TX is done
+    return TRUE; // Refuse to lock a car that is turned on (unless FEATURE_ROADSTERBITS_LOCKWHILEON bypass is enabled)
+
+  tr_txbuf[0] = 0x0B;
+  tr_txbuf[1] = mode;
+  tr_txbuf[2] = 0x00;
+  tr_txbuf[3] = 0x00;
+  tr_txbuf[4] = lpin & 0xff;
+  tr_txbuf[5] = (lpin>>8) & 0xff;
+  tr_txbuf[6] = (lpin>>16) & 0xff;
+  tr_txbuf[7] = (strlen(pin)<<4) + ((lpin>>24) & 0x0f);
+  return vehicle_cantx(0x102, VEHICLE_CANTX_NORMAL, 8, tr_txbuf);
   }
 
-void vehicle_teslaroadster_tx_timermode(unsigned char mode, unsigned int starttime)
+BOOL vehicle_teslaroadster_tx_timermode(unsigned char mode, unsigned int starttime)
   {
-  vehicle_teslaroadster_tx_wakeup(); // Also, wakeup the car if necessary
-
-  while (TXB0CONbits.TXREQ) {} // Loop until TX is done
-  TXB0CON = 0;
-  TXB0SIDL = 0b01000000; // Setup 0x102
-  TXB0SIDH = 0b00100000; // Setup 0x102
-  TXB0D0 = 0x05;
-  TXB0D1 = 0x1B;
-  TXB0D2 = 0x00;
-  TXB0D3 = 0x00;
-  TXB0D4 = mode;
-  TXB0D5 = 0x00;
-  TXB0D6 = 0x00;
-  TXB0D7 = 0x00;
-  TXB0DLC = 0b00001000; // data length (8)
-  TXB0CON = 0b00001000; // mark for transmission
-  while (TXB0CONbits.TXREQ) {} // Loop until TX is done
+  if (!vehicle_teslaroadster_tx_wakeup()) // Also, wakeup the car if necessary
+    return FALSE;
+
+  tr_txbuf[0] = 0x05;
+  tr_txbuf[1] = 0x1B;
+  tr_txbuf[2] = 0x00;
+  tr_txbuf[3] = 0x00;
+  tr_txbuf[4] = mode;
+  tr_txbuf[5] = 0x00;
+  tr_txbuf[6] = 0x00;
+  tr_txbuf[7] = 0x00;
+  if (!vehicle_cantx(0x102, VEHICLE_CANTX_NORMAL, 8, tr_txbuf))
+    return FALSE;
   if (mode == 1)
     {
-    TXB0CON = 0;
-    TXB0SIDL = 0b01000000; // Setup 0x102
-    TXB0SIDH = 0b00100000; // Setup 0x102
-    TXB0D0 = 0x05;
-    TXB0D1 = 0x1A;
-    TXB0D2 = 0x00;
-    TXB0D3 = 0x00;
-    TXB0D4 = (starttime >>8)&0xff;
-    TXB0D5 = (starttime & 0xff);
-    TXB0D6 = 0x00;
-    TXB0D7 = 0x00;
-    TXB0DLC = 0b00001000; // data length (8)
-    TXB0CON = 0b00001000; // mark for transmission
-    while (TXB0CONbits.TXREQ) {} // Loop until TX is done
+    tr_txbuf[0] = 0x05;
+    tr_txbuf[1] = 0x1A;
+    tr_txbuf[2] = 0x00;
+    tr_txbuf[3] = 0x00;
+    tr_txbuf[4] = (starttime >>8)&0xff;
+    tr_txbuf[5] = (starttime & 0xff);
+    tr_txbuf[6] = 0x00;
+    tr_txbuf[7] = 0x00;
+    return vehicle_cantx(0x102, VEHICLE_CANTX_NORMAL, 8, tr_txbuf);
     }
+  return TRUE;
   }
 
-void vehicle_teslaroadster_tx_homelink(unsigned char button)
+BOOL vehicle_teslaroadster_tx_homelink(unsigned char button)
   {
-  vehicle_teslaroadster_tx_wakeup(); // Also, wakeup the car if necessary
-
-  while (TXB0CONbits.TXREQ) {} // Loop until TX is done
-  TXB0CON = 0;
-  TXB0SIDL = 0b01000000; // Setup 0x102
-  TXB0SIDH = 0b00100000; // Setup 0x102
-  TXB0D0 = 0x09;
-  TXB0D1 = 0x00;
-  TXB0D2 = button;
-  TXB0DLC = 0b00000011; // data length (3)
-  TXB0CON = 0b00001000; // mark for transmission
-  while (TXB0CONbits.TXREQ) {} // Loop until TX is done
+  if (!vehicle_teslaroadster_tx_wakeup()) // Also, wakeup the car if necessary
+    return FALSE;
+
+  tr_txbuf[0] = 0x09;
+  tr_txbuf[1] = 0x00;
+  tr_txbuf[2] = button;
+  return vehicle_cantx(0x102, VEHICLE_CANTX_NORMAL, 3, tr_txbuf);
   }
 
-void vehicle_teslaroadster_cooldown(void)
+BOOL vehicle_teslaroadster_cooldown(void)
   {
   // We have been requested to cool down the battery pack
   char *p;
   int k;
+  BOOL ok, sent = FALSE;
 
   // Save the old charge mode and limit
   car_cooldown_wascharging = (CAR_IS_CHARGING)?1:0;
@@ -738,17 +624,23 @@ void vehicle_teslaroadster_cooldown(void)
     delay100(10);
     for (k=0;k<2;k++) // Be persistent, and do this a few times to make sure
       {
-      vehicle_teslaroadster_tx_setchargecurrent(13); // 13A charge
+      ok = vehicle_teslaroadster_tx_setchargecurrent(13); // 13A charge
       delay100(1);
-      vehicle_teslaroadster_tx_setchargemode(3);     // Switch to RANGE mode
+      if (!vehicle_teslaroadster_tx_setchargemode(3))     // Switch to RANGE mode
+        ok = FALSE;
       delay100(1);
-      vehicle_teslaroadster_tx_startstopcharge(1);   // Force START charge
+      if (!vehicle_teslaroadster_tx_startstopcharge(1))   // Force START charge
+        ok = FALSE;
       delay100(1);
+      if (ok) sent = TRUE;
       }
+    if (!sent)
+      return FALSE; // CAN TX queue full, no complete round sent
     vehicle_teslaroadster_tx_wakeuphvac();         // Start HVAC data
     car_coolingdown = 0;
     tr_cooldown_recycle = -1;
     }
+  return TRUE;
   }
 
 BOOL vehicle_teslaroadster_commandhandler(BOOL msgmode, int code, char* msg)
@@ -765,8 +657,10 @@ BOOL vehicle_teslaroadster_commandhandler(BOOL msgmode, int code, char* msg)
         }
       else
         {
-        vehicle_teslaroadster_tx_setchargemode(atoi(msg));
-        STP_OK(net_scratchpad, code);
+        if (vehicle_teslaroadster_tx_setchargemode(atoi(msg)))
+          STP_OK(net_scratchpad, code);
+        else
+          STP_CANTXFULL(net_scratchpad, code);
         }
       break;
 
@@ -780,9 +674,13 @@ BOOL vehicle_teslaroadster_commandhandler(BOOL msgmode, int code, char* msg)
         {
         if ((car_doors1 & 0x04)&&(car_chargesubstate != 0x07))
           {
-          vehicle_teslaroadster_tx_startstopcharge(1);
-          net_notify_suppresscount = 0; // Enable notifications
-          STP_OK(net_scratchpad, code);
+          if (vehicle_teslaroadster_tx_startstopcharge(1))
+            {
+            net_notify_suppresscount = 0; // Enable notifications
+            STP_OK(net_scratchpad, code);
+            }
+          else
+            STP_CANTXFULL(net_scratchpad, code);
           }
         else
           {
@@ -800,9 +698,13 @@ BOOL vehicle_teslaroadster_commandhandler(BOOL msgmode, int code, char* msg)
         {
         if ((car_doors1 & 0x10))
           {
-          vehicle_teslaroadster_tx_startstopcharge(0);
-          net_notify_suppresscount = 30; // Suppress notifications for 30 seconds
-          STP_OK(net_scratchpad, code);
+          if (vehicle_teslaroadster_tx_startstopcharge(0))
+            {
+            net_notify_suppresscount = 30; // Suppress notifications for 30 seconds
+            STP_OK(net_scratchpad, code);
+            }
+          else
+            STP_CANTXFULL(net_scratchpad, code);
           }
         else
           {
@@ -818,8 +720,10 @@ BOOL vehicle_teslaroadster_commandhandler(BOOL msgmode, int code, char* msg)
         }
       else
         {
-        vehicle_teslaroadster_tx_setchargecurrent(atoi(msg));
-        STP_OK(net_scratchpad, code);
+        if (vehicle_teslaroadster_tx_setchargecurrent(atoi(msg)))
+          STP_OK(net_scratchpad, code);
+        else
+          STP_CANTXFULL(net_scratchpad, code);
         }
       break;
 
@@ -836,9 +740,11 @@ BOOL vehicle_teslaroadster_commandhandler(BOOL msgmode, int code, char* msg)
           {
           *p++ = 0;
           // At this point, <msg> points to the mode, and p to the current
-          vehicle_teslaroadster_tx_setchargemode(atoi(msg));
-          vehicle_teslaroadster_tx_setchargecurrent(atoi(p));
-          STP_OK(net_scratchpad, code);
+          if (vehicle_teslaroadster_tx_setchargemode(atoi(msg))&&
+              vehicle_teslaroadster_tx_setchargecurrent(atoi(p)))
+            STP_OK(net_scratchpad, code);
+          else
+            STP_CANTXFULL(net_scratchpad, code);
           }
         else
           {
@@ -860,8 +766,10 @@ BOOL vehicle_teslaroadster_commandhandler(BOOL msgmode, int code, char* msg)
           {
           *p++ = 0;
           // At this point, <msg> points to the mode, and p to the time
-          vehicle_teslaroadster_tx_timermode(atoi(msg),atoi(p));
-          STP_OK(net_scratchpad, code);
+          if (vehicle_teslaroadster_tx_timermode(atoi(msg),atoi(p)))
+            STP_OK(net_scratchpad, code);
+          else
+            STP_CANTXFULL(net_scratchpad, code);
           }
         else
           {
@@ -877,9 +785,11 @@ BOOL vehicle_teslaroadster_commandhandler(BOOL msgmode, int code, char* msg)
         }
       else
         {
-        vehicle_teslaroadster_tx_wakeup();
-        vehicle_teslaroadster_tx_wakeuptemps();
-        STP_OK(net_scratchpad, code);
+        if (vehicle_teslaroadster_tx_wakeup()&&
+            vehicle_teslaroadster_tx_wakeuptemps())
+          STP_OK(net_scratchpad, code);
+        else
+          STP_CANTXFULL(net_scratchpad, code);
         }
       break;
 
@@ -890,8 +800,10 @@ BOOL vehicle_teslaroadster_commandhandler(BOOL msgmode, int code, char* msg)
         }
       else
         {
-        vehicle_teslaroadster_tx_wakeuptemps();
-        STP_OK(net_scratchpad, code);
+        if (vehicle_teslaroadster_tx_wakeuptemps())
+          STP_OK(net_scratchpad, code);
+        else
+          STP_CANTXFULL(net_scratchpad, code);
         }
       break;
 
@@ -902,8 +814,10 @@ BOOL vehicle_teslaroadster_commandhandler(BOOL msgmode, int code, char* msg)
         }
       else
         {
-        vehicle_teslaroadster_tx_lockunlockcar(2, msg);
-        STP_OK(net_scratchpad, code);
+        if (vehicle_teslaroadster_tx_lockunlockcar(2, msg))
+          STP_OK(net_scratchpad, code);
+        else
+          STP_CANTXFULL(net_scratchpad, code);
         }
       sendenv=TRUE;
       break;
@@ -915,8 +829,10 @@ BOOL vehicle_teslaroadster_commandhandler(BOOL msgmode, int code, char* msg)
         }
       else
         {
-        vehicle_teslaroadster_tx_lockunlockcar(0, msg);
-        STP_OK(net_scratchpad, code);
+        if (vehicle_teslaroadster_tx_lockunlockcar(0, msg))
+          STP_OK(net_scratchpad, code);
+        else
+          STP_CANTXFULL(net_scratchpad, code);
         }
       sendenv=TRUE;
       break;
@@ -928,8 +844,10 @@ BOOL vehicle_teslaroadster_commandhandler(BOOL msgmode, int code, char* msg)
         }
       else
         {
-        vehicle_teslaroadster_tx_lockunlockcar(3, msg);
-        STP_OK(net_scratchpad, code);
+        if (vehicle_teslaroadster_tx_lockunlockcar(3, msg))
+          STP_OK(net_scratchpad, code);
+        else
+          STP_CANTXFULL(net_scratchpad, code);
         }
       sendenv=TRUE;
       break;
@@ -941,8 +859,10 @@ BOOL vehicle_teslaroadster_commandhandler(BOOL msgmode, int code, char* msg)
         }
       else
         {
-        vehicle_teslaroadster_tx_lockunlockcar(1, msg);
-        STP_OK(net_scratchpad, code);
+        if (vehicle_teslaroadster_tx_lockunlockcar(1, msg))
+          STP_OK(net_scratchpad, code);
+        else
+          STP_CANTXFULL(net_scratchpad, code);
         }
       sendenv=TRUE;
       break;
@@ -954,8 +874,10 @@ BOOL vehicle_teslaroadster_commandhandler(BOOL msgmode, int code, char* msg)
         }
       else
         {
-        vehicle_teslaroadster_tx_homelink(atoi(msg));
-        STP_OK(net_scratchpad, code);
+        if (vehicle_teslaroadster_tx_homelink(atoi(msg)))
+          STP_OK(net_scratchpad, code);
+        else
+          STP_CANTXFULL(net_scratchpad, code);
         }
       break;
 
@@ -966,8 +888,10 @@ BOOL vehicle_teslaroadster_commandhandler(BOOL msgmode, int code, char* msg)
         }
       else
         {
-        vehicle_teslaroadster_cooldown();
-        STP_OK(net_scratchpad, code);
+        if (vehicle_teslaroadster_cooldown())
+          STP_OK(net_scratchpad, code);
+        else
+          STP_CANTXFULL(net_scratchpad, code);
         }
       break;
 
@@ -1161,13 +1085,16 @@ BOOL vehicle_teslaroadster_ticker1(void)
       if (tr_cooldown_recycle == 10)
         {
         // Switch to PERFORMANCE mode for ten seconds
-        vehicle_teslaroadster_tx_setchargemode(4);     // Switch to PERFORMANCE mode
+        if (!vehicle_teslaroadster_tx_setchargemode(4)) // Switch to PERFORMANCE mode
+          tr_cooldown_recycle++; // Queue full, retry on the next tick
         }
       else if (tr_cooldown_recycle == 0)
         {
         // Switch back to RANGE mode, and reset cycle
-        vehicle_teslaroadster_tx_setchargemode(3);     // Switch to RANGE mode
-        tr_cooldown_recycle = 60;
+        if (vehicle_teslaroadster_tx_setchargemode(3)) // Switch to RANGE mode
+          tr_cooldown_recycle = 60;
+        else
+          tr_cooldown_recycle = 1; // Queue full, retry on the next tick
         }
       }
     if (car_chargelimit != 13)
@@ -1225,21 +1152,22 @@ BOOL vehicle_teslaroadster_ticker60(void)
 
     if (car_coolingdown>=0)
       {
-      car_cooldown_timelimit--;
+      if (car_cooldown_timelimit > 0)
+        car_cooldown_timelimit--;
       vehicle_teslaroadster_tx_wakeuphvac();         // Start HVAC data
       if ((car_cooldown_timelimit == 0)||
           (car_tbattery <= car_cooldown_tbattery))
         {
-        // Stop the cooldown...
+        // Stop the cooldown, retry next minute if the CAN TX queue is full...
         net_notify_suppresscount = 30;
-        vehicle_teslaroadster_tx_setchargecurrent(car_cooldown_chargelimit); // Restore charge limit
-        vehicle_teslaroadster_tx_setchargemode(car_cooldown_chargemode);     // Restore charge mode
-        if (car_cooldown_wascharging == 0)
+        if (vehicle_teslaroadster_tx_setchargecurrent(car_cooldown_chargelimit)&& // Restore charge limit
+            vehicle_teslaroadster_tx_setchargemode(car_cooldown_chargemode)&&     // Restore charge mode
+            ((car_cooldown_wascharging != 0)||
+             vehicle_teslaroadster_tx_startstopcharge(0)))                        // Force START charge
           {
-          vehicle_teslaroadster_tx_startstopcharge(0);                        // Force START charge
+          car_coolingdown = -1;
+          tr_cooldown_recycle = -1;
           }
-        car_coolingdown = -1;
-        tr_cooldown_recycle = -1;
         }
       }
     }
@@ -1249,10 +1177,12 @@ BOOL vehicle_teslaroadster_ticker60(void)
     if (car_coolingdown>0)
       {
       net_notify_suppresscount = 30;
-      vehicle_teslaroadster_tx_setchargecurrent(car_cooldown_chargelimit); // Restore charge limit
-      vehicle_teslaroadster_tx_setchargemode(car_cooldown_chargemode);     // Restore charge mode
-      car_coolingdown = -1;
-      tr_cooldown_recycle = -1;
+      if (vehicle_teslaroadster_tx_setchargecurrent(car_cooldown_chargelimit)&& // Restore charge limit
+          vehicle_teslaroadster_tx_setchargemode(car_cooldown_chargemode))      // Restore charge mode
+        {
+        car_coolingdown = -1;
+        tr_cooldown_recycle = -1;
+        }
       }
     }
   
@@ -1279,19 +1209,13 @@ void vehicle_teslaroadster_initialise(void)
 
   // We are now in Configuration Mode
   
-  // RX buffer0 uses Mask RXM0 and filters RXF0, RXF1
+  // RX buffer0: 0x100 and 0x102, buffer1: 0x344, 0x400, 0x402
   RXB0CON = 0b00000000;
-  RXM0SIDH = 0b11111111; RXM0SIDL = 0b10100000; // Msk0 111 1111 1101 (0x7fd)
-  RXF0SIDH = 0b00100000; RXF0SIDL = 0b00000000; // Flt0 001 0000 00x0 (0x100 and 0x102 will be accepted)
-  RXF1SIDH = 0b00000000; RXF1SIDL = 0b00000000; // Flt1 000 0000 00x0 (-)
-
-  // RX buffer1 uses Mask RXM1 and filters RXF2, RXF3, RXF4, RXF5
   RXB1CON = 0b00000000;
-  RXM1SIDH = 0b11111111; RXM1SIDL = 0b11100000; // Msk1 111 1111 1111 (0x7ff)
-  RXF2SIDH = 0b01101000; RXF2SIDL = 0b10000000; // Flt2 011 0100 0100 (0x344)
-  RXF3SIDH = 0b10000000; RXF3SIDL = 0b01000000; // Flt3 100 0000 0010 (0x402)
-  RXF4SIDH = 0b10000000; RXF4SIDL = 0b00000000; // Flt4 100 0000 0000 (0x400)
-  RXF5SIDH = 0b00000000; RXF5SIDL = 0b00000000; // Flt5 000 0000 0000 (-)
+  vehicle_can_setfilters(&teslaroadster_canfilter);
+#ifdef OVMS_CAN_SUPPRESS
+  vehicle_can_suppress(teslaroadster_cansupp);
+#endif // OVMS_CAN_SUPPRESS
   
   BRGCON1 = 0; // SET BAUDRATE to 1 Mbps
   BRGCON2 = 0xD2;
@@ -0,0 +1,65 @@
+// Generated by cansig.pl from vehicle_teslaroadster.dbc, do not edit.
+// Signal table for cansig_decode(), see cansig.h
+
+#include "cansig.h"
+
+rom cansig_sig_t teslaroadster_sigs[] =
+  {
+  // target, size, flags, byte, nbytes, shift, len, mul, div, offset, min, max
+  { (void*)&car_SOC, 1, 0, 1, 1, 0, 8, 1, 1, 0, 0, 0 }, // 0x100/0x80 VDS.SOC
+  { (void*)&car_idealrange, 2, CANSIG_RANGE, 2, 2, 0, 16, 1, 1, 0, 0, 6000 }, // 0x100/0x80 VDS.IdealRange
+  { (void*)&car_estrange, 2, CANSIG_RANGE, 6, 2, 0, 16, 1, 1, 0, 0, 6000 }, // 0x100/0x80 VDS.EstRange
+  { (void*)&car_time, 4, 0, 4, 4, 0, 32, 1, 1, 0, 0, 0 }, // 0x100/0x81 VDS.Time
+  { (void*)&car_ambient_temp, 2, CANSIG_SIGNED, 1, 1, 0, 8, 1, 1, 0, 0, 0 }, // 0x100/0x82 VDS.AmbientTemp
+  { (void*)&car_stale_ambient, 1, 0, 0, 0, 0, 0, 1, 1, 120, 0, 0 }, // 0x100/0x82 VDS.AmbientStale
+  { (void*)&car_latitude, 4, CANSIG_SIGNED, 4, 4, 0, 32, 1, 1, 0, 0, 0 }, // 0x100/0x83 VDS.Latitude
+  { (void*)&car_longitude, 4, CANSIG_SIGNED, 4, 4, 0, 32, 1, 1, 0, 0, 0 }, // 0x100/0x84 VDS.Longitude
+  { (void*)&car_tpem, 2, CANSIG_SIGNED, 1, 1, 0, 8, 1, 1, 0, 0, 0 }, // 0x100/0xA3 VDS.Tpem
+  { (void*)&car_tmotor, 2, 0, 2, 1, 0, 8, 1, 1, 0, 0, 0 }, // 0x100/0xA3 VDS.Tmotor
+  { (void*)&car_tbattery, 2, CANSIG_SIGNED, 6, 1, 0, 8, 1, 1, 0, 0, 0 }, // 0x100/0xA3 VDS.Tbattery
+  { (void*)&car_stale_temps, 1, 0, 0, 0, 0, 0, 1, 1, 120, 0, 0 }, // 0x100/0xA3 VDS.TempsStale
+  { (void*)&car_vin[0], 1, 0, 1, 1, 0, 8, 1, 1, 0, 0, 0 }, // 0x100/0xA4 VDS.VIN0
+  { (void*)&car_vin[1], 1, 0, 2, 1, 0, 8, 1, 1, 0, 0, 0 }, // 0x100/0xA4 VDS.VIN1
+  { (void*)&car_vin[2], 1, 0, 3, 1, 0, 8, 1, 1, 0, 0, 0 }, // 0x100/0xA4 VDS.VIN2
+  { (void*)&car_vin[3], 1, 0, 4, 1, 0, 8, 1, 1, 0, 0, 0 }, // 0x100/0xA4 VDS.VIN3
+  { (void*)&car_vin[4], 1, 0, 5, 1, 0, 8, 1, 1, 0, 0, 0 }, // 0x100/0xA4 VDS.VIN4
+  { (void*)&car_vin[5], 1, 0, 6, 1, 0, 8, 1, 1, 0, 0, 0 }, // 0x100/0xA4 VDS.VIN5
+  { (void*)&car_vin[6], 1, 0, 7, 1, 0, 8, 1, 1, 0, 0, 0 }, // 0x100/0xA4 VDS.VIN6
+  { (void*)&car_vin[14], 1, 0, 1, 1, 0, 8, 1, 1, 0, 0, 0 }, // 0x100/0xA6 VDS.VIN14
+  { (void*)&car_vin[15], 1, 0, 2, 1, 0, 8, 1, 1, 0, 0, 0 }, // 0x100/0xA6 VDS.VIN15
+  { (void*)&car_vin[16], 1, 0, 3, 1, 0, 8, 1, 1, 0, 0, 0 }, // 0x100/0xA6 VDS.VIN16
+  { (void*)&car_odometer, 4, 0, 3, 3, 0, 24, 1, 1, 0, 0, 0 }, // 0x402/0xFA Odometer.Odometer
+  { (void*)&car_trip, 2, 0, 6, 2, 0, 16, 1, 1, 0, 0, 0 }, // 0x402/0xFA Odometer.Trip
+  };
+
+rom cansig_msg_t teslaroadster_msgs[] =
+  {
+  // mux, first, count
+  { 0x80, 0, 3 }, // 0x100 VDS
+  { 0x81, 3, 1 }, // 0x100 VDS
+  { 0x82, 4, 2 }, // 0x100 VDS
+  { 0x83, 6, 1 }, // 0x100 VDS
+  { 0, 0, 0 },
+  { 0x84, 7, 1 }, // 0x100 VDS
+  { 0, 0, 0 },
+  { 0, 0, 0 },
+  { 0, 0, 0 },
+  { 0, 0, 0 },
+  { 0, 0, 0 },
+  { 0xA3, 8, 4 }, // 0x100 VDS
+  { 0, 0, 0 },
+  { 0xA4, 12, 7 }, // 0x100 VDS
+  { 0, 0, 0 },
+  { 0xA6, 19, 3 }, // 0x100 VDS
+  { 0xFA, 22, 2 }, // 0x402 Odometer
+  };
+
+rom cansig_id_t teslaroadster_ids[] =
+  {
+  // id, muxbyte, muxshift, muxmask, first
+  { 0x100, 0, 2, 0x0F, 0 }, // VDS
+  { 0x402, 0, 1, 0x00, 16 }, // Odometer
+  };
+
+rom cansig_table_t teslaroadster_signals =
+  { teslaroadster_ids, teslaroadster_msgs, teslaroadster_sigs, 1, 0x001 };
@@ -513,56 +513,20 @@ BOOL vehicle_thinkcity_poll1(void)
 //
 BOOL vehicle_thinkcity_idlepoll(void)
 {
+  unsigned char req[4];
 
   if (sys_features[FEATURE_CANWRITE]>0)
   {
-    while (TXB0CONbits.TXREQ) {} // Loop until TX is done
-    TXB0CON = 0;
-    TXB0SIDL = 0b01100000;
-    TXB0SIDH = 0b11101010;
-    TXB0D0 = 0x03;
-    TXB0D1 = 0x22;
-    TXB0D2 = 0x49;
-    TXB0D3 = 0x65;
-    TXB0DLC = 0b00000100; // data length (4)
-    TXB0CON = 0b00001000; // mark for transmission
-    delay100b(); // Delay a little... (100ms, approx)
-
-    while (TXB0CONbits.TXREQ) {} // Loop until TX is done
-    TXB0CON = 0;
-    TXB0SIDL = 0b01100000;
-    TXB0SIDH = 0b11101010;
-    TXB0D0 = 0x03;
-    TXB0D1 = 0x22;
-    TXB0D2 = 0x49;
-    TXB0D3 = 0x66;
-    TXB0DLC = 0b00000100; // data length (4)
-    TXB0CON = 0b00001000; // mark for transmission
-    delay100b(); // Delay a little... (100ms, approx)
-
-    while (TXB0CONbits.TXREQ) {} // Loop until TX is done
-    TXB0CON = 0;
-    TXB0SIDL = 0b01100000;
-    TXB0SIDH = 0b11101010;
-    TXB0D0 = 0x03;
-    TXB0D1 = 0x22;
-    TXB0D2 = 0x49;
-    TXB0D3 = 0x67;
-    TXB0DLC = 0b00000100; // data length (4)
-    TXB0CON = 0b00001000; // mark for transmission
-    delay100b(); // Delay a little... (100ms, approx)
-
-    while (TXB0CONbits.TXREQ) {} // Loop until TX is done
-    TXB0CON = 0;
-    TXB0SIDL = 0b01100000;
-    TXB0SIDH = 0b11101010;
-    TXB0D0 = 0x03;
-    TXB0D1 = 0x22;
-    TXB0D2 = 0x49;
-    TXB0D3 = 0x68;
-    TXB0DLC = 0b00000100; // data length (4)
-    TXB0CON = 0b00001000; // mark for transmission
-    delay100b(); // Delay a little... (100ms, approx)
+    // Request PIDs 0x4965..0x4968 from 0x753:
+    req[0] = 0x03;
+    req[1] = 0x22;
+    req[2] = 0x49;
+    for (req[3] = 0x65; req[3] <= 0x68; req[3]++)
+    {
+      if (!vehicle_cantx(0x753, VEHICLE_CANTX_NORMAL, 4, req))
+        break; // Queue full, retry on the next call
+      delay100b(); // Delay a little... (100ms, approx)
+    }
   }
 
 
@@ -1031,33 +1031,17 @@ UINT vehicle_twizy_resetlogs_msgp(UINT8 which, UINT8 *retcnt);
 // asynchronous SDO request:
 void vehicle_twizy_sendsdoreq(void)
 {
-  // wait for previous async send (if any) to finish:
-  while ((TXB0CON & 0b00111000) == 0b00001000) {} // wait for TX done / error
-  TXB0CON = 0; // init new TX / abort TX error
-  while (TXB0CONbits.TXREQ) {} // wait for TX clear
-  
-  // dest ID 0x601 (SEVCON):
-  TXB0SIDH = 0b11000000;
-  TXB0SIDL = 0b00100000;
-
-  // fill in from twizy_sdo:
-  TXB0D0 = twizy_sdo.byte[0];
-  TXB0D1 = twizy_sdo.byte[1];
-  TXB0D2 = twizy_sdo.byte[2];
-  TXB0D3 = twizy_sdo.byte[3];
-  TXB0D4 = twizy_sdo.byte[4];
-  TXB0D5 = twizy_sdo.byte[5];
-  TXB0D6 = twizy_sdo.byte[6];
-  TXB0D7 = twizy_sdo.byte[7];
-
-  // data length (8):
-  TXB0DLC = 0b00001000;
+  UINT8 i, req[8];
+
+  // take request from twizy_sdo:
+  for (i = 0; i < 8; i++)
+    req[i] = twizy_sdo.byte[i];
 
   // clear status to detect reply:
   twizy_sdo.control = 0xff;
 
-  // send:
-  TXB0CON = 0b00001000;
+  // send to 0x601 (SEVCON):
+  vehicle_cantx(0x601, VEHICLE_CANTX_NORMAL, 8, req);
 }
 
 // synchronous SDO request (1000 ms timeout, 3 tries):
@@ -1082,6 +1066,9 @@ UINT vehicle_twizy_sendsdoreq_sync(void)
     timeout = 250; // ~50 ms
     do {
       Delay1KTCYx(1); // 0.2 ms
+#ifdef OVMS_CAN_DEFERRED
+      vehicle_canring_dispatch(); // the reply is decoded by poll1
+#endif // OVMS_CAN_DEFERRED
     } while (twizy_sdo.control == 0xff && --timeout);
 
     if (timeout != 0)
@@ -4444,25 +4431,39 @@ char vehicle_twizy_sdolog_msgp(char stat, UINT regindex)
 
 void high_isr(void);
 
+#ifndef OVMS_HOST
 #pragma code can_int_service = 0x08
 void can_int_service(void)
 {
   _asm goto high_isr _endasm
 }
+#endif // OVMS_HOST
 
 #pragma code
 // ISR optimization, see http://www.xargs.com/pic/c18-isr-optim.pdf
+#ifdef OVMS_CAN_DEFERRED
+#pragma tmpdata high_isr_ring_tmpdata
+#else
 #pragma tmpdata high_isr_tmpdata
+#endif // OVMS_CAN_DEFERRED
 #pragma	interrupt high_isr nosave=section(".tmpdata")
 void high_isr(void)
 {
   // High priority CAN interrupt
+  if (PIR3 & 0b00000011)
+    can_rxflag = 1; // Bus activity for can_quiet
+
   do
   {
     
+    // TX complete:
+    if (PIR3 & PIE3 & 0b00011100)
+      vehicle_cantx_isr();
+
     // Check RX buffer 0:
     if (RXB0CONbits.RXFUL)
     {
+      VEHICLE_ISRPROF_START();
       
       // Fast ID 0x155 processing:
       if ((RXB0CONbits.FILHIT0 == 0) &&
@@ -4536,6 +4537,9 @@ void high_isr(void)
 
       // Continue with normal processing:
 
+#ifdef OVMS_CAN_DEFERRED
+      vehicle_canring_push(0);
+#else // OVMS_CAN_DEFERRED
       can_id = ((unsigned int)RXB0SIDL >>5)
              + ((unsigned int)RXB0SIDH <<3);
       can_filter = RXB0CON & 0x01;
@@ -4552,11 +4556,19 @@ void high_isr(void)
       PIR3bits.RXB0IF = 0;   // reset interrupt flag
 
       vehicle_twizy_poll0();
+      VEHICLE_ISRPROF_STOP();
+      VEHICLE_POLL_COST();
+      VEHICLE_CANSTATS_RECORD(can_id, can_datalength, can_databuffer);
+#endif // OVMS_CAN_DEFERRED
     }
     
     // Check RX buffer 1:
     if (RXB1CONbits.RXFUL)
     {
+#ifdef OVMS_CAN_DEFERRED
+      vehicle_canring_push(1);
+#else // OVMS_CAN_DEFERRED
+      VEHICLE_ISRPROF_START();
       can_id = ((unsigned int)RXB1SIDL >>5)
              + ((unsigned int)RXB1SIDH <<3);
       can_filter = RXB1CON & 0x07;
@@ -4573,6 +4585,10 @@ void high_isr(void)
       PIR3bits.RXB1IF = 0;          // reset interrupt flag
       
       vehicle_twizy_poll1();
+      VEHICLE_ISRPROF_STOP();
+      VEHICLE_POLL_COST();
+      VEHICLE_CANSTATS_RECORD(can_id, can_datalength, can_databuffer);
+#endif // OVMS_CAN_DEFERRED
     }
 
   } while (PIR3bits.RXB0IF || PIR3bits.RXB1IF);
@@ -5272,13 +5288,11 @@ BOOL vehicle_twizy_poll1(void)
 
 void vehicle_twizy_req_notification(UINT8 notify)
 {
-  par_read(PARAM_NOTIFIES);
-  
-  if (strchr(par_value, 'S') &&
+  if ((par_notifies & PAR_NOTIFY_SMS) &&
           ((sys_features[FEATURE_CARBITS] & FEATURE_CB_SOUT_SMS)==0))
     twizy_notify_sms |= notify;
   
-  if (strchr(par_value, 'I'))
+  if (par_notifies & PAR_NOTIFY_IP)
     twizy_notify_msg |= notify;
 }
 
@@ -8905,12 +8919,15 @@ BOOL vehicle_twizy_initialise(void)
     CANCON = 0b01100000; // Listen only mode, Receive bufer 0
   }
 
+  // TXB1 & TXB2 are used by the charge control in high_isr():
+  vehicle_cantx_setbuffers(0x01);
+
   // Hook in...
 
   vehicle_version = vehicle_twizy_version;
   can_capabilities = vehicle_twizy_capabilities;
 
-#ifndef OVMS_CUSTOM_CAN_ISR
+#if !defined(OVMS_CUSTOM_CAN_ISR) || defined(OVMS_CAN_DEFERRED)
   vehicle_fn_poll0 = &vehicle_twizy_poll0;
   vehicle_fn_poll1 = &vehicle_twizy_poll1;
 #endif
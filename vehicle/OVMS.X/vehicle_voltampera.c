@@ -40,6 +40,7 @@ BOOL va_bus_is_active;           // Indicates recent activity on the bus
 unsigned char va_charge_timer;   // A per-second charge timer
 unsigned long va_charge_wm;      // A per-minute watt accumulator
 unsigned char va_candata_timer;  // A per-second timer for CAN bus data
+unsigned int va_poll_retry;      // Polls not sent: CAN TX queue full
 
 unsigned int va_obd_expect_id;   // ODBII expected ID
 unsigned int va_obd_expect_pid;  // OBDII expected PID
@@ -83,6 +84,7 @@ BOOL vehicle_voltampera_ticker1(void)
   {
   int k;
   BOOL doneone = FALSE;
+  unsigned char req[8];
 
   ////////////////////////////////////////////////////////////////////////
   // Stale tickers
@@ -193,26 +195,25 @@ BOOL vehicle_voltampera_ticker1(void)
   // Let's run through and see if we have to poll for any data..
   for (k=0;vehicle_voltampera_polls[k].moduleid != 0; k++)
     {
-    if ((can_granular_tick % vehicle_voltampera_polls[k].polltime) == 0)
+    if (((can_granular_tick % vehicle_voltampera_polls[k].polltime) == 0)||
+        (va_poll_retry & (1<<k)))
       {
       // OK. Let's send it...
       if (doneone)
         delay100b(); // Delay a little... (100ms, approx)
 
-      while (TXB0CONbits.TXREQ) {} // Loop until TX is done
-      TXB0CON = 0;
-      TXB0SIDL = (vehicle_voltampera_polls[k].moduleid & 0x07)<<5;
-      TXB0SIDH = (vehicle_voltampera_polls[k].moduleid>>3);
-      TXB0D0 = 0x03;
-      TXB0D1 = 0x22;        // Get extended PID
-      TXB0D2 = vehicle_voltampera_polls[k].pid >> 8;
-      TXB0D3 = vehicle_voltampera_polls[k].pid & 0xff;
-      TXB0D4 = 0x00;
-      TXB0D5 = 0x00;
-      TXB0D6 = 0x00;
-      TXB0D7 = 0x00;
-      TXB0DLC = 0b00001000; // data length (8)
-      TXB0CON = 0b00001000; // mark for transmission
+      req[0] = 0x03;
+      req[1] = 0x22;        // Get extended PID
+      req[2] = vehicle_voltampera_polls[k].pid >> 8;
+      req[3] = vehicle_voltampera_polls[k].pid & 0xff;
+      req[4] = 0x00;
+      req[5] = 0x00;
+      req[6] = 0x00;
+      req[7] = 0x00;
+      if (vehicle_cantx(vehicle_voltampera_polls[k].moduleid, VEHICLE_CANTX_NORMAL, 8, req))
+        va_poll_retry &= ~(1<<k);
+      else
+        va_poll_retry |= (1<<k); // Queue full, retry on the next tick
       doneone = TRUE;
       }
     }
@@ -389,6 +390,8 @@ BOOL vehicle_voltampera_poll1(void)
 
 BOOL vehicle_voltampera_fn_commandhandler(BOOL msgmode, int cmd, char *msg)
   {
+  unsigned char req[8];
+
   switch (cmd)
     {
     case 46:
@@ -404,21 +407,24 @@ BOOL vehicle_voltampera_fn_commandhandler(BOOL msgmode, int cmd, char *msg)
 
       delay100b(); // Delay a little... (100ms, approx)
 
-      while (TXB0CONbits.TXREQ) {} // Loop until TX is done
-      TXB0CON = 0;
-      TXB0SIDL = (va_obd_expect_id & 0x07)<<5;
-      TXB0SIDH = (va_obd_expect_id >>3);
+      req[0] = 0x03;
+      req[1] = 0x22;        // Get extended PID
+      req[2] = va_obd_expect_pid >> 8;
+      req[3] = va_obd_expect_pid & 0xff;
+      req[4] = 0x00;
+      req[5] = 0x00;
+      req[6] = 0x00;
+      req[7] = 0x00;
+      if (!vehicle_cantx(va_obd_expect_id, VEHICLE_CANTX_NORMAL, 8, req))
+        {
+        if (msgmode)
+          {
+          STP_CANTXFULL(net_scratchpad, cmd);
+          net_msg_encode_puts();
+          }
+        return TRUE;
+        }
       va_obd_expect_id += 8;   // Get ready for reply
-      TXB0D0 = 0x03;
-      TXB0D1 = 0x22;        // Get extended PID
-      TXB0D2 = va_obd_expect_pid >> 8;
-      TXB0D3 = va_obd_expect_pid & 0xff;
-      TXB0D4 = 0x00;
-      TXB0D5 = 0x00;
-      TXB0D6 = 0x00;
-      TXB0D7 = 0x00;
-      TXB0DLC = 0b00001000; // data length (8)
-      TXB0CON = 0b00001000; // mark for transmission
 
       return TRUE;
     }
@@ -449,6 +455,7 @@ BOOL vehicle_voltampera_initialise(void)
   va_charge_timer = 0;
   va_charge_wm = 0;
   va_candata_timer = 0;
+  va_poll_retry = 0;
   va_obd_expect_id = 0;
   va_obd_expect_pid = 0;
   va_obd_expect_waiting = FALSE;